@@ -27,6 +27,8 @@ public class ComputeShaderModule : ModuleRules
 			"Renderer",
 			"Projects",
 			"TextureCompressor",
+			"ImageCore",
+			"Json",
 		});
 
 		if (Target.bBuildEditor == true)
@@ -11,6 +11,10 @@
 #include "RenderTargetPool.h"
 #include "Runtime/Core/Public/Modules/ModuleManager.h"
 #include "Interfaces/IPluginManager.h"
+#include "RenderingThread.h"
+#include "WriteToRenderTarget/WriteToRenderTargetGroupSize.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPool.h"
+#include "WriteToRenderTarget/WriteToRenderTargetResultCache.h"
 
 #define LOCTEXT_NAMESPACE "FComputeShaderModule"
 
@@ -19,10 +23,23 @@ void FComputeShaderModule::StartupModule()
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
 	FString PluginShaderDir = FPaths::Combine(IPluginManager::Get().FindPlugin(TEXT("ShaderMod"))->GetBaseDir(), TEXT("Shaders/ComputeShaderModule/Private"));
 	AddShaderSourceDirectoryMapping(TEXT("/ComputeShaderModuleShaders"), PluginShaderDir);
+
+	// Group sizes measured in earlier sessions on this machine
+	FWriteToRenderTargetGroupSizeTuner::Get().LoadConfig();
 }
 
 void FComputeShaderModule::ShutdownModule()
 {
+	// Release the cached results and pooled textures while the render thread still runs, instead of in static destructors;
+	// the results hand their textures to the render thread when they are destroyed
+	FWriteToRenderTargetResultCache::Get().Empty();
+	FWriteToRenderTargetTexturePool::Get().Empty(true);
+	ENQUEUE_RENDER_COMMAND(WriteToRenderTargetShutdown)(
+		[](FRHICommandListImmediate& RHICmdList)
+		{
+			FWriteToRenderTargetRenderTargetPool::Get().Empty();
+		});
+	FlushRenderingCommands();
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -7,65 +7,340 @@
 #include "PixelShaderUtils.h"
 #include "GlobalShader.h"
 #include "ImageUtils.h"
+#include "ImageCore.h"
+#include "HAL/IConsoleManager.h"
+#include "WriteToRenderTarget/WriteToRenderTargetCPU.h"
+#include "WriteToRenderTarget/WriteToRenderTargetEffects.h"
+#include "WriteToRenderTarget/WriteToRenderTargetGroupSize.h"
+#include "WriteToRenderTarget/WriteToRenderTargetHistogram.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPermutation.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPool.h"
+#include "WriteToRenderTarget/WriteToRenderTargetResampler.h"
+#include "WriteToRenderTarget/WriteToRenderTargetResizeCache.h"
+#include "WriteToRenderTarget/WriteToRenderTargetResultCache.h"
+#include "WriteToRenderTarget/WriteToRenderTargetScheduler.h"
+#include "WriteToRenderTarget/WriteToRenderTargetShaders.h"
+#include "WriteToRenderTarget/WriteToRenderTargetSnapshot.h"
+#include "WriteToRenderTarget/WriteToRenderTargetStats.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTiled.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTrace.h"
 
-// Stat declarations for profiling and performance monitoring
-DECLARE_STATS_GROUP(TEXT("WriteToRenderTarget"), STATGROUP_WriteToRenderTarget, STATCAT_Advanced);
-DECLARE_CYCLE_STAT(TEXT("WriteToRenderTarget Execute"), STAT_WriteToRenderTarget_Execute, STATGROUP_WriteToRenderTarget);
+DEFINE_STAT(STAT_WriteToRenderTarget_Execute);
+DEFINE_STAT(STAT_WriteToRenderTarget_GraphSetup);
+DEFINE_STAT(STAT_WriteToRenderTarget_GraphExecute);
+DEFINE_STAT(STAT_WriteToRenderTarget_ExecuteCPU);
+DEFINE_STAT(STAT_WriteToRenderTarget_CPUMegapixelsPerCore);
+DEFINE_STAT(STAT_WriteToRenderTarget_DispatchesIssued);
+DEFINE_STAT(STAT_WriteToRenderTarget_DispatchesCoalesced);
+DEFINE_STAT(STAT_WriteToRenderTarget_DispatchesDropped);
+DEFINE_STAT(STAT_WriteToRenderTarget_DispatchesSkipped);
+DEFINE_STAT(STAT_WriteToRenderTarget_Resize);
+DEFINE_STAT(STAT_WriteToRenderTarget_ResizeMegabytes);
+DEFINE_STAT(STAT_WriteToRenderTarget_ResizeCacheHits);
+DEFINE_STAT(STAT_WriteToRenderTarget_ResizeCacheMisses);
+DEFINE_STAT(STAT_WriteToRenderTarget_ResizeCacheMemory);
+DEFINE_STAT(STAT_WriteToRenderTarget_TransientTextures);
+DEFINE_STAT(STAT_WriteToRenderTarget_OutputMegabytes);
+DEFINE_STAT(STAT_WriteToRenderTarget_UploadMegabytes);
+DEFINE_GPU_STAT(WriteToRenderTarget);
+DEFINE_STAT(STAT_WriteToRenderTarget_LeanPermutationDispatches);
 
-// This class represents the global shader used to write to a render target
-class FWriteToRenderTarget : public FGlobalShader
+// Number of RDG dispatches per effect permutation (FWriteToRenderTargetPermutation::GetIndex), written on the render thread
+static std::atomic<uint64> GWriteToRenderTargetPermutationDispatches[FWriteToRenderTargetPermutation::NumPermutations];
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetBackend(
+    TEXT("r.ShaderMod.Backend"),
+    0,
+    TEXT("Backend used by UWriteToRenderTarget instances set to Auto.\n")
+    TEXT(" 0: Auto, RDG compute when a GPU is available, CPU under NullRHI (default)\n")
+    TEXT(" 1: RDG compute shader\n")
+    TEXT(" 2: CPU reference kernel"),
+    ECVF_Default);
+
+// Implementation of the global shader              // Shader file path                // Entry point function name  // Shader function (Compute)
+IMPLEMENT_GLOBAL_SHADER(FWriteToRenderTarget, "/ComputeShaderModuleShaders/WriteToRenderTarget/WriteToRenderTarget.usf", "Main", SF_Compute);
+
+FWriteToRenderTargetOutputTarget FWriteToRenderTargetOutputTarget::Select(EPixelFormat Format, ETextureCreateFlags Flags)
 {
-public:
-    DECLARE_GLOBAL_SHADER(FWriteToRenderTarget);
-    SHADER_USE_PARAMETER_STRUCT(FWriteToRenderTarget, FGlobalShader);
+    FWriteToRenderTargetOutputTarget OutputTarget;
+    switch (Format)
+    {
+    case PF_B8G8R8A8:
+    case PF_R8G8B8A8:
+        OutputTarget.Format = EWriteToRenderTargetOutputFormat::RGBA8;
+        break;
+    case PF_FloatRGBA:
+        OutputTarget.Format = EWriteToRenderTargetOutputFormat::RGBA16F;
+        break;
+    case PF_A32B32G32R32F:
+        OutputTarget.Format = EWriteToRenderTargetOutputFormat::RGBA32F;
+        break;
+    case PF_G8:
+    case PF_R8:
+        OutputTarget.Format = EWriteToRenderTargetOutputFormat::R8;
+        break;
+    default:
+        return OutputTarget;
+    }
 
-    // Define a permutation domain for shader configuration
-    class FWriteToRenderTarget_Perm_TEST : SHADER_PERMUTATION_INT("TEST", 1);
-    using FPermutationDomain = TShaderPermutationDomain<FWriteToRenderTarget_Perm_TEST>;
+    // Typed UAV stores are not guaranteed for every format (B8G8R8A8 in particular), so check the device capability
+    const bool bTypedStore = UE::PixelFormat::HasCapabilities(Format, EPixelFormatCapabilities::TypedUAVStore);
+    if (!bTypedStore)
+    {
+        OutputTarget.Format = EWriteToRenderTargetOutputFormat::Unsupported;
+        return OutputTarget;
+    }
+    OutputTarget.bDirectWrite = EnumHasAnyFlags(Flags, TexCreate_UAV);
+    return OutputTarget;
+}
 
-    BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
-        SHADER_PARAMETER_TEXTURE(Texture2D, InputTexture) // The input texture to be processed
-        SHADER_PARAMETER_SAMPLER(SamplerState, InputSampler) // Sampler state for the input texture
-        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, RenderTarget) // The render target to output the processed texture
-        // Color change
-        SHADER_PARAMETER(uint32, bInvertColors) // Boolean parameter for inverting colors
-        SHADER_PARAMETER(uint32, bGreyscale) // Boolean parameter for applying grayscale
-        SHADER_PARAMETER(float, Contrast) // Float parameter for contrast adjustment
-        // Deformation
-        SHADER_PARAMETER(float, DistortionStrength) // Float parameter for distortion strength
-        SHADER_PARAMETER(float, ImageScale) // Float parameter for image scaling
-        SHADER_PARAMETER(float, RotationAngle) // Float parameter for image rotation
-    END_SHADER_PARAMETER_STRUCT()
+int32 FWriteToRenderTargetOutputTarget::GetShaderOutputFormat() const
+{
+    switch (Format)
+    {
+    case EWriteToRenderTargetOutputFormat::RGBA16F:
+    case EWriteToRenderTargetOutputFormat::RGBA32F:
+        return 1;
+    case EWriteToRenderTargetOutputFormat::R8:
+        return 2;
+    default:
+        return 0;
+    }
+}
 
-    // This function determines whether the shader permutation should be compiled
-    static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+namespace WriteToRenderTargetRDG
+{
+    FWriteToRenderTarget::FParameters* AllocPassParameters(
+        FRDGBuilder& GraphBuilder,
+        FRHITexture* InputTextureRHI,
+        FRDGTextureRef OutputTexture,
+        FIntPoint Extent,
+        const FWriteToRenderTargetFusedEffects& Effects,
+        bool bResampleInKernel)
     {
-        return true;
+        const FIntPoint InputSize = InputTextureRHI->GetDesc().Extent;
+        const bool bFilteredInput = bResampleInKernel && InputSize != Extent;
+
+        FWriteToRenderTarget::FParameters* PassParameters = GraphBuilder.AllocParameters<FWriteToRenderTarget::FParameters>();
+        PassParameters->InputTexture = InputTextureRHI;
+        PassParameters->InputSampler = bFilteredInput
+            ? TStaticSamplerState<SF_Trilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI()
+            : TStaticSamplerState<SF_Point>::GetRHI();
+        // The mip level only depends on the size ratio and the folded scale, so it is picked once per dispatch
+        const FVector2f ResolutionRatio((float)InputSize.X / Extent.X, (float)InputSize.Y / Extent.Y);
+        PassParameters->InputMipLevel = bFilteredInput ? FWriteToRenderTargetCPU::ComputeInputLod(ResolutionRatio, Effects.GetImageScale()) : 0.0f;
+        FWriteToRenderTarget::SetEffectParameters(*PassParameters, Effects);
+        PassParameters->RenderTarget = GraphBuilder.CreateUAV(OutputTexture);
+        // The whole output in one dispatch: UVs span the bound texture, threads past it or past Extent are rejected
+        const FIntPoint OutputSize = OutputTexture->Desc.Extent;
+        FWriteToRenderTarget::SetTileParameters(*PassParameters, OutputSize, FIntRect(FIntPoint::ZeroValue, Extent.ComponentMin(OutputSize)), FIntPoint::ZeroValue);
+        return PassParameters;
     }
 
-    // This function modifies the shader compilation environment by setting constants and configurations
-    static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+    void AddExecutePass(
+        FRDGBuilder& GraphBuilder,
+        const TShaderRef<FWriteToRenderTarget>& ComputeShader,
+        FRHITexture* InputTextureRHI,
+        FRDGTextureRef TargetTexture,
+        const FWriteToRenderTargetOutputTarget& OutputTarget,
+        const FWriteToRenderTargetPermutation& Permutation,
+        EWriteToRenderTargetGroupSize GroupSize,
+        FIntPoint Extent,
+        const FWriteToRenderTargetFusedEffects& Effects,
+        bool bResampleInKernel,
+        int32 TileSize)
     {
-        FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
-        OutEnvironment.SetDefine(TEXT("THREADS_X"), NUM_THREADS_WriteToRenderTarget_X);
-        OutEnvironment.SetDefine(TEXT("THREADS_Y"), NUM_THREADS_WriteToRenderTarget_Y);
-        OutEnvironment.SetDefine(TEXT("THREADS_Z"), NUM_THREADS_WriteToRenderTarget_Z);
+        // Pixels covered by the dispatch; the UVs always span the whole render target
+        const FIntPoint TargetSize = TargetTexture->Desc.Extent;
+        const FIntPoint Covered = Extent.ComponentMin(TargetSize);
+        const bool bTiled = TileSize > 0 && (Covered.X > TileSize || Covered.Y > TileSize);
+        const FIntPoint TileExtent = bTiled ? FIntPoint(FMath::Min(TileSize, Covered.X), FMath::Min(TileSize, Covered.Y)) : Covered;
+
+        // Write straight into the render target when it exposes a UAV, otherwise into one scratch texture of the same format,
+        // only one tile large when tiled. Scratch textures are pooled, so same-sized dispatches keep reusing the same one.
+        FRDGTextureRef OutputTexture = TargetTexture;
+        if (!OutputTarget.bDirectWrite)
+        {
+            FRDGTextureDesc Desc = FRDGTextureDesc::Create2D(
+                bTiled ? TileExtent : TargetSize,
+                TargetTexture->Desc.Format,
+                FClearValueBinding::White,
+                TexCreate_ShaderResource | TexCreate_UAV
+            );
+            OutputTexture = FWriteToRenderTargetRenderTargetPool::Get().CreateTexture(GraphBuilder, Desc, TEXT("WriteToRenderTarget_TempTexture"));
+        }
+
+        // One pass per tile, row by row. The passes all write the same texture, so RDG keeps them in order
+        // and a scratch tile is copied out before the next tile overwrites it
+        int32 NumTiles = 0;
+        for (int32 TileY = 0; TileY < Covered.Y; TileY += TileExtent.Y)
+        {
+            for (int32 TileX = 0; TileX < Covered.X; TileX += TileExtent.X)
+            {
+                const FIntRect Tile(TileX, TileY, FMath::Min(TileX + TileExtent.X, Covered.X), FMath::Min(TileY + TileExtent.Y, Covered.Y));
+                ++NumTiles;
+
+                FWriteToRenderTarget::FParameters* PassParameters = AllocPassParameters(GraphBuilder, InputTextureRHI, OutputTexture, Extent, Effects, bResampleInKernel);
+                if (bTiled)
+                {
+                    FWriteToRenderTarget::SetTileParameters(*PassParameters, TargetSize, Tile, OutputTarget.bDirectWrite ? Tile.Min : FIntPoint::ZeroValue);
+                }
+
+                // One thread per pixel, the kernel rejects the threads of partial edge groups
+                const FIntVector GroupCount = FWriteToRenderTargetGroupSize::GetGroupCount(bTiled ? Tile.Size() : Extent, GroupSize);
+
+                GraphBuilder.AddPass(
+                    RDG_EVENT_NAME("ExecuteWriteToRenderTarget %s %dx%d %s", *Permutation.ToString(), Tile.Width(), Tile.Height(), *FWriteToRenderTargetGroupSize::ToString(GroupSize)),
+                    PassParameters,
+                    ERDGPassFlags::AsyncCompute,
+                    [PassParameters, ComputeShader, GroupCount](FRHIComputeCommandList& RHICmdList)
+                    {
+                        FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, *PassParameters, GroupCount);
+                    }
+                );
+
+                if (!OutputTarget.bDirectWrite && bTiled)
+                {
+                    FRHICopyTextureInfo CopyInfo;
+                    CopyInfo.Size = FIntVector(Tile.Width(), Tile.Height(), 1);
+                    CopyInfo.DestPosition = FIntVector(Tile.Min.X, Tile.Min.Y, 0);
+                    AddCopyTexturePass(GraphBuilder, OutputTexture, TargetTexture, CopyInfo);
+                }
+            }
+        }
+
+        if (!OutputTarget.bDirectWrite && !bTiled)
+        {
+            AddCopyTexturePass(GraphBuilder, OutputTexture, TargetTexture, FRHICopyTextureInfo());
+        }
+
+        // Per dispatch output traffic: one write, plus a read and a second write for the fallback copy
+        const int64 OutputBytes = (int64)TargetSize.X * TargetSize.Y * GPixelFormats[TargetTexture->Desc.Format].BlockBytes;
+        const int64 BytesWritten = OutputTarget.bDirectWrite ? OutputBytes : OutputBytes * 3;
+        GWriteToRenderTargetPermutationDispatches[Permutation.GetIndex()]++;
+        INC_DWORD_STAT_BY(STAT_WriteToRenderTarget_LeanPermutationDispatches, Permutation.IsLean() ? 1 : 0);
+        INC_DWORD_STAT_BY(STAT_WriteToRenderTarget_TransientTextures, OutputTarget.bDirectWrite ? 0 : 1);
+        INC_FLOAT_STAT_BY(STAT_WriteToRenderTarget_OutputMegabytes, (float)(BytesWritten / (1024.0 * 1024.0)));
+        UE_LOG(LogTemp, Verbose, TEXT("AddExecutePass - %s write, %d tiles, %d transient textures, %.2f MB output traffic"),
+            OutputTarget.bDirectWrite ? TEXT("direct") : TEXT("copy"), NumTiles, OutputTarget.bDirectWrite ? 0 : 1, BytesWritten / (1024.0 * 1024.0));
     }
-};
 
-// Implementation of the global shader              // Shader file path                // Entry point function name  // Shader function (Compute)
-IMPLEMENT_GLOBAL_SHADER(FWriteToRenderTarget, "/ComputeShaderModuleShaders/WriteToRenderTarget/WriteToRenderTarget.usf", "Main", SF_Compute);
+    /*
+     * Times every group size on the real input and effect permutation.
+     * Each candidate is dispatched once to warm up, then Iterations times between two timestamp queries into a scratch
+     * texture of the target's format. Reading the queries flushes the GPU, so this costs one hitch per new resolution and GPU.
+     */
+    EWriteToRenderTargetGroupSize AutotuneGroupSize(
+        FRHICommandListImmediate& RHICmdList,
+        FRHITexture* InputTextureRHI,
+        EPixelFormat TargetFormat,
+        FIntPoint Extent,
+        const FWriteToRenderTargetOutputTarget& OutputTarget,
+        const FWriteToRenderTargetPermutation& Permutation,
+        const FWriteToRenderTargetFusedEffects& Effects,
+        bool bResampleInKernel)
+    {
+        if (!GSupportsTimestampRenderQueries)
+        {
+            return FWriteToRenderTargetGroupSize::Default;
+        }
+
+        constexpr int32 NumCandidates = (int32)EWriteToRenderTargetGroupSize::Num;
+        const int32 Iterations = FWriteToRenderTargetGroupSizeTuner::GetIterations();
+        FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+
+        auto AddCandidatePasses = [&](FRDGBuilder& GraphBuilder, EWriteToRenderTargetGroupSize GroupSize, int32 NumPasses)
+        {
+            TShaderMapRef<FWriteToRenderTarget> ComputeShader(ShaderMap, FWriteToRenderTarget::GetPermutationVector(OutputTarget, Permutation, GroupSize));
+            const FRDGTextureDesc Desc = FRDGTextureDesc::Create2D(Extent, TargetFormat, FClearValueBinding::None, TexCreate_ShaderResource | TexCreate_UAV);
+            FRDGTextureRef OutputTexture = GraphBuilder.CreateTexture(Desc, TEXT("WriteToRenderTarget_AutotuneTexture"));
+            const FIntVector GroupCount = FWriteToRenderTargetGroupSize::GetGroupCount(Extent, GroupSize);
+
+            for (int32 Pass = 0; Pass < NumPasses; ++Pass)
+            {
+                FComputeShaderUtils::AddPass(
+                    GraphBuilder,
+                    RDG_EVENT_NAME("AutotuneWriteToRenderTarget %s", *FWriteToRenderTargetGroupSize::ToString(GroupSize)),
+                    ERDGPassFlags::Compute | ERDGPassFlags::NeverCull,
+                    ComputeShader,
+                    AllocPassParameters(GraphBuilder, InputTextureRHI, OutputTexture, Extent, Effects, bResampleInKernel),
+                    GroupCount);
+            }
+        };
+
+        // Warm up: first use of each permutation may create its pipeline state
+        {
+            FRDGBuilder GraphBuilder(RHICmdList);
+            for (int32 Candidate = 0; Candidate < NumCandidates; ++Candidate)
+            {
+                AddCandidatePasses(GraphBuilder, (EWriteToRenderTargetGroupSize)Candidate, 1);
+            }
+            GraphBuilder.Execute();
+        }
+
+        TArray<FRenderQueryRHIRef> StartQueries;
+        TArray<FRenderQueryRHIRef> EndQueries;
+        for (int32 Candidate = 0; Candidate < NumCandidates; ++Candidate)
+        {
+            StartQueries.Add(RHICreateRenderQuery(RQT_AbsoluteTime));
+            EndQueries.Add(RHICreateRenderQuery(RQT_AbsoluteTime));
+
+            RHICmdList.EndRenderQuery(StartQueries[Candidate]);
+            {
+                FRDGBuilder GraphBuilder(RHICmdList);
+                AddCandidatePasses(GraphBuilder, (EWriteToRenderTargetGroupSize)Candidate, Iterations);
+                GraphBuilder.Execute();
+            }
+            RHICmdList.EndRenderQuery(EndQueries[Candidate]);
+        }
+        RHICmdList.SubmitCommandsAndFlushGPU();
+
+        EWriteToRenderTargetGroupSize Best = FWriteToRenderTargetGroupSize::Default;
+        uint64 BestMicroseconds = MAX_uint64;
+        for (int32 Candidate = 0; Candidate < NumCandidates; ++Candidate)
+        {
+            uint64 StartMicroseconds = 0;
+            uint64 EndMicroseconds = 0;
+            if (!RHIGetRenderQueryResult(StartQueries[Candidate], StartMicroseconds, true) || !RHIGetRenderQueryResult(EndQueries[Candidate], EndMicroseconds, true))
+            {
+                continue;
+            }
+
+            const uint64 Microseconds = EndMicroseconds - StartMicroseconds;
+            UE_LOG(LogTemp, Verbose, TEXT("AutotuneGroupSize - %dx%d %s: %.1f us per dispatch"),
+                Extent.X, Extent.Y, *FWriteToRenderTargetGroupSize::ToString((EWriteToRenderTargetGroupSize)Candidate), (double)Microseconds / Iterations);
+            if (Microseconds < BestMicroseconds)
+            {
+                BestMicroseconds = Microseconds;
+                Best = (EWriteToRenderTargetGroupSize)Candidate;
+            }
+        }
+
+        UE_LOG(LogTemp, Display, TEXT("AutotuneGroupSize - %s picked %s for %dx%d"), *GRHIAdapterName, *FWriteToRenderTargetGroupSize::ToString(Best), Extent.X, Extent.Y);
+        return Best;
+    }
+}
 
 /*
  * Initializes the resources necessary during shader execution.
  */
-void UWriteToRenderTarget::Initialize(FRHICommandListImmediate& RHICmdList, UTexture2D* InputTexture, FWriteToRenderTargetDispatchParams Params)
+void UWriteToRenderTarget::Initialize(UTexture2D* InputTexture, FWriteToRenderTargetDispatchParams Params)
 {
     if (InputTexture && Params.RenderTarget)
     {
-        StoredRHICmdList = &RHICmdList;
+        // A resized input that the resize cache evicts stays out of the texture pool while this processor may dispatch it
+        if (InputTexture != StoredInputTexture)
+        {
+            FWriteToRenderTargetTexturePool::Get().AddInputUser(InputTexture);
+            FWriteToRenderTargetTexturePool::Get().RemoveInputUser(StoredInputTexture);
+        }
         StoredInputTexture = InputTexture;
         StoredParams = Params;
+        if (!RenderState)
+        {
+            RenderState = MakeShared<FWriteToRenderTargetRenderState, ESPMode::ThreadSafe>();
+        }
     }
     else
     {
@@ -76,37 +351,225 @@ void UWriteToRenderTarget::Initialize(FRHICommandListImmediate& RHICmdList, UTex
 void UWriteToRenderTarget::SetInvertColors(bool bInvert)
 {
     bInvertColors = bInvert ? 1 : 0;
-    EnqueueShaderExecution();
+    RequestDispatch();
 }
 
 void UWriteToRenderTarget::SetGreyscale(bool bGrey)
 {
     bGreyscale = bGrey ? 1 : 0;
-    EnqueueShaderExecution();
+    RequestDispatch();
 }
 
 void UWriteToRenderTarget::SetContrast(float InContrast)
 {
     Contrast = InContrast;
-    EnqueueShaderExecution();
+    RequestDispatch();
+}
+
+void UWriteToRenderTarget::SetAutoContrast(EWriteToRenderTargetAutoContrast InAutoContrast, float InClipPercent)
+{
+    AutoContrast = InAutoContrast;
+    AutoContrastClipPercent = InClipPercent;
+    RequestDispatch();
 }
 
 void UWriteToRenderTarget::SetDistortionStrength(float InDistortionStrength)
 {
     DistortionStrength = InDistortionStrength;
-    EnqueueShaderExecution();
+    RequestDispatch();
 }
 
 void UWriteToRenderTarget::SetImageScale(float InImageScale)
 {
     ImageScale = InImageScale;
-    EnqueueShaderExecution();
+    RequestDispatch();
 }
 
 void UWriteToRenderTarget::SetRotationAngle(float InAngle)
 {
     RotationAngle = InAngle;
-    EnqueueShaderExecution();
+    RequestDispatch();
+}
+
+void UWriteToRenderTarget::SetResampleInKernel(bool bInKernel)
+{
+    bResampleInKernel = bInKernel;
+    RequestDispatch();
+}
+
+void UWriteToRenderTarget::SetGenerateMips(bool bInGenerateMips)
+{
+    bGenerateMips = bInGenerateMips;
+    RequestDispatch();
+}
+
+void UWriteToRenderTarget::SetEffectStack(const TArray<FWriteToRenderTargetEffect>& InEffectStack)
+{
+    EffectStack = InEffectStack;
+    RequestDispatch();
+}
+
+void UWriteToRenderTarget::SetEffectParams(const FWriteToRenderTargetEffectParams& InEffectParams)
+{
+    bInvertColors = InEffectParams.bInvertColors ? 1 : 0;
+    bGreyscale = InEffectParams.bGreyscale ? 1 : 0;
+    Contrast = InEffectParams.Contrast;
+    AutoContrast = InEffectParams.AutoContrast;
+    AutoContrastClipPercent = InEffectParams.AutoContrastClipPercent;
+    DistortionStrength = InEffectParams.DistortionStrength;
+    ImageScale = InEffectParams.ImageScale;
+    RotationAngle = InEffectParams.RotationAngle;
+    bResampleInKernel = InEffectParams.bResampleInKernel;
+    bGenerateMips = InEffectParams.bGenerateMips;
+    EffectStack = InEffectParams.EffectStack;
+    RequestDispatch();
+}
+
+void UWriteToRenderTarget::SetBackend(EWriteToRenderTargetBackend InBackend)
+{
+    Backend = InBackend;
+    RequestDispatch();
+}
+
+void UWriteToRenderTarget::SetPriority(EWriteToRenderTargetPriority InPriority)
+{
+    Priority = InPriority;
+    if (bDispatchPending && ScheduledJobId != 0)
+    {
+        ScheduleDispatch();
+    }
+}
+
+void UWriteToRenderTarget::SetPreviewScale(float Scale)
+{
+    const float NewPreviewScale = FMath::Clamp(Scale, 0.01f, 1.0f);
+    if (NewPreviewScale != PreviewScale)
+    {
+        PreviewScale = NewPreviewScale;
+        RequestDispatch();
+    }
+}
+
+void UWriteToRenderTarget::SavePreset(FName Name)
+{
+    FWriteToRenderTargetResultCache::Get().SavePreset(Name, GetEffectParams());
+}
+
+bool UWriteToRenderTarget::ApplyPreset(FName Name)
+{
+    FWriteToRenderTargetEffectParams PresetParams;
+    if (!FWriteToRenderTargetResultCache::Get().FindPreset(Name, PresetParams))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("ApplyPreset - No preset named %s."), *Name.ToString());
+        return false;
+    }
+    SetEffectParams(PresetParams);
+    return true;
+}
+
+EWriteToRenderTargetBackend UWriteToRenderTarget::ResolveBackend() const
+{
+    if (Backend != EWriteToRenderTargetBackend::Auto)
+    {
+        return Backend;
+    }
+
+    switch (CVarWriteToRenderTargetBackend.GetValueOnAnyThread())
+    {
+    case 1:
+        return EWriteToRenderTargetBackend::RDG;
+    case 2:
+        return EWriteToRenderTargetBackend::CPU;
+    default:
+        return GUsingNullRHI ? EWriteToRenderTargetBackend::CPU : EWriteToRenderTargetBackend::RDG;
+    }
+}
+
+FWriteToRenderTargetEffectParams UWriteToRenderTarget::GetEffectParams() const
+{
+    FWriteToRenderTargetEffectParams EffectParams;
+    EffectParams.bInvertColors = bInvertColors != 0;
+    EffectParams.bGreyscale = bGreyscale != 0;
+    EffectParams.Contrast = Contrast;
+    EffectParams.AutoContrast = AutoContrast;
+    EffectParams.AutoContrastClipPercent = AutoContrastClipPercent;
+    EffectParams.DistortionStrength = DistortionStrength;
+    EffectParams.ImageScale = ImageScale;
+    EffectParams.RotationAngle = RotationAngle;
+    EffectParams.bResampleInKernel = bResampleInKernel;
+    EffectParams.bGenerateMips = bGenerateMips;
+    EffectParams.EffectStack = EffectStack;
+    return EffectParams;
+}
+
+FWriteToRenderTargetEffectParams UWriteToRenderTarget::GetDispatchEffectParams(UTexture2D* InputTexture, FIntPoint TargetSize)
+{
+    FWriteToRenderTargetEffectParams EffectParams = GetEffectParams();
+    // Only the RDG fallback of PrepareInput hands over an unresized input without bResampleInKernel; the CPU backend keeps its setting
+    if (InputTexture && ResolveBackend() == EWriteToRenderTargetBackend::RDG
+        && (InputTexture->GetSizeX() != TargetSize.X || InputTexture->GetSizeY() != TargetSize.Y))
+    {
+        EffectParams.bResampleInKernel = true;
+    }
+    if (IsInGameThread() && FWriteToRenderTargetLuminanceHistogram::IsNeededBy(EffectParams))
+    {
+        FWriteToRenderTargetLuminanceHistogram Histogram;
+        if (FWriteToRenderTargetHistogramCache::Get().FindOrCompute(InputTexture, this, Histogram))
+        {
+            Histogram.Resolve(EffectParams);
+        }
+    }
+    return EffectParams;
+}
+
+/*
+ * Returns the texture the kernel should read for InputTexture: the input itself when it matches the target size
+ * or is resampled in the kernel, otherwise a resized copy. Resized copies are cached, so repeated executions on the
+ * same input skip the resize and the upload.
+ */
+UTexture2D* UWriteToRenderTarget::PrepareInput(UTexture2D* InputTexture, FIntPoint TargetSize, bool bInKernel)
+{
+    if (!InputTexture)
+    {
+        return nullptr;
+    }
+
+    if (bInKernel || (InputTexture->GetSizeX() == TargetSize.X && InputTexture->GetSizeY() == TargetSize.Y))
+    {
+        // The kernel samples a mismatched input at the mip its footprint selects, which a streamed input may not have resident yet
+        if (bInKernel && InputTexture->IsStreamable())
+        {
+            const int32 NumMips = InputTexture->GetNumMips();
+            const FIntPoint MinSize = FWriteToRenderTargetRowReader::GetMinInputSize(TargetSize, FWriteToRenderTargetFusedEffects::Fold(GetEffectParams()).GetImageScale());
+            const int32 NumMipsNeeded = NumMips - FWriteToRenderTargetRowReader::SelectMip(FIntPoint(InputTexture->GetSizeX(), InputTexture->GetSizeY()), NumMips, MinSize);
+            if (InputTexture->GetNumResidentMips() < NumMipsNeeded)
+            {
+                InputTexture->StreamIn(NumMipsNeeded, true);
+            }
+        }
+        return InputTexture;
+    }
+
+    FWriteToRenderTargetResizeCache& ResizeCache = FWriteToRenderTargetResizeCache::Get();
+    UTexture2D* ResizedTexture = ResizeCache.Find(InputTexture, TargetSize, ResampleFilter);
+    if (!ResizedTexture)
+    {
+        ResizedTexture = ResizeTexture(InputTexture, TargetSize.X, TargetSize.Y);
+        if (!ResizedTexture)
+        {
+            // Block compressed inputs of cooked builds have no CPU readable pixels, but the GPU can still sample them
+            if (ResolveBackend() == EWriteToRenderTargetBackend::RDG)
+            {
+                UE_LOG(LogTemp, Warning, TEXT("Failed to resize %s on the CPU, resampling it in the kernel instead. Set bResampleInKernel for block compressed inputs in cooked builds."),
+                    *InputTexture->GetName());
+                return PrepareInput(InputTexture, TargetSize, true);
+            }
+            UE_LOG(LogTemp, Error, TEXT("Failed to resize texture."));
+            return nullptr;
+        }
+        ResizeCache.Add(InputTexture, TargetSize, ResampleFilter, ResizedTexture);
+    }
+    return ResizedTexture;
 }
 
 UTexture2D* UWriteToRenderTarget::ResizeTexture(UTexture2D* SourceTexture, int32 TargetWidth, int32 TargetHeight)
@@ -116,23 +579,22 @@ UTexture2D* UWriteToRenderTarget::ResizeTexture(UTexture2D* SourceTexture, int32
         UE_LOG(LogTemp, Error, TEXT("Invalid SourceTexture."));
         return nullptr;
     }
+
+    SCOPE_CYCLE_COUNTER(STAT_WriteToRenderTarget_Resize);
+    WRITETORENDERTARGET_TRACE_SCOPE(WriteToRenderTarget_Resize);
     
-    FImage SourceImage;
-    if (!FImageUtils::GetTexture2DSourceImage(SourceTexture, SourceImage))
+    // Source rows are converted as the resampler's bands need them, the source is never copied as a whole.
+    // Only the smallest mip that still covers the target is read, so large inputs skip their top mips.
+    FWriteToRenderTargetRowReader SourceReader;
+    if (!SourceReader.Open(SourceTexture, FIntPoint(TargetWidth, TargetHeight)))
     {
-        UE_LOG(LogTemp, Error, TEXT("Failed to convert SourceTexture to FImage."));
+        UE_LOG(LogTemp, Error, TEXT("Failed to read the pixels of SourceTexture."));
         return nullptr;
     }
+    const FIntPoint SourceSize = SourceReader.GetSize();
 
-    // Prepare the destination array for resized image data
-    TArray<FColor> ResizedColors;
-    ResizedColors.SetNumUninitialized(TargetWidth * TargetHeight);
-
-    // Resize the image using FImageUtils::ImageResize
-    FImageUtils::ImageResize(SourceImage.SizeX, SourceImage.SizeY, SourceImage.AsBGRA8(), TargetWidth, TargetHeight, ResizedColors, true, true);
-
-    // Create a new transient texture to hold the resized image
-    UTexture2D* ResizedTexture = UTexture2D::CreateTransient(TargetWidth, TargetHeight, PF_B8G8R8A8);
+    // Transient texture to hold the resized image, recycled from a previously released one of the same size when possible
+    UTexture2D* ResizedTexture = FWriteToRenderTargetTexturePool::Get().Acquire(FIntPoint(TargetWidth, TargetHeight), PF_B8G8R8A8);
     if (!ResizedTexture)
     {
         UE_LOG(LogTemp, Error, TEXT("Failed to create ResizedTexture."));
@@ -147,39 +609,266 @@ UTexture2D* UWriteToRenderTarget::ResizeTexture(UTexture2D* SourceTexture, int32
         return nullptr;
     }
 
-    // Copy the resized pixel data into the new texture
-    FMemory::Memcpy(TextureData, ResizedColors.GetData(), ResizedColors.Num() * sizeof(FColor));
+    // Resample on all cores directly into the locked mip
+    FWriteToRenderTargetResampler::Resample(
+        [&SourceReader](int32 X, int32 Y, int32 Width, FColor* Dest) { SourceReader.ReadRow(X, Y, Width, Dest); },
+        SourceSize.X, SourceSize.Y,
+        static_cast<FColor*>(TextureData), TargetWidth, TargetHeight,
+        ResampleFilter);
+    SourceReader.Close();
 
     // Unlock and update the texture resource
     ResizedTexture->GetPlatformData()->Mips[0].BulkData.Unlock();
     ResizedTexture->UpdateResource();
 
+    // A recycled texture keeps its revision, so a histogram or a processed result of its previous content must not be found again
+    FWriteToRenderTargetHistogramCache::Get().Invalidate(ResizedTexture);
+    FWriteToRenderTargetResultCache::Get().Invalidate(ResizedTexture);
+
+    // Bytes read and written by the resample; the resized mip is then uploaded once
+    const int64 ResizedBytes = (int64)TargetWidth * TargetHeight * sizeof(FColor);
+    INC_FLOAT_STAT_BY(STAT_WriteToRenderTarget_ResizeMegabytes, (float)(((int64)SourceSize.X * SourceSize.Y * sizeof(FColor) + ResizedBytes) / (1024.0 * 1024.0)));
+    INC_FLOAT_STAT_BY(STAT_WriteToRenderTarget_UploadMegabytes, (float)(ResizedBytes / (1024.0 * 1024.0)));
+
     return ResizedTexture;
 }
 
+// Bytes of a cached copy of the render target's mip 0; the format of its texture is fixed once it was created
+static int64 GetCachedResultBytes(const FRenderTarget* RenderTarget, FIntPoint Size)
+{
+    const FRHITexture* Texture = RenderTarget->GetRenderTargetTexture().GetReference();
+    const EPixelFormat Format = Texture ? Texture->GetFormat() : PF_B8G8R8A8;
+    return (int64)Size.X * Size.Y * GPixelFormats[Format].BlockBytes;
+}
+
 /*
  * Enqueues the shader execution command on the render thread. This function checks if the necessary resources
- * are available and then enqueues the shader to be executed using the stored parameters.
+ * are available, publishes an immutable snapshot of the current parameters and enqueues a command that renders the
+ * newest snapshot when it runs. A command that finds the newest snapshot already rendered by an earlier one is dropped,
+ * since that dispatch rewrote the whole render target with later parameters anyway.
+ * Parameters the render target was already processed with are answered from FWriteToRenderTargetResultCache.
  */
 void UWriteToRenderTarget::EnqueueShaderExecution()
 {
-    if (StoredRHICmdList && StoredInputTexture && StoredParams.RenderTarget)
+    bDispatchPending = false;
+    if (ScheduledJobId != 0)
+    {
+        // Issued ahead of the scheduler (FlushPendingDispatch), the queued job has nothing left to do
+        FWriteToRenderTargetScheduler::Get().Cancel(ScheduledJobId);
+        ScheduledJobId = 0;
+    }
+
+    FWriteToRenderTargetDispatchParams DispatchParams = StoredParams;
+    DispatchParams.PreviewScale = PreviewScale;
+
+    if (StoredInputTexture && StoredParams.RenderTarget && ResolveBackend() == EWriteToRenderTargetBackend::CPU)
+    {
+        ++DispatchesIssued;
+        INC_DWORD_STAT(STAT_WriteToRenderTarget_DispatchesIssued);
+        DispatchCPU(StoredInputTexture, DispatchParams);
+    }
+    else if (StoredInputTexture && StoredParams.RenderTarget)
     {
+        ++DispatchesIssued;
+        INC_DWORD_STAT(STAT_WriteToRenderTarget_DispatchesIssued);
+
+        // A hit copies the earlier result into the render target. A full resolution miss adds an entry that the render
+        // command fills behind the dispatch; previews only read the cache.
+        const FWriteToRenderTargetEffectParams EffectParams = GetDispatchEffectParams(StoredInputTexture, FIntPoint(StoredParams.X, StoredParams.Y));
+        const FIntPoint TargetSize(StoredParams.X, StoredParams.Y);
+        FWriteToRenderTargetResultCache& ResultCache = FWriteToRenderTargetResultCache::Get();
+        const FWriteToRenderTargetResultKey ResultKey = FWriteToRenderTargetResultCache::MakeKey(StoredInputTexture, StoredParams.RenderTargetObject, TargetSize, EWriteToRenderTargetBackend::RDG, EffectParams);
+        FWriteToRenderTargetCachedResultPtr CachedResult = ResultCache.Find(ResultKey, EffectParams);
+        if (!CachedResult && !DispatchParams.IsPreview())
+        {
+            CachedResult = ResultCache.Add(ResultKey, EffectParams, GetEffectParams(), GetCachedResultBytes(StoredParams.RenderTarget, TargetSize));
+        }
+
+        // The render command only holds the render state, never this instance or its parameter fields
+        FWriteToRenderTargetDispatchSnapshot Snapshot;
+        Snapshot.Serial = ++LatestDispatchSerial;
+        Snapshot.InputTexture = StoredInputTexture;
+        Snapshot.Params = DispatchParams;
+        Snapshot.EffectParams = EffectParams;
+        Snapshot.CachedResult = CachedResult;
+        RenderState->Publish(Snapshot);
+
         ENQUEUE_RENDER_COMMAND(ExecuteShader)(
-            [this](FRHICommandListImmediate& RHICmdList)
+            [State = RenderState, Serial = Snapshot.Serial](FRHICommandListImmediate& RHICmdList)
             {
-                DispatchRenderThread(*StoredRHICmdList, StoredInputTexture, StoredParams);
+                const FWriteToRenderTargetDispatchSnapshot* Snapshot = State->BeginRender_RenderThread();
+                if (!Snapshot)
+                {
+                    INC_DWORD_STAT(STAT_WriteToRenderTarget_DispatchesDropped);
+                    INC_DWORD_STAT(STAT_WriteToRenderTarget_DispatchesSkipped);
+                    WriteToRenderTargetTrace::DispatchSkipped(WriteToRenderTargetTrace::ESkipReason::Dropped, Serial);
+                    return;
+                }
+                const FWriteToRenderTargetDispatchSnapshot& Latest = *Snapshot;
+
+                if (Latest.CachedResult && FWriteToRenderTargetResultCache::CopyToRenderTarget_RenderThread(RHICmdList, *Latest.CachedResult, Latest.Params.RenderTarget, Latest.EffectParams.bGenerateMips))
+                {
+                    return;
+                }
+
+                // Also reached by a hit whose result was never captured because the dispatch that should have was dropped
+                DispatchRenderThread(RHICmdList, Latest.InputTexture, Latest.Params, Latest.EffectParams);
+                if (Latest.CachedResult && !Latest.Params.IsPreview())
+                {
+                    FWriteToRenderTargetResultCache::CaptureRenderTarget_RenderThread(RHICmdList, *Latest.CachedResult, Latest.Params.RenderTarget);
+                }
             });
     }
     else
     {
-        UE_LOG(LogTemp, Error, TEXT("StoredRHICmdList %s, StoredInputTexture %s, StoredParams.RenderTarget %s"), 
-            StoredRHICmdList ? TEXT("true") : TEXT("false"), 
+        UE_LOG(LogTemp, Error, TEXT("StoredInputTexture %s, StoredParams.RenderTarget %s"), 
             StoredInputTexture ? TEXT("true") : TEXT("false"), 
             StoredParams.RenderTarget ? TEXT("true") : TEXT("false"));
     }
 }
 
+void UWriteToRenderTarget::RequestDispatch()
+{
+    ++DispatchesRequested;
+    if (bDispatchPending)
+    {
+        ++DispatchesCoalesced;
+        INC_DWORD_STAT(STAT_WriteToRenderTarget_DispatchesCoalesced);
+        INC_DWORD_STAT(STAT_WriteToRenderTarget_DispatchesSkipped);
+        WriteToRenderTargetTrace::DispatchSkipped(WriteToRenderTargetTrace::ESkipReason::Coalesced, LatestDispatchSerial);
+    }
+    bDispatchPending = true;
+    ScheduleDispatch();
+}
+
+/*
+ * With r.ShaderMod.Scheduler the pending dispatch is issued by the scheduler instead of the next tick, in priority
+ * order and within the frame budget. The job is keyed by this processor, so further requests update it in place.
+ */
+void UWriteToRenderTarget::ScheduleDispatch()
+{
+    if (!FWriteToRenderTargetScheduler::IsEnabled())
+    {
+        return;
+    }
+
+    // A preview only costs its reduced extent against the frame budget
+    const double Megapixels = (double)StoredParams.X * StoredParams.Y * PreviewScale * PreviewScale / 1.0e6;
+    ScheduledJobId = FWriteToRenderTargetScheduler::Get().Enqueue(Priority, Megapixels,
+        [WeakThis = TWeakObjectPtr<UWriteToRenderTarget>(this)]()
+        {
+            if (UWriteToRenderTarget* Processor = WeakThis.Get())
+            {
+                Processor->ScheduledJobId = 0;
+                Processor->FlushPendingDispatch();
+            }
+        },
+        this);
+}
+
+void UWriteToRenderTarget::FlushPendingDispatch()
+{
+    if (bDispatchPending)
+    {
+        EnqueueShaderExecution();
+    }
+}
+
+bool UWriteToRenderTarget::CancelPendingDispatch()
+{
+    if (!bDispatchPending)
+    {
+        return false;
+    }
+
+    bDispatchPending = false;
+    if (ScheduledJobId != 0)
+    {
+        FWriteToRenderTargetScheduler::Get().Cancel(ScheduledJobId);
+        ScheduledJobId = 0;
+    }
+    return true;
+}
+
+FWriteToRenderTargetDispatchCounters UWriteToRenderTarget::GetDispatchCounters() const
+{
+    FWriteToRenderTargetDispatchCounters Counters;
+    Counters.Requested = DispatchesRequested;
+    Counters.Issued = DispatchesIssued;
+    Counters.Coalesced = DispatchesCoalesced;
+    Counters.Dropped = RenderState ? RenderState->DispatchesDropped.load() : 0;
+    return Counters;
+}
+
+void UWriteToRenderTarget::ResetDispatchCounters()
+{
+    DispatchesRequested = 0;
+    DispatchesIssued = 0;
+    DispatchesCoalesced = 0;
+    if (RenderState)
+    {
+        RenderState->DispatchesDropped = 0;
+    }
+}
+
+/*
+ * Issues at most one dispatch per frame, using whatever the parameters are at that point, unless the scheduler
+ * issues it, and completes the readbacks whose copy the GPU has finished.
+ */
+void UWriteToRenderTarget::Tick(float DeltaTime)
+{
+    if (ScheduledJobId == 0)
+    {
+        FlushPendingDispatch();
+    }
+
+    if (ReadbacksInFlight > 0 && ReadbackRing)
+    {
+        ENQUEUE_RENDER_COMMAND(WriteToRenderTargetPollReadbacks)(
+            [Ring = ReadbackRing](FRHICommandListImmediate& RHICmdList)
+            {
+                Ring->Poll_RenderThread();
+            });
+    }
+}
+
+ETickableTickType UWriteToRenderTarget::GetTickableTickType() const
+{
+    return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UWriteToRenderTarget::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UWriteToRenderTarget, STATGROUP_Tickables);
+}
+
+/*
+ * No render command captures this instance, they hold the render state or copies of the parameters. Destruction still
+ * waits until the render thread has run the commands enqueued so far, since they read the input texture this instance
+ * kept alive. Outstanding readbacks are failed; their callbacks still run on the game thread.
+ */
+void UWriteToRenderTarget::BeginDestroy()
+{
+    Super::BeginDestroy();
+    CancelPendingDispatch();
+    FWriteToRenderTargetTexturePool::Get().RemoveInputUser(StoredInputTexture);
+    StoredInputTexture = nullptr;
+    if (ReadbackRing)
+    {
+        ENQUEUE_RENDER_COMMAND(WriteToRenderTargetCancelReadbacks)(
+            [Ring = ReadbackRing](FRHICommandListImmediate& RHICmdList)
+            {
+                Ring->Cancel_RenderThread();
+            });
+    }
+    ReleaseFence.BeginFence();
+}
+
+bool UWriteToRenderTarget::IsReadyForFinishDestroy()
+{
+    return Super::IsReadyForFinishDestroy() && ReleaseFence.IsFenceComplete();
+}
+
 /*
  * This function executes the shader on the render thread. It builds the render graph, allocates
  * the necessary parameters, and dispatches the compute shader to process the input texture and
@@ -187,69 +876,102 @@ void UWriteToRenderTarget::EnqueueShaderExecution()
  */
 void UWriteToRenderTarget::DispatchRenderThread(FRHICommandListImmediate& RHICmdList, UTexture2D* InputTexture, FWriteToRenderTargetDispatchParams Params)
 {
-    if (!StoredInputTexture)
+    // Before the first published dispatch the parameters are still the defaults
+    const FWriteToRenderTargetEffectParams EffectParams = RenderState ? RenderState->Acquire_RenderThread().EffectParams : FWriteToRenderTargetEffectParams();
+    DispatchRenderThread(RHICmdList, InputTexture, Params, EffectParams);
+}
+
+void UWriteToRenderTarget::DispatchRenderThread(FRHICommandListImmediate& RHICmdList, UTexture2D* InputTexture, FWriteToRenderTargetDispatchParams Params, const FWriteToRenderTargetEffectParams& EffectParams)
+{
+    if (!InputTexture)
     {
         return;
     }
+
+    SCOPE_CYCLE_COUNTER(STAT_WriteToRenderTarget_Execute);
+    WRITETORENDERTARGET_TRACE_SCOPE(WriteToRenderTarget_DispatchRenderThread);
     
+    // The render target format decides how the kernel converts its output
+    FRHITexture* TargetTextureRHI = Params.RenderTarget->GetRenderTargetTexture();
+    const FWriteToRenderTargetOutputTarget OutputTarget = FWriteToRenderTargetOutputTarget::Select(TargetTextureRHI->GetFormat(), TargetTextureRHI->GetFlags());
+
+    // Fold the effect stack once and compile out every stage that is at identity
+    const FWriteToRenderTargetFusedEffects Effects = FWriteToRenderTargetFusedEffects::Fold(EffectParams);
+    const FWriteToRenderTargetPermutation Permutation = FWriteToRenderTargetPermutation::Select(Effects);
+
+    // Group size measured for this GPU and resolution; the first dispatch of a new resolution measures it (with its own graphs).
+    // Previews never stall an interaction on a measurement, unmeasured preview sizes keep the default.
+    const FIntPoint Extent(Params.X, Params.Y);
+    const FIntPoint ShadedExtent = Params.GetShadedExtent();
+    const bool bPreview = ShadedExtent != Extent;
+    EWriteToRenderTargetGroupSize GroupSize = FWriteToRenderTargetGroupSize::Default;
+    if (bPreview)
+    {
+        if (!FWriteToRenderTargetGroupSizeTuner::Get().Find(ShadedExtent, GroupSize))
+        {
+            GroupSize = FWriteToRenderTargetGroupSize::Default;
+        }
+    }
+    else if (OutputTarget.Format != EWriteToRenderTargetOutputFormat::Unsupported && !FWriteToRenderTargetGroupSizeTuner::Get().Find(Extent, GroupSize))
+    {
+        GroupSize = WriteToRenderTargetRDG::AutotuneGroupSize(
+            RHICmdList, InputTexture->GetResource()->TextureRHI, TargetTextureRHI->GetFormat(), Extent, OutputTarget, Permutation, Effects, EffectParams.bResampleInKernel);
+        FWriteToRenderTargetGroupSizeTuner::Get().Set(Extent, GroupSize);
+    }
+
+    WriteToRenderTargetTrace::Dispatch(Extent, EffectParams, EWriteToRenderTargetBackend::RDG, Permutation.GetIndex(), false);
+
+    // Scratch textures and the render target's RDG wrapper come from the pool; a steady dispatch allocates neither
+    FWriteToRenderTargetRenderTargetPool& Pool = FWriteToRenderTargetRenderTargetPool::Get();
+    const FWriteToRenderTargetRenderTargetPoolStats PoolStatsBefore = Pool.GetStats();
+
     FRDGBuilder GraphBuilder(RHICmdList);
     {
-        SCOPE_CYCLE_COUNTER(STAT_WriteToRenderTarget_Execute);
-        DECLARE_GPU_STAT(WriteToRenderTarget);
+        SCOPE_CYCLE_COUNTER(STAT_WriteToRenderTarget_GraphSetup);
+        WRITETORENDERTARGET_TRACE_SCOPE(WriteToRenderTarget_GraphSetup);
         RDG_EVENT_SCOPE(GraphBuilder, "WriteToRenderTarget");
         RDG_GPU_STAT_SCOPE(GraphBuilder, WriteToRenderTarget);
 
-        FWriteToRenderTarget::FPermutationDomain PermutationVector;
-        TShaderMapRef<FWriteToRenderTarget> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
-        if (ComputeShader.IsValid()) 
-        {
-            FTexture2DRHIRef InputTextureRHI = InputTexture->GetResource()->TextureRHI->GetTexture2D();
-            FWriteToRenderTarget::FParameters* PassParameters = GraphBuilder.AllocParameters<FWriteToRenderTarget::FParameters>();
-            PassParameters->InputTexture = InputTextureRHI;
-            PassParameters->InputSampler = TStaticSamplerState<SF_Point>::GetRHI();
-            // Color change
-            PassParameters->bInvertColors = bInvertColors;
-            PassParameters->bGreyscale = bGreyscale;
-            PassParameters->Contrast = Contrast;
-            // Deformation
-            PassParameters->DistortionStrength = DistortionStrength;
-            PassParameters->ImageScale = ImageScale;
-            PassParameters->RotationAngle = RotationAngle;
-
-            FRDGTextureDesc Desc = FRDGTextureDesc::Create2D(
-                FIntPoint(InputTexture->GetSizeX(), InputTexture->GetSizeY()),
-                PF_B8G8R8A8,
-                FClearValueBinding::White,
-                TexCreate_RenderTargetable | TexCreate_ShaderResource | TexCreate_UAV
-            );
+        FRDGTextureRef TargetTexture = Pool.RegisterExternalTexture(GraphBuilder, TargetTextureRHI, TEXT("WriteToRenderTarget_RT"));
 
-            FRDGTextureRef RenderTargetRDG = GraphBuilder.CreateTexture(Desc, TEXT("RenderTarget"));
-            PassParameters->RenderTarget = GraphBuilder.CreateUAV(RenderTargetRDG);
-            FRDGTextureRef TmpTexture = GraphBuilder.CreateTexture(Desc, TEXT("WriteToRenderTarget_TempTexture"));
-            FRDGTextureRef TargetTexture = RegisterExternalTexture(GraphBuilder, Params.RenderTarget->GetRenderTargetTexture(), TEXT("WriteToRenderTarget_RT"));
-            PassParameters->RenderTarget = GraphBuilder.CreateUAV(TmpTexture);
-
-            auto GroupCount = FComputeShaderUtils::GetGroupCount(FIntVector(Params.X, Params.Y, Params.Z), FComputeShaderUtils::kGolden2DGroupSize);
+        const FWriteToRenderTarget::FPermutationDomain PermutationVector = FWriteToRenderTarget::GetPermutationVector(OutputTarget, Permutation, GroupSize);
+        TShaderMapRef<FWriteToRenderTarget> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
 
-            GraphBuilder.AddPass(
-                RDG_EVENT_NAME("ExecuteWriteToRenderTarget"),
-                PassParameters,
-                ERDGPassFlags::AsyncCompute,
-                [PassParameters, ComputeShader, GroupCount](FRHIComputeCommandList& RHICmdList)
-                {
-                    FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, *PassParameters, GroupCount);
-                }
-            );
+        if (OutputTarget.Format == EWriteToRenderTargetOutputFormat::Unsupported)
+        {
+            #if WITH_EDITOR
+                GEngine->AddOnScreenDebugMessage((uint64)42145125184, 6.f, FColor::Red, FString(TEXT("The provided render target has an incompatible format (Please change the RT format to RGBA8, RGBA16f, RGBA32f or R8).")));
+            #endif
+        }
+        else if (ComputeShader.IsValid() && bPreview)
+        {
+            // Interactive preview: the kernel shades a reduced image into a pooled texture, which is stretched over the render target
+            FRDGTextureRef PreviewTexture = Pool.CreateTexture(GraphBuilder,
+                FRDGTextureDesc::Create2D(ShadedExtent, TargetTexture->Desc.Format, FClearValueBinding::None, TexCreate_ShaderResource | TexCreate_UAV),
+                TEXT("WriteToRenderTarget_PreviewTexture"));
+            FWriteToRenderTargetOutputTarget PreviewTarget = OutputTarget;
+            PreviewTarget.bDirectWrite = true;
+            WriteToRenderTargetRDG::AddExecutePass(
+                GraphBuilder, ComputeShader, InputTexture->GetResource()->TextureRHI, PreviewTexture, PreviewTarget, Permutation, GroupSize, ShadedExtent, Effects, EffectParams.bResampleInKernel);
+            WriteToRenderTargetRDG::AddUpsamplePreviewPass(GraphBuilder, PreviewTexture, TargetTexture);
+            INC_DWORD_STAT(STAT_WriteToRenderTarget_PreviewDispatches);
 
-            if (TargetTexture->Desc.Format == PF_B8G8R8A8)
+            if (EffectParams.bGenerateMips)
             {
-                AddCopyTexturePass(GraphBuilder, TmpTexture, TargetTexture, FRHICopyTextureInfo());
+                WriteToRenderTargetRDG::AddGenerateMipsPass(GraphBuilder, TargetTexture);
             }
-            else
+        }
+        else if (ComputeShader.IsValid()) 
+        {
+            // Large outputs run as one pass per tile (r.ShaderMod.Tiled), which bounds the scratch texture of the copy path
+            WriteToRenderTargetRDG::AddExecutePass(
+                GraphBuilder, ComputeShader, InputTexture->GetResource()->TextureRHI, TargetTexture, OutputTarget, Permutation, GroupSize, Extent, Effects, EffectParams.bResampleInKernel,
+                FWriteToRenderTargetTiling::GetTileSize(Extent));
+
+            // The lower mips follow the processed image in the same graph, behind the kernel passes
+            if (EffectParams.bGenerateMips)
             {
-                #if WITH_EDITOR
-                    GEngine->AddOnScreenDebugMessage((uint64)42145125184, 6.f, FColor::Red, FString(TEXT("The provided render target has an incompatible format (Please change the RT format to: RGBA8).")));
-                #endif
+                WriteToRenderTargetRDG::AddGenerateMipsPass(GraphBuilder, TargetTexture);
             }
         }
         else
@@ -260,7 +982,16 @@ void UWriteToRenderTarget::DispatchRenderThread(FRHICommandListImmediate& RHICmd
         }
     }
 
-    GraphBuilder.Execute();
+    {
+        SCOPE_CYCLE_COUNTER(STAT_WriteToRenderTarget_GraphExecute);
+        WRITETORENDERTARGET_TRACE_SCOPE(WriteToRenderTarget_GraphExecute);
+        GraphBuilder.Execute();
+    }
+
+    const FWriteToRenderTargetRenderTargetPoolStats PoolStats = Pool.GetStats();
+    UE_LOG(LogTemp, Verbose, TEXT("DispatchRenderThread - %llu textures allocated, %llu reused, %llu render target wrappers created, %llu reused"),
+        PoolStats.TexturesAllocated - PoolStatsBefore.TexturesAllocated, PoolStats.TexturesReused - PoolStatsBefore.TexturesReused,
+        PoolStats.RegistrationsCreated - PoolStatsBefore.RegistrationsCreated, PoolStats.RegistrationsReused - PoolStatsBefore.RegistrationsReused);
 }
 
 /*
@@ -270,9 +1001,9 @@ void UWriteToRenderTarget::DispatchRenderThread(FRHICommandListImmediate& RHICmd
 void UWriteToRenderTarget::DispatchGameThread(UTexture2D* InputTexture, FWriteToRenderTargetDispatchParams Params)
 {
     ENQUEUE_RENDER_COMMAND(SceneDrawCompletion)(
-        [InputTexture, Params, this](FRHICommandListImmediate& RHICmdList)
+        [InputTexture, Params, EffectParams = GetDispatchEffectParams(InputTexture, FIntPoint(Params.X, Params.Y))](FRHICommandListImmediate& RHICmdList)
         {
-            DispatchRenderThread(RHICmdList, InputTexture, Params);
+            UWriteToRenderTarget::DispatchRenderThread(RHICmdList, InputTexture, Params, EffectParams);
         });
 }
 
@@ -282,7 +1013,11 @@ void UWriteToRenderTarget::DispatchGameThread(UTexture2D* InputTexture, FWriteTo
  */
 void UWriteToRenderTarget::Dispatch(UTexture2D* InputTexture, FWriteToRenderTargetDispatchParams Params)
 {
-    if (IsInRenderingThread())
+    if (ResolveBackend() == EWriteToRenderTargetBackend::CPU && IsInGameThread())
+    {
+        DispatchCPU(InputTexture, Params);
+    }
+    else if (IsInRenderingThread())
     {
         DispatchRenderThread(GetImmediateCommandList_ForRenderCommand(), InputTexture, Params);
     }
@@ -291,3 +1026,291 @@ void UWriteToRenderTarget::Dispatch(UTexture2D* InputTexture, FWriteToRenderTarg
         DispatchGameThread(InputTexture, Params);
     }
 }
+
+/*
+ * Executes the CPU reference kernel. The input pixels are read back from the texture's CPU data, processed in tiles
+ * across all cores and, when a real RHI is active, uploaded into the render target on the render thread.
+ */
+void UWriteToRenderTarget::DispatchCPU(UTexture2D* InputTexture, FWriteToRenderTargetDispatchParams Params)
+{
+    if (!InputTexture || Params.X <= 0 || Params.Y <= 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("DispatchCPU - InputTexture is null or the dispatch size is empty."));
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_WriteToRenderTarget_ExecuteCPU);
+    WRITETORENDERTARGET_TRACE_SCOPE(WriteToRenderTarget_DispatchCPU);
+
+    const FWriteToRenderTargetEffectParams EffectParams = GetDispatchEffectParams(InputTexture, FIntPoint(Params.X, Params.Y));
+
+    // Parameters this render target was already processed with upload the cached pixels again
+    FWriteToRenderTargetResultCache& ResultCache = FWriteToRenderTargetResultCache::Get();
+    const FWriteToRenderTargetResultKey ResultKey = FWriteToRenderTargetResultCache::MakeKey(InputTexture, Params.RenderTargetObject, FIntPoint(Params.X, Params.Y), EWriteToRenderTargetBackend::CPU, EffectParams);
+    if (const FWriteToRenderTargetCachedResultPtr CachedResult = ResultCache.Find(ResultKey, EffectParams))
+    {
+        CPUOutputSize = FIntPoint(Params.X, Params.Y);
+        CPUOutput = CachedResult->Pixels;
+        UploadCPUOutput(Params.RenderTarget, EffectParams.bGenerateMips);
+        return;
+    }
+
+    WriteToRenderTargetTrace::Dispatch(FIntPoint(Params.X, Params.Y), EffectParams, EWriteToRenderTargetBackend::CPU, FWriteToRenderTargetPermutation::Select(EffectParams).GetIndex(), false);
+
+    // A mismatched input sampled in the kernel is read from the mip its footprint selects, any other input at its top mip
+    const FIntPoint MinInputSize = EffectParams.bResampleInKernel
+        ? FWriteToRenderTargetRowReader::GetMinInputSize(FIntPoint(Params.X, Params.Y), FWriteToRenderTargetFusedEffects::Fold(EffectParams).GetImageScale())
+        : FIntPoint::ZeroValue;
+
+    // Large outputs are shaded tile by tile from a locked source (r.ShaderMod.Tiled). Sampling a mismatched input at its
+    // native size through its mip chain needs the whole chain, so that case keeps processing the whole image, and so do
+    // previews, which only shade a fraction of it. Tiled results are never held as a whole, so they are not cached.
+    const int32 TileSize = Params.IsPreview() ? 0 : FWriteToRenderTargetTiling::GetTileSize(FIntPoint(Params.X, Params.Y));
+    if (TileSize > 0)
+    {
+        FWriteToRenderTargetRowReader SourceReader;
+        if (!SourceReader.Open(InputTexture, MinInputSize))
+        {
+            UE_LOG(LogTemp, Error, TEXT("DispatchCPU - Failed to read the pixels of %s."), *InputTexture->GetName());
+            return;
+        }
+        const FIntPoint SourceSize = SourceReader.GetSize();
+        if (!EffectParams.bResampleInKernel || SourceSize == FIntPoint(Params.X, Params.Y))
+        {
+            DispatchCPUTiled(SourceReader, Params, EffectParams, TileSize);
+            return;
+        }
+    }
+
+    FImage SourceImage;
+    if (!FWriteToRenderTargetCPU::ReadTexturePixels(InputTexture, SourceImage, MinInputSize))
+    {
+        UE_LOG(LogTemp, Error, TEXT("DispatchCPU - Failed to read the pixels of %s."), *InputTexture->GetName());
+        return;
+    }
+
+    CPUOutputSize = FIntPoint(Params.X, Params.Y);
+    CPUOutput.SetNumUninitialized(Params.X * Params.Y);
+    const FWriteToRenderTargetCPUStats Stats = FWriteToRenderTargetCPU::ExecutePreview(SourceImage, CPUOutput.GetData(), Params.X, Params.Y, EffectParams, Params.GetShadedExtent());
+    INC_DWORD_STAT_BY(STAT_WriteToRenderTarget_PreviewDispatches, Params.IsPreview() ? 1 : 0);
+
+    SET_FLOAT_STAT(STAT_WriteToRenderTarget_CPUMegapixelsPerCore, Stats.GetMegapixelsPerSecondPerCore());
+    UE_LOG(LogTemp, Verbose, TEXT("DispatchCPU - %dx%d in %.2f ms, %.1f MP/s/core on %d workers"),
+        Params.X, Params.Y, Stats.Seconds * 1000.0, Stats.GetMegapixelsPerSecondPerCore(), Stats.NumWorkers);
+
+    if (!Params.IsPreview())
+    {
+        if (const FWriteToRenderTargetCachedResultPtr NewResult = ResultCache.Add(ResultKey, EffectParams, GetEffectParams(), CPUOutput.Num() * (int64)sizeof(FColor)))
+        {
+            NewResult->Pixels = CPUOutput;
+        }
+    }
+
+    UploadCPUOutput(Params.RenderTarget, EffectParams.bGenerateMips);
+}
+
+void UWriteToRenderTarget::UploadCPUOutput(FRenderTarget* RenderTarget, bool bGenerateMips)
+{
+    if (GUsingNullRHI || !RenderTarget)
+    {
+        return;
+    }
+
+    ENQUEUE_RENDER_COMMAND(WriteToRenderTargetUploadCPU)(
+        [RenderTarget, Pixels = CPUOutput, Size = CPUOutputSize, bGenerateMips](FRHICommandListImmediate& RHICmdList)
+        {
+            FRHITexture* TargetTexture = RenderTarget->GetRenderTargetTexture();
+            if (TargetTexture && TargetTexture->GetFormat() == PF_B8G8R8A8)
+            {
+                const FUpdateTextureRegion2D Region(0, 0, 0, 0, Size.X, Size.Y);
+                RHICmdList.UpdateTexture2D(TargetTexture, 0, Region, Size.X * sizeof(FColor), reinterpret_cast<const uint8*>(Pixels.GetData()));
+                INC_FLOAT_STAT_BY(STAT_WriteToRenderTarget_UploadMegabytes, (float)(Pixels.Num() * sizeof(FColor) / (1024.0 * 1024.0)));
+
+                // The CPU backend builds the lower mips itself (the same box filter as the GPU mip pass) and uploads them with mip 0
+                const int32 NumLowerMips = TargetTexture->GetNumMips() - 1;
+                if (bGenerateMips && NumLowerMips > 0 && FIntPoint(TargetTexture->GetSizeXYZ().X, TargetTexture->GetSizeXYZ().Y) == Size)
+                {
+                    TArray<FImage> LowerMips;
+                    FWriteToRenderTargetCPU::GenerateMips(Pixels.GetData(), Size.X, Size.Y, NumLowerMips, LowerMips);
+                    for (int32 Index = 0; Index < LowerMips.Num(); ++Index)
+                    {
+                        const FImage& Mip = LowerMips[Index];
+                        const FUpdateTextureRegion2D MipRegion(0, 0, 0, 0, Mip.SizeX, Mip.SizeY);
+                        RHICmdList.UpdateTexture2D(TargetTexture, Index + 1, MipRegion, Mip.SizeX * sizeof(FColor), Mip.RawData.GetData());
+                    }
+                    INC_DWORD_STAT_BY(STAT_WriteToRenderTarget_MipLevelsGenerated, LowerMips.Num());
+                }
+            }
+        });
+}
+
+/*
+ * Tiled variant of DispatchCPU. With a GPU each finished tile is uploaded into its region of the render target and
+ * dropped, so neither the source nor the output is ever held in memory as a whole; the render thread is flushed whenever
+ * the queued uploads exceed the tile memory budget. Without one (NullRHI, or no render target) the tiles are assembled
+ * into CPUOutput, which is then the only full-size allocation.
+ */
+void UWriteToRenderTarget::DispatchCPUTiled(const FWriteToRenderTargetRowReader& SourceReader, const FWriteToRenderTargetDispatchParams& Params, const FWriteToRenderTargetEffectParams& EffectParams, int32 TileSize)
+{
+    const bool bUpload = !GUsingNullRHI && Params.RenderTarget;
+    const int64 MemoryBudget = FWriteToRenderTargetTiling::GetMemoryBudget();
+    CPUOutputSize = FIntPoint(Params.X, Params.Y);
+    if (bUpload)
+    {
+        CPUOutput.Empty();
+    }
+    else
+    {
+        CPUOutput.SetNumUninitialized(Params.X * Params.Y);
+    }
+
+    const FIntPoint SourceSize = SourceReader.GetSize();
+    int64 QueuedUploadBytes = 0;
+    const FWriteToRenderTargetCPUStats Stats = FWriteToRenderTargetCPU::ExecuteTiled(
+        [&SourceReader](int32 X, int32 Y, int32 Width, FColor* Dest) { SourceReader.ReadRow(X, Y, Width, Dest); },
+        SourceSize.X, SourceSize.Y, Params.X, Params.Y, EffectParams, TileSize, MemoryBudget,
+        [this, &Params, bUpload, MemoryBudget, &QueuedUploadBytes](const FIntRect& Tile, const FColor* Pixels)
+        {
+            const int64 TileBytes = (int64)Tile.Area() * sizeof(FColor);
+            if (!bUpload)
+            {
+                for (int32 Row = 0; Row < Tile.Height(); ++Row)
+                {
+                    FMemory::Memcpy(&CPUOutput[(Tile.Min.Y + Row) * Params.X + Tile.Min.X], Pixels + Row * Tile.Width(), Tile.Width() * sizeof(FColor));
+                }
+                return;
+            }
+
+            ENQUEUE_RENDER_COMMAND(WriteToRenderTargetUploadCPUTile)(
+                [RenderTarget = Params.RenderTarget, TilePixels = TArray<FColor>(Pixels, Tile.Area()), Tile, TileBytes](FRHICommandListImmediate& RHICmdList)
+                {
+                    FRHITexture* TargetTexture = RenderTarget->GetRenderTargetTexture();
+                    if (TargetTexture && TargetTexture->GetFormat() == PF_B8G8R8A8)
+                    {
+                        const FUpdateTextureRegion2D Region(Tile.Min.X, Tile.Min.Y, 0, 0, Tile.Width(), Tile.Height());
+                        RHICmdList.UpdateTexture2D(TargetTexture, 0, Region, Tile.Width() * sizeof(FColor), reinterpret_cast<const uint8*>(TilePixels.GetData()));
+                        INC_FLOAT_STAT_BY(STAT_WriteToRenderTarget_UploadMegabytes, (float)(TileBytes / (1024.0 * 1024.0)));
+                    }
+                });
+
+            // Copies waiting for the render thread count against the budget too
+            QueuedUploadBytes += TileBytes;
+            if (QueuedUploadBytes > MemoryBudget)
+            {
+                FlushRenderingCommands();
+                QueuedUploadBytes = 0;
+            }
+        });
+
+    // The tiles only exist one at a time, so the lower mips are built on the GPU from the uploaded image
+    if (bUpload && EffectParams.bGenerateMips)
+    {
+        ENQUEUE_RENDER_COMMAND(WriteToRenderTargetGenerateMipsCPUTiled)(
+            [RenderTarget = Params.RenderTarget](FRHICommandListImmediate& RHICmdList)
+            {
+                FRHITexture* TargetTexture = RenderTarget->GetRenderTargetTexture();
+                if (TargetTexture && TargetTexture->GetNumMips() > 1)
+                {
+                    FRDGBuilder GraphBuilder(RHICmdList);
+                    WriteToRenderTargetRDG::AddGenerateMipsPass(GraphBuilder,
+                        FWriteToRenderTargetRenderTargetPool::Get().RegisterExternalTexture(GraphBuilder, TargetTexture, TEXT("WriteToRenderTarget_RT")));
+                    GraphBuilder.Execute();
+                }
+            });
+    }
+
+    SET_FLOAT_STAT(STAT_WriteToRenderTarget_CPUMegapixelsPerCore, Stats.GetMegapixelsPerSecondPerCore());
+    UE_LOG(LogTemp, Verbose, TEXT("DispatchCPU - %dx%d in %d tiles in %.2f ms, peak %.1f MB per tile, %.1f MP/s/core on %d workers"),
+        Params.X, Params.Y, Stats.NumTiles, Stats.Seconds * 1000.0, Stats.PeakWorkingBytes / (1024.0 * 1024.0), Stats.GetMegapixelsPerSecondPerCore(), Stats.NumWorkers);
+}
+
+/*
+ * Prints how many RDG dispatches used each effect permutation since startup or the last reset.
+ * The GPU time of each permutation shows up under its RDG event name ("ExecuteWriteToRenderTarget <Permutation>") in ProfileGPU and Insights.
+ * Usage: ShaderMod.PermutationStats [reset]
+ */
+static FAutoConsoleCommand GWriteToRenderTargetPermutationStatsCommand(
+    TEXT("ShaderMod.PermutationStats"),
+    TEXT("Prints the number of dispatches per WriteToRenderTarget shader permutation. Usage: ShaderMod.PermutationStats [reset]"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        const bool bReset = Args.Num() > 0 && Args[0] == TEXT("reset");
+        for (int32 Index = 0; Index < FWriteToRenderTargetPermutation::NumPermutations; ++Index)
+        {
+            const uint64 Count = bReset ? GWriteToRenderTargetPermutationDispatches[Index].exchange(0) : GWriteToRenderTargetPermutationDispatches[Index].load();
+            if (Count > 0)
+            {
+                UE_LOG(LogTemp, Display, TEXT("ShaderMod.PermutationStats %2d %-50s %llu"), Index, *FWriteToRenderTargetPermutation::FromIndex(Index).ToString(), Count);
+            }
+        }
+    }));
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetPermutationTest, "ShaderMod.WriteToRenderTarget.Permutations", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks FWriteToRenderTargetPermutation::Select against hand-written expectations.
+ */
+bool FWriteToRenderTargetPermutationTest::RunTest(const FString& Parameters)
+{
+    auto TestPermutation = [this](const TCHAR* Name, const FWriteToRenderTargetEffectParams& Params, int32 ExpectedIndex)
+    {
+        const FWriteToRenderTargetPermutation Permutation = FWriteToRenderTargetPermutation::Select(Params);
+        TestEqual(Name, Permutation.ToString(), FWriteToRenderTargetPermutation::FromIndex(ExpectedIndex).ToString());
+    };
+
+    // Bits of FWriteToRenderTargetPermutation::GetIndex, NUM_DISTORTIONS starts at bit 2
+    const int32 IdentityColor = 1, IdentityTransform = 2, Distort1 = 4, Distort2 = 8;
+
+    FWriteToRenderTargetEffectParams Params;
+    TestPermutation(TEXT("Defaults"), Params, IdentityColor);
+
+    Params.RotationAngle = 0.0f;
+    TestPermutation(TEXT("No rotation"), Params, IdentityColor | IdentityTransform);
+
+    Params.bGreyscale = true;
+    Params.bInvertColors = true;
+    TestPermutation(TEXT("Greyscale invert"), Params, IdentityTransform);
+
+    Params = FWriteToRenderTargetEffectParams();
+    Params.RotationAngle = 45.0f;
+    TestPermutation(TEXT("Rotation"), Params, IdentityColor);
+
+    Params.RotationAngle = 0.0f;
+    Params.ImageScale = -1.0f;
+    TestPermutation(TEXT("Mirrored scale"), Params, IdentityColor);
+
+    Params.ImageScale = 1.0f;
+    Params.DistortionStrength = 0.01f;
+    TestPermutation(TEXT("Distortion"), Params, IdentityColor | IdentityTransform | Distort1);
+
+    Params.DistortionStrength = 0.0f;
+    Params.Contrast = 1.0001f;
+    TestPermutation(TEXT("Contrast"), Params, IdentityTransform);
+
+    Params.Contrast = 0.0f;
+    TestPermutation(TEXT("Zero contrast"), Params, IdentityTransform);
+
+    // An explicit stack replaces the individual fields
+    Params.EffectStack = {
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Distort, 0.01f),
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Hue, 30.0f),
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Rotate, 45.0f),
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Distort, 0.02f) };
+    TestPermutation(TEXT("Stack with two distortions"), Params, IdentityTransform | Distort2);
+
+    Params.EffectStack = {
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Brightness, 0.25f),
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Brightness, -0.25f) };
+    TestPermutation(TEXT("Cancelling stack"), Params, IdentityColor | IdentityTransform);
+
+    for (int32 Index = 0; Index < FWriteToRenderTargetPermutation::NumPermutations; ++Index)
+    {
+        TestEqual(FString::Printf(TEXT("Round trip of index %d"), Index), FWriteToRenderTargetPermutation::FromIndex(Index).GetIndex(), Index);
+        TestEqual(FString::Printf(TEXT("Index %d is lean"), Index), FWriteToRenderTargetPermutation::FromIndex(Index).IsLean(), Index != FWriteToRenderTargetPermutation::FullIndex);
+    }
+    TestTrue(TEXT("Fewer distortions than the full kernel is lean"), FWriteToRenderTargetPermutation::FromIndex(Distort1).IsLean());
+    return true;
+}
+
+#endif
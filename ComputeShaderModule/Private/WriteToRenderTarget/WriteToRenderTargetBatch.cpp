@@ -0,0 +1,411 @@
+#include "WriteToRenderTarget/WriteToRenderTarget.h"
+#include "Engine/Texture2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "RenderGraphUtils.h"
+#include "RenderingThread.h"
+#include "TextureResource.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPool.h"
+#include "WriteToRenderTarget/WriteToRenderTargetShaders.h"
+#include "WriteToRenderTarget/WriteToRenderTargetStats.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTrace.h"
+
+DEFINE_STAT(STAT_WriteToRenderTarget_ExecuteBatch);
+DEFINE_STAT(STAT_WriteToRenderTarget_BatchItems);
+DEFINE_STAT(STAT_WriteToRenderTarget_BatchItemsPacked);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetBatchPacking(
+    TEXT("r.ShaderMod.BatchPacking"),
+    1,
+    TEXT("Pack batch items of equal size, formats and permutation into texture arrays processed by one dispatch.\n")
+    TEXT(" 0: One dispatch per item\n")
+    TEXT(" 1: Pack groups of at least r.ShaderMod.BatchPacking.MinItems items (default)"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetBatchPackingMinItems(
+    TEXT("r.ShaderMod.BatchPacking.MinItems"),
+    8,
+    TEXT("Smallest group of matching batch items that is packed into a texture array."),
+    ECVF_RenderThreadSafe);
+
+IMPLEMENT_GLOBAL_SHADER(FWriteToRenderTargetBatched, "/ComputeShaderModuleShaders/WriteToRenderTarget/WriteToRenderTarget.usf", "MainBatched", SF_Compute);
+
+namespace WriteToRenderTargetBatch
+{
+    // A batch item with everything the render thread derives from it
+    struct FPreparedItem
+    {
+        FRHITexture* Input = nullptr;
+        FRHITexture* Target = nullptr;
+        FIntPoint Extent = FIntPoint::ZeroValue;
+        FWriteToRenderTargetOutputTarget OutputTarget;
+        FWriteToRenderTargetFusedEffects Effects;
+        FWriteToRenderTargetPermutation Permutation;
+        bool bResampleInKernel = false;
+        bool bGenerateMips = false;
+    };
+
+    // Items that can share a texture array: same size, same input and output format, same permutation
+    struct FPackKey
+    {
+        FIntPoint Extent = FIntPoint::ZeroValue;
+        EPixelFormat InputFormat = PF_Unknown;
+        EPixelFormat TargetFormat = PF_Unknown;
+        int32 PermutationIndex = 0;
+
+        bool operator==(const FPackKey& Other) const
+        {
+            return Extent == Other.Extent && InputFormat == Other.InputFormat && TargetFormat == Other.TargetFormat && PermutationIndex == Other.PermutationIndex;
+        }
+
+        friend uint32 GetTypeHash(const FPackKey& Key)
+        {
+            return HashCombine(HashCombine(GetTypeHash(Key.Extent), ::GetTypeHash((uint32)Key.InputFormat)), HashCombine(::GetTypeHash((uint32)Key.TargetFormat), ::GetTypeHash(Key.PermutationIndex)));
+        }
+    };
+
+    /*
+     * Registers every external texture once per graph, batches often reuse the same input.
+     * The RDG wrappers come from the pool, so the render targets of a recurring batch are not wrapped again.
+     */
+    class FExternalTextures
+    {
+    public:
+        explicit FExternalTextures(FRDGBuilder& InGraphBuilder) : GraphBuilder(InGraphBuilder) {}
+
+        FRDGTextureRef Register(FRHITexture* Texture, const TCHAR* Name)
+        {
+            if (FRDGTextureRef* Existing = Textures.Find(Texture))
+            {
+                return *Existing;
+            }
+            return Textures.Add(Texture, FWriteToRenderTargetRenderTargetPool::Get().RegisterExternalTexture(GraphBuilder, Texture, Name));
+        }
+
+    private:
+        FRDGBuilder& GraphBuilder;
+        TMap<FRHITexture*, FRDGTextureRef> Textures;
+    };
+
+    // Copies the inputs into one texture array, runs MainBatched over all slices and copies each slice into its render target
+    void AddPackedPasses(FRDGBuilder& GraphBuilder, FExternalTextures& ExternalTextures, const TShaderRef<FWriteToRenderTargetBatched>& ComputeShader, const FPackKey& Key, TConstArrayView<const FPreparedItem*> Items)
+    {
+        const int32 NumItems = Items.Num();
+
+        // The arrays are pooled; a recurring batch of the same shape reuses them
+        FWriteToRenderTargetRenderTargetPool& Pool = FWriteToRenderTargetRenderTargetPool::Get();
+        FRDGTextureRef InputArray = Pool.CreateTexture(GraphBuilder,
+            FRDGTextureDesc::Create2DArray(Key.Extent, Key.InputFormat, FClearValueBinding::None, TexCreate_ShaderResource, NumItems),
+            TEXT("WriteToRenderTarget_BatchInput"));
+        FRDGTextureRef OutputArray = Pool.CreateTexture(GraphBuilder,
+            FRDGTextureDesc::Create2DArray(Key.Extent, Key.TargetFormat, FClearValueBinding::None, TexCreate_ShaderResource | TexCreate_UAV, NumItems),
+            TEXT("WriteToRenderTarget_BatchOutput"));
+
+        TArray<FWriteToRenderTargetBatched::FItem> ItemParams;
+        ItemParams.SetNumUninitialized(NumItems);
+        for (int32 Index = 0; Index < NumItems; ++Index)
+        {
+            ItemParams[Index] = FWriteToRenderTargetBatched::FItem::Make(Items[Index]->Effects);
+
+            FRHICopyTextureInfo CopyInfo;
+            CopyInfo.Size = FIntVector(Key.Extent.X, Key.Extent.Y, 1);
+            CopyInfo.DestSliceIndex = Index;
+            AddCopyTexturePass(GraphBuilder, ExternalTextures.Register(Items[Index]->Input, TEXT("WriteToRenderTarget_BatchItemInput")), InputArray, CopyInfo);
+        }
+
+        FRDGBufferRef ItemBuffer = CreateStructuredBuffer(
+            GraphBuilder, TEXT("WriteToRenderTarget_BatchItems"), sizeof(FWriteToRenderTargetBatched::FItem), NumItems,
+            ItemParams.GetData(), ItemParams.Num() * sizeof(FWriteToRenderTargetBatched::FItem));
+
+        FWriteToRenderTargetBatched::FParameters* PassParameters = GraphBuilder.AllocParameters<FWriteToRenderTargetBatched::FParameters>();
+        PassParameters->BatchInputTexture = InputArray;
+        PassParameters->InputSampler = TStaticSamplerState<SF_Point>::GetRHI();
+        PassParameters->BatchItems = GraphBuilder.CreateSRV(ItemBuffer);
+        PassParameters->BatchRenderTarget = GraphBuilder.CreateUAV(OutputArray);
+
+        FIntVector GroupCount = FWriteToRenderTargetGroupSize::GetGroupCount(Key.Extent, FWriteToRenderTargetGroupSize::Default);
+        GroupCount.Z = NumItems;
+
+        FComputeShaderUtils::AddPass(
+            GraphBuilder,
+            RDG_EVENT_NAME("ExecuteWriteToRenderTargetBatched %s %dx%dx%d", *Items[0]->Permutation.ToString(), Key.Extent.X, Key.Extent.Y, NumItems),
+            ERDGPassFlags::Compute,
+            ComputeShader,
+            PassParameters,
+            GroupCount);
+
+        for (int32 Index = 0; Index < NumItems; ++Index)
+        {
+            FRHICopyTextureInfo CopyInfo;
+            CopyInfo.Size = FIntVector(Key.Extent.X, Key.Extent.Y, 1);
+            CopyInfo.SourceSliceIndex = Index;
+            AddCopyTexturePass(GraphBuilder, OutputArray, ExternalTextures.Register(Items[Index]->Target, TEXT("WriteToRenderTarget_RT")), CopyInfo);
+        }
+
+        INC_DWORD_STAT_BY(STAT_WriteToRenderTarget_BatchItemsPacked, NumItems);
+    }
+}
+
+void UWriteToRenderTarget::DispatchBatchRenderThread(FRHICommandListImmediate& RHICmdList, TConstArrayView<FWriteToRenderTargetBatchRenderItem> Items)
+{
+    using namespace WriteToRenderTargetBatch;
+
+    SCOPE_CYCLE_COUNTER(STAT_WriteToRenderTarget_ExecuteBatch);
+
+    TArray<FPreparedItem> PreparedItems;
+    PreparedItems.Reserve(Items.Num());
+    int32 NumSkipped = 0;
+    for (const FWriteToRenderTargetBatchRenderItem& Item : Items)
+    {
+        FRHITexture* Input = Item.Input ? Item.Input->TextureRHI.GetReference() : nullptr;
+        FRHITexture* Target = Item.RenderTarget ? Item.RenderTarget->GetRenderTargetTexture().GetReference() : nullptr;
+        const FWriteToRenderTargetOutputTarget OutputTarget = Target
+            ? FWriteToRenderTargetOutputTarget::Select(Target->GetFormat(), Target->GetFlags())
+            : FWriteToRenderTargetOutputTarget();
+        if (!Input || OutputTarget.Format == EWriteToRenderTargetOutputFormat::Unsupported)
+        {
+            ++NumSkipped;
+            continue;
+        }
+
+        FPreparedItem& Prepared = PreparedItems.AddDefaulted_GetRef();
+        Prepared.Input = Input;
+        Prepared.Target = Target;
+        Prepared.Extent = Target->GetDesc().Extent;
+        Prepared.OutputTarget = OutputTarget;
+        Prepared.Effects = FWriteToRenderTargetFusedEffects::Fold(Item.EffectParams);
+        Prepared.Permutation = FWriteToRenderTargetPermutation::Select(Prepared.Effects);
+        Prepared.bResampleInKernel = Item.EffectParams.bResampleInKernel;
+        Prepared.bGenerateMips = Item.EffectParams.bGenerateMips;
+        WriteToRenderTargetTrace::Dispatch(Prepared.Extent, Item.EffectParams, EWriteToRenderTargetBackend::RDG, Prepared.Permutation.GetIndex(), true);
+    }
+
+    if (NumSkipped > 0)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("DispatchBatchRenderThread - Skipped %d of %d items without a valid input or with an unsupported render target format."), NumSkipped, Items.Num());
+    }
+
+    // Group the items that can be packed; anything else (mismatched sizes, in-kernel resampling) is dispatched on its own
+    TMap<FPackKey, TArray<const FPreparedItem*>> PackGroups;
+    TArray<const FPreparedItem*> SingleItems;
+    const bool bPacking = CVarWriteToRenderTargetBatchPacking.GetValueOnRenderThread() != 0;
+    for (const FPreparedItem& Item : PreparedItems)
+    {
+        if (bPacking && Item.Input->GetDesc().Extent == Item.Extent)
+        {
+            const FPackKey Key{ Item.Extent, Item.Input->GetFormat(), Item.Target->GetFormat(), Item.Permutation.GetIndex() };
+            PackGroups.FindOrAdd(Key).Add(&Item);
+        }
+        else
+        {
+            SingleItems.Add(&Item);
+        }
+    }
+
+    const int32 MinPackedItems = FMath::Max(CVarWriteToRenderTargetBatchPackingMinItems.GetValueOnRenderThread(), 2);
+    for (auto It = PackGroups.CreateIterator(); It; ++It)
+    {
+        if (It.Value().Num() < MinPackedItems)
+        {
+            SingleItems.Append(It.Value());
+            It.RemoveCurrent();
+        }
+    }
+
+    FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+    TMap<int32, TShaderRef<FWriteToRenderTarget>> Shaders;
+    TMap<int32, TShaderRef<FWriteToRenderTargetBatched>> BatchedShaders;
+
+    FRDGBuilder GraphBuilder(RHICmdList);
+    {
+        SCOPE_CYCLE_COUNTER(STAT_WriteToRenderTarget_GraphSetup);
+        WRITETORENDERTARGET_TRACE_SCOPE(WriteToRenderTarget_GraphSetup);
+        RDG_EVENT_SCOPE(GraphBuilder, "WriteToRenderTargetBatch %d", PreparedItems.Num());
+        RDG_GPU_STAT_SCOPE(GraphBuilder, WriteToRenderTarget);
+
+        FExternalTextures ExternalTextures(GraphBuilder);
+
+        for (const FPreparedItem* Item : SingleItems)
+        {
+            // Batches never autotune (that would flush the GPU in the middle of recording), unknown sizes use the default group size
+            EWriteToRenderTargetGroupSize GroupSize = FWriteToRenderTargetGroupSize::Default;
+            FWriteToRenderTargetGroupSizeTuner::Get().Find(Item->Extent, GroupSize);
+
+            const FWriteToRenderTarget::FPermutationDomain PermutationVector = FWriteToRenderTarget::GetPermutationVector(Item->OutputTarget, Item->Permutation, GroupSize);
+            const int32 PermutationId = PermutationVector.ToDimensionValueId();
+            TShaderRef<FWriteToRenderTarget>* ComputeShader = Shaders.Find(PermutationId);
+            if (!ComputeShader)
+            {
+                ComputeShader = &Shaders.Add(PermutationId, TShaderMapRef<FWriteToRenderTarget>(ShaderMap, PermutationVector));
+            }
+            if (!ComputeShader->IsValid())
+            {
+                continue;
+            }
+
+            WriteToRenderTargetRDG::AddExecutePass(
+                GraphBuilder, *ComputeShader, Item->Input, ExternalTextures.Register(Item->Target, TEXT("WriteToRenderTarget_RT")),
+                Item->OutputTarget, Item->Permutation, GroupSize, Item->Extent, Item->Effects, Item->bResampleInKernel);
+        }
+
+        for (const TPair<FPackKey, TArray<const FPreparedItem*>>& Group : PackGroups)
+        {
+            const FPreparedItem* First = Group.Value[0];
+            const FWriteToRenderTargetBatched::FPermutationDomain PermutationVector = FWriteToRenderTarget::GetPermutationVector(First->OutputTarget, First->Permutation, FWriteToRenderTargetGroupSize::Default);
+            const int32 PermutationId = PermutationVector.ToDimensionValueId();
+            TShaderRef<FWriteToRenderTargetBatched>* ComputeShader = BatchedShaders.Find(PermutationId);
+            if (!ComputeShader)
+            {
+                ComputeShader = &BatchedShaders.Add(PermutationId, TShaderMapRef<FWriteToRenderTargetBatched>(ShaderMap, PermutationVector));
+            }
+            if (ComputeShader->IsValid())
+            {
+                AddPackedPasses(GraphBuilder, ExternalTextures, *ComputeShader, Group.Key, Group.Value);
+            }
+        }
+
+        // Mips last, once every pass that writes mip 0 of the targets is recorded
+        for (const FPreparedItem& Item : PreparedItems)
+        {
+            if (Item.bGenerateMips)
+            {
+                WriteToRenderTargetRDG::AddGenerateMipsPass(GraphBuilder, ExternalTextures.Register(Item.Target, TEXT("WriteToRenderTarget_RT")));
+            }
+        }
+    }
+
+    {
+        SCOPE_CYCLE_COUNTER(STAT_WriteToRenderTarget_GraphExecute);
+        WRITETORENDERTARGET_TRACE_SCOPE(WriteToRenderTarget_GraphExecute);
+        GraphBuilder.Execute();
+    }
+
+    INC_DWORD_STAT_BY(STAT_WriteToRenderTarget_BatchItems, PreparedItems.Num());
+    UE_LOG(LogTemp, Verbose, TEXT("DispatchBatchRenderThread - %d items, %d packed groups, %d single dispatches, %d shader lookups"),
+        PreparedItems.Num(), PackGroups.Num(), SingleItems.Num(), Shaders.Num() + BatchedShaders.Num());
+}
+
+void UWriteToRenderTarget::DispatchBatchGameThread(TArray<FWriteToRenderTargetBatchRenderItem> Items)
+{
+    if (Items.Num() == 0)
+    {
+        return;
+    }
+
+    ENQUEUE_RENDER_COMMAND(WriteToRenderTargetBatch)(
+        [Items = MoveTemp(Items)](FRHICommandListImmediate& RHICmdList)
+        {
+            DispatchBatchRenderThread(RHICmdList, Items);
+        });
+}
+
+/*
+ * Measures the per-item cost of a batch against one graph per item, for batches of 1, 10, 100 and 1000 items.
+ * Render thread time covers recording and executing the graph, GPU time is taken from timestamp queries around it.
+ * Usage: ShaderMod.BenchBatch [Size] [MaxItems]
+ */
+static FAutoConsoleCommand GWriteToRenderTargetBenchBatchCommand(
+    TEXT("ShaderMod.BenchBatch"),
+    TEXT("Times batched WriteToRenderTarget dispatches against one graph per item. Usage: ShaderMod.BenchBatch [Size] [MaxItems]"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        if (GUsingNullRHI)
+        {
+            UE_LOG(LogTemp, Warning, TEXT("ShaderMod.BenchBatch needs a GPU."));
+            return;
+        }
+
+        const int32 Size = Args.Num() > 0 ? FMath::Clamp(FCString::Atoi(*Args[0]), 1, 4096) : 128;
+        const int32 MaxItems = Args.Num() > 1 ? FMath::Clamp(FCString::Atoi(*Args[1]), 1, 1000) : 1000;
+
+        // Inputs at render target size, so the packed path is eligible
+        TArray<UTexture2D*> Inputs;
+        TArray<UTextureRenderTarget2D*> RenderTargets;
+        TArray<FWriteToRenderTargetBatchRenderItem> Items;
+        for (int32 Index = 0; Index < MaxItems; ++Index)
+        {
+            UTexture2D* Input = UTexture2D::CreateTransient(Size, Size, PF_B8G8R8A8);
+            FColor* Pixels = static_cast<FColor*>(Input->GetPlatformData()->Mips[0].BulkData.Lock(LOCK_READ_WRITE));
+            for (int32 Pixel = 0; Pixel < Size * Size; ++Pixel)
+            {
+                Pixels[Pixel] = FColor((uint8)(Pixel + Index), (uint8)(Pixel * 3), (uint8)(Index * 7), 255);
+            }
+            Input->GetPlatformData()->Mips[0].BulkData.Unlock();
+            Input->UpdateResource();
+
+            UTextureRenderTarget2D* RenderTarget = NewObject<UTextureRenderTarget2D>();
+            RenderTarget->bCanCreateUAV = true;
+            RenderTarget->InitCustomFormat(Size, Size, PF_R8G8B8A8, true);
+            RenderTarget->UpdateResourceImmediate(false);
+
+            Inputs.Add(Input);
+            RenderTargets.Add(RenderTarget);
+
+            FWriteToRenderTargetBatchRenderItem& Item = Items.AddDefaulted_GetRef();
+            Item.Input = Input->GetResource();
+            Item.RenderTarget = RenderTarget->GameThread_GetRenderTargetResource();
+            Item.EffectParams.RotationAngle = (float)(Index % 4) * 90.0f;
+        }
+        FlushRenderingCommands();
+
+        for (int32 NumItems = 1; NumItems <= MaxItems; NumItems *= 10)
+        {
+            ENQUEUE_RENDER_COMMAND(WriteToRenderTargetBenchBatch)(
+                [NumItems, Size, ItemView = TConstArrayView<FWriteToRenderTargetBatchRenderItem>(Items.GetData(), NumItems)](FRHICommandListImmediate& RHICmdList)
+                {
+                    // Warm up the pipelines of every path
+                    UWriteToRenderTarget::DispatchBatchRenderThread(RHICmdList, ItemView);
+                    UWriteToRenderTarget::DispatchBatchRenderThread(RHICmdList, ItemView.Left(1));
+                    RHICmdList.SubmitCommandsAndFlushGPU();
+
+                    auto Measure = [&RHICmdList](TFunctionRef<void()> Work, double& OutCPUSeconds, double& OutGPUSeconds)
+                    {
+                        FRenderQueryRHIRef StartQuery = RHICreateRenderQuery(RQT_AbsoluteTime);
+                        FRenderQueryRHIRef EndQuery = RHICreateRenderQuery(RQT_AbsoluteTime);
+                        RHICmdList.EndRenderQuery(StartQuery);
+                        const double StartTime = FPlatformTime::Seconds();
+                        Work();
+                        OutCPUSeconds = FPlatformTime::Seconds() - StartTime;
+                        RHICmdList.EndRenderQuery(EndQuery);
+                        RHICmdList.SubmitCommandsAndFlushGPU();
+
+                        uint64 StartMicroseconds = 0;
+                        uint64 EndMicroseconds = 0;
+                        OutGPUSeconds = RHIGetRenderQueryResult(StartQuery, StartMicroseconds, true) && RHIGetRenderQueryResult(EndQuery, EndMicroseconds, true)
+                            ? (EndMicroseconds - StartMicroseconds) / 1.0e6
+                            : 0.0;
+                    };
+
+                    double SeparateCPU = 0.0, SeparateGPU = 0.0, BatchCPU = 0.0, BatchGPU = 0.0;
+                    Measure([&]()
+                    {
+                        for (int32 Index = 0; Index < ItemView.Num(); ++Index)
+                        {
+                            UWriteToRenderTarget::DispatchBatchRenderThread(RHICmdList, ItemView.Slice(Index, 1));
+                        }
+                    }, SeparateCPU, SeparateGPU);
+                    Measure([&]()
+                    {
+                        UWriteToRenderTarget::DispatchBatchRenderThread(RHICmdList, ItemView);
+                    }, BatchCPU, BatchGPU);
+
+                    const double ToMicrosecondsPerItem = 1.0e6 / NumItems;
+                    UE_LOG(LogTemp, Display, TEXT("ShaderMod.BenchBatch %4d x %dx%d: one graph per item %.1f us CPU / %.1f us GPU per item, batch %.1f us CPU / %.1f us GPU per item (packing %s)"),
+                        NumItems, Size, Size,
+                        SeparateCPU * ToMicrosecondsPerItem, SeparateGPU * ToMicrosecondsPerItem,
+                        BatchCPU * ToMicrosecondsPerItem, BatchGPU * ToMicrosecondsPerItem,
+                        CVarWriteToRenderTargetBatchPacking.GetValueOnRenderThread() != 0 ? TEXT("on") : TEXT("off"));
+                });
+            FlushRenderingCommands();
+        }
+
+        for (UTexture2D* Input : Inputs)
+        {
+            Input->MarkAsGarbage();
+        }
+        for (UTextureRenderTarget2D* RenderTarget : RenderTargets)
+        {
+            RenderTarget->MarkAsGarbage();
+        }
+    }));
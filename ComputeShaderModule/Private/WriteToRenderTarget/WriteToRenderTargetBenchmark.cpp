@@ -0,0 +1,375 @@
+#include "WriteToRenderTarget/WriteToRenderTarget.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Texture2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Interfaces/IPluginManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RenderGraphBuilder.h"
+#include "RenderingThread.h"
+#include "RenderUtils.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "WriteToRenderTarget/WriteToRenderTargetCPU.h"
+#include "WriteToRenderTarget/WriteToRenderTargetEffects.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPermutation.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPool.h"
+#include "WriteToRenderTarget/WriteToRenderTargetShaders.h"
+#include "WriteToRenderTarget/WriteToRenderTargetSubsystem.h"
+
+/*
+ * Benchmark suite of the WriteToRenderTarget module (ShaderMod.BenchSuite). Every measurement becomes one row;
+ * the rows are written as CSV and JSON under Saved/Profiling/ShaderMod so results of plugin versions can be diffed.
+ * Everything runs without a GPU: the kernel is measured through the CPU backend and the RDG measurement records the
+ * graph of a dispatch with an empty pass body, so it covers the recording and scheduling cost, not the GPU time.
+ */
+namespace WriteToRenderTargetBenchmark
+{
+    struct FRow
+    {
+        FString Suite;
+        FString Case;
+        int32 Iterations = 0;
+        double MeanMs = 0.0;
+        double MinMs = 0.0;
+        double Value = 0.0;
+        FString Unit;
+    };
+
+    // Times Body Iterations times after one warm-up run
+    template <typename BodyType>
+    static FRow Measure(const FString& Suite, const FString& Case, int32 Iterations, BodyType&& Body)
+    {
+        Body();
+
+        FRow Row;
+        Row.Suite = Suite;
+        Row.Case = Case;
+        Row.Iterations = Iterations;
+        Row.MinMs = TNumericLimits<double>::Max();
+        double TotalMs = 0.0;
+        for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+        {
+            const double StartTime = FPlatformTime::Seconds();
+            Body();
+            const double Ms = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+            TotalMs += Ms;
+            Row.MinMs = FMath::Min(Row.MinMs, Ms);
+        }
+        Row.MeanMs = TotalMs / FMath::Max(Iterations, 1);
+        return Row;
+    }
+
+    static void FillPattern(TArray<FColor>& Pixels, int32 Size)
+    {
+        Pixels.SetNumUninitialized(Size * Size);
+        for (int32 Index = 0; Index < Pixels.Num(); ++Index)
+        {
+            Pixels[Index] = FColor((uint8)(Index * 7), (uint8)(Index / Size * 13), (uint8)(Index * 29), 255);
+        }
+    }
+
+    static UTexture2D* CreateInput(int32 Size)
+    {
+        TArray<FColor> Pixels;
+        FillPattern(Pixels, Size);
+        UTexture2D* Input = UTexture2D::CreateTransient(Size, Size, PF_B8G8R8A8);
+        FMemory::Memcpy(Input->GetPlatformData()->Mips[0].BulkData.Lock(LOCK_READ_WRITE), Pixels.GetData(), Pixels.Num() * sizeof(FColor));
+        Input->GetPlatformData()->Mips[0].BulkData.Unlock();
+        Input->UpdateResource();
+        return Input;
+    }
+
+    // The effect combinations measured by the kernel and graph suites, named after what they enable
+    static TArray<TPair<FString, FWriteToRenderTargetEffectParams>> MakeEffectCombinations()
+    {
+        using EOp = EWriteToRenderTargetEffectOp;
+        auto MakeStack = [](std::initializer_list<FWriteToRenderTargetEffect> Effects)
+        {
+            FWriteToRenderTargetEffectParams Params;
+            Params.EffectStack = TArray<FWriteToRenderTargetEffect>(Effects);
+            return Params;
+        };
+
+        TArray<TPair<FString, FWriteToRenderTargetEffectParams>> Combinations;
+        Combinations.Emplace(TEXT("Identity"), MakeStack({ FWriteToRenderTargetEffect::Make(EOp::Rotate, 0.0f) }));
+        Combinations.Emplace(TEXT("Rotate"), MakeStack({ FWriteToRenderTargetEffect::Make(EOp::Rotate, 30.0f) }));
+        Combinations.Emplace(TEXT("Scale"), MakeStack({ FWriteToRenderTargetEffect::Make(EOp::Scale, 0.8f) }));
+        Combinations.Emplace(TEXT("Distort"), MakeStack({ FWriteToRenderTargetEffect::Make(EOp::Distort, 0.05f) }));
+        Combinations.Emplace(TEXT("Greyscale"), MakeStack({ FWriteToRenderTargetEffect::Make(EOp::Greyscale) }));
+        Combinations.Emplace(TEXT("Contrast"), MakeStack({ FWriteToRenderTargetEffect::Make(EOp::Contrast, 1.3f) }));
+        Combinations.Emplace(TEXT("Invert"), MakeStack({ FWriteToRenderTargetEffect::Make(EOp::Invert) }));
+        Combinations.Emplace(TEXT("Hue+Saturation"), MakeStack({ FWriteToRenderTargetEffect::Make(EOp::Hue, 45.0f), FWriteToRenderTargetEffect::Make(EOp::Saturation, 0.5f) }));
+
+        // The default field parameters: rotate 90, greyscale, contrast, distort
+        FWriteToRenderTargetEffectParams Fields;
+        Fields.bGreyscale = true;
+        Fields.Contrast = 1.2f;
+        Fields.DistortionStrength = 0.05f;
+        Combinations.Emplace(TEXT("Fields"), Fields);
+
+        Combinations.Emplace(TEXT("TwoDistortions+Color"), MakeStack({
+            FWriteToRenderTargetEffect::Make(EOp::Rotate, 15.0f), FWriteToRenderTargetEffect::Make(EOp::Distort, 0.03f),
+            FWriteToRenderTargetEffect::Make(EOp::Scale, 1.1f), FWriteToRenderTargetEffect::Make(EOp::Distort, 0.02f),
+            FWriteToRenderTargetEffect::Make(EOp::Brightness, 0.1f), FWriteToRenderTargetEffect::Make(EOp::Contrast, 1.2f) }));
+        return Combinations;
+    }
+
+    // ResizeTexture from several source sizes into a fixed target, once per filter
+    static void RunResize(UWriteToRenderTarget* Processor, int32 Iterations, TArray<FRow>& OutRows)
+    {
+        const int32 TargetSize = 512;
+        for (const int32 SourceSize : { 256, 1024, 2048, 4096 })
+        {
+            UTexture2D* Input = CreateInput(SourceSize);
+            for (const EWriteToRenderTargetResampleFilter Filter : { EWriteToRenderTargetResampleFilter::Box, EWriteToRenderTargetResampleFilter::Bilinear, EWriteToRenderTargetResampleFilter::Lanczos })
+            {
+                Processor->ResampleFilter = Filter;
+                const FString Case = FString::Printf(TEXT("%d->%d %s"), SourceSize, TargetSize, *UEnum::GetDisplayValueAsText(Filter).ToString());
+                FRow Row = Measure(TEXT("ResizeTexture"), Case, Iterations, [Processor, Input, TargetSize]()
+                {
+                    if (UTexture2D* Resized = Processor->ResizeTexture(Input, TargetSize, TargetSize))
+                    {
+                        FWriteToRenderTargetTexturePool::Get().Release(Resized);
+                    }
+                });
+                Row.Value = (double)SourceSize * SourceSize / 1.0e6 / FMath::Max(Row.MeanMs / 1000.0, UE_DOUBLE_SMALL_NUMBER);
+                Row.Unit = TEXT("source MP/s");
+                OutRows.Add(Row);
+            }
+            Input->MarkAsGarbage();
+        }
+        Processor->ResampleFilter = EWriteToRenderTargetResampleFilter::Box;
+    }
+
+    // The CPU kernel per effect combination
+    static void RunKernel(int32 Iterations, TArray<FRow>& OutRows)
+    {
+        const int32 Size = 1024;
+        TArray<FColor> Source;
+        FillPattern(Source, Size);
+        TArray<FColor> Dest;
+        Dest.SetNumUninitialized(Size * Size);
+
+        for (const TPair<FString, FWriteToRenderTargetEffectParams>& Combination : MakeEffectCombinations())
+        {
+            const FString Case = FString::Printf(TEXT("%s (%s)"), *Combination.Key, *FWriteToRenderTargetPermutation::Select(Combination.Value).ToString());
+            FRow Row = Measure(TEXT("CPUKernel"), Case, Iterations, [&]()
+            {
+                FWriteToRenderTargetCPU::Execute(Source.GetData(), Size, Size, Dest.GetData(), Size, Size, Combination.Value);
+            });
+            Row.Value = (double)Size * Size / 1.0e6 / FMath::Max(Row.MeanMs / 1000.0, UE_DOUBLE_SMALL_NUMBER);
+            Row.Unit = TEXT("MP/s");
+            OutRows.Add(Row);
+        }
+    }
+
+    /*
+     * Dispatches issued for one Execute call and for one frame of slider movement (many setter calls before the tick).
+     * Value is the number of dispatches actually issued; the time is the game thread cost up to and including the flush.
+     */
+    static void RunDispatchCounts(UWriteToRenderTargetSubsystem* Subsystem, int32 Iterations, TArray<FRow>& OutRows)
+    {
+        const int32 Size = 256;
+        const int32 SliderStepsPerFrame = 30;
+        UTexture2D* Input = CreateInput(Size);
+        UTextureRenderTarget2D* RenderTarget = NewObject<UTextureRenderTarget2D>();
+        RenderTarget->bCanCreateUAV = true;
+        RenderTarget->InitCustomFormat(Size, Size, PF_B8G8R8A8, true);
+        RenderTarget->UpdateResourceImmediate(false);
+
+        const FWriteToRenderTargetHandle Handle = Subsystem->CreateProcessor();
+        UWriteToRenderTarget* Processor = Subsystem->GetProcessor(Handle);
+
+        auto AddCountRow = [&OutRows, Processor](FRow Row, int32 NumRuns)
+        {
+            const FWriteToRenderTargetDispatchCounters Counters = Processor->GetDispatchCounters();
+            Row.Value = (double)Counters.Issued / FMath::Max(NumRuns, 1);
+            Row.Unit = FString::Printf(TEXT("dispatches (%llu requested, %llu coalesced)"), Counters.Requested, Counters.Coalesced);
+            OutRows.Add(Row);
+        };
+
+        Processor->ResetDispatchCounters();
+        FRow ExecuteRow = Measure(TEXT("Dispatches"), TEXT("ExecuteRTComputeShader"), Iterations, [&]()
+        {
+            Subsystem->Execute(Handle, Input, RenderTarget);
+            Processor->FlushPendingDispatch();
+        });
+        AddCountRow(ExecuteRow, Iterations + 1);
+
+        Processor->ResetDispatchCounters();
+        FRow SliderRow = Measure(TEXT("Dispatches"), FString::Printf(TEXT("Slider frame (%d changes)"), SliderStepsPerFrame), Iterations, [&]()
+        {
+            for (int32 Step = 0; Step < SliderStepsPerFrame; ++Step)
+            {
+                Processor->SetContrast(0.5f + Step * 0.05f);
+            }
+            Processor->FlushPendingDispatch();
+        });
+        AddCountRow(SliderRow, Iterations + 1);
+
+        FlushRenderingCommands();
+        Subsystem->ReleaseProcessor(Handle);
+        Input->MarkAsGarbage();
+        RenderTarget->MarkAsGarbage();
+    }
+
+    /*
+     * Cost of recording and executing the render graph of one dispatch per effect combination, on the render thread.
+     * The pass body is empty so the numbers are the same under NullRHI and on a GPU.
+     */
+    static void RunGraph(int32 Iterations, TArray<FRow>& OutRows)
+    {
+        const FIntPoint Extent(1024, 1024);
+        for (const TPair<FString, FWriteToRenderTargetEffectParams>& Combination : MakeEffectCombinations())
+        {
+            double RecordMs = 0.0;
+            double ExecuteMs = 0.0;
+            double RecordMinMs = TNumericLimits<double>::Max();
+            double ExecuteMinMs = TNumericLimits<double>::Max();
+            ENQUEUE_RENDER_COMMAND(WriteToRenderTargetBenchGraph)(
+                [&, Params = Combination.Value](FRHICommandListImmediate& RHICmdList)
+                {
+                    for (int32 Iteration = 0; Iteration <= Iterations; ++Iteration)
+                    {
+                        const double StartTime = FPlatformTime::Seconds();
+                        FRDGBuilder GraphBuilder(RHICmdList);
+                        const FWriteToRenderTargetFusedEffects Effects = FWriteToRenderTargetFusedEffects::Fold(Params);
+                        const FWriteToRenderTargetPermutation Permutation = FWriteToRenderTargetPermutation::Select(Effects);
+
+                        const FRDGTextureDesc Desc = FRDGTextureDesc::Create2D(Extent, PF_R8G8B8A8, FClearValueBinding::None, TexCreate_ShaderResource | TexCreate_UAV);
+                        FRDGTextureRef OutputTexture = GraphBuilder.CreateTexture(Desc, TEXT("WriteToRenderTarget_BenchOutput"));
+                        FWriteToRenderTarget::FParameters* PassParameters = WriteToRenderTargetRDG::AllocPassParameters(
+                            GraphBuilder, GWhiteTexture->TextureRHI, OutputTexture, Extent, Effects, Params.bResampleInKernel);
+
+                        GraphBuilder.AddPass(
+                            RDG_EVENT_NAME("BenchWriteToRenderTarget %s", *Permutation.ToString()),
+                            PassParameters,
+                            ERDGPassFlags::Compute | ERDGPassFlags::NeverCull,
+                            [](FRHIComputeCommandList&) {});
+                        const double RecordedTime = FPlatformTime::Seconds();
+
+                        GraphBuilder.Execute();
+                        const double ExecutedTime = FPlatformTime::Seconds();
+
+                        // The first iteration warms the render target pool up
+                        if (Iteration > 0)
+                        {
+                            RecordMs += (RecordedTime - StartTime) * 1000.0;
+                            ExecuteMs += (ExecutedTime - RecordedTime) * 1000.0;
+                            RecordMinMs = FMath::Min(RecordMinMs, (RecordedTime - StartTime) * 1000.0);
+                            ExecuteMinMs = FMath::Min(ExecuteMinMs, (ExecutedTime - RecordedTime) * 1000.0);
+                        }
+                    }
+                });
+            FlushRenderingCommands();
+
+            FRow Row;
+            Row.Suite = TEXT("RDGGraph");
+            Row.Iterations = Iterations;
+            Row.Unit = TEXT("ms");
+            Row.Case = Combination.Key + TEXT(" record");
+            Row.MeanMs = Row.Value = RecordMs / Iterations;
+            Row.MinMs = RecordMinMs;
+            OutRows.Add(Row);
+            Row.Case = Combination.Key + TEXT(" execute");
+            Row.MeanMs = Row.Value = ExecuteMs / Iterations;
+            Row.MinMs = ExecuteMinMs;
+            OutRows.Add(Row);
+        }
+    }
+
+    static FString EscapeCsv(const FString& Field)
+    {
+        return Field.Contains(TEXT(",")) || Field.Contains(TEXT("\""))
+            ? TEXT("\"") + Field.Replace(TEXT("\""), TEXT("\"\"")) + TEXT("\"")
+            : Field;
+    }
+
+    static void WriteResults(const FString& BasePath, const TArray<FRow>& Rows)
+    {
+        TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("ShaderMod"));
+        const FString PluginVersion = Plugin ? Plugin->GetDescriptor().VersionName : FString(TEXT("Unknown"));
+        const FString RHIName = GDynamicRHI ? FString(GDynamicRHI->GetName()) : FString(TEXT("None"));
+
+        FString Csv = TEXT("suite,case,iterations,mean_ms,min_ms,value,unit\n");
+        for (const FRow& Row : Rows)
+        {
+            Csv += FString::Printf(TEXT("%s,%s,%d,%.4f,%.4f,%.4f,%s\n"),
+                *EscapeCsv(Row.Suite), *EscapeCsv(Row.Case), Row.Iterations, Row.MeanMs, Row.MinMs, Row.Value, *EscapeCsv(Row.Unit));
+        }
+        FFileHelper::SaveStringToFile(Csv, *(BasePath + TEXT(".csv")));
+
+        TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+        Root->SetStringField(TEXT("pluginVersion"), PluginVersion);
+        Root->SetStringField(TEXT("rhi"), RHIName);
+        Root->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+        Root->SetNumberField(TEXT("logicalCores"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+        TArray<TSharedPtr<FJsonValue>> JsonRows;
+        for (const FRow& Row : Rows)
+        {
+            TSharedRef<FJsonObject> JsonRow = MakeShared<FJsonObject>();
+            JsonRow->SetStringField(TEXT("suite"), Row.Suite);
+            JsonRow->SetStringField(TEXT("case"), Row.Case);
+            JsonRow->SetNumberField(TEXT("iterations"), Row.Iterations);
+            JsonRow->SetNumberField(TEXT("meanMs"), Row.MeanMs);
+            JsonRow->SetNumberField(TEXT("minMs"), Row.MinMs);
+            JsonRow->SetNumberField(TEXT("value"), Row.Value);
+            JsonRow->SetStringField(TEXT("unit"), Row.Unit);
+            JsonRows.Add(MakeShared<FJsonValueObject>(JsonRow));
+        }
+        Root->SetArrayField(TEXT("results"), JsonRows);
+
+        FString Json;
+        TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+        FJsonSerializer::Serialize(Root, Writer);
+        FFileHelper::SaveStringToFile(Json, *(BasePath + TEXT(".json")));
+    }
+}
+
+/*
+ * Runs every benchmark of the module and writes the results to Saved/Profiling/ShaderMod/<Name>.csv and .json.
+ * Suites: ResizeTexture per source size and filter, the CPU kernel per effect combination, dispatches issued per
+ * Execute call and per frame of slider changes, and the cost of recording and executing the RDG graph of a dispatch.
+ * Usage: ShaderMod.BenchSuite [Iterations] [Name]
+ */
+static FAutoConsoleCommand GWriteToRenderTargetBenchSuiteCommand(
+    TEXT("ShaderMod.BenchSuite"),
+    TEXT("Runs the WriteToRenderTarget benchmark suite and writes CSV and JSON to Saved/Profiling/ShaderMod. Usage: ShaderMod.BenchSuite [Iterations] [Name]"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        using namespace WriteToRenderTargetBenchmark;
+
+        UWriteToRenderTargetSubsystem* Subsystem = UWriteToRenderTargetSubsystem::Get();
+        if (!Subsystem)
+        {
+            return;
+        }
+
+        const int32 Iterations = Args.Num() > 0 ? FMath::Clamp(FCString::Atoi(*Args[0]), 1, 1000) : 10;
+        const FString Name = Args.Num() > 1 ? Args[1] : FString::Printf(TEXT("BenchSuite-%s"), *FDateTime::Now().ToString());
+
+        TArray<FRow> Rows;
+        const FWriteToRenderTargetHandle Handle = Subsystem->CreateProcessor();
+        RunResize(Subsystem->GetProcessor(Handle), Iterations, Rows);
+        Subsystem->ReleaseProcessor(Handle);
+        RunKernel(Iterations, Rows);
+        RunDispatchCounts(Subsystem, Iterations, Rows);
+        RunGraph(Iterations, Rows);
+
+        for (const FRow& Row : Rows)
+        {
+            UE_LOG(LogTemp, Display, TEXT("ShaderMod.BenchSuite %-14s %-40s mean %8.3f ms  min %8.3f ms  %10.2f %s"),
+                *Row.Suite, *Row.Case, Row.MeanMs, Row.MinMs, Row.Value, *Row.Unit);
+        }
+
+        const FString Directory = FPaths::Combine(FPaths::ProfilingDir(), TEXT("ShaderMod"));
+        IFileManager::Get().MakeDirectory(*Directory, true);
+        const FString BasePath = FPaths::Combine(Directory, Name);
+        WriteResults(BasePath, Rows);
+        UE_LOG(LogTemp, Display, TEXT("ShaderMod.BenchSuite - %d results written to %s.csv and .json"), Rows.Num(), *BasePath);
+    }));
@@ -0,0 +1,1249 @@
+#include "WriteToRenderTarget/WriteToRenderTargetCPU.h"
+#include "WriteToRenderTarget/WriteToRenderTargetEffects.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "ImageCore.h"
+#include "Misc/App.h"
+#include "WriteToRenderTarget/WriteToRenderTargetResampler.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTiled.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS && PLATFORM_CPU_X86_FAMILY
+#include <emmintrin.h>
+#define WRITETORENDERTARGET_PACKED_SSE2 1
+#else
+#define WRITETORENDERTARGET_PACKED_SSE2 0
+#endif
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetPackedColor(
+    TEXT("r.ShaderMod.PackedColor"),
+    1,
+    TEXT("Lets the CPU kernel apply greyscale, contrast, invert and brightness to point sampled inputs in 8-bit fixed point.\n")
+    TEXT("0: always in float\n")
+    TEXT("1: in fixed point when the folded color transform allows it, at most one 8-bit step from the float result"),
+    ECVF_Default);
+
+namespace WriteToRenderTargetCPU
+{
+    /*
+     * The folded color transform in 8-bit fixed point, for the transforms that treat R, G and B alike and keep alpha:
+     * Scale covers contrast, invert, brightness and their combinations (C' = A * C + B on each channel), Luma the same
+     * after greyscale (C' = A * (0.3 R + 0.6 G + 0.1 B) + B on all three). Four BGRA8 pixels share one 128-bit register
+     * from load to store, where the float path holds one pixel per register.
+     * Error bound against the float path: Scale keeps three fractional bits after a Q12 multiply and Luma sums Q12
+     * weights in 32 bits, so the value before rounding is off by less than 0.22 and 0.1 of an 8-bit step. A channel
+     * therefore differs by at most one step, and only where the exact value lies that close to a rounding boundary
+     * (ShaderMod.WriteToRenderTarget.PackedColor test). ApplyScalar is the bit-exact fallback of ApplyRow for platforms without SSE2.
+     */
+    struct FPackedColor
+    {
+        enum class EMode : uint8
+        {
+            None,       // Float path
+            Identity,   // Texels are copied as they are, exact
+            Scale,
+            Luma
+        };
+
+        EMode Mode = EMode::None;
+
+        // Scale, per channel in memory order (B, G, R, A): Q12 factors and offsets in eighths of a step, rounding included
+        int16 Factors[4] = {};
+        int16 Offsets[4] = {};
+
+        // Luma: Q12 weights in memory order and the Q12 offset, rounding included
+        int16 Weights[4] = {};
+        int32 LumaOffset = 0;
+
+        static FPackedColor Make(const FWriteToRenderTargetFusedEffects& Effects)
+        {
+            FPackedColor Packed;
+            if (Effects.IsIdentityColor())
+            {
+                Packed.Mode = EMode::Identity;
+                return Packed;
+            }
+
+            // Alpha passes through and does not feed RGB, and the three channels get the same offset
+            const FMatrix44f& Matrix = Effects.ColorMatrix;
+            const FVector4f& Offset = Effects.ColorOffset;
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                if (Matrix.M[3][Channel] != 0.0f || Matrix.M[Channel][3] != 0.0f || Offset[Channel] != Offset[0])
+                {
+                    return Packed;
+                }
+            }
+            if (Matrix.M[3][3] != 1.0f || Offset[3] != 0.0f)
+            {
+                return Packed;
+            }
+
+            auto ToQ12 = [](float Value, int16& OutValue)
+            {
+                const float Scaled = FMath::RoundToFloat(Value * 4096.0f);
+                OutValue = (int16)FMath::Clamp(Scaled, -32768.0f, 32767.0f);
+                return FMath::Abs(Scaled) <= 32767.0f;
+            };
+
+            const bool bDiagonal = Matrix.M[0][0] == Matrix.M[1][1] && Matrix.M[1][1] == Matrix.M[2][2]
+                && Matrix.M[0][1] == 0.0f && Matrix.M[0][2] == 0.0f && Matrix.M[1][0] == 0.0f
+                && Matrix.M[1][2] == 0.0f && Matrix.M[2][0] == 0.0f && Matrix.M[2][1] == 0.0f;
+            int16 Factor = 0;
+            // |A| below 8 and |B| below 4 keep every intermediate inside int16
+            if (bDiagonal && ToQ12(Matrix.M[0][0], Factor) && FMath::Abs(Offset[0]) < 4.0f)
+            {
+                const int16 OffsetQ3 = (int16)(FMath::RoundToInt(Offset[0] * 255.0f * 8.0f) + 4);
+                for (int32 Channel = 0; Channel < 3; ++Channel)
+                {
+                    Packed.Factors[Channel] = Factor;
+                    Packed.Offsets[Channel] = OffsetQ3;
+                }
+                Packed.Factors[3] = 4096;
+                Packed.Offsets[3] = 4;
+                Packed.Mode = EMode::Scale;
+                return Packed;
+            }
+
+            // Greyscale folded with the rest: every output channel reads the same weighted sum
+            bool bLuma = FMath::Abs(Offset[0]) < 64.0f;
+            for (int32 Row = 0; Row < 3; ++Row)
+            {
+                bLuma &= Matrix.M[Row][0] == Matrix.M[Row][1] && Matrix.M[Row][1] == Matrix.M[Row][2];
+            }
+            // Rows are R, G, B; the weights are stored in memory order
+            if (bLuma && ToQ12(Matrix.M[2][0], Packed.Weights[0]) && ToQ12(Matrix.M[1][0], Packed.Weights[1]) && ToQ12(Matrix.M[0][0], Packed.Weights[2]))
+            {
+                Packed.Weights[3] = 0;
+                Packed.LumaOffset = FMath::RoundToInt(Offset[0] * 255.0f * 4096.0f) + 2048;
+                Packed.Mode = EMode::Luma;
+            }
+            return Packed;
+        }
+
+        // Mirrors the SSE2 sequence of ApplyRow lane by lane: mulhi, saturating add, arithmetic shift, clamp
+        static FORCEINLINE uint8 ScaleChannel(uint8 Value, int16 Factor, int16 Offset)
+        {
+            const int32 Product = ((int32)Value * 128 * Factor) >> 16;
+            const int32 Shifted = FMath::Clamp(Product + Offset, -32768, 32767) >> 3;
+            return (uint8)FMath::Clamp(Shifted, 0, 255);
+        }
+
+        void ApplyScalar(FColor* Pixels, int32 NumPixels) const
+        {
+            for (int32 Index = 0; Index < NumPixels; ++Index)
+            {
+                FColor& Pixel = Pixels[Index];
+                if (Mode == EMode::Scale)
+                {
+                    Pixel.B = ScaleChannel(Pixel.B, Factors[0], Offsets[0]);
+                    Pixel.G = ScaleChannel(Pixel.G, Factors[1], Offsets[1]);
+                    Pixel.R = ScaleChannel(Pixel.R, Factors[2], Offsets[2]);
+                    Pixel.A = ScaleChannel(Pixel.A, Factors[3], Offsets[3]);
+                }
+                else if (Mode == EMode::Luma)
+                {
+                    const int32 Sum = Pixel.B * Weights[0] + Pixel.G * Weights[1] + Pixel.R * Weights[2] + LumaOffset;
+                    const uint8 Value = (uint8)FMath::Clamp(Sum >> 12, 0, 255);
+                    Pixel.B = Value;
+                    Pixel.G = Value;
+                    Pixel.R = Value;
+                }
+            }
+        }
+
+        // Transforms NumPixels pixels in place, four at a time
+        void ApplyRow(FColor* Pixels, int32 NumPixels) const
+        {
+            int32 X = 0;
+#if WRITETORENDERTARGET_PACKED_SSE2
+            // As 16-bit lanes a pixel is [B | G << 8, R | A << 8]: the low bytes give B and R, the high bytes G and A
+            auto PairLanes = [](int16 Low, int16 High) { return _mm_set1_epi32((int32)((uint32)(uint16)Low | ((uint32)(uint16)High << 16))); };
+            const __m128i LowBytes = _mm_set1_epi16(0xFF);
+            if (Mode == EMode::Scale)
+            {
+                const __m128i FactorsBR = PairLanes(Factors[0], Factors[2]);
+                const __m128i FactorsGA = PairLanes(Factors[1], Factors[3]);
+                const __m128i OffsetsBR = PairLanes(Offsets[0], Offsets[2]);
+                const __m128i OffsetsGA = PairLanes(Offsets[1], Offsets[3]);
+                const __m128i Zero = _mm_setzero_si128();
+                const __m128i MaxValue = _mm_set1_epi16(255);
+                for (; X + 4 <= NumPixels; X += 4)
+                {
+                    __m128i* Ptr = reinterpret_cast<__m128i*>(Pixels + X);
+                    const __m128i Pixels4 = _mm_loadu_si128(Ptr);
+                    // Value << 7 times a Q12 factor, high half: the result in eighths of a step
+                    __m128i BR = _mm_mulhi_epi16(_mm_slli_epi16(_mm_and_si128(Pixels4, LowBytes), 7), FactorsBR);
+                    __m128i GA = _mm_mulhi_epi16(_mm_slli_epi16(_mm_srli_epi16(Pixels4, 8), 7), FactorsGA);
+                    BR = _mm_srai_epi16(_mm_adds_epi16(BR, OffsetsBR), 3);
+                    GA = _mm_srai_epi16(_mm_adds_epi16(GA, OffsetsGA), 3);
+                    BR = _mm_min_epi16(_mm_max_epi16(BR, Zero), MaxValue);
+                    GA = _mm_min_epi16(_mm_max_epi16(GA, Zero), MaxValue);
+                    _mm_storeu_si128(Ptr, _mm_or_si128(BR, _mm_slli_epi16(GA, 8)));
+                }
+            }
+            else if (Mode == EMode::Luma)
+            {
+                const __m128i WeightsBR = PairLanes(Weights[0], Weights[2]);
+                const __m128i WeightsGA = PairLanes(Weights[1], Weights[3]);
+                const __m128i Offset = _mm_set1_epi32(LumaOffset);
+                const __m128i AlphaMask = _mm_set1_epi32((int32)0xFF000000);
+                for (; X + 4 <= NumPixels; X += 4)
+                {
+                    __m128i* Ptr = reinterpret_cast<__m128i*>(Pixels + X);
+                    const __m128i Pixels4 = _mm_loadu_si128(Ptr);
+                    // One 32-bit weighted sum per pixel, saturated to a byte and replicated into B, G and R
+                    const __m128i Sum = _mm_add_epi32(_mm_add_epi32(
+                        _mm_madd_epi16(_mm_and_si128(Pixels4, LowBytes), WeightsBR),
+                        _mm_madd_epi16(_mm_srli_epi16(Pixels4, 8), WeightsGA)), Offset);
+                    __m128i Value = _mm_srai_epi32(Sum, 12);
+                    Value = _mm_packs_epi32(Value, Value);
+                    Value = _mm_packus_epi16(Value, Value);
+                    Value = _mm_unpacklo_epi8(Value, Value);
+                    Value = _mm_unpacklo_epi16(Value, Value);
+                    _mm_storeu_si128(Ptr, _mm_or_si128(_mm_andnot_si128(AlphaMask, Value), _mm_and_si128(Pixels4, AlphaMask)));
+                }
+            }
+#endif
+            ApplyScalar(Pixels + X, NumPixels - X);
+        }
+    };
+
+    /*
+     * Per-dispatch constants derived once from the effect parameters: the folded effect stack, with the color
+     * matrix swizzled to the memory order of the samples (B, G, R, A) so a pixel costs four multiply-adds,
+     * and its fixed point form when point sampled inputs can take the packed path.
+     */
+    struct FKernelConstants
+    {
+        float InvDestSizeX = 1.0f;
+        float InvDestSizeY = 1.0f;
+        FWriteToRenderTargetFusedEffects Effects;
+        bool bIdentityColor = true;
+        VectorRegister4Float ColorRows[4];
+        VectorRegister4Float ColorOffset;
+        FPackedColor PackedColor;
+    };
+
+    FKernelConstants MakeKernelConstants(const FWriteToRenderTargetEffectParams& Params, int32 DestSizeX, int32 DestSizeY)
+    {
+        FKernelConstants Constants;
+        Constants.InvDestSizeX = 1.0f / DestSizeX;
+        Constants.InvDestSizeY = 1.0f / DestSizeY;
+        Constants.Effects = FWriteToRenderTargetFusedEffects::Fold(Params);
+        Constants.bIdentityColor = Constants.Effects.IsIdentityColor();
+        if (CVarWriteToRenderTargetPackedColor.GetValueOnAnyThread() != 0)
+        {
+            Constants.PackedColor = FPackedColor::Make(Constants.Effects);
+        }
+
+        // RGBA index of each BGRA memory channel
+        const int32 Channel[4] = { 2, 1, 0, 3 };
+        const FMatrix44f& Matrix = Constants.Effects.ColorMatrix;
+        for (int32 Row = 0; Row < 4; ++Row)
+        {
+            Constants.ColorRows[Row] = MakeVectorRegisterFloat(
+                Matrix.M[Channel[Row]][Channel[0]], Matrix.M[Channel[Row]][Channel[1]], Matrix.M[Channel[Row]][Channel[2]], Matrix.M[Channel[Row]][Channel[3]]);
+        }
+        const FVector4f& Offset = Constants.Effects.ColorOffset;
+        Constants.ColorOffset = MakeVectorRegisterFloat(Offset[Channel[0]], Offset[Channel[1]], Offset[Channel[2]], Offset[Channel[3]]);
+        return Constants;
+    }
+
+    // Mirrors the shader's point sampler, which clamps: texel = clamp(floor(UV * Size), 0, Size - 1)
+    FORCEINLINE VectorRegister4Float ClampToTexel(const VectorRegister4Float& UV, const VectorRegister4Float& Size, const VectorRegister4Float& MaxTexel)
+    {
+        return VectorMin(VectorMax(VectorFloor(VectorMultiply(UV, Size)), VectorZero()), MaxTexel);
+    }
+
+    // Float samples of a point sampler: its texels converted to 0..1
+    template<typename SamplerType>
+    FORCEINLINE void SampleTexels(const SamplerType& Sampler, const VectorRegister4Float& U, const VectorRegister4Float& V, int32 NumLanes, VectorRegister4Float* OutColors)
+    {
+        const VectorRegister4Float Inv255 = VectorSetFloat1(1.0f / 255.0f);
+        FColor Texels[4];
+        Sampler.FetchLanes(U, V, NumLanes, Texels);
+        for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+        {
+            OutColors[Lane] = VectorMultiply(VectorLoadByte4(&Texels[Lane]), Inv255);
+        }
+    }
+
+    /*
+     * Point sampler with clamp addressing on a single BGRA8 level, used when the input already matches the render target.
+     */
+    struct FPointSampler
+    {
+        const FColor* Source;
+        int32 SourceSizeX;
+        VectorRegister4Float SizeX;
+        VectorRegister4Float SizeY;
+        VectorRegister4Float MaxTexelX;
+        VectorRegister4Float MaxTexelY;
+
+        FPointSampler(const FColor* InSource, int32 InSizeX, int32 InSizeY)
+            : Source(InSource)
+            , SourceSizeX(InSizeX)
+            , SizeX(VectorSetFloat1((float)InSizeX))
+            , SizeY(VectorSetFloat1((float)InSizeY))
+            , MaxTexelX(VectorSetFloat1((float)(InSizeX - 1)))
+            , MaxTexelY(VectorSetFloat1((float)(InSizeY - 1)))
+        {
+        }
+
+        // Texels are read as stored, so the packed color path can work on them directly
+        static constexpr bool bPointSampled = true;
+
+        // Copies the NumLanes texels sampled at U, V
+        FORCEINLINE void FetchLanes(const VectorRegister4Float& U, const VectorRegister4Float& V, int32 NumLanes, FColor* OutTexels) const
+        {
+            alignas(16) float TexelX[4];
+            alignas(16) float TexelY[4];
+            VectorStoreAligned(ClampToTexel(U, SizeX, MaxTexelX), TexelX);
+            VectorStoreAligned(ClampToTexel(V, SizeY, MaxTexelY), TexelY);
+
+            for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+            {
+                OutTexels[Lane] = Source[(int64)TexelY[Lane] * SourceSizeX + (int32)TexelX[Lane]];
+            }
+        }
+
+        // Fetches NumLanes samples as float4 in memory order (B, G, R, A), 0..1
+        FORCEINLINE void SampleLanes(const VectorRegister4Float& U, const VectorRegister4Float& V, int32 NumLanes, VectorRegister4Float* OutColors) const
+        {
+            SampleTexels(*this, U, V, NumLanes, OutColors);
+        }
+    };
+
+    /*
+     * Point sampler over a copy of only part of the source, used by ExecuteTiled. Texels are computed on the whole
+     * source exactly like FPointSampler, then looked up in the region, which starts at RegionX, RegionY.
+     */
+    struct FRegionSampler
+    {
+        const FColor* Region;
+        int32 RegionX;
+        int32 RegionY;
+        int32 RegionSizeX;
+        VectorRegister4Float SizeX;
+        VectorRegister4Float SizeY;
+        VectorRegister4Float MaxTexelX;
+        VectorRegister4Float MaxTexelY;
+
+        FRegionSampler(const FColor* InRegion, int32 InRegionX, int32 InRegionY, int32 InRegionSizeX, int32 InSourceSizeX, int32 InSourceSizeY)
+            : Region(InRegion)
+            , RegionX(InRegionX)
+            , RegionY(InRegionY)
+            , RegionSizeX(InRegionSizeX)
+            , SizeX(VectorSetFloat1((float)InSourceSizeX))
+            , SizeY(VectorSetFloat1((float)InSourceSizeY))
+            , MaxTexelX(VectorSetFloat1((float)(InSourceSizeX - 1)))
+            , MaxTexelY(VectorSetFloat1((float)(InSourceSizeY - 1)))
+        {
+        }
+
+        static constexpr bool bPointSampled = true;
+
+        FORCEINLINE void FetchLanes(const VectorRegister4Float& U, const VectorRegister4Float& V, int32 NumLanes, FColor* OutTexels) const
+        {
+            alignas(16) float TexelX[4];
+            alignas(16) float TexelY[4];
+            VectorStoreAligned(ClampToTexel(U, SizeX, MaxTexelX), TexelX);
+            VectorStoreAligned(ClampToTexel(V, SizeY, MaxTexelY), TexelY);
+
+            for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+            {
+                const int32 LocalX = (int32)TexelX[Lane] - RegionX;
+                const int32 LocalY = (int32)TexelY[Lane] - RegionY;
+                OutTexels[Lane] = Region[(int64)LocalY * RegionSizeX + LocalX];
+            }
+        }
+
+        FORCEINLINE void SampleLanes(const VectorRegister4Float& U, const VectorRegister4Float& V, int32 NumLanes, VectorRegister4Float* OutColors) const
+        {
+            SampleTexels(*this, U, V, NumLanes, OutColors);
+        }
+    };
+
+    /*
+     * Trilinear sampler with clamp addressing over a mip chain, the CPU equivalent of SampleLevel through
+     * a trilinear sampler state. The LOD is constant over the image since it only depends on the size ratio and scale.
+     */
+    struct FTrilinearSampler
+    {
+        TArrayView<const FWriteToRenderTargetCPUMip> Mips;
+        int32 MipA = 0;
+        int32 MipB = 0;
+        float MipBlend = 0.0f;
+
+        // Filtered samples are not bytes of the input, they always take the float path
+        static constexpr bool bPointSampled = false;
+
+        FTrilinearSampler(TArrayView<const FWriteToRenderTargetCPUMip> InMips, float Lod)
+            : Mips(InMips)
+        {
+            const float ClampedLod = FMath::Clamp(Lod, 0.0f, (float)(Mips.Num() - 1));
+            MipA = FMath::FloorToInt(ClampedLod);
+            MipB = FMath::Min(MipA + 1, Mips.Num() - 1);
+            MipBlend = ClampedLod - MipA;
+        }
+
+        static FORCEINLINE VectorRegister4Float SampleBilinear(const FWriteToRenderTargetCPUMip& Mip, float U, float V)
+        {
+            const float X = U * Mip.SizeX - 0.5f;
+            const float Y = V * Mip.SizeY - 0.5f;
+            const float FloorX = FMath::FloorToFloat(X);
+            const float FloorY = FMath::FloorToFloat(Y);
+            const VectorRegister4Float FracX = VectorSetFloat1(X - FloorX);
+            const VectorRegister4Float FracY = VectorSetFloat1(Y - FloorY);
+
+            // Clamp addressing on both taps of each axis, in float so far out UVs cannot overflow
+            const int32 X0 = (int32)FMath::Clamp(FloorX, 0.0f, (float)(Mip.SizeX - 1));
+            const int32 Y0 = (int32)FMath::Clamp(FloorY, 0.0f, (float)(Mip.SizeY - 1));
+            const int32 X1 = (int32)FMath::Clamp(FloorX + 1.0f, 0.0f, (float)(Mip.SizeX - 1));
+            const int32 Y1 = (int32)FMath::Clamp(FloorY + 1.0f, 0.0f, (float)(Mip.SizeY - 1));
+
+            const FColor* Row0 = Mip.Pixels + (int64)Y0 * Mip.SizeX;
+            const FColor* Row1 = Mip.Pixels + (int64)Y1 * Mip.SizeX;
+            const VectorRegister4Float Top = VectorLerp(VectorLoadByte4(&Row0[X0]), VectorLoadByte4(&Row0[X1]), FracX);
+            const VectorRegister4Float Bottom = VectorLerp(VectorLoadByte4(&Row1[X0]), VectorLoadByte4(&Row1[X1]), FracX);
+            return VectorLerp(Top, Bottom, FracY);
+        }
+
+        FORCEINLINE void SampleLanes(const VectorRegister4Float& U, const VectorRegister4Float& V, int32 NumLanes, VectorRegister4Float* OutColors) const
+        {
+            const VectorRegister4Float Inv255 = VectorSetFloat1(1.0f / 255.0f);
+            const VectorRegister4Float Blend = VectorSetFloat1(MipBlend);
+            alignas(16) float LaneU[4];
+            alignas(16) float LaneV[4];
+            VectorStoreAligned(U, LaneU);
+            VectorStoreAligned(V, LaneV);
+
+            for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+            {
+                VectorRegister4Float Color = SampleBilinear(Mips[MipA], LaneU[Lane], LaneV[Lane]);
+                if (MipB != MipA)
+                {
+                    Color = VectorLerp(Color, SampleBilinear(Mips[MipB], LaneU[Lane], LaneV[Lane]), Blend);
+                }
+                OutColors[Lane] = VectorMultiply(Color, Inv255);
+            }
+        }
+    };
+
+    /*
+     * Applies the folded color transform to one sample in memory order (B, G, R, A).
+     * Output is rounded like a UNORM render target write.
+     */
+    FORCEINLINE void ShadeColor(VectorRegister4Float Color, FColor& Out, const FKernelConstants& Constants)
+    {
+        if (!Constants.bIdentityColor)
+        {
+            VectorRegister4Float Result = VectorMultiplyAdd(VectorReplicate(Color, 0), Constants.ColorRows[0], Constants.ColorOffset);
+            Result = VectorMultiplyAdd(VectorReplicate(Color, 1), Constants.ColorRows[1], Result);
+            Result = VectorMultiplyAdd(VectorReplicate(Color, 2), Constants.ColorRows[2], Result);
+            Color = VectorMultiplyAdd(VectorReplicate(Color, 3), Constants.ColorRows[3], Result);
+        }
+        Color = VectorMin(VectorMax(Color, VectorZero()), VectorOne());
+        VectorStoreByte4(VectorMultiplyAdd(Color, VectorSetFloat1(255.0f), VectorSetFloat1(0.5f)), &Out);
+    }
+
+    // One affine UV stage on four lanes
+    FORCEINLINE void ApplyUVStage(const FWriteToRenderTargetUVTransform& Stage, VectorRegister4Float& U, VectorRegister4Float& V)
+    {
+        const VectorRegister4Float NewU = VectorMultiplyAdd(U, VectorSetFloat1(Stage.Matrix.X), VectorMultiplyAdd(V, VectorSetFloat1(Stage.Matrix.Y), VectorSetFloat1(Stage.Offset.X)));
+        V = VectorMultiplyAdd(U, VectorSetFloat1(Stage.Matrix.Z), VectorMultiplyAdd(V, VectorSetFloat1(Stage.Matrix.W), VectorSetFloat1(Stage.Offset.Y)));
+        U = NewU;
+    }
+
+    /*
+     * Sample positions of the destination pixels [X0, X1) of row Y, at most FWriteToRenderTargetCPU::TileSize of them,
+     * written to OutU/OutV rounded up to a multiple of four. The UV math is evaluated for four pixels at a time.
+     * Kept out of line so shading and the source footprint pass of ExecuteTiled run the exact same instructions:
+     * both then address the same texels, bit for bit.
+     */
+    FORCENOINLINE void ComputeRowUVs(const FKernelConstants& Constants, int32 Y, int32 X0, int32 X1, float* OutU, float* OutV)
+    {
+        const FWriteToRenderTargetFusedEffects& Effects = Constants.Effects;
+        const FWriteToRenderTargetUVTransform& FirstStage = Effects.UVStages[0];
+        const VectorRegister4Float LaneOffsets = MakeVectorRegisterFloat(0.0f, 1.0f, 2.0f, 3.0f);
+        const VectorRegister4Float Ten = VectorSetFloat1(10.0f);
+        const VectorRegister4Float InvDestSizeX = VectorSetFloat1(Constants.InvDestSizeX);
+        const VectorRegister4Float FirstStageM00 = VectorSetFloat1(FirstStage.Matrix.X);
+        const VectorRegister4Float FirstStageM10 = VectorSetFloat1(FirstStage.Matrix.Z);
+
+        // Row-constant part of the first stage: U' = M00 * U + (M01 * V + Tx), V' = M10 * U + (M11 * V + Ty)
+        const float V = Y * Constants.InvDestSizeY;
+        const VectorRegister4Float RowU = VectorSetFloat1(FirstStage.Matrix.Y * V + FirstStage.Offset.X);
+        const VectorRegister4Float RowV = VectorSetFloat1(FirstStage.Matrix.W * V + FirstStage.Offset.Y);
+
+        for (int32 X = X0; X < X1; X += 4)
+        {
+            const VectorRegister4Float U = VectorMultiply(VectorAdd(VectorSetFloat1((float)X), LaneOffsets), InvDestSizeX);
+            VectorRegister4Float SampleU = VectorMultiplyAdd(U, FirstStageM00, RowU);
+            VectorRegister4Float SampleV = VectorMultiplyAdd(U, FirstStageM10, RowV);
+
+            for (int32 Distortion = 0; Distortion < Effects.NumDistortions; ++Distortion)
+            {
+                const VectorRegister4Float Strength = VectorSetFloat1(Effects.DistortionStrengths[Distortion]);
+                const VectorRegister4Float DistortedU = VectorMultiplyAdd(VectorSin(VectorMultiply(SampleV, Ten)), Strength, SampleU);
+                SampleV = VectorMultiplyAdd(VectorSin(VectorMultiply(SampleU, Ten)), Strength, SampleV);
+                SampleU = DistortedU;
+                ApplyUVStage(Effects.UVStages[Distortion + 1], SampleU, SampleV);
+            }
+
+            VectorStoreAligned(SampleU, OutU + (X - X0));
+            VectorStoreAligned(SampleV, OutV + (X - X0));
+        }
+    }
+
+    /*
+     * Processes the destination rectangle [X0, X1) x [Y0, Y1), at most FWriteToRenderTargetCPU::TileSize wide.
+     * Dest holds the pixels from DestOrigin on, DestStride pixels per row. The texel fetch is a scalar gather
+     * since the sample positions are arbitrary after rotation and distortion. Point sampled inputs whose color
+     * transform has a fixed point form (FPackedColor) never leave 8 bits.
+     */
+    template<typename SamplerType>
+    void ShadeTile(
+        const SamplerType& Sampler,
+        FColor* Dest, int32 DestStride, FIntPoint DestOrigin,
+        int32 X0, int32 Y0, int32 X1, int32 Y1,
+        const FKernelConstants& Constants)
+    {
+        check(X1 - X0 <= FWriteToRenderTargetCPU::TileSize);
+        alignas(16) float RowU[FWriteToRenderTargetCPU::TileSize];
+        alignas(16) float RowV[FWriteToRenderTargetCPU::TileSize];
+
+        // Packed path: the texels land in the destination row as they are and the color transform runs on them in place
+        if constexpr (SamplerType::bPointSampled)
+        {
+            if (Constants.PackedColor.Mode != FPackedColor::EMode::None)
+            {
+                for (int32 Y = Y0; Y < Y1; ++Y)
+                {
+                    ComputeRowUVs(Constants, Y, X0, X1, RowU, RowV);
+                    FColor* DestRow = Dest + (int64)(Y - DestOrigin.Y) * DestStride + (X0 - DestOrigin.X);
+                    for (int32 X = 0; X < X1 - X0; X += 4)
+                    {
+                        Sampler.FetchLanes(VectorLoadAligned(RowU + X), VectorLoadAligned(RowV + X), FMath::Min(4, X1 - X0 - X), DestRow + X);
+                    }
+                    Constants.PackedColor.ApplyRow(DestRow, X1 - X0);
+                }
+                return;
+            }
+        }
+
+        for (int32 Y = Y0; Y < Y1; ++Y)
+        {
+            ComputeRowUVs(Constants, Y, X0, X1, RowU, RowV);
+            FColor* DestRow = Dest + (int64)(Y - DestOrigin.Y) * DestStride + (X0 - DestOrigin.X);
+
+            for (int32 X = 0; X < X1 - X0; X += 4)
+            {
+                const int32 NumLanes = FMath::Min(4, X1 - X0 - X);
+                VectorRegister4Float Colors[4];
+                Sampler.SampleLanes(VectorLoadAligned(RowU + X), VectorLoadAligned(RowV + X), NumLanes, Colors);
+                for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+                {
+                    ShadeColor(Colors[Lane], DestRow[X + Lane], Constants);
+                }
+            }
+        }
+    }
+
+    // Splits the destination into tiles and shades them on all cores
+    template<typename SamplerType>
+    FWriteToRenderTargetCPUStats ShadeImage(const SamplerType& Sampler, FColor* Dest, int32 DestSizeX, int32 DestSizeY, const FWriteToRenderTargetEffectParams& Params)
+    {
+        FWriteToRenderTargetCPUStats Stats;
+        const double StartTime = FPlatformTime::Seconds();
+        const FKernelConstants Constants = MakeKernelConstants(Params, DestSizeX, DestSizeY);
+
+        const int32 TileSize = FWriteToRenderTargetCPU::TileSize;
+        const int32 TilesX = FMath::DivideAndRoundUp(DestSizeX, TileSize);
+        const int32 TilesY = FMath::DivideAndRoundUp(DestSizeY, TileSize);
+        const int32 NumTiles = TilesX * TilesY;
+
+        ParallelFor(NumTiles, [&](int32 TileIndex)
+        {
+            const int32 X0 = (TileIndex % TilesX) * TileSize;
+            const int32 Y0 = (TileIndex / TilesX) * TileSize;
+            ShadeTile(Sampler, Dest, DestSizeX, FIntPoint::ZeroValue, X0, Y0, FMath::Min(X0 + TileSize, DestSizeX), FMath::Min(Y0 + TileSize, DestSizeY), Constants);
+        });
+
+        const int32 AvailableWorkers = FApp::ShouldUseThreadingForPerformance() ? FTaskGraphInterface::Get().GetNumWorkerThreads() + 1 : 1;
+        Stats.Seconds = FPlatformTime::Seconds() - StartTime;
+        Stats.NumPixels = (int64)DestSizeX * DestSizeY;
+        Stats.NumTiles = NumTiles;
+        Stats.NumWorkers = FMath::Min(NumTiles, AvailableWorkers);
+        return Stats;
+    }
+}
+
+FWriteToRenderTargetCPUStats FWriteToRenderTargetCPU::Execute(
+    const FColor* Source, int32 SourceSizeX, int32 SourceSizeY,
+    FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+    const FWriteToRenderTargetEffectParams& Params)
+{
+    FWriteToRenderTargetCPUStats Stats;
+    if (!Source || !Dest || SourceSizeX <= 0 || SourceSizeY <= 0 || DestSizeX <= 0 || DestSizeY <= 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("FWriteToRenderTargetCPU::Execute - Invalid source or destination."));
+        return Stats;
+    }
+
+    return WriteToRenderTargetCPU::ShadeImage(WriteToRenderTargetCPU::FPointSampler(Source, SourceSizeX, SourceSizeY), Dest, DestSizeX, DestSizeY, Params);
+}
+
+FWriteToRenderTargetCPUStats FWriteToRenderTargetCPU::ExecuteFiltered(
+    TArrayView<const FWriteToRenderTargetCPUMip> Mips,
+    FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+    const FWriteToRenderTargetEffectParams& Params)
+{
+    if (Mips.Num() == 0 || !Mips[0].Pixels || Mips[0].SizeX <= 0 || Mips[0].SizeY <= 0 || !Dest || DestSizeX <= 0 || DestSizeY <= 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("FWriteToRenderTargetCPU::ExecuteFiltered - Invalid source or destination."));
+        return FWriteToRenderTargetCPUStats();
+    }
+
+    const FVector2f Ratio((float)Mips[0].SizeX / DestSizeX, (float)Mips[0].SizeY / DestSizeY);
+    const float Lod = ComputeInputLod(Ratio, FWriteToRenderTargetFusedEffects::Fold(Params).GetImageScale());
+    return WriteToRenderTargetCPU::ShadeImage(WriteToRenderTargetCPU::FTrilinearSampler(Mips, Lod), Dest, DestSizeX, DestSizeY, Params);
+}
+
+FWriteToRenderTargetCPUStats FWriteToRenderTargetCPU::ExecuteImage(
+    const FImage& Source,
+    FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+    const FWriteToRenderTargetEffectParams& Params)
+{
+    if (Source.Format != ERawImageFormat::BGRA8)
+    {
+        UE_LOG(LogTemp, Error, TEXT("FWriteToRenderTargetCPU::ExecuteImage - The source has to be BGRA8."));
+        return FWriteToRenderTargetCPUStats();
+    }
+
+    const TArrayView64<const FColor> SourcePixels = Source.AsBGRA8();
+    if (Params.bResampleInKernel && (Source.SizeX != DestSizeX || Source.SizeY != DestSizeY))
+    {
+        // Same rule as the RDG path: mismatched inputs are sampled at native size through their mip chain
+        TArray<FImage> LowerMips;
+        BuildMipChain(SourcePixels.GetData(), Source.SizeX, Source.SizeY, LowerMips);
+
+        TArray<FWriteToRenderTargetCPUMip> Mips;
+        Mips.Add({ SourcePixels.GetData(), Source.SizeX, Source.SizeY });
+        for (FImage& Mip : LowerMips)
+        {
+            Mips.Add({ Mip.AsBGRA8().GetData(), Mip.SizeX, Mip.SizeY });
+        }
+        return ExecuteFiltered(Mips, Dest, DestSizeX, DestSizeY, Params);
+    }
+
+    return Execute(SourcePixels.GetData(), Source.SizeX, Source.SizeY, Dest, DestSizeX, DestSizeY, Params);
+}
+
+FWriteToRenderTargetCPUStats FWriteToRenderTargetCPU::ExecutePreview(
+    const FImage& Source,
+    FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+    const FWriteToRenderTargetEffectParams& Params,
+    FIntPoint ShadedExtent)
+{
+    if (ShadedExtent == FIntPoint(DestSizeX, DestSizeY))
+    {
+        return ExecuteImage(Source, Dest, DestSizeX, DestSizeY, Params);
+    }
+
+    TArray<FColor> Preview;
+    Preview.SetNumUninitialized(ShadedExtent.X * ShadedExtent.Y);
+    FWriteToRenderTargetCPUStats Stats = ExecuteImage(Source, Preview.GetData(), ShadedExtent.X, ShadedExtent.Y, Params);
+
+    // Alpha is stretched like the other channels, as the GPU upsample does
+    const double StartTime = FPlatformTime::Seconds();
+    FWriteToRenderTargetResampler::Resample(Preview.GetData(), ShadedExtent.X, ShadedExtent.Y, Dest, DestSizeX, DestSizeY, EWriteToRenderTargetResampleFilter::Bilinear, false);
+    Stats.Seconds += FPlatformTime::Seconds() - StartTime;
+    return Stats;
+}
+
+namespace WriteToRenderTargetCPU
+{
+    // Interval [Start, Start + Length) of one source axis
+    struct FAxisSpan
+    {
+        int32 Start = 0;
+        int32 Length = 0;
+    };
+
+    // Smallest interval covering every used texel; clamped samples never reach past the edges
+    FAxisSpan FindCoveringSpan(const TBitArray<>& Used)
+    {
+        const int32 FirstUsed = Used.Find(true);
+        if (FirstUsed == INDEX_NONE)
+        {
+            return FAxisSpan();
+        }
+
+        FAxisSpan Span;
+        Span.Start = FirstUsed;
+        Span.Length = Used.FindLast(true) - FirstUsed + 1;
+        return Span;
+    }
+
+    // Marks the source texels sampled by the destination pixels of Tile, on each axis separately
+    void FindTileFootprint(const FKernelConstants& Constants, const FIntRect& Tile, int32 SourceSizeX, int32 SourceSizeY, TBitArray<>& OutUsedX, TBitArray<>& OutUsedY)
+    {
+        const int32 StripHeight = FWriteToRenderTargetCPU::TileSize;
+        const int32 NumStrips = FMath::DivideAndRoundUp(Tile.Height(), StripHeight);
+        TArray<TBitArray<>> StripUsedX;
+        TArray<TBitArray<>> StripUsedY;
+        StripUsedX.SetNum(NumStrips);
+        StripUsedY.SetNum(NumStrips);
+
+        ParallelFor(NumStrips, [&](int32 StripIndex)
+        {
+            TBitArray<>& UsedX = StripUsedX[StripIndex];
+            TBitArray<>& UsedY = StripUsedY[StripIndex];
+            UsedX.Init(false, SourceSizeX);
+            UsedY.Init(false, SourceSizeY);
+
+            const VectorRegister4Float SizeX = VectorSetFloat1((float)SourceSizeX);
+            const VectorRegister4Float SizeY = VectorSetFloat1((float)SourceSizeY);
+            const VectorRegister4Float MaxTexelX = VectorSetFloat1((float)(SourceSizeX - 1));
+            const VectorRegister4Float MaxTexelY = VectorSetFloat1((float)(SourceSizeY - 1));
+            alignas(16) float RowU[FWriteToRenderTargetCPU::TileSize];
+            alignas(16) float RowV[FWriteToRenderTargetCPU::TileSize];
+            alignas(16) float TexelX[4];
+            alignas(16) float TexelY[4];
+
+            const int32 Y0 = Tile.Min.Y + StripIndex * StripHeight;
+            const int32 Y1 = FMath::Min(Y0 + StripHeight, Tile.Max.Y);
+            for (int32 Y = Y0; Y < Y1; ++Y)
+            {
+                for (int32 X0 = Tile.Min.X; X0 < Tile.Max.X; X0 += FWriteToRenderTargetCPU::TileSize)
+                {
+                    const int32 X1 = FMath::Min(X0 + FWriteToRenderTargetCPU::TileSize, Tile.Max.X);
+                    ComputeRowUVs(Constants, Y, X0, X1, RowU, RowV);
+                    for (int32 X = 0; X < X1 - X0; X += 4)
+                    {
+                        VectorStoreAligned(ClampToTexel(VectorLoadAligned(RowU + X), SizeX, MaxTexelX), TexelX);
+                        VectorStoreAligned(ClampToTexel(VectorLoadAligned(RowV + X), SizeY, MaxTexelY), TexelY);
+                        const int32 NumLanes = FMath::Min(4, X1 - X0 - X);
+                        for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+                        {
+                            UsedX[(int32)TexelX[Lane]] = true;
+                            UsedY[(int32)TexelY[Lane]] = true;
+                        }
+                    }
+                }
+            }
+        });
+
+        OutUsedX.Init(false, SourceSizeX);
+        OutUsedY.Init(false, SourceSizeY);
+        for (int32 StripIndex = 0; StripIndex < NumStrips; ++StripIndex)
+        {
+            for (TConstSetBitIterator<> It(StripUsedX[StripIndex]); It; ++It)
+            {
+                OutUsedX[It.GetIndex()] = true;
+            }
+            for (TConstSetBitIterator<> It(StripUsedY[StripIndex]); It; ++It)
+            {
+                OutUsedY[It.GetIndex()] = true;
+            }
+        }
+    }
+}
+
+FWriteToRenderTargetCPUStats FWriteToRenderTargetCPU::ExecuteTiled(
+    FWriteToRenderTargetRowReadFunction ReadSourceRow, int32 SourceSizeX, int32 SourceSizeY,
+    int32 DestSizeX, int32 DestSizeY,
+    const FWriteToRenderTargetEffectParams& Params,
+    int32 OutputTileSize, int64 MemoryBudget,
+    TFunctionRef<void(const FIntRect& Tile, const FColor* Pixels)> WriteTile)
+{
+    using namespace WriteToRenderTargetCPU;
+
+    FWriteToRenderTargetCPUStats Stats;
+    if (SourceSizeX <= 0 || SourceSizeY <= 0 || DestSizeX <= 0 || DestSizeY <= 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("FWriteToRenderTargetCPU::ExecuteTiled - Invalid source or destination."));
+        return Stats;
+    }
+
+    const double StartTime = FPlatformTime::Seconds();
+    const FKernelConstants Constants = MakeKernelConstants(Params, DestSizeX, DestSizeY);
+    OutputTileSize = FMath::Max(OutputTileSize, TileSize);
+
+    // Output tiles in raster order; tiles over budget are replaced by their quarters, processed before the next tile
+    TArray<FIntRect> Pending;
+    for (int32 Y = FMath::DivideAndRoundUp(DestSizeY, OutputTileSize) - 1; Y >= 0; --Y)
+    {
+        for (int32 X = FMath::DivideAndRoundUp(DestSizeX, OutputTileSize) - 1; X >= 0; --X)
+        {
+            const FIntPoint Min(X * OutputTileSize, Y * OutputTileSize);
+            Pending.Add(FIntRect(Min, FIntPoint(FMath::Min(Min.X + OutputTileSize, DestSizeX), FMath::Min(Min.Y + OutputTileSize, DestSizeY))));
+        }
+    }
+
+    TArray<FColor> TilePixels;
+    TArray<FColor> Region;
+    TBitArray<> UsedX;
+    TBitArray<> UsedY;
+    int32 NumSubTiles = 0;
+    while (Pending.Num() > 0)
+    {
+        const FIntRect Tile = Pending.Pop();
+
+        // Exact source footprint of the tile, halo and clamped edges included
+        FindTileFootprint(Constants, Tile, SourceSizeX, SourceSizeY, UsedX, UsedY);
+        const FAxisSpan SpanX = FindCoveringSpan(UsedX);
+        const FAxisSpan SpanY = FindCoveringSpan(UsedY);
+
+        const int64 TileBytes = (int64)Tile.Width() * Tile.Height() * sizeof(FColor);
+        const int64 RegionBytes = (int64)SpanX.Length * SpanY.Length * sizeof(FColor);
+        const bool bCanSplit = Tile.Width() > TileSize || Tile.Height() > TileSize;
+        if (TileBytes + RegionBytes > MemoryBudget && bCanSplit)
+        {
+            // Halve every axis that is still larger than a ParallelFor tile, pushed so the first quarter comes out first
+            const FIntPoint Split(
+                Tile.Width() > TileSize ? Tile.Min.X + FMath::DivideAndRoundUp(Tile.Width() / 2, TileSize) * TileSize : Tile.Max.X,
+                Tile.Height() > TileSize ? Tile.Min.Y + FMath::DivideAndRoundUp(Tile.Height() / 2, TileSize) * TileSize : Tile.Max.Y);
+            const FIntRect Quarters[4] =
+            {
+                FIntRect(Tile.Min.X, Tile.Min.Y, Split.X, Split.Y),
+                FIntRect(Split.X, Tile.Min.Y, Tile.Max.X, Split.Y),
+                FIntRect(Tile.Min.X, Split.Y, Split.X, Tile.Max.Y),
+                FIntRect(Split.X, Split.Y, Tile.Max.X, Tile.Max.Y),
+            };
+            for (int32 Quarter = 3; Quarter >= 0; --Quarter)
+            {
+                if (Quarters[Quarter].Area() > 0)
+                {
+                    Pending.Add(Quarters[Quarter]);
+                }
+            }
+            continue;
+        }
+        if (TileBytes + RegionBytes > MemoryBudget)
+        {
+            UE_LOG(LogTemp, Verbose, TEXT("FWriteToRenderTargetCPU::ExecuteTiled - Tile %s needs %.1f MB, over the %.1f MB budget."),
+                *Tile.ToString(), (TileBytes + RegionBytes) / (1024.0 * 1024.0), MemoryBudget / (1024.0 * 1024.0));
+        }
+
+        // Read the region, one span of each source row
+        Region.SetNumUninitialized(SpanX.Length * SpanY.Length);
+        ParallelFor(SpanY.Length, [&](int32 RegionRow)
+        {
+            ReadSourceRow(SpanX.Start, SpanY.Start + RegionRow, SpanX.Length, Region.GetData() + (int64)RegionRow * SpanX.Length);
+        });
+
+        // Shade the tile on all cores, in the same ParallelFor tiles as Execute
+        const FRegionSampler Sampler(Region.GetData(), SpanX.Start, SpanY.Start, SpanX.Length, SourceSizeX, SourceSizeY);
+        TilePixels.SetNumUninitialized(Tile.Area());
+        const int32 SubTilesX = FMath::DivideAndRoundUp(Tile.Width(), TileSize);
+        const int32 SubTilesY = FMath::DivideAndRoundUp(Tile.Height(), TileSize);
+        ParallelFor(SubTilesX * SubTilesY, [&](int32 SubTileIndex)
+        {
+            const int32 X0 = Tile.Min.X + (SubTileIndex % SubTilesX) * TileSize;
+            const int32 Y0 = Tile.Min.Y + (SubTileIndex / SubTilesX) * TileSize;
+            ShadeTile(Sampler, TilePixels.GetData(), Tile.Width(), Tile.Min, X0, Y0, FMath::Min(X0 + TileSize, Tile.Max.X), FMath::Min(Y0 + TileSize, Tile.Max.Y), Constants);
+        });
+
+        WriteTile(Tile, TilePixels.GetData());
+
+        ++Stats.NumTiles;
+        NumSubTiles += SubTilesX * SubTilesY;
+        Stats.PeakWorkingBytes = FMath::Max(Stats.PeakWorkingBytes, TileBytes + RegionBytes);
+    }
+
+    const int32 AvailableWorkers = FApp::ShouldUseThreadingForPerformance() ? FTaskGraphInterface::Get().GetNumWorkerThreads() + 1 : 1;
+    Stats.Seconds = FPlatformTime::Seconds() - StartTime;
+    Stats.NumPixels = (int64)DestSizeX * DestSizeY;
+    Stats.NumWorkers = FMath::Min(NumSubTiles, AvailableWorkers);
+    return Stats;
+}
+
+float FWriteToRenderTargetCPU::ComputeInputLod(const FVector2f& ResolutionRatio, float ImageScale)
+{
+    // One output pixel covers ResolutionRatio / ImageScale input texels (must match WriteToRenderTarget.usf)
+    const float Footprint = FMath::Max(ResolutionRatio.X, ResolutionRatio.Y) / FMath::Max(FMath::Abs(ImageScale), 1.0e-5f);
+    return FMath::Max(FMath::Log2(Footprint), 0.0f);
+}
+
+void FWriteToRenderTargetCPU::BuildMipChain(const FColor* Mip0, int32 SizeX, int32 SizeY, TArray<FImage>& OutLowerMips)
+{
+    OutLowerMips.Reset();
+    const FColor* Previous = Mip0;
+    int32 PreviousX = SizeX;
+    int32 PreviousY = SizeY;
+
+    while (PreviousX > 1 || PreviousY > 1)
+    {
+        const int32 MipX = FMath::Max(PreviousX / 2, 1);
+        const int32 MipY = FMath::Max(PreviousY / 2, 1);
+        FImage& Mip = OutLowerMips.AddDefaulted_GetRef();
+        Mip.Init(MipX, MipY, ERawImageFormat::BGRA8);
+        FWriteToRenderTargetResampler::Resample(Previous, PreviousX, PreviousY, Mip.AsBGRA8().GetData(), MipX, MipY, EWriteToRenderTargetResampleFilter::Box, false);
+
+        Previous = Mip.AsBGRA8().GetData();
+        PreviousX = MipX;
+        PreviousY = MipY;
+    }
+}
+
+/*
+ * One pixel per vector, its four channels in the lanes. The sum of four bytes plus 2 is an exact integer in float,
+ * so flooring a quarter of it gives the same half-up rounding as the integer average of the GPU pass.
+ */
+void FWriteToRenderTargetCPU::DownsampleMip(const FColor* Source, int32 SourceSizeX, int32 SourceSizeY, FColor* Dest)
+{
+    const int32 DestSizeX = FMath::Max(SourceSizeX / 2, 1);
+    const int32 DestSizeY = FMath::Max(SourceSizeY / 2, 1);
+
+    // Several rows per task, the small levels are not worth a task each
+    const int32 RowsPerTask = FMath::Max(1, (TileSize * TileSize) / DestSizeX);
+    const int32 NumTasks = FMath::DivideAndRoundUp(DestSizeY, RowsPerTask);
+    ParallelFor(NumTasks, [Source, SourceSizeX, SourceSizeY, Dest, DestSizeX, DestSizeY, RowsPerTask](int32 Task)
+    {
+        const VectorRegister4Float Bias = VectorSetFloat1(2.0f);
+        const VectorRegister4Float Quarter = VectorSetFloat1(0.25f);
+        const int32 LastRow = FMath::Min((Task + 1) * RowsPerTask, DestSizeY);
+        for (int32 Y = Task * RowsPerTask; Y < LastRow; ++Y)
+        {
+            const FColor* Row0 = Source + (int64)FMath::Min(Y * 2, SourceSizeY - 1) * SourceSizeX;
+            const FColor* Row1 = Source + (int64)FMath::Min(Y * 2 + 1, SourceSizeY - 1) * SourceSizeX;
+            FColor* DestRow = Dest + (int64)Y * DestSizeX;
+            for (int32 X = 0; X < DestSizeX; ++X)
+            {
+                const int32 X0 = FMath::Min(X * 2, SourceSizeX - 1);
+                const int32 X1 = FMath::Min(X * 2 + 1, SourceSizeX - 1);
+                const VectorRegister4Float Sum = VectorAdd(
+                    VectorAdd(VectorLoadByte4(&Row0[X0]), VectorLoadByte4(&Row0[X1])),
+                    VectorAdd(VectorLoadByte4(&Row1[X0]), VectorLoadByte4(&Row1[X1])));
+                VectorStoreByte4(VectorFloor(VectorMultiply(VectorAdd(Sum, Bias), Quarter)), &DestRow[X]);
+            }
+        }
+    });
+}
+
+void FWriteToRenderTargetCPU::GenerateMips(const FColor* Mip0, int32 SizeX, int32 SizeY, int32 MaxLevels, TArray<FImage>& OutLowerMips)
+{
+    OutLowerMips.Reset();
+    const FColor* Previous = Mip0;
+    int32 PreviousX = SizeX;
+    int32 PreviousY = SizeY;
+
+    while ((PreviousX > 1 || PreviousY > 1) && OutLowerMips.Num() < MaxLevels)
+    {
+        FImage& Mip = OutLowerMips.AddDefaulted_GetRef();
+        Mip.Init(FMath::Max(PreviousX / 2, 1), FMath::Max(PreviousY / 2, 1), ERawImageFormat::BGRA8);
+        DownsampleMip(Previous, PreviousX, PreviousY, Mip.AsBGRA8().GetData());
+
+        Previous = Mip.AsBGRA8().GetData();
+        PreviousX = Mip.SizeX;
+        PreviousY = Mip.SizeY;
+    }
+}
+
+FWriteToRenderTargetImageDiff FWriteToRenderTargetCPU::CompareImages(const FColor* A, const FColor* B, int64 NumPixels)
+{
+    FWriteToRenderTargetImageDiff Diff;
+    int64 TotalError = 0;
+    for (int64 Index = 0; Index < NumPixels; ++Index)
+    {
+        const int32 ErrorB = FMath::Abs((int32)A[Index].B - (int32)B[Index].B);
+        const int32 ErrorG = FMath::Abs((int32)A[Index].G - (int32)B[Index].G);
+        const int32 ErrorR = FMath::Abs((int32)A[Index].R - (int32)B[Index].R);
+        const int32 ErrorA = FMath::Abs((int32)A[Index].A - (int32)B[Index].A);
+        const int32 PixelMax = FMath::Max(FMath::Max(ErrorB, ErrorG), FMath::Max(ErrorR, ErrorA));
+
+        Diff.MaxError = FMath::Max(Diff.MaxError, PixelMax);
+        Diff.NumDifferentPixels += PixelMax > 0 ? 1 : 0;
+        TotalError += ErrorB + ErrorG + ErrorR + ErrorA;
+    }
+    Diff.MeanError = NumPixels > 0 ? (double)TotalError / (NumPixels * 4) : 0.0;
+    return Diff;
+}
+
+bool FWriteToRenderTargetCPU::ReadTexturePixels(UTexture2D* Texture, FImage& OutImage, FIntPoint MinSize)
+{
+    FWriteToRenderTargetRowReader Reader;
+    if (!Reader.Open(Texture, MinSize))
+    {
+        return false;
+    }
+
+    const FIntPoint Size = Reader.GetSize();
+    OutImage.Init(Size.X, Size.Y, ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+    FColor* Pixels = reinterpret_cast<FColor*>(OutImage.RawData.GetData());
+    ParallelFor(Size.Y, [&Reader, Pixels, Size](int32 Y)
+    {
+        Reader.ReadRow(0, Y, Size.X, Pixels + (int64)Y * Size.X);
+    });
+    return true;
+}
+
+/*
+ * Runs the CPU kernel on a synthetic image so the throughput of a machine can be checked without any assets.
+ * Usage: ShaderMod.BenchCPU [Size] [Iterations]
+ */
+static FAutoConsoleCommand GWriteToRenderTargetBenchCPUCommand(
+    TEXT("ShaderMod.BenchCPU"),
+    TEXT("Runs the WriteToRenderTarget CPU kernel on a synthetic image and logs megapixels per second per core. Usage: ShaderMod.BenchCPU [Size] [Iterations]"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        const int32 Size = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 2048;
+        const int32 Iterations = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 8;
+
+        TArray<FColor> Source;
+        Source.SetNumUninitialized(Size * Size);
+        for (int32 Index = 0; Index < Source.Num(); ++Index)
+        {
+            Source[Index] = FColor((uint8)(Index * 7), (uint8)(Index * 13), (uint8)(Index * 29), 255);
+        }
+        TArray<FColor> Dest;
+        Dest.SetNumUninitialized(Size * Size);
+
+        FWriteToRenderTargetEffectParams Params;
+        Params.bGreyscale = true;
+        Params.Contrast = 1.2f;
+        Params.DistortionStrength = 0.05f;
+        Params.ImageScale = 0.9f;
+
+        // Once in float and once on the packed 8-bit color path, which greyscale and contrast qualify for
+        IConsoleVariable* PackedColor = CVarWriteToRenderTargetPackedColor.AsVariable();
+        const int32 PreviousPackedColor = PackedColor->GetInt();
+        for (int32 bPacked = 0; bPacked < 2; ++bPacked)
+        {
+            PackedColor->Set(bPacked, ECVF_SetByConsole);
+
+            FWriteToRenderTargetCPUStats Total;
+            for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+            {
+                const FWriteToRenderTargetCPUStats Stats = FWriteToRenderTargetCPU::Execute(Source.GetData(), Size, Size, Dest.GetData(), Size, Size, Params);
+                Total.NumPixels += Stats.NumPixels;
+                Total.Seconds += Stats.Seconds;
+                Total.NumTiles = Stats.NumTiles;
+                Total.NumWorkers = Stats.NumWorkers;
+            }
+
+            UE_LOG(LogTemp, Display, TEXT("ShaderMod.BenchCPU %dx%d x%d (%s color): %.1f MP/s total, %.1f MP/s/core on %d workers"),
+                Size, Size, Iterations, bPacked ? TEXT("packed") : TEXT("float"), Total.GetMegapixelsPerSecond(), Total.GetMegapixelsPerSecondPerCore(), Total.NumWorkers);
+        }
+        PackedColor->Set(PreviousPackedColor, ECVF_SetByConsole);
+    }));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetPackedColorTest, "ShaderMod.WriteToRenderTarget.PackedColor", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks the packed 8-bit color path against the float path on noise, for every operation it covers: at most one
+ * 8-bit step apart (exact when the colors pass through), and the SSE2 and scalar variants bit-identical.
+ */
+bool FWriteToRenderTargetPackedColorTest::RunTest(const FString& Parameters)
+{
+    constexpr int32 Size = 512;
+    const TArray<FColor> Source = WriteToRenderTargetTest::MakeNoise(FIntPoint(Size, Size));
+
+    struct FCase
+    {
+        const TCHAR* Name;
+        TArray<FWriteToRenderTargetEffect> Stack;
+        int32 MaxError;
+    };
+    using EOp = EWriteToRenderTargetEffectOp;
+    using FEffect = FWriteToRenderTargetEffect;
+    const FCase Cases[] =
+    {
+        { TEXT("identity"),             { FEffect::Make(EOp::Rotate, 30.0f) },                                                         0 },
+        { TEXT("greyscale"),            { FEffect::Make(EOp::Greyscale) },                                                             1 },
+        { TEXT("contrast 0.5"),         { FEffect::Make(EOp::Contrast, 0.5f) },                                                        1 },
+        { TEXT("contrast 1.2"),         { FEffect::Make(EOp::Contrast, 1.2f) },                                                        1 },
+        { TEXT("contrast 3"),           { FEffect::Make(EOp::Contrast, 3.0f) },                                                        1 },
+        { TEXT("invert"),               { FEffect::Make(EOp::Invert) },                                                                1 },
+        { TEXT("brightness"),           { FEffect::Make(EOp::Brightness, -0.2f) },                                                     1 },
+        { TEXT("contrast invert"),      { FEffect::Make(EOp::Contrast, 1.7f), FEffect::Make(EOp::Invert) },                            1 },
+        { TEXT("greyscale contrast"),   { FEffect::Make(EOp::Greyscale), FEffect::Make(EOp::Contrast, 1.2f) },                         1 },
+        { TEXT("greyscale all"),        { FEffect::Make(EOp::Contrast, 0.8f), FEffect::Make(EOp::Greyscale), FEffect::Make(EOp::Invert), FEffect::Make(EOp::Brightness, 0.1f) }, 1 },
+        // No fixed point form: both runs take the float path
+        { TEXT("hue"),                  { FEffect::Make(EOp::Hue, 45.0f) },                                                            0 },
+    };
+
+    AddInfo(WRITETORENDERTARGET_PACKED_SSE2 ? TEXT("SSE2 packed color") : TEXT("Scalar packed color"));
+    TArray<FColor> Expected;
+    TArray<FColor> Actual;
+    Expected.SetNumUninitialized(Size * Size);
+    Actual.SetNumUninitialized(Size * Size);
+    {
+        WriteToRenderTargetTest::FScopedConsoleVariable PackedColor(TEXT("r.ShaderMod.PackedColor"), 0);
+        for (const FCase& Case : Cases)
+        {
+            FWriteToRenderTargetEffectParams Params;
+            Params.EffectStack = Case.Stack;
+
+            PackedColor.Set(0);
+            FWriteToRenderTargetCPU::Execute(Source.GetData(), Size, Size, Expected.GetData(), Size, Size, Params);
+            PackedColor.Set(1);
+            FWriteToRenderTargetCPU::Execute(Source.GetData(), Size, Size, Actual.GetData(), Size, Size, Params);
+            WriteToRenderTargetTest::TestImagesEqual(*this, FString::Printf(TEXT("Packed %s"), Case.Name), Expected, Actual, Case.MaxError);
+        }
+    }
+
+    // The vector loop against the scalar loop it must match bit for bit, 4n + 3 pixels so the tail runs too
+    const int32 NumPixels = FMath::Min(Source.Num() - 1, 4 * 1021 + 3);
+    for (const FCase& Case : Cases)
+    {
+        FWriteToRenderTargetEffectParams Params;
+        Params.EffectStack = Case.Stack;
+        const WriteToRenderTargetCPU::FPackedColor Packed = WriteToRenderTargetCPU::FPackedColor::Make(FWriteToRenderTargetFusedEffects::Fold(Params));
+        TArray<FColor> Vector(Source.GetData(), NumPixels);
+        TArray<FColor> Scalar(Source.GetData(), NumPixels);
+        Packed.ApplyRow(Vector.GetData(), NumPixels);
+        Packed.ApplyScalar(Scalar.GetData(), NumPixels);
+        WriteToRenderTargetTest::TestImagesEqual(*this, FString::Printf(TEXT("Vector against scalar %s"), Case.Name), Scalar, Vector);
+    }
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetBackendsTest, "ShaderMod.WriteToRenderTarget.Backends", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks that the CPU and RDG backends produce the same image when samples land outside the input: rotated and scaled
+ * down, the corners of the render target sample past every edge, where both must repeat the edge texels. The input is
+ * a linear gradient, so samples that round to a neighbouring texel on one backend stay within a few 8-bit steps while
+ * wrapped addressing would pull in the opposite edge.
+ */
+bool FWriteToRenderTargetBackendsTest::RunTest(const FString& Parameters)
+{
+    constexpr int32 Size = 512;
+    constexpr int32 MaxError = 3;
+
+    if (!WriteToRenderTargetTest::HasGPU(*this))
+    {
+        return true;
+    }
+
+    UTexture2D* Input = WriteToRenderTargetTest::CreateTexture(FIntPoint(Size, Size), WriteToRenderTargetTest::MakeGradient(Size), false);
+
+    struct FCase
+    {
+        const TCHAR* Name;
+        float RotationAngle;
+        float ImageScale;
+    };
+    const FCase Cases[] =
+    {
+        { TEXT("Rotate 30"), 30.0f, 1.0f },
+        { TEXT("Scale 0.5"), 0.0f, 0.5f },
+        { TEXT("Rotate 45 scale 0.7"), 45.0f, 0.7f },
+    };
+
+    // The CPU backend uploads into BGRA8 targets only
+    UTextureRenderTarget2D* CPUTarget = WriteToRenderTargetTest::CreateRenderTarget(FIntPoint(Size, Size), PF_B8G8R8A8, false);
+    UTextureRenderTarget2D* RDGTarget = WriteToRenderTargetTest::CreateRenderTarget(FIntPoint(Size, Size), PF_R8G8B8A8, true);
+    WriteToRenderTargetTest::FScopedProcessor CPUProcessor(EWriteToRenderTargetBackend::CPU);
+    WriteToRenderTargetTest::FScopedProcessor RDGProcessor(EWriteToRenderTargetBackend::RDG);
+
+    TArray<FColor> Expected;
+    TArray<FColor> Actual;
+    for (const FCase& Case : Cases)
+    {
+        FWriteToRenderTargetEffectParams Params;
+        Params.RotationAngle = Case.RotationAngle;
+        Params.ImageScale = Case.ImageScale;
+
+        CPUProcessor.Execute(Input, CPUTarget, Params);
+        RDGProcessor.Execute(Input, RDGTarget, Params);
+        CPUTarget->GameThread_GetRenderTargetResource()->ReadPixels(Expected);
+        RDGTarget->GameThread_GetRenderTargetResource()->ReadPixels(Actual);
+        WriteToRenderTargetTest::TestImagesEqual(*this, FString::Printf(TEXT("CPU against RDG %s"), Case.Name), Expected, Actual, MaxError);
+    }
+
+    CPUTarget->MarkAsGarbage();
+    RDGTarget->MarkAsGarbage();
+    Input->MarkAsGarbage();
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetKernelResampleTest, "ShaderMod.WriteToRenderTarget.KernelResample", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks that sampling the input inside the kernel stays close to the resize-then-point-sample path, over the image and
+ * along its border: the gradient runs from black to full red and green across the input, so an in-kernel lookup that
+ * wrapped instead of clamping like the resize would blend the opposite edges there.
+ * Both paths run on the CPU reference so the check works on any machine.
+ */
+bool FWriteToRenderTargetKernelResampleTest::RunTest(const FString& Parameters)
+{
+    constexpr int32 SourceSize = 2048;
+    constexpr int32 DestSize = 512;
+    constexpr double MaxMeanError = 2.0;
+    constexpr int32 MaxEdgeError = 8;
+    constexpr int32 EdgeWidth = 2;
+
+    const TArray<FColor> Source = WriteToRenderTargetTest::MakeGradient(SourceSize);
+
+    // Current path: resize to the render target size, then point sample
+    TArray<FColor> Resized;
+    Resized.SetNumUninitialized(DestSize * DestSize);
+    FWriteToRenderTargetResampler::Resample(Source.GetData(), SourceSize, SourceSize, Resized.GetData(), DestSize, DestSize, EWriteToRenderTargetResampleFilter::Box, false);
+
+    // In-kernel path: trilinear sampling of the native size input
+    TArray<FImage> LowerMips;
+    FWriteToRenderTargetCPU::BuildMipChain(Source.GetData(), SourceSize, SourceSize, LowerMips);
+    TArray<FWriteToRenderTargetCPUMip> Mips;
+    Mips.Add({ Source.GetData(), SourceSize, SourceSize });
+    for (FImage& Mip : LowerMips)
+    {
+        Mips.Add({ Mip.AsBGRA8().GetData(), Mip.SizeX, Mip.SizeY });
+    }
+
+    struct FCase
+    {
+        const TCHAR* Name;
+        FWriteToRenderTargetEffectParams Params;
+    };
+    TArray<FCase> Cases;
+    FCase& Distorted = Cases.Add_GetRef({ TEXT("distorted"), FWriteToRenderTargetEffectParams() });
+    Distorted.Params.Contrast = 1.1f;
+    Distorted.Params.DistortionStrength = 0.02f;
+    // Scaled down, so the border of the render target samples past the edges of the input
+    FCase& Scaled = Cases.Add_GetRef({ TEXT("scaled 0.8"), FWriteToRenderTargetEffectParams() });
+    Scaled.Params.RotationAngle = 0.0f;
+    Scaled.Params.ImageScale = 0.8f;
+
+    TArray<FColor> Expected;
+    TArray<FColor> Actual;
+    Expected.SetNumUninitialized(DestSize * DestSize);
+    Actual.SetNumUninitialized(DestSize * DestSize);
+    for (FCase& Case : Cases)
+    {
+        FWriteToRenderTargetCPU::Execute(Resized.GetData(), DestSize, DestSize, Expected.GetData(), DestSize, DestSize, Case.Params);
+        Case.Params.bResampleInKernel = true;
+        FWriteToRenderTargetCPU::ExecuteFiltered(Mips, Actual.GetData(), DestSize, DestSize, Case.Params);
+
+        const FWriteToRenderTargetImageDiff Diff = FWriteToRenderTargetCPU::CompareImages(Expected.GetData(), Actual.GetData(), Expected.Num());
+        AddInfo(FString::Printf(TEXT("%d -> %d %s: mean error %.3f, max error %d"), SourceSize, DestSize, Case.Name, Diff.MeanError, Diff.MaxError));
+        TestTrue(FString::Printf(TEXT("Mean error %.3f within %.3f (%s)"), Diff.MeanError, MaxMeanError, Case.Name), Diff.MeanError <= MaxMeanError);
+
+        TArray<FColor> ExpectedEdge;
+        TArray<FColor> ActualEdge;
+        for (int32 Y = 0; Y < DestSize; ++Y)
+        {
+            for (int32 X = 0; X < DestSize; ++X)
+            {
+                if (FMath::Min(FMath::Min(X, DestSize - 1 - X), FMath::Min(Y, DestSize - 1 - Y)) < EdgeWidth)
+                {
+                    ExpectedEdge.Add(Expected[Y * DestSize + X]);
+                    ActualEdge.Add(Actual[Y * DestSize + X]);
+                }
+            }
+        }
+        WriteToRenderTargetTest::TestImagesEqual(*this, FString::Printf(TEXT("Border of %s"), Case.Name), ExpectedEdge, ActualEdge, MaxEdgeError);
+    }
+    return true;
+}
+
+#endif
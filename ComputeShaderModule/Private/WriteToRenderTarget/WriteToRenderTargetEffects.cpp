@@ -0,0 +1,452 @@
+#include "WriteToRenderTarget/WriteToRenderTargetEffects.h"
+#include "Math/RandomStream.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+
+namespace WriteToRenderTargetEffects
+{
+    // Luminance weights of the greyscale and saturation operations (must match WriteToRenderTarget.usf)
+    const FVector3f GreyWeights(0.3f, 0.6f, 0.1f);
+
+    // Frequency of the sine distortion (must match WriteToRenderTarget.usf)
+    constexpr float DistortionFrequency = 10.0f;
+
+    FVector2f Distort(const FVector2f& UV, float Strength)
+    {
+        return UV + Strength * FVector2f(FMath::Sin(UV.Y * DistortionFrequency), FMath::Sin(UV.X * DistortionFrequency));
+    }
+
+    // Guard against a zero scale, which would turn every UV into NaN
+    float GetSafeScale(float Scale)
+    {
+        return FMath::Abs(Scale) > UE_SMALL_NUMBER ? Scale : UE_SMALL_NUMBER;
+    }
+
+    // Rows of the SVG feColorMatrix hueRotate matrix, applied to a column vector (R' = dot(Row0, RGB))
+    void GetHueRows(float Degrees, FVector3f& OutRow0, FVector3f& OutRow1, FVector3f& OutRow2)
+    {
+        float Sin, Cos;
+        FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(Degrees));
+        OutRow0 = FVector3f(0.213f + Cos * 0.787f - Sin * 0.213f, 0.715f - Cos * 0.715f - Sin * 0.715f, 0.072f - Cos * 0.072f + Sin * 0.928f);
+        OutRow1 = FVector3f(0.213f - Cos * 0.213f + Sin * 0.143f, 0.715f + Cos * 0.285f + Sin * 0.140f, 0.072f - Cos * 0.072f - Sin * 0.283f);
+        OutRow2 = FVector3f(0.213f - Cos * 0.213f - Sin * 0.787f, 0.715f - Cos * 0.715f + Sin * 0.715f, 0.072f + Cos * 0.928f + Sin * 0.072f);
+    }
+
+    // Affine form of a rotate or scale operation around the image center
+    FWriteToRenderTargetUVTransform GetUVTransform(const FWriteToRenderTargetEffect& Effect)
+    {
+        FWriteToRenderTargetUVTransform Transform;
+        if (Effect.Op == EWriteToRenderTargetEffectOp::Rotate)
+        {
+            float Sin, Cos;
+            FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(Effect.Value));
+            Transform.Matrix = FVector4f(Cos, -Sin, Sin, Cos);
+        }
+        else
+        {
+            const float InvScale = 1.0f / GetSafeScale(Effect.Value);
+            Transform.Matrix = FVector4f(InvScale, 0.0f, 0.0f, InvScale);
+        }
+
+        // Keep the center in place: Offset = 0.5 - Matrix * 0.5
+        Transform.Offset = FVector2f(
+            0.5f - 0.5f * (Transform.Matrix.X + Transform.Matrix.Y),
+            0.5f - 0.5f * (Transform.Matrix.Z + Transform.Matrix.W));
+        return Transform;
+    }
+
+    // Affine form of a color operation as a row vector transform: Color * OutMatrix + OutOffset
+    void GetColorTransform(const FWriteToRenderTargetEffect& Effect, FMatrix44f& OutMatrix, FVector4f& OutOffset)
+    {
+        OutMatrix = FMatrix44f::Identity;
+        OutOffset = FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+
+        switch (Effect.Op)
+        {
+        case EWriteToRenderTargetEffectOp::Greyscale:
+        case EWriteToRenderTargetEffectOp::Saturation:
+        {
+            // Greyscale is saturation 0
+            const float Saturation = Effect.Op == EWriteToRenderTargetEffectOp::Greyscale ? 0.0f : Effect.Value;
+            for (int32 Row = 0; Row < 3; ++Row)
+            {
+                for (int32 Column = 0; Column < 3; ++Column)
+                {
+                    OutMatrix.M[Row][Column] = (1.0f - Saturation) * GreyWeights[Row] + (Row == Column ? Saturation : 0.0f);
+                }
+            }
+            break;
+        }
+        case EWriteToRenderTargetEffectOp::Contrast:
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                OutMatrix.M[Channel][Channel] = Effect.Value;
+                OutOffset[Channel] = 0.5f - 0.5f * Effect.Value;
+            }
+            break;
+        case EWriteToRenderTargetEffectOp::Invert:
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                OutMatrix.M[Channel][Channel] = -1.0f;
+                OutOffset[Channel] = 1.0f;
+            }
+            break;
+        case EWriteToRenderTargetEffectOp::Brightness:
+            OutOffset = FVector4f(Effect.Value, Effect.Value, Effect.Value, 0.0f);
+            break;
+        case EWriteToRenderTargetEffectOp::Hue:
+        {
+            // The hue rows act on a column vector, the row vector form is their transpose
+            FVector3f Rows[3];
+            GetHueRows(Effect.Value, Rows[0], Rows[1], Rows[2]);
+            for (int32 Row = 0; Row < 3; ++Row)
+            {
+                for (int32 Column = 0; Column < 3; ++Column)
+                {
+                    OutMatrix.M[Row][Column] = Rows[Column][Row];
+                }
+            }
+            break;
+        }
+        case EWriteToRenderTargetEffectOp::ColorMatrix:
+            OutMatrix = FMatrix44f(Effect.ColorMatrix);
+            OutOffset = FVector4f(Effect.ColorOffset);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+FWriteToRenderTargetFusedEffects FWriteToRenderTargetFusedEffects::Fold(TConstArrayView<FWriteToRenderTargetEffect> EffectStack)
+{
+    using namespace WriteToRenderTargetEffects;
+
+    FWriteToRenderTargetFusedEffects Fused;
+    for (const FWriteToRenderTargetEffect& Effect : EffectStack)
+    {
+        if (Effect.Op == EWriteToRenderTargetEffectOp::Distort)
+        {
+            // A zero strength distortion is the identity and must not use up a stage
+            if (Effect.Value == 0.0f)
+            {
+                continue;
+            }
+            if (Fused.NumDistortions == MaxDistortions)
+            {
+                ++Fused.NumDroppedOps;
+                continue;
+            }
+            Fused.DistortionStrengths[Fused.NumDistortions++] = Effect.Value;
+        }
+        else if (IsUVOp(Effect.Op))
+        {
+            FWriteToRenderTargetUVTransform& Stage = Fused.UVStages[Fused.NumDistortions];
+            Stage = Stage.Then(GetUVTransform(Effect));
+        }
+        else
+        {
+            // (Color * A + a) * B + b = Color * (A * B) + (a * B + b)
+            FMatrix44f Matrix;
+            FVector4f Offset;
+            GetColorTransform(Effect, Matrix, Offset);
+            Fused.ColorOffset = Matrix.TransformFVector4(Fused.ColorOffset) + Offset;
+            Fused.ColorMatrix = Fused.ColorMatrix * Matrix;
+        }
+    }
+
+    if (Fused.NumDroppedOps > 0)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("FWriteToRenderTargetFusedEffects::Fold - Dropped %d distortions, at most %d are supported per stack."), Fused.NumDroppedOps, MaxDistortions);
+    }
+    return Fused;
+}
+
+FWriteToRenderTargetFusedEffects FWriteToRenderTargetFusedEffects::Fold(const FWriteToRenderTargetEffectParams& Params)
+{
+    if (Params.EffectStack.Num() > 0)
+    {
+        return Fold(Params.EffectStack);
+    }
+
+    TArray<FWriteToRenderTargetEffect> FieldStack;
+    MakeFieldStack(Params, FieldStack);
+    return Fold(FieldStack);
+}
+
+void FWriteToRenderTargetFusedEffects::MakeFieldStack(const FWriteToRenderTargetEffectParams& Params, TArray<FWriteToRenderTargetEffect>& OutEffectStack)
+{
+    OutEffectStack.Reset();
+    OutEffectStack.Add(FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Rotate, Params.RotationAngle));
+    OutEffectStack.Add(FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Scale, Params.ImageScale));
+    OutEffectStack.Add(FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Distort, Params.DistortionStrength));
+    if (Params.AutoContrast != EWriteToRenderTargetAutoContrast::Off)
+    {
+        const EWriteToRenderTargetEffectOp AutoOp = Params.AutoContrast == EWriteToRenderTargetAutoContrast::Levels
+            ? EWriteToRenderTargetEffectOp::AutoLevels : EWriteToRenderTargetEffectOp::AutoContrast;
+        OutEffectStack.Add(FWriteToRenderTargetEffect::Make(AutoOp, Params.AutoContrastClipPercent));
+    }
+    if (Params.bGreyscale)
+    {
+        OutEffectStack.Add(FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Greyscale));
+    }
+    OutEffectStack.Add(FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Contrast, Params.Contrast));
+    if (Params.bInvertColors)
+    {
+        OutEffectStack.Add(FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Invert));
+    }
+}
+
+uint32 GetTypeHash(const FWriteToRenderTargetEffectParams& Params)
+{
+    uint32 Hash = HashCombine(GetTypeHash(Params.bInvertColors), GetTypeHash(Params.bGreyscale));
+    Hash = HashCombine(Hash, GetTypeHash(Params.Contrast));
+    Hash = HashCombine(Hash, GetTypeHash((uint8)Params.AutoContrast));
+    Hash = HashCombine(Hash, GetTypeHash(Params.AutoContrastClipPercent));
+    Hash = HashCombine(Hash, GetTypeHash(Params.DistortionStrength));
+    Hash = HashCombine(Hash, GetTypeHash(Params.ImageScale));
+    Hash = HashCombine(Hash, GetTypeHash(Params.RotationAngle));
+    Hash = HashCombine(Hash, GetTypeHash(Params.bResampleInKernel));
+    Hash = HashCombine(Hash, GetTypeHash(Params.bGenerateMips));
+    for (const FWriteToRenderTargetEffect& Effect : Params.EffectStack)
+    {
+        Hash = HashCombine(Hash, GetTypeHash((uint8)Effect.Op));
+        Hash = HashCombine(Hash, GetTypeHash(Effect.Value));
+        if (Effect.Op == EWriteToRenderTargetEffectOp::ColorMatrix)
+        {
+            Hash = HashCombine(Hash, FCrc::MemCrc32(&Effect.ColorMatrix, sizeof(Effect.ColorMatrix)));
+            Hash = HashCombine(Hash, FCrc::MemCrc32(&Effect.ColorOffset, sizeof(Effect.ColorOffset)));
+        }
+    }
+    return Hash;
+}
+
+FVector2f FWriteToRenderTargetFusedEffects::TransformUV(const FVector2f& UV) const
+{
+    FVector2f Result = UVStages[0].Apply(UV);
+    for (int32 Index = 0; Index < NumDistortions; ++Index)
+    {
+        Result = UVStages[Index + 1].Apply(WriteToRenderTargetEffects::Distort(Result, DistortionStrengths[Index]));
+    }
+    return Result;
+}
+
+FVector4f FWriteToRenderTargetFusedEffects::TransformColor(const FVector4f& Color) const
+{
+    return ColorMatrix.TransformFVector4(Color) + ColorOffset;
+}
+
+float FWriteToRenderTargetFusedEffects::GetImageScale() const
+{
+    // One output pixel covers sqrt(|det|) input pixels of each affine stage
+    float Determinant = 1.0f;
+    for (int32 Index = 0; Index <= NumDistortions; ++Index)
+    {
+        Determinant *= FMath::Abs(UVStages[Index].GetDeterminant());
+    }
+    return Determinant > UE_SMALL_NUMBER ? 1.0f / FMath::Sqrt(Determinant) : 1.0f / UE_SMALL_NUMBER;
+}
+
+FVector2f FWriteToRenderTargetFusedEffects::ApplyUV(const FWriteToRenderTargetEffect& Effect, const FVector2f& UV)
+{
+    using namespace WriteToRenderTargetEffects;
+
+    // Same steps as the fixed order kernel: translate to the center, rotate or scale, translate back
+    const FVector2f Centered = UV - FVector2f(0.5f, 0.5f);
+    switch (Effect.Op)
+    {
+    case EWriteToRenderTargetEffectOp::Rotate:
+    {
+        const float Radians = FMath::DegreesToRadians(Effect.Value);
+        const float Cos = FMath::Cos(Radians);
+        const float Sin = FMath::Sin(Radians);
+        return FVector2f(Cos * Centered.X - Sin * Centered.Y, Sin * Centered.X + Cos * Centered.Y) + FVector2f(0.5f, 0.5f);
+    }
+    case EWriteToRenderTargetEffectOp::Scale:
+        return Centered / GetSafeScale(Effect.Value) + FVector2f(0.5f, 0.5f);
+    case EWriteToRenderTargetEffectOp::Distort:
+        return Distort(UV, Effect.Value);
+    default:
+        return UV;
+    }
+}
+
+FVector4f FWriteToRenderTargetFusedEffects::ApplyColor(const FWriteToRenderTargetEffect& Effect, const FVector4f& Color)
+{
+    using namespace WriteToRenderTargetEffects;
+
+    const FVector3f RGB(Color.X, Color.Y, Color.Z);
+    const float Grey = RGB | GreyWeights;
+    FVector3f Result = RGB;
+    switch (Effect.Op)
+    {
+    case EWriteToRenderTargetEffectOp::Greyscale:
+        Result = FVector3f(Grey);
+        break;
+    case EWriteToRenderTargetEffectOp::Contrast:
+        Result = (RGB - FVector3f(0.5f)) * Effect.Value + FVector3f(0.5f);
+        break;
+    case EWriteToRenderTargetEffectOp::Invert:
+        Result = FVector3f(1.0f) - RGB;
+        break;
+    case EWriteToRenderTargetEffectOp::Brightness:
+        Result = RGB + FVector3f(Effect.Value);
+        break;
+    case EWriteToRenderTargetEffectOp::Saturation:
+        Result = FVector3f(Grey) + (RGB - FVector3f(Grey)) * Effect.Value;
+        break;
+    case EWriteToRenderTargetEffectOp::Hue:
+    {
+        FVector3f Row0, Row1, Row2;
+        GetHueRows(Effect.Value, Row0, Row1, Row2);
+        Result = FVector3f(Row0 | RGB, Row1 | RGB, Row2 | RGB);
+        break;
+    }
+    case EWriteToRenderTargetEffectOp::ColorMatrix:
+        return FVector4f(Effect.ColorMatrix.TransformFVector4(FVector4(Color)) + Effect.ColorOffset);
+    default:
+        break;
+    }
+    return FVector4f(Result, Color.W);
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetEffectFoldingTest, "ShaderMod.WriteToRenderTarget.EffectFolding", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks FWriteToRenderTargetFusedEffects::Fold against applying every operation of the stack one by one,
+ * on random stacks, UVs and colors, plus a few stacks with known results.
+ */
+bool FWriteToRenderTargetEffectFoldingTest::RunTest(const FString& Parameters)
+{
+    constexpr int32 NumStacks = 1000;
+    constexpr int32 NumOps = (int32)EWriteToRenderTargetEffectOp::ColorMatrix + 1;
+    constexpr float Tolerance = 1.0e-4f;
+
+    FRandomStream Random(1234);
+
+    auto RandomEffect = [&Random]()
+    {
+        FWriteToRenderTargetEffect Effect = FWriteToRenderTargetEffect::Make((EWriteToRenderTargetEffectOp)Random.RandRange(0, NumOps - 1));
+        switch (Effect.Op)
+        {
+        case EWriteToRenderTargetEffectOp::Rotate:
+        case EWriteToRenderTargetEffectOp::Hue:
+            Effect.Value = Random.FRandRange(-360.0f, 360.0f);
+            break;
+        case EWriteToRenderTargetEffectOp::Scale:
+            Effect.Value = Random.FRandRange(0.25f, 4.0f) * (Random.FRand() < 0.2f ? -1.0f : 1.0f);
+            break;
+        case EWriteToRenderTargetEffectOp::Distort:
+            Effect.Value = Random.FRandRange(-0.1f, 0.1f);
+            break;
+        case EWriteToRenderTargetEffectOp::Contrast:
+        case EWriteToRenderTargetEffectOp::Saturation:
+            Effect.Value = Random.FRandRange(0.0f, 2.0f);
+            break;
+        case EWriteToRenderTargetEffectOp::Brightness:
+            Effect.Value = Random.FRandRange(-0.5f, 0.5f);
+            break;
+        case EWriteToRenderTargetEffectOp::ColorMatrix:
+            for (int32 Row = 0; Row < 4; ++Row)
+            {
+                for (int32 Column = 0; Column < 4; ++Column)
+                {
+                    Effect.ColorMatrix.M[Row][Column] = Random.FRandRange(-1.0f, 1.0f);
+                }
+                Effect.ColorOffset[Row] = Random.FRandRange(-0.5f, 0.5f);
+            }
+            break;
+        default:
+            break;
+        }
+        return Effect;
+    };
+
+    auto IsClose = [Tolerance](float Actual, float Expected)
+    {
+        return FMath::Abs(Actual - Expected) <= Tolerance * FMath::Max(1.0f, FMath::Abs(Expected));
+    };
+
+    for (int32 StackIndex = 0; StackIndex < NumStacks; ++StackIndex)
+    {
+        // Stay within MaxDistortions, the one by one reference has no limit
+        TArray<FWriteToRenderTargetEffect> Stack;
+        int32 NumDistortions = 0;
+        const int32 StackSize = Random.RandRange(1, 8);
+        while (Stack.Num() < StackSize)
+        {
+            const FWriteToRenderTargetEffect Effect = RandomEffect();
+            if (Effect.Op == EWriteToRenderTargetEffectOp::Distort && ++NumDistortions > FWriteToRenderTargetFusedEffects::MaxDistortions)
+            {
+                continue;
+            }
+            Stack.Add(Effect);
+        }
+
+        const FWriteToRenderTargetFusedEffects Fused = FWriteToRenderTargetFusedEffects::Fold(Stack);
+        for (int32 Sample = 0; Sample < 16; ++Sample)
+        {
+            const FVector2f UV(Random.FRand(), Random.FRand());
+            const FVector4f Color(Random.FRand(), Random.FRand(), Random.FRand(), Random.FRand());
+
+            FVector2f ExpectedUV = UV;
+            FVector4f ExpectedColor = Color;
+            for (const FWriteToRenderTargetEffect& Effect : Stack)
+            {
+                if (FWriteToRenderTargetFusedEffects::IsUVOp(Effect.Op))
+                {
+                    ExpectedUV = FWriteToRenderTargetFusedEffects::ApplyUV(Effect, ExpectedUV);
+                }
+                else
+                {
+                    ExpectedColor = FWriteToRenderTargetFusedEffects::ApplyColor(Effect, ExpectedColor);
+                }
+            }
+
+            const FVector2f ActualUV = Fused.TransformUV(UV);
+            const FVector4f ActualColor = Fused.TransformColor(Color);
+            const bool bUVClose = IsClose(ActualUV.X, ExpectedUV.X) && IsClose(ActualUV.Y, ExpectedUV.Y);
+            const bool bColorClose = IsClose(ActualColor.X, ExpectedColor.X) && IsClose(ActualColor.Y, ExpectedColor.Y)
+                && IsClose(ActualColor.Z, ExpectedColor.Z) && IsClose(ActualColor.W, ExpectedColor.W);
+            if (!bUVClose || !bColorClose)
+            {
+                AddError(FString::Printf(TEXT("Stack %d (%d ops): UV %s vs %s, color %s vs %s"), StackIndex, Stack.Num(),
+                    *ActualUV.ToString(), *ExpectedUV.ToString(), *ActualColor.ToString(), *ExpectedColor.ToString()));
+                break;
+            }
+        }
+    }
+
+    // Default fields: rotation only, no distortion stage and no color work
+    const FWriteToRenderTargetFusedEffects Defaults = FWriteToRenderTargetFusedEffects::Fold(FWriteToRenderTargetEffectParams());
+    TestTrue(TEXT("Defaults have an identity color transform"), Defaults.IsIdentityColor());
+    TestEqual(TEXT("Defaults have no distortion"), Defaults.NumDistortions, 0);
+    TestFalse(TEXT("Defaults rotate"), Defaults.UVStages[0].IsIdentity());
+    TestTrue(TEXT("Defaults have unit image scale"), FMath::IsNearlyEqual(Defaults.GetImageScale(), 1.0f, 1.0e-5f));
+
+    // Operations that cancel fold to the identity exactly
+    const FWriteToRenderTargetEffect Cancelling[] = {
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Contrast, 2.0f),
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Invert),
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Invert),
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Contrast, 0.5f),
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Scale, 2.0f),
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Scale, 0.5f),
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Distort, 0.0f) };
+    const FWriteToRenderTargetFusedEffects CancellingFused = FWriteToRenderTargetFusedEffects::Fold(Cancelling);
+    TestTrue(TEXT("Cancelling color operations fold to the identity"), CancellingFused.IsIdentityColor());
+    TestTrue(TEXT("Cancelling UV operations fold to the identity"), CancellingFused.UVStages[0].IsIdentity() && CancellingFused.NumDistortions == 0);
+
+    // Distortions past MaxDistortions are dropped and counted
+    const FWriteToRenderTargetEffect Distortions[] = {
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Distort, 0.01f),
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Distort, 0.02f),
+        FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Distort, 0.03f) };
+    const FWriteToRenderTargetFusedEffects DistortionsFused = FWriteToRenderTargetFusedEffects::Fold(Distortions);
+    TestEqual(TEXT("Distortions are capped"), DistortionsFused.NumDistortions, (int32)FWriteToRenderTargetFusedEffects::MaxDistortions);
+    TestEqual(TEXT("Dropped distortions are counted"), DistortionsFused.NumDroppedOps, 1);
+    return true;
+}
+
+#endif
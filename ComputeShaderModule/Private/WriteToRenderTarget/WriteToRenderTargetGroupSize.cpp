@@ -0,0 +1,183 @@
+#include "WriteToRenderTarget/WriteToRenderTargetGroupSize.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/ScopeLock.h"
+#include "RHI.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+
+static const TCHAR* GWriteToRenderTargetGroupSizeSection = TEXT("ShaderMod.GroupSizeAutotune");
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetGroupSize(
+    TEXT("r.ShaderMod.GroupSize"),
+    -1,
+    TEXT("Thread group size of the WriteToRenderTarget kernel.\n")
+    TEXT(" -1: Autotuned per GPU and resolution (default)\n")
+    TEXT("  0: 8x8\n")
+    TEXT("  1: 16x16\n")
+    TEXT("  2: 32x8\n")
+    TEXT("  3: 8x32"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetGroupSizeAutotuneIterations(
+    TEXT("r.ShaderMod.GroupSizeAutotune.Iterations"),
+    8,
+    TEXT("Number of timed dispatches per group size when a new resolution is autotuned."),
+    ECVF_RenderThreadSafe);
+
+FWriteToRenderTargetGroupSizeTuner& FWriteToRenderTargetGroupSizeTuner::Get()
+{
+    static FWriteToRenderTargetGroupSizeTuner Tuner;
+    return Tuner;
+}
+
+void FWriteToRenderTargetGroupSizeTuner::LoadConfig()
+{
+    check(IsInGameThread());
+
+    TArray<FString> Lines;
+    if (!GConfig || !GConfig->GetSection(GWriteToRenderTargetGroupSizeSection, Lines, GEngineIni))
+    {
+        return;
+    }
+
+    FScopeLock Lock(&CriticalSection);
+    for (const FString& Line : Lines)
+    {
+        FString Key;
+        FString Value;
+        if (Line.Split(TEXT("="), &Key, &Value))
+        {
+            const int32 GroupSize = FCString::Atoi(*Value);
+            if (GroupSize >= 0 && GroupSize < (int32)EWriteToRenderTargetGroupSize::Num)
+            {
+                Entries.Add(Key, (EWriteToRenderTargetGroupSize)GroupSize);
+            }
+        }
+    }
+}
+
+bool FWriteToRenderTargetGroupSizeTuner::Find(FIntPoint Extent, EWriteToRenderTargetGroupSize& OutGroupSize) const
+{
+    const int32 Forced = CVarWriteToRenderTargetGroupSize.GetValueOnAnyThread();
+    if (Forced >= 0)
+    {
+        OutGroupSize = (EWriteToRenderTargetGroupSize)FMath::Min(Forced, (int32)EWriteToRenderTargetGroupSize::Num - 1);
+        return true;
+    }
+
+    FScopeLock Lock(&CriticalSection);
+    if (const EWriteToRenderTargetGroupSize* GroupSize = Entries.Find(MakeKey(Extent)))
+    {
+        OutGroupSize = *GroupSize;
+        return true;
+    }
+    return false;
+}
+
+void FWriteToRenderTargetGroupSizeTuner::Set(FIntPoint Extent, EWriteToRenderTargetGroupSize GroupSize)
+{
+    const FString Key = MakeKey(Extent);
+    {
+        FScopeLock Lock(&CriticalSection);
+        Entries.Add(Key, GroupSize);
+    }
+
+    // GConfig is not thread safe, persist from the game thread
+    AsyncTask(ENamedThreads::GameThread, [Key, GroupSize]()
+    {
+        GConfig->SetInt(GWriteToRenderTargetGroupSizeSection, *Key, (int32)GroupSize, GEngineIni);
+        GConfig->Flush(false, GEngineIni);
+    });
+}
+
+void FWriteToRenderTargetGroupSizeTuner::Empty()
+{
+    {
+        FScopeLock Lock(&CriticalSection);
+        Entries.Empty();
+    }
+
+    AsyncTask(ENamedThreads::GameThread, []()
+    {
+        GConfig->EmptySection(GWriteToRenderTargetGroupSizeSection, GEngineIni);
+        GConfig->Flush(false, GEngineIni);
+    });
+}
+
+int32 FWriteToRenderTargetGroupSizeTuner::GetIterations()
+{
+    return FMath::Max(CVarWriteToRenderTargetGroupSizeAutotuneIterations.GetValueOnAnyThread(), 1);
+}
+
+FString FWriteToRenderTargetGroupSizeTuner::MakeKey(FIntPoint Extent)
+{
+    // Config keys cannot contain '=' and should stay readable, keep the adapter name alphanumeric
+    FString Adapter = GRHIAdapterName.IsEmpty() ? FString(TEXT("UnknownGPU")) : GRHIAdapterName;
+    for (TCHAR& Character : Adapter)
+    {
+        if (!FChar::IsAlnum(Character))
+        {
+            Character = TEXT('_');
+        }
+    }
+    return FString::Printf(TEXT("%s_%dx%d"), *Adapter, Extent.X, Extent.Y);
+}
+
+/*
+ * Forgets the autotuned group sizes so the next dispatch of each resolution measures again.
+ */
+static FAutoConsoleCommand GWriteToRenderTargetGroupSizeResetCommand(
+    TEXT("ShaderMod.GroupSize.Reset"),
+    TEXT("Clears the autotuned WriteToRenderTarget group sizes, in memory and in the engine config."),
+    FConsoleCommandDelegate::CreateLambda([]()
+    {
+        FWriteToRenderTargetGroupSizeTuner::Get().Empty();
+        UE_LOG(LogTemp, Display, TEXT("ShaderMod.GroupSize.Reset - Autotune results cleared."));
+    }));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetGroupCountTest, "ShaderMod.WriteToRenderTarget.GroupCount", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks FWriteToRenderTargetGroupSize::GetGroupCount: every pixel is covered by exactly one thread
+ * and no group lies completely outside the output.
+ */
+bool FWriteToRenderTargetGroupCountTest::RunTest(const FString& Parameters)
+{
+    auto TestGroupCount = [this](FIntPoint Extent, EWriteToRenderTargetGroupSize GroupSize, FIntVector Expected)
+    {
+        TestEqual(FString::Printf(TEXT("%dx%d with %s"), Extent.X, Extent.Y, *FWriteToRenderTargetGroupSize::ToString(GroupSize)),
+            FWriteToRenderTargetGroupSize::GetGroupCount(Extent, GroupSize), Expected);
+    };
+
+    TestGroupCount(FIntPoint(1, 1), EWriteToRenderTargetGroupSize::G8x8, FIntVector(1, 1, 1));
+    TestGroupCount(FIntPoint(0, 0), EWriteToRenderTargetGroupSize::G8x8, FIntVector(0, 0, 1));
+    TestGroupCount(FIntPoint(1024, 1024), EWriteToRenderTargetGroupSize::G8x8, FIntVector(128, 128, 1));
+    TestGroupCount(FIntPoint(1920, 1080), EWriteToRenderTargetGroupSize::G16x16, FIntVector(120, 68, 1));
+    TestGroupCount(FIntPoint(1000, 1000), EWriteToRenderTargetGroupSize::G32x8, FIntVector(32, 125, 1));
+    TestGroupCount(FIntPoint(1000, 1000), EWriteToRenderTargetGroupSize::G8x32, FIntVector(125, 32, 1));
+    TestGroupCount(FIntPoint(33, 9), EWriteToRenderTargetGroupSize::G32x8, FIntVector(2, 2, 1));
+
+    // Coverage over a range of sizes: enough threads, and less than one spare group per axis
+    for (int32 GroupSizeIndex = 0; GroupSizeIndex < (int32)EWriteToRenderTargetGroupSize::Num; ++GroupSizeIndex)
+    {
+        const EWriteToRenderTargetGroupSize GroupSize = (EWriteToRenderTargetGroupSize)GroupSizeIndex;
+        const FIntPoint ThreadCount = FWriteToRenderTargetGroupSize::GetThreadCount(GroupSize);
+        for (int32 Size = 1; Size <= 300; ++Size)
+        {
+            const FIntVector GroupCount = FWriteToRenderTargetGroupSize::GetGroupCount(FIntPoint(Size, Size + 7), GroupSize);
+            const bool bCovers = GroupCount.X * ThreadCount.X >= Size && GroupCount.Y * ThreadCount.Y >= Size + 7;
+            const bool bTight = (GroupCount.X - 1) * ThreadCount.X < Size && (GroupCount.Y - 1) * ThreadCount.Y < Size + 7;
+            if (!bCovers || !bTight)
+            {
+                AddError(FString::Printf(TEXT("%dx%d with %s: %s"),
+                    Size, Size + 7, *FWriteToRenderTargetGroupSize::ToString(GroupSize), bCovers ? TEXT("spare group") : TEXT("pixels not covered")));
+            }
+        }
+    }
+    return true;
+}
+
+#endif
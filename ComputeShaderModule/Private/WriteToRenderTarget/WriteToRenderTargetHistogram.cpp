@@ -0,0 +1,823 @@
+#include "WriteToRenderTarget/WriteToRenderTargetHistogram.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+#include "RenderGraphUtils.h"
+#include "RenderingThread.h"
+#include "RHIGPUReadback.h"
+#include "TextureResource.h"
+#include "WriteToRenderTarget/WriteToRenderTarget.h"
+#include "WriteToRenderTarget/WriteToRenderTargetEffects.h"
+#include "WriteToRenderTarget/WriteToRenderTargetResizeCache.h"
+#include "WriteToRenderTarget/WriteToRenderTargetShaders.h"
+#include "WriteToRenderTarget/WriteToRenderTargetStats.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTiled.h"
+
+DEFINE_STAT(STAT_WriteToRenderTarget_Histogram);
+DEFINE_STAT(STAT_WriteToRenderTarget_HistogramCacheHits);
+DEFINE_STAT(STAT_WriteToRenderTarget_HistogramCacheMisses);
+
+IMPLEMENT_GLOBAL_SHADER(FWriteToRenderTargetHistogram, "/ComputeShaderModuleShaders/WriteToRenderTarget/WriteToRenderTargetHistogram.usf", "MainHistogram", SF_Compute);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetHistogramCacheSize(
+    TEXT("r.ShaderMod.HistogramCacheSize"),
+    64,
+    TEXT("Number of input luminance histograms kept for the automatic contrast and levels. 0 disables the cache."),
+    ECVF_Default);
+
+namespace WriteToRenderTargetHistogram
+{
+    using FBins = uint32[FWriteToRenderTargetLuminanceHistogram::NumBins];
+
+    /*
+     * Bins one row, four pixels per vector. FColor is BGRA in memory, so a pixel loaded as a little endian uint32 holds
+     * B in its low byte. The four lanes go to four sub-histograms: consecutive pixels of a flat region hit the same bin,
+     * and incrementing one counter four times in a row would serialize on the store of each increment.
+     */
+    static void BinRow(const FColor* Row, int32 Width, FBins SubBins[4])
+    {
+        const VectorRegister4Int ByteMask = VectorIntSet1(0xFF);
+        const VectorRegister4Int WeightR = VectorIntSet1(307);
+        const VectorRegister4Int WeightG = VectorIntSet1(614);
+        const VectorRegister4Int WeightB = VectorIntSet1(103);
+        const VectorRegister4Int Rounding = VectorIntSet1(512);
+
+        int32 X = 0;
+        alignas(16) uint32 Lanes[4];
+        for (; X + 4 <= Width; X += 4)
+        {
+            const VectorRegister4Int Pixels = VectorIntLoad(&Row[X]);
+            const VectorRegister4Int B = VectorIntAnd(Pixels, ByteMask);
+            const VectorRegister4Int G = VectorIntAnd(VectorShiftRightImmLogical(Pixels, 8), ByteMask);
+            const VectorRegister4Int R = VectorIntAnd(VectorShiftRightImmLogical(Pixels, 16), ByteMask);
+            const VectorRegister4Int Sum = VectorIntAdd(
+                VectorIntAdd(VectorIntMultiply(R, WeightR), VectorIntMultiply(G, WeightG)),
+                VectorIntAdd(VectorIntMultiply(B, WeightB), Rounding));
+            VectorIntStoreAligned(VectorShiftRightImmLogical(Sum, 10), Lanes);
+
+            ++SubBins[0][Lanes[0]];
+            ++SubBins[1][Lanes[1]];
+            ++SubBins[2][Lanes[2]];
+            ++SubBins[3][Lanes[3]];
+        }
+        for (; X < Width; ++X)
+        {
+            ++SubBins[0][FWriteToRenderTargetLuminanceHistogram::GetBin(Row[X].R, Row[X].G, Row[X].B)];
+        }
+    }
+
+    // Adds Source to Dest, four bins per vector
+    static void AddBins(uint32* Dest, const uint32* Source)
+    {
+        for (int32 Bin = 0; Bin < FWriteToRenderTargetLuminanceHistogram::NumBins; Bin += 4)
+        {
+            VectorIntStore(VectorIntAdd(VectorIntLoad(&Dest[Bin]), VectorIntLoad(&Source[Bin])), &Dest[Bin]);
+        }
+    }
+
+    /*
+     * Splits the rows into NumTasks bands, bins each band with BinBand into private sub-histograms and sums them.
+     * No bin is shared between tasks, so the reduction needs no atomics.
+     */
+    static FWriteToRenderTargetLuminanceHistogram ComputeBands(int32 SizeX, int32 SizeY, int32 NumTasks, TFunctionRef<void(int32 FirstRow, int32 LastRow, FBins SubBins[4])> BinBand)
+    {
+        FWriteToRenderTargetLuminanceHistogram Histogram;
+        if (SizeX <= 0 || SizeY <= 0)
+        {
+            return Histogram;
+        }
+
+        SCOPE_CYCLE_COUNTER(STAT_WriteToRenderTarget_Histogram);
+
+        if (NumTasks <= 0)
+        {
+            NumTasks = FApp::ShouldUseThreadingForPerformance() ? FTaskGraphInterface::Get().GetNumWorkerThreads() + 1 : 1;
+        }
+        NumTasks = FMath::Clamp(NumTasks, 1, SizeY);
+        const int32 RowsPerTask = FMath::DivideAndRoundUp(SizeY, NumTasks);
+
+        TArray<uint32> TaskBins;
+        TaskBins.SetNumZeroed(NumTasks * FWriteToRenderTargetLuminanceHistogram::NumBins);
+        ParallelFor(NumTasks, [&](int32 Task)
+        {
+            FBins SubBins[4] = {};
+            const int32 FirstRow = Task * RowsPerTask;
+            const int32 LastRow = FMath::Min(FirstRow + RowsPerTask, SizeY);
+            if (FirstRow < LastRow)
+            {
+                BinBand(FirstRow, LastRow, SubBins);
+            }
+            uint32* Bins = &TaskBins[Task * FWriteToRenderTargetLuminanceHistogram::NumBins];
+            for (const FBins& Sub : SubBins)
+            {
+                AddBins(Bins, Sub);
+            }
+        });
+
+        for (int32 Task = 0; Task < NumTasks; ++Task)
+        {
+            AddBins(Histogram.Bins, &TaskBins[Task * FWriteToRenderTargetLuminanceHistogram::NumBins]);
+        }
+        Histogram.NumPixels = (uint64)SizeX * SizeY;
+        return Histogram;
+    }
+
+    static FWriteToRenderTargetEffect MakeIdentity()
+    {
+        return FWriteToRenderTargetEffect::MakeColorMatrix(FMatrix::Identity, FVector4(0.0, 0.0, 0.0, 0.0));
+    }
+
+    // Black and white points closer than one 8-bit step are a flat image, which no stretch would improve
+    static constexpr float MinLevelsRange = 1.0f / 255.0f;
+}
+
+FWriteToRenderTargetLuminanceHistogram FWriteToRenderTargetLuminanceHistogram::Compute(FWriteToRenderTargetRowReadFunction ReadRow, int32 SizeX, int32 SizeY, int32 NumTasks)
+{
+    using namespace WriteToRenderTargetHistogram;
+
+    return ComputeBands(SizeX, SizeY, NumTasks, [&ReadRow, SizeX](int32 FirstRow, int32 LastRow, FBins SubBins[4])
+    {
+        TArray<FColor> RowPixels;
+        RowPixels.SetNumUninitialized(SizeX);
+        for (int32 Y = FirstRow; Y < LastRow; ++Y)
+        {
+            ReadRow(0, Y, SizeX, RowPixels.GetData());
+            BinRow(RowPixels.GetData(), SizeX, SubBins);
+        }
+    });
+}
+
+FWriteToRenderTargetLuminanceHistogram FWriteToRenderTargetLuminanceHistogram::Compute(const FColor* Pixels, int32 SizeX, int32 SizeY, int32 NumTasks)
+{
+    using namespace WriteToRenderTargetHistogram;
+
+    return ComputeBands(SizeX, SizeY, NumTasks, [Pixels, SizeX](int32 FirstRow, int32 LastRow, FBins SubBins[4])
+    {
+        for (int32 Y = FirstRow; Y < LastRow; ++Y)
+        {
+            BinRow(Pixels + (int64)Y * SizeX, SizeX, SubBins);
+        }
+    });
+}
+
+FWriteToRenderTargetLuminanceHistogram FWriteToRenderTargetLuminanceHistogram::ComputeReference(const FColor* Pixels, int64 NumPixels)
+{
+    FWriteToRenderTargetLuminanceHistogram Histogram;
+    for (int64 Index = 0; Index < NumPixels; ++Index)
+    {
+        ++Histogram.Bins[GetBin(Pixels[Index].R, Pixels[Index].G, Pixels[Index].B)];
+    }
+    Histogram.NumPixels = (uint64)FMath::Max<int64>(NumPixels, 0);
+    return Histogram;
+}
+
+float FWriteToRenderTargetLuminanceHistogram::GetPercentile(float Fraction) const
+{
+    const double Threshold = FMath::Clamp((double)Fraction, 0.0, 1.0) * NumPixels;
+    uint64 Count = 0;
+    for (int32 Bin = 0; Bin < NumBins; ++Bin)
+    {
+        Count += Bins[Bin];
+        if (Count > Threshold)
+        {
+            return Bin / 255.0f;
+        }
+    }
+    return 1.0f;
+}
+
+void FWriteToRenderTargetLuminanceHistogram::GetLevels(float ClipPercent, float& OutBlack, float& OutWhite) const
+{
+    // Never clip more than half from either end, the points would cross
+    const double Threshold = FMath::Clamp((double)ClipPercent, 0.0, 50.0) / 100.0 * NumPixels;
+
+    OutBlack = 0.0f;
+    uint64 Count = 0;
+    for (int32 Bin = 0; Bin < NumBins; ++Bin)
+    {
+        Count += Bins[Bin];
+        if (Count > Threshold)
+        {
+            OutBlack = Bin / 255.0f;
+            break;
+        }
+    }
+
+    OutWhite = 1.0f;
+    Count = 0;
+    for (int32 Bin = NumBins - 1; Bin >= 0; --Bin)
+    {
+        Count += Bins[Bin];
+        if (Count > Threshold)
+        {
+            OutWhite = Bin / 255.0f;
+            break;
+        }
+    }
+}
+
+FWriteToRenderTargetEffect FWriteToRenderTargetLuminanceHistogram::ResolveAutoContrast(float ClipPercent) const
+{
+    using namespace WriteToRenderTargetHistogram;
+
+    float Black, White;
+    GetLevels(ClipPercent, Black, White);
+    if (NumPixels == 0 || White - Black < MinLevelsRange)
+    {
+        return MakeIdentity();
+    }
+
+    // Contrast keeps 0.5 in place, so the end further from it decides how far the rest can be stretched
+    const float Extent = FMath::Max(0.5f - Black, White - 0.5f);
+    return FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Contrast, 0.5f / FMath::Max(Extent, MinLevelsRange));
+}
+
+FWriteToRenderTargetEffect FWriteToRenderTargetLuminanceHistogram::ResolveAutoLevels(float ClipPercent) const
+{
+    using namespace WriteToRenderTargetHistogram;
+
+    float Black, White;
+    GetLevels(ClipPercent, Black, White);
+    if (NumPixels == 0 || White - Black < MinLevelsRange)
+    {
+        return MakeIdentity();
+    }
+
+    // Color * Scale - Black * Scale on RGB, alpha untouched
+    const float Scale = 1.0f / (White - Black);
+    FMatrix ColorMatrix = FMatrix::Identity;
+    for (int32 Channel = 0; Channel < 3; ++Channel)
+    {
+        ColorMatrix.M[Channel][Channel] = Scale;
+    }
+    const double Offset = -Black * Scale;
+    return FWriteToRenderTargetEffect::MakeColorMatrix(ColorMatrix, FVector4(Offset, Offset, Offset, 0.0));
+}
+
+bool FWriteToRenderTargetLuminanceHistogram::IsNeededBy(const FWriteToRenderTargetEffectParams& Params)
+{
+    if (Params.EffectStack.Num() == 0)
+    {
+        return Params.AutoContrast != EWriteToRenderTargetAutoContrast::Off;
+    }
+    return Params.EffectStack.ContainsByPredicate([](const FWriteToRenderTargetEffect& Effect)
+    {
+        return Effect.Op == EWriteToRenderTargetEffectOp::AutoContrast || Effect.Op == EWriteToRenderTargetEffectOp::AutoLevels;
+    });
+}
+
+void FWriteToRenderTargetLuminanceHistogram::Resolve(FWriteToRenderTargetEffectParams& Params) const
+{
+    if (!IsNeededBy(Params))
+    {
+        return;
+    }
+
+    if (Params.EffectStack.Num() == 0)
+    {
+        FWriteToRenderTargetFusedEffects::MakeFieldStack(Params, Params.EffectStack);
+    }
+    for (FWriteToRenderTargetEffect& Effect : Params.EffectStack)
+    {
+        if (Effect.Op == EWriteToRenderTargetEffectOp::AutoContrast)
+        {
+            Effect = ResolveAutoContrast(Effect.Value);
+        }
+        else if (Effect.Op == EWriteToRenderTargetEffectOp::AutoLevels)
+        {
+            Effect = ResolveAutoLevels(Effect.Value);
+        }
+    }
+}
+
+/*
+ * One GPU reduction in flight. The readback is created, polled and destroyed on the render thread;
+ * the game thread only looks at State.
+ */
+struct FWriteToRenderTargetHistogramCache::FGPURequest
+{
+    enum EState : int32
+    {
+        InFlight,
+        Done,
+        Failed
+    };
+
+    TUniquePtr<FRHIGPUBufferReadback> Readback;
+    FWriteToRenderTargetLuminanceHistogram Result;
+    std::atomic<int32> State{ InFlight };
+    bool bDiscarded = false;        // Game thread: invalidated while in flight, the result is not stored
+
+    void Start_RenderThread(FRDGBuilder& GraphBuilder, FRHITexture* Texture)
+    {
+        const FIntPoint Size = Texture->GetSizeXY();
+        Result.NumPixels = (uint64)Size.X * Size.Y;
+        Readback = MakeUnique<FRHIGPUBufferReadback>(TEXT("WriteToRenderTarget_HistogramReadback"));
+        AddEnqueueCopyPass(GraphBuilder, Readback.Get(), WriteToRenderTargetRDG::AddHistogramPass(GraphBuilder, Texture), sizeof(Result.Bins));
+    }
+
+    void Poll_RenderThread()
+    {
+        if (State.load() != InFlight || !Readback || !Readback->IsReady())
+        {
+            return;
+        }
+        FMemory::Memcpy(Result.Bins, Readback->Lock(sizeof(Result.Bins)), sizeof(Result.Bins));
+        Readback->Unlock();
+        Readback.Reset();
+        State.store(Done);
+    }
+};
+
+FRDGBufferRef WriteToRenderTargetRDG::AddHistogramPass(FRDGBuilder& GraphBuilder, FRHITexture* Input)
+{
+    const FIntPoint Size = Input->GetSizeXY();
+    RDG_EVENT_SCOPE(GraphBuilder, "Histogram %dx%d", Size.X, Size.Y);
+
+    FRDGBufferRef Bins = GraphBuilder.CreateBuffer(
+        FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), FWriteToRenderTargetHistogram::NumBins), TEXT("WriteToRenderTarget_HistogramBins"));
+    FRDGBufferUAVRef BinsUAV = GraphBuilder.CreateUAV(Bins, PF_R32_UINT);
+    AddClearUAVPass(GraphBuilder, BinsUAV, 0u);
+
+    FWriteToRenderTargetHistogram::FParameters* PassParameters = GraphBuilder.AllocParameters<FWriteToRenderTargetHistogram::FParameters>();
+    PassParameters->InputTexture = Input;
+    PassParameters->HistogramBins = BinsUAV;
+    PassParameters->InputSize = FUintVector2(Size.X, Size.Y);
+    PassParameters->bInputSRGB = EnumHasAnyFlags(Input->GetFlags(), TexCreate_SRGB) ? 1 : 0;
+
+    TShaderMapRef<FWriteToRenderTargetHistogram> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+    FComputeShaderUtils::AddPass(
+        GraphBuilder,
+        RDG_EVENT_NAME("Histogram"),
+        ComputeShader,
+        PassParameters,
+        FComputeShaderUtils::GetGroupCount(Size, FWriteToRenderTargetHistogram::BlockSize));
+    return Bins;
+}
+
+FWriteToRenderTargetHistogramCache& FWriteToRenderTargetHistogramCache::Get()
+{
+    static FWriteToRenderTargetHistogramCache Instance;
+    return Instance;
+}
+
+FWriteToRenderTargetHistogramCache::FKey FWriteToRenderTargetHistogramCache::MakeKey(const UTexture2D* Texture)
+{
+    return FKey{ FObjectKey(Texture), FWriteToRenderTargetResizeCache::GetSourceRevision(Texture), FIntPoint(Texture->GetSizeX(), Texture->GetSizeY()) };
+}
+
+bool FWriteToRenderTargetHistogramCache::FindOrCompute(UTexture2D* Texture, UWriteToRenderTarget* Waiter, FWriteToRenderTargetLuminanceHistogram& OutHistogram)
+{
+    check(IsInGameThread());
+
+    if (!Texture)
+    {
+        return false;
+    }
+
+    const FKey Key = MakeKey(Texture);
+    if (FEntry* Entry = Entries.Find(Key))
+    {
+        ++Stats.Hits;
+        INC_DWORD_STAT(STAT_WriteToRenderTarget_HistogramCacheHits);
+        Entry->LastUseTick = ++UseTick;
+        OutHistogram = Entry->Histogram;
+        return true;
+    }
+
+    if (FPendingRequest* PendingRequest = Pending.Find(Key))
+    {
+        if (Waiter)
+        {
+            PendingRequest->Waiters.AddUnique(Waiter);
+        }
+        return false;
+    }
+
+    ++Stats.Misses;
+    INC_DWORD_STAT(STAT_WriteToRenderTarget_HistogramCacheMisses);
+
+    // Readable pixels are reduced right here, which is cheaper than a round trip through the GPU
+    FWriteToRenderTargetRowReader Reader;
+    if (Reader.Open(Texture))
+    {
+        const FIntPoint Size = Reader.GetSize();
+        OutHistogram = FWriteToRenderTargetLuminanceHistogram::Compute(
+            [&Reader](int32 X, int32 Y, int32 Width, FColor* Dest) { Reader.ReadRow(X, Y, Width, Dest); }, Size.X, Size.Y);
+        Reader.Close();
+        ++Stats.ComputedOnCPU;
+        Add(Key, OutHistogram);
+        return true;
+    }
+
+    FTextureResource* Resource = Texture->GetResource();
+    if (GUsingNullRHI || !Resource)
+    {
+        return false;
+    }
+
+    // A partially streamed texture is reduced at its resident top mip, whose histogram is close to the full one
+    TSharedPtr<FGPURequest, ESPMode::ThreadSafe> Request = MakeShared<FGPURequest, ESPMode::ThreadSafe>();
+    ENQUEUE_RENDER_COMMAND(WriteToRenderTargetHistogram)(
+        [Request, Resource](FRHICommandListImmediate& RHICmdList)
+        {
+            FRHITexture* TextureRHI = Resource->GetTexture2DRHI();
+            if (!TextureRHI)
+            {
+                Request->State.store(FGPURequest::Failed);
+                return;
+            }
+            FRDGBuilder GraphBuilder(RHICmdList);
+            Request->Start_RenderThread(GraphBuilder, TextureRHI);
+            GraphBuilder.Execute();
+        });
+
+    FPendingRequest& PendingRequest = Pending.Add(Key);
+    PendingRequest.Request = Request;
+    if (Waiter)
+    {
+        PendingRequest.Waiters.Add(Waiter);
+    }
+    return false;
+}
+
+void FWriteToRenderTargetHistogramCache::Add(const FKey& Key, const FWriteToRenderTargetLuminanceHistogram& Histogram)
+{
+    const int32 MaxEntries = CVarWriteToRenderTargetHistogramCacheSize.GetValueOnGameThread();
+    if (MaxEntries <= 0)
+    {
+        return;
+    }
+
+    // Least recently used first out; a few dozen entries are cheap to scan
+    while (Entries.Num() >= MaxEntries)
+    {
+        const FKey* OldestKey = nullptr;
+        uint64 OldestTick = MAX_uint64;
+        for (const TPair<FKey, FEntry>& Pair : Entries)
+        {
+            if (Pair.Value.LastUseTick < OldestTick)
+            {
+                OldestTick = Pair.Value.LastUseTick;
+                OldestKey = &Pair.Key;
+            }
+        }
+        const FKey KeyToRemove = *OldestKey;
+        Entries.Remove(KeyToRemove);
+    }
+
+    FEntry& Entry = Entries.Add(Key);
+    Entry.Histogram = Histogram;
+    Entry.LastUseTick = ++UseTick;
+}
+
+void FWriteToRenderTargetHistogramCache::Invalidate(const UTexture2D* Texture)
+{
+    check(IsInGameThread());
+
+    const FObjectKey TextureKey(Texture);
+    for (auto It = Entries.CreateIterator(); It; ++It)
+    {
+        if (It.Key().Texture == TextureKey)
+        {
+            It.RemoveCurrent();
+        }
+    }
+    for (TPair<FKey, FPendingRequest>& Pair : Pending)
+    {
+        if (Pair.Key.Texture == TextureKey)
+        {
+            Pair.Value.Request->bDiscarded = true;
+        }
+    }
+}
+
+void FWriteToRenderTargetHistogramCache::Empty()
+{
+    // Requests in flight still own their readbacks on the render thread; they finish and are dropped as discarded
+    Entries.Empty();
+    for (TPair<FKey, FPendingRequest>& Pair : Pending)
+    {
+        Pair.Value.Request->bDiscarded = true;
+    }
+}
+
+FWriteToRenderTargetHistogramCacheStats FWriteToRenderTargetHistogramCache::GetStats() const
+{
+    FWriteToRenderTargetHistogramCacheStats Result = Stats;
+    Result.NumEntries = Entries.Num();
+    Result.NumPending = Pending.Num();
+    return Result;
+}
+
+void FWriteToRenderTargetHistogramCache::Tick(float DeltaTime)
+{
+    for (auto It = Pending.CreateIterator(); It; ++It)
+    {
+        FPendingRequest& PendingRequest = It.Value();
+        FGPURequest& Request = *PendingRequest.Request;
+        const int32 State = Request.State.load();
+        if (State == FGPURequest::InFlight)
+        {
+            // The readback is only touched on the render thread
+            ENQUEUE_RENDER_COMMAND(WriteToRenderTargetHistogramPoll)(
+                [Request = PendingRequest.Request](FRHICommandListImmediate& RHICmdList)
+                {
+                    Request->Poll_RenderThread();
+                });
+            continue;
+        }
+
+        if (State == FGPURequest::Done && !Request.bDiscarded)
+        {
+            ++Stats.ComputedOnGPU;
+            Add(It.Key(), Request.Result);
+        }
+        else if (State == FGPURequest::Failed)
+        {
+            UE_LOG(LogTemp, Warning, TEXT("HistogramCache - The input had no GPU resource, its automatic contrast stays off."));
+        }
+
+        // Failed inputs are not retried until their next miss; the waiters dispatch once more either way
+        const TArray<TWeakObjectPtr<UWriteToRenderTarget>> Waiters = MoveTemp(PendingRequest.Waiters);
+        It.RemoveCurrent();
+        for (const TWeakObjectPtr<UWriteToRenderTarget>& Waiter : Waiters)
+        {
+            if (UWriteToRenderTarget* Processor = Waiter.Get())
+            {
+                Processor->RequestDispatch();
+            }
+        }
+    }
+}
+
+TStatId FWriteToRenderTargetHistogramCache::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(FWriteToRenderTargetHistogramCache, STATGROUP_Tickables);
+}
+
+bool FWriteToRenderTargetHistogramCache::ComputeOnGPUBlocking(UTexture2D* Texture, FWriteToRenderTargetLuminanceHistogram& OutHistogram)
+{
+    FTextureResource* Resource = Texture ? Texture->GetResource() : nullptr;
+    if (GUsingNullRHI || !Resource)
+    {
+        return false;
+    }
+
+    TSharedPtr<FGPURequest, ESPMode::ThreadSafe> Request = MakeShared<FGPURequest, ESPMode::ThreadSafe>();
+    ENQUEUE_RENDER_COMMAND(WriteToRenderTargetHistogramBlocking)(
+        [Request, Resource](FRHICommandListImmediate& RHICmdList)
+        {
+            FRHITexture* TextureRHI = Resource->GetTexture2DRHI();
+            if (!TextureRHI)
+            {
+                Request->State.store(FGPURequest::Failed);
+                return;
+            }
+            FRDGBuilder GraphBuilder(RHICmdList);
+            Request->Start_RenderThread(GraphBuilder, TextureRHI);
+            GraphBuilder.Execute();
+            RHICmdList.SubmitCommandsAndFlushGPU();
+            RHICmdList.BlockUntilGPUIdle();
+            Request->Poll_RenderThread();
+        });
+    FlushRenderingCommands();
+
+    if (Request->State.load() != FGPURequest::Done)
+    {
+        return false;
+    }
+    OutHistogram = Request->Result;
+    return true;
+}
+
+namespace WriteToRenderTargetHistogram
+{
+    // Noise with a luminance range of [Low, High], so the levels of the image are known
+    static TArray<FColor> MakeNoise(FIntPoint Size, uint32 Seed, uint8 Low = 0, uint8 High = 255)
+    {
+        TArray<FColor> Pixels;
+        Pixels.SetNumUninitialized(Size.X * Size.Y);
+        const uint32 Range = (uint32)(High - Low) + 1;
+        for (int32 Index = 0; Index < Pixels.Num(); ++Index)
+        {
+            const uint32 Hash = ((uint32)Index + Seed) * 2654435761u;
+            const uint8 Grey = (uint8)(Low + (Hash >> 8) % Range);
+            Pixels[Index] = Low == 0 && High == 255
+                ? FColor((uint8)Hash, (uint8)(Hash >> 8), (uint8)(Hash >> 16), (uint8)(Hash >> 24))
+                : FColor(Grey, Grey, Grey, 255);
+        }
+        return Pixels;
+    }
+
+    // Transient BGRA8 texture; sRGB like imported color textures unless bSRGB is false
+    static UTexture2D* MakeTexture(const TArray<FColor>& Pixels, FIntPoint Size, bool bSRGB = true)
+    {
+        UTexture2D* Texture = UTexture2D::CreateTransient(Size.X, Size.Y, PF_B8G8R8A8);
+        Texture->SRGB = bSRGB;
+        FMemory::Memcpy(Texture->GetPlatformData()->Mips[0].BulkData.Lock(LOCK_READ_WRITE), Pixels.GetData(), Pixels.Num() * sizeof(FColor));
+        Texture->GetPlatformData()->Mips[0].BulkData.Unlock();
+        Texture->UpdateResource();
+        return Texture;
+    }
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetHistogramTest, "ShaderMod.WriteToRenderTarget.Histogram", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks the histogram reductions against the one pixel at a time reference: the vectorized CPU reduction on sizes
+ * that leave tails and more tasks than rows, the GPU pass bin for bin on sRGB and linear inputs, and the levels and
+ * contrast derived from a known range. Then checks that the cache hits for an unchanged input and misses again after Invalidate.
+ */
+bool FWriteToRenderTargetHistogramTest::RunTest(const FString& Parameters)
+{
+    using namespace WriteToRenderTargetHistogram;
+
+    constexpr int32 Size = 1000;
+
+    for (const FIntPoint CaseSize : { FIntPoint(1, 1), FIntPoint(3, 5), FIntPoint(257, 131), FIntPoint(Size, Size + 3) })
+    {
+        const TArray<FColor> Pixels = MakeNoise(CaseSize, CaseSize.X);
+        const FWriteToRenderTargetLuminanceHistogram Reference = FWriteToRenderTargetLuminanceHistogram::ComputeReference(Pixels.GetData(), Pixels.Num());
+        for (const int32 NumTasks : { 1, 7, 0 })
+        {
+            const FWriteToRenderTargetLuminanceHistogram Histogram = FWriteToRenderTargetLuminanceHistogram::Compute(Pixels.GetData(), CaseSize.X, CaseSize.Y, NumTasks);
+            TestTrue(FString::Printf(TEXT("CPU %dx%d, %d tasks"), CaseSize.X, CaseSize.Y, NumTasks), Histogram == Reference);
+        }
+    }
+
+    // Grey 64..191: the levels are exactly its range, contrast stretches the end further from 0.5 to 0 or 1
+    {
+        const TArray<FColor> Pixels = MakeNoise(FIntPoint(256, 256), 1, 64, 191);
+        const FWriteToRenderTargetLuminanceHistogram Histogram = FWriteToRenderTargetLuminanceHistogram::Compute(Pixels.GetData(), 256, 256);
+        float Black, White;
+        Histogram.GetLevels(0.0f, Black, White);
+        TestEqual(TEXT("Black level of 64..191"), Black, 64 / 255.0f, 0.0f);
+        TestEqual(TEXT("White level of 64..191"), White, 191 / 255.0f, 0.0f);
+
+        const FWriteToRenderTargetEffect Levels = Histogram.ResolveAutoLevels(0.0f);
+        TestEqual(TEXT("Auto levels maps the black level to 0"), (float)(Levels.ColorMatrix.M[0][0] * Black + Levels.ColorOffset.X), 0.0f, 1.0e-5f);
+        TestEqual(TEXT("Auto levels maps the white level to 1"), (float)(Levels.ColorMatrix.M[0][0] * White + Levels.ColorOffset.X), 1.0f, 1.0e-5f);
+
+        const FWriteToRenderTargetEffect Contrast = Histogram.ResolveAutoContrast(0.0f);
+        TestTrue(TEXT("Auto contrast resolves to a contrast"), Contrast.Op == EWriteToRenderTargetEffectOp::Contrast);
+        TestEqual(TEXT("Auto contrast maps the darker end to 0"), Contrast.Value * (Black - 0.5f) + 0.5f, 0.0f, 1.0e-5f);
+
+        const TArray<FColor> Flat = MakeNoise(FIntPoint(16, 16), 1, 100, 100);
+        const FWriteToRenderTargetLuminanceHistogram FlatHistogram = FWriteToRenderTargetLuminanceHistogram::Compute(Flat.GetData(), 16, 16);
+        const TArray<FWriteToRenderTargetEffect> FlatStack = { FlatHistogram.ResolveAutoLevels(0.5f), FlatHistogram.ResolveAutoContrast(0.5f) };
+        TestTrue(TEXT("Flat image stays unchanged"), FWriteToRenderTargetFusedEffects::Fold(FlatStack).IsIdentityColor());
+    }
+
+    const FIntPoint TextureSize(Size + 13, Size / 2 + 7);
+    const TArray<FColor> Pixels = MakeNoise(TextureSize, 3);
+    UTexture2D* Texture = MakeTexture(Pixels, TextureSize);
+    const FWriteToRenderTargetLuminanceHistogram Reference = FWriteToRenderTargetLuminanceHistogram::ComputeReference(Pixels.GetData(), Pixels.Num());
+
+    if (WriteToRenderTargetTest::HasGPU(*this))
+    {
+        // Both bin the stored bytes, whether the texture is sampled as sRGB or not
+        UTexture2D* LinearTexture = MakeTexture(Pixels, TextureSize, false);
+        for (UTexture2D* GPUTexture : { Texture, LinearTexture })
+        {
+            FWriteToRenderTargetLuminanceHistogram GPUHistogram;
+            const bool bComputed = FWriteToRenderTargetHistogramCache::ComputeOnGPUBlocking(GPUTexture, GPUHistogram);
+            TestTrue(FString::Printf(TEXT("GPU %dx%d, %s"), TextureSize.X, TextureSize.Y, GPUTexture->SRGB ? TEXT("sRGB") : TEXT("linear")),
+                bComputed && GPUHistogram == Reference);
+        }
+        LinearTexture->MarkAsGarbage();
+    }
+
+    FWriteToRenderTargetHistogramCache& Cache = FWriteToRenderTargetHistogramCache::Get();
+    const FWriteToRenderTargetHistogramCacheStats Before = Cache.GetStats();
+    FWriteToRenderTargetLuminanceHistogram Cached;
+    TestTrue(TEXT("First lookup"), Cache.FindOrCompute(Texture, nullptr, Cached));
+    TestTrue(TEXT("Second lookup"), Cache.FindOrCompute(Texture, nullptr, Cached));
+    Cache.Invalidate(Texture);
+    TestTrue(TEXT("Lookup after Invalidate"), Cache.FindOrCompute(Texture, nullptr, Cached));
+    const FWriteToRenderTargetHistogramCacheStats After = Cache.GetStats();
+    TestTrue(TEXT("Cached histogram matches the reference"), Cached == Reference);
+    TestEqual(TEXT("Cache hits"), (int64)(After.Hits - Before.Hits), (int64)1);
+    TestEqual(TEXT("Cache misses"), (int64)(After.Misses - Before.Misses), (int64)2);
+    Cache.Invalidate(Texture);
+    Texture->MarkAsGarbage();
+    return true;
+}
+
+#endif
+
+/*
+ * Times the histogram reduction of a Size x Size image: the CPU reduction on 1, 2, 4... cores up to all of them,
+ * the one pixel at a time reference, and with a GPU the compute pass alone, timed with GPU queries.
+ * Usage: ShaderMod.BenchHistogram [Size] [Iterations]
+ */
+static FAutoConsoleCommand GWriteToRenderTargetBenchHistogramCommand(
+    TEXT("ShaderMod.BenchHistogram"),
+    TEXT("Times the CPU luminance histogram across core counts and the GPU histogram pass. Usage: ShaderMod.BenchHistogram [Size] [Iterations]"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        using namespace WriteToRenderTargetHistogram;
+
+        const int32 Size = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 16) : 4096;
+        const int32 Iterations = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 10;
+        const TArray<FColor> Pixels = MakeNoise(FIntPoint(Size, Size), 5);
+        const double Megapixels = (double)Size * Size / 1.0e6;
+
+        auto Report = [Size, Megapixels](const TCHAR* Name, double Seconds)
+        {
+            UE_LOG(LogTemp, Display, TEXT("ShaderMod.BenchHistogram %dx%d %-16s %8.3f ms %8.1f MP/s"), Size, Size, Name, Seconds * 1000.0, Megapixels / FMath::Max(Seconds, 1.0e-9));
+        };
+
+        // Best of Iterations, after one warm up run
+        auto Measure = [Iterations](TFunctionRef<void()> Work)
+        {
+            Work();
+            double Best = MAX_dbl;
+            for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+            {
+                const double StartTime = FPlatformTime::Seconds();
+                Work();
+                Best = FMath::Min(Best, FPlatformTime::Seconds() - StartTime);
+            }
+            return Best;
+        };
+
+        Report(TEXT("Reference"), Measure([&Pixels]() { FWriteToRenderTargetLuminanceHistogram::ComputeReference(Pixels.GetData(), Pixels.Num()); }));
+
+        const int32 AvailableWorkers = FApp::ShouldUseThreadingForPerformance() ? FTaskGraphInterface::Get().GetNumWorkerThreads() + 1 : 1;
+        for (int32 NumCores = 1; ; NumCores = FMath::Min(NumCores * 2, AvailableWorkers))
+        {
+            const double Seconds = Measure([&Pixels, Size, NumCores]() { FWriteToRenderTargetLuminanceHistogram::Compute(Pixels.GetData(), Size, Size, NumCores); });
+            Report(*FString::Printf(TEXT("CPU %d cores"), NumCores), Seconds);
+            if (NumCores == AvailableWorkers)
+            {
+                break;
+            }
+        }
+
+        if (GUsingNullRHI)
+        {
+            return;
+        }
+
+        UTexture2D* Texture = MakeTexture(Pixels, FIntPoint(Size, Size));
+        FlushRenderingCommands();
+        double GPUSeconds = 0.0;
+        ENQUEUE_RENDER_COMMAND(WriteToRenderTargetBenchHistogram)(
+            [Resource = Texture->GetResource(), Iterations, &GPUSeconds](FRHICommandListImmediate& RHICmdList)
+            {
+                FRHITexture* TextureRHI = Resource ? Resource->GetTexture2DRHI() : nullptr;
+                if (!TextureRHI)
+                {
+                    return;
+                }
+                auto AddPasses = [&RHICmdList, TextureRHI](int32 NumPasses)
+                {
+                    FRDGBuilder GraphBuilder(RHICmdList);
+                    for (int32 Pass = 0; Pass < NumPasses; ++Pass)
+                    {
+                        WriteToRenderTargetRDG::AddHistogramPass(GraphBuilder, TextureRHI);
+                    }
+                    GraphBuilder.Execute();
+                };
+                AddPasses(1);
+                RHICmdList.SubmitCommandsAndFlushGPU();
+
+                FRenderQueryRHIRef StartQuery = RHICreateRenderQuery(RQT_AbsoluteTime);
+                FRenderQueryRHIRef EndQuery = RHICreateRenderQuery(RQT_AbsoluteTime);
+                RHICmdList.EndRenderQuery(StartQuery);
+                AddPasses(Iterations);
+                RHICmdList.EndRenderQuery(EndQuery);
+                RHICmdList.SubmitCommandsAndFlushGPU();
+
+                uint64 StartMicroseconds = 0;
+                uint64 EndMicroseconds = 0;
+                if (RHIGetRenderQueryResult(StartQuery, StartMicroseconds, true) && RHIGetRenderQueryResult(EndQuery, EndMicroseconds, true))
+                {
+                    GPUSeconds = (EndMicroseconds - StartMicroseconds) / 1.0e6 / Iterations;
+                }
+            });
+        FlushRenderingCommands();
+        Texture->MarkAsGarbage();
+
+        if (GPUSeconds > 0.0)
+        {
+            Report(TEXT("GPU"), GPUSeconds);
+        }
+    }));
+
+static FAutoConsoleCommand GWriteToRenderTargetHistogramStatsCommand(
+    TEXT("ShaderMod.Histogram.Stats"),
+    TEXT("Logs the statistics of the luminance histogram cache used by the automatic contrast."),
+    FConsoleCommandDelegate::CreateLambda([]()
+    {
+        const FWriteToRenderTargetHistogramCacheStats Stats = FWriteToRenderTargetHistogramCache::Get().GetStats();
+        UE_LOG(LogTemp, Display, TEXT("ShaderMod histogram cache: %d entries, %d pending, %llu hits, %llu misses, %llu computed on the CPU, %llu on the GPU"),
+            Stats.NumEntries, Stats.NumPending, Stats.Hits, Stats.Misses, Stats.ComputedOnCPU, Stats.ComputedOnGPU);
+    }));
@@ -1,8 +1,10 @@
 #include "WriteToRenderTarget/WriteToRenderTargetLibrary.h"
+#include "Engine/Texture2D.h"
 #include "Engine/TextureRenderTarget2D.h"
 #include "WriteToRenderTarget/WriteToRenderTarget.h"
-
-UWriteToRenderTarget* UWriteToRenderTargetLibrary::WriteToRenderTargetInstance = nullptr;
+#include "WriteToRenderTarget/WriteToRenderTargetHistogram.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPool.h"
+#include "WriteToRenderTarget/WriteToRenderTargetSubsystem.h"
 
 /*
  * Executes the compute shader by ensuring that the texture is processed, resized if necessary,
@@ -10,54 +12,85 @@ UWriteToRenderTarget* UWriteToRenderTargetLibrary::WriteToRenderTargetInstance =
  */
 void UWriteToRenderTargetLibrary::ExecuteRTComputeShader(UTexture2D* InputTexture, UTextureRenderTarget2D* RT)
 {
-    if (!InputTexture || !RT)
+    // Parameter changes made through the setters of the default processor are picked up by its pending dispatch,
+    // so there is no need to reapply them here.
+    if (UWriteToRenderTargetSubsystem* Subsystem = UWriteToRenderTargetSubsystem::Get())
     {
-        UE_LOG(LogTemp, Warning, TEXT("Invalid input texture or render target."));
-        return;
+        Subsystem->Execute(Subsystem->GetDefaultProcessor(), InputTexture, RT);
+    }
+}
+
+void UWriteToRenderTargetLibrary::ExecuteRTComputeShaderWithProcessor(FWriteToRenderTargetHandle Processor, UTexture2D* InputTexture, UTextureRenderTarget2D* RT)
+{
+    if (UWriteToRenderTargetSubsystem* Subsystem = UWriteToRenderTargetSubsystem::Get())
+    {
+        Subsystem->Execute(Processor, InputTexture, RT);
     }
+}
 
-    // If the singleton instance already exists, apply the current shader parameters.
-    if (WriteToRenderTargetInstance)
+/*
+ * Executes the compute shader on every item with its own parameters. All items are recorded into one render graph
+ * on the render thread; see UWriteToRenderTarget::DispatchBatchRenderThread.
+ */
+void UWriteToRenderTargetLibrary::ExecuteRTComputeShaderBatch(const TArray<FWriteToRenderTargetBatchItem>& Items)
+{
+    // The default processor provides the resize filter and the backend selection
+    UWriteToRenderTargetSubsystem* Subsystem = UWriteToRenderTargetSubsystem::Get();
+    UWriteToRenderTarget* Processor = Subsystem ? Subsystem->GetProcessor(Subsystem->GetDefaultProcessor()) : nullptr;
+    if (!Processor)
     {
-        // Reapply shader parameters to the instance before execution
-        WriteToRenderTargetInstance->SetInvertColors(WriteToRenderTargetInstance->bInvertColors == 1);
-        WriteToRenderTargetInstance->SetGreyscale(WriteToRenderTargetInstance->bGreyscale == 1);
-        WriteToRenderTargetInstance->SetContrast(WriteToRenderTargetInstance->Contrast);
-        WriteToRenderTargetInstance->SetDistortionStrength(WriteToRenderTargetInstance->DistortionStrength);
-        WriteToRenderTargetInstance->SetImageScale(WriteToRenderTargetInstance->ImageScale);
-        WriteToRenderTargetInstance->SetRotationAngle(WriteToRenderTargetInstance->RotationAngle);
+        return;
     }
-    else
+
+    if (Processor->ResolveBackend() == EWriteToRenderTargetBackend::CPU)
     {
-        // Create a new instance if it doesn't exist
-        WriteToRenderTargetInstance = NewObject<UWriteToRenderTarget>();
-        UE_LOG(LogTemp, Warning, TEXT("WriteToRenderTargetInstance created."));
+        UE_LOG(LogTemp, Warning, TEXT("ExecuteRTComputeShaderBatch - Batches need the RDG backend, use ExecuteRTComputeShader per item on the CPU backend."));
+        return;
     }
 
-    // Resize the texture if its dimensions do not match the render target's dimensions
-    UTexture2D* ResizedTexture = InputTexture;
-    if (InputTexture->GetSizeX() != RT->SizeX || InputTexture->GetSizeY() != RT->SizeY)
+    // Resized inputs evicted by later items must not be recycled before the batch has read them
+    FWriteToRenderTargetTexturePool& TexturePool = FWriteToRenderTargetTexturePool::Get();
+    TArray<UTexture2D*> KernelInputs;
+    KernelInputs.Reserve(Items.Num());
+
+    TArray<FWriteToRenderTargetBatchRenderItem> RenderItems;
+    RenderItems.Reserve(Items.Num());
+    for (const FWriteToRenderTargetBatchItem& Item : Items)
     {
-        ResizedTexture = WriteToRenderTargetInstance->ResizeTexture(InputTexture, RT->SizeX, RT->SizeY);
-        if (!ResizedTexture)
+        if (!Item.InputTexture || !Item.RenderTarget)
         {
-            UE_LOG(LogTemp, Error, TEXT("Failed to resize texture."));
-            return;
+            UE_LOG(LogTemp, Warning, TEXT("Invalid input texture or render target."));
+            continue;
         }
-    }
 
-    FRHICommandListImmediate& RHICmdList = GetImmediateCommandList_ForRenderCommand();
-    FWriteToRenderTargetDispatchParams Params(RT->SizeX, RT->SizeY, 1);
-    Params.RenderTarget = RT->GameThread_GetRenderTargetResource();
+        UTexture2D* KernelInput = Processor->PrepareInput(Item.InputTexture, FIntPoint(Item.RenderTarget->SizeX, Item.RenderTarget->SizeY), Item.Params.bResampleInKernel);
+        if (!KernelInput)
+        {
+            continue;
+        }
+        TexturePool.AddInputUser(KernelInput);
+        KernelInputs.Add(KernelInput);
 
-    // Initialize the shader resources before dispatching is necessary
-    // as the shader resources are not available on the render thread
-    WriteToRenderTargetInstance->Initialize(RHICmdList, ResizedTexture, Params);
+        FWriteToRenderTargetBatchRenderItem& RenderItem = RenderItems.AddDefaulted_GetRef();
+        RenderItem.Input = KernelInput->GetResource();
+        RenderItem.RenderTarget = Item.RenderTarget->GameThread_GetRenderTargetResource();
+        RenderItem.EffectParams = Item.Params;
+        // PrepareInput hands over an input it could not resize for the kernel to resample
+        RenderItem.EffectParams.bResampleInKernel |= KernelInput->GetSizeX() != Item.RenderTarget->SizeX || KernelInput->GetSizeY() != Item.RenderTarget->SizeY;
 
-    // Enqueue the shader execution on the render thread
-    ENQUEUE_RENDER_COMMAND(ExecuteShader)(
-        [ResizedTexture, Params](FRHICommandListImmediate& RHICmdList)
+        // A batch is issued once, so an input whose histogram is still on its way to the GPU gets no automatic contrast
+        FWriteToRenderTargetLuminanceHistogram Histogram;
+        if (FWriteToRenderTargetLuminanceHistogram::IsNeededBy(Item.Params)
+            && FWriteToRenderTargetHistogramCache::Get().FindOrCompute(Item.InputTexture, nullptr, Histogram))
         {
-            WriteToRenderTargetInstance->DispatchRenderThread(RHICmdList, ResizedTexture, Params);
-        });
+            Histogram.Resolve(RenderItem.EffectParams);
+        }
+    }
+
+    UWriteToRenderTarget::DispatchBatchGameThread(MoveTemp(RenderItems));
+
+    for (UTexture2D* KernelInput : KernelInputs)
+    {
+        TexturePool.RemoveInputUser(KernelInput);
+    }
 }
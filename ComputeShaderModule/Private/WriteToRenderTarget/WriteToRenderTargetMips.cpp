@@ -0,0 +1,223 @@
+#include "WriteToRenderTarget/WriteToRenderTargetShaders.h"
+#include "Engine/Texture2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "HAL/IConsoleManager.h"
+#include "ImageCore.h"
+#include "RenderGraphUtils.h"
+#include "RenderingThread.h"
+#include "TextureResource.h"
+#include "WriteToRenderTarget/WriteToRenderTargetCPU.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPool.h"
+#include "WriteToRenderTarget/WriteToRenderTargetStats.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+
+DEFINE_STAT(STAT_WriteToRenderTarget_MipLevelsGenerated);
+
+IMPLEMENT_GLOBAL_SHADER(FWriteToRenderTargetMips, "/ComputeShaderModuleShaders/WriteToRenderTarget/WriteToRenderTargetMips.usf", "MainMips", SF_Compute);
+
+void WriteToRenderTargetRDG::AddGenerateMipsPass(FRDGBuilder& GraphBuilder, FRDGTextureRef Texture)
+{
+    const FRDGTextureDesc& Desc = Texture->Desc;
+    const int32 NumMips = Desc.NumMips;
+    const int32 MipFormat = FWriteToRenderTargetMips::GetMipFormat(Desc.Format);
+    if (NumMips <= 1 || MipFormat == INDEX_NONE || !UE::PixelFormat::HasCapabilities(Desc.Format, EPixelFormatCapabilities::TypedUAVStore))
+    {
+        return;
+    }
+
+    RDG_EVENT_SCOPE(GraphBuilder, "GenerateMips %dx%d %d levels", Desc.Extent.X, Desc.Extent.Y, NumMips - 1);
+
+    // The levels are written through UAVs; a target without them gets a scratch copy of its mip 0 and the lower mips copied back
+    const bool bDirectWrite = EnumHasAnyFlags(Desc.Flags, TexCreate_UAV);
+    FRDGTextureRef MipTexture = Texture;
+    if (!bDirectWrite)
+    {
+        MipTexture = FWriteToRenderTargetRenderTargetPool::Get().CreateTexture(GraphBuilder,
+            FRDGTextureDesc::Create2D(Desc.Extent, Desc.Format, FClearValueBinding::None, TexCreate_ShaderResource | TexCreate_UAV, NumMips),
+            TEXT("WriteToRenderTarget_MipTexture"));
+        AddCopyTexturePass(GraphBuilder, Texture, MipTexture, FRHICopyTextureInfo());
+    }
+
+    FWriteToRenderTargetMips::FPermutationDomain PermutationVector;
+    PermutationVector.Set<FWriteToRenderTargetMips::FMipFormatDim>(MipFormat);
+    TShaderMapRef<FWriteToRenderTargetMips> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+    // Each dispatch reads the last level written by the previous one
+    for (int32 SourceMip = 0; SourceMip < NumMips - 1; SourceMip += FWriteToRenderTargetMips::MaxLevelsPerPass)
+    {
+        const int32 NumLevels = FMath::Min(FWriteToRenderTargetMips::MaxLevelsPerPass, NumMips - 1 - SourceMip);
+        const FIntPoint SourceSize(FMath::Max(Desc.Extent.X >> SourceMip, 1), FMath::Max(Desc.Extent.Y >> SourceMip, 1));
+
+        FRDGTextureUAVRef LevelUAVs[FWriteToRenderTargetMips::MaxLevelsPerPass];
+        for (int32 Level = 0; Level < FWriteToRenderTargetMips::MaxLevelsPerPass; ++Level)
+        {
+            LevelUAVs[Level] = Level < NumLevels ? GraphBuilder.CreateUAV(FRDGTextureUAVDesc(MipTexture, SourceMip + 1 + Level)) : LevelUAVs[NumLevels - 1];
+        }
+
+        FWriteToRenderTargetMips::FParameters* PassParameters = GraphBuilder.AllocParameters<FWriteToRenderTargetMips::FParameters>();
+        PassParameters->SourceMip = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(MipTexture, SourceMip));
+        PassParameters->OutMip1 = LevelUAVs[0];
+        PassParameters->OutMip2 = LevelUAVs[1];
+        PassParameters->OutMip3 = LevelUAVs[2];
+        PassParameters->OutMip4 = LevelUAVs[3];
+        PassParameters->OutMip5 = LevelUAVs[4];
+        PassParameters->OutMip6 = LevelUAVs[5];
+        PassParameters->SourceSize = FUintVector2(SourceSize.X, SourceSize.Y);
+        PassParameters->NumLevels = NumLevels;
+
+        FComputeShaderUtils::AddPass(
+            GraphBuilder,
+            RDG_EVENT_NAME("GenerateMips %d-%d", SourceMip + 1, SourceMip + NumLevels),
+            ComputeShader,
+            PassParameters,
+            FComputeShaderUtils::GetGroupCount(SourceSize, FWriteToRenderTargetMips::SourceBlockSize));
+    }
+
+    if (!bDirectWrite)
+    {
+        FRHICopyTextureInfo CopyInfo;
+        CopyInfo.SourceMipIndex = 1;
+        CopyInfo.DestMipIndex = 1;
+        CopyInfo.NumMips = NumMips - 1;
+        AddCopyTexturePass(GraphBuilder, MipTexture, Texture, CopyInfo);
+    }
+
+    INC_DWORD_STAT_BY(STAT_WriteToRenderTarget_MipLevelsGenerated, NumMips - 1);
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace WriteToRenderTargetMips
+{
+    // Scalar 2x2 box filter of one BGRA8 level, channel by channel, as the definition the mip builders are checked against
+    static void ReferenceDownsample(const TArray<FColor>& Source, FIntPoint SourceSize, TArray<FColor>& OutDest, FIntPoint& OutDestSize)
+    {
+        OutDestSize = FIntPoint(FMath::Max(SourceSize.X / 2, 1), FMath::Max(SourceSize.Y / 2, 1));
+        OutDest.SetNumUninitialized(OutDestSize.X * OutDestSize.Y);
+        for (int32 Y = 0; Y < OutDestSize.Y; ++Y)
+        {
+            const int32 Y0 = FMath::Min(Y * 2, SourceSize.Y - 1);
+            const int32 Y1 = FMath::Min(Y * 2 + 1, SourceSize.Y - 1);
+            for (int32 X = 0; X < OutDestSize.X; ++X)
+            {
+                const int32 X0 = FMath::Min(X * 2, SourceSize.X - 1);
+                const int32 X1 = FMath::Min(X * 2 + 1, SourceSize.X - 1);
+                const uint8* Texels[4] = {
+                    reinterpret_cast<const uint8*>(&Source[Y0 * SourceSize.X + X0]), reinterpret_cast<const uint8*>(&Source[Y0 * SourceSize.X + X1]),
+                    reinterpret_cast<const uint8*>(&Source[Y1 * SourceSize.X + X0]), reinterpret_cast<const uint8*>(&Source[Y1 * SourceSize.X + X1]) };
+                uint8* Dest = reinterpret_cast<uint8*>(&OutDest[Y * OutDestSize.X + X]);
+                for (int32 Channel = 0; Channel < 4; ++Channel)
+                {
+                    Dest[Channel] = (uint8)((Texels[0][Channel] + Texels[1][Channel] + Texels[2][Channel] + Texels[3][Channel] + 2) / 4);
+                }
+            }
+        }
+    }
+
+    // Compares each level of Mips (level 1 first) with the reference chain of Mip0, bit for bit
+    static void TestAgainstReference(FAutomationTestBase& Test, const TCHAR* Case, const TArray<FColor>& Mip0, FIntPoint Size,
+        TFunctionRef<bool(int32 Level, FIntPoint LevelSize, TArray<FColor>& OutPixels)> GetLevel, int32 NumLevels)
+    {
+        TArray<FColor> Expected = Mip0;
+        FIntPoint ExpectedSize = Size;
+        for (int32 Level = 1; Level <= NumLevels; ++Level)
+        {
+            TArray<FColor> Previous = MoveTemp(Expected);
+            ReferenceDownsample(Previous, ExpectedSize, Expected, ExpectedSize);
+
+            const FString What = FString::Printf(TEXT("%s %dx%d level %d"), Case, Size.X, Size.Y, Level);
+            TArray<FColor> Actual;
+            if (Test.TestTrue(What + TEXT(" read"), GetLevel(Level, ExpectedSize, Actual)))
+            {
+                WriteToRenderTargetTest::TestImagesEqual(Test, What, Expected, Actual);
+            }
+        }
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetMipsTest, "ShaderMod.WriteToRenderTarget.Mips", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks the mip builders against a scalar 2x2 box filter, level by level and bit for bit: the CPU builder on
+ * odd, thin and power of two sizes, and with a GPU the RDG mip pass (direct and through a scratch texture) and the
+ * CPU backend's uploaded mips, both read back from real render targets.
+ */
+bool FWriteToRenderTargetMipsTest::RunTest(const FString& Parameters)
+{
+    using namespace WriteToRenderTargetMips;
+
+    constexpr int32 Size = 1000;
+
+    for (const FIntPoint CaseSize : { FIntPoint(256, 256), FIntPoint(257, 131), FIntPoint(1, 37), FIntPoint(640, 3), FIntPoint(Size, Size) })
+    {
+        const TArray<FColor> Mip0 = WriteToRenderTargetTest::MakeNoise(CaseSize, CaseSize.X);
+        TArray<FImage> LowerMips;
+        FWriteToRenderTargetCPU::GenerateMips(Mip0.GetData(), CaseSize.X, CaseSize.Y, MAX_int32, LowerMips);
+        TestAgainstReference(*this, TEXT("CPU"), Mip0, CaseSize,
+            [&LowerMips](int32 Level, FIntPoint LevelSize, TArray<FColor>& OutPixels)
+            {
+                const FImage& Mip = LowerMips[Level - 1];
+                OutPixels = TArray<FColor>(Mip.AsBGRA8().GetData(), Mip.SizeX * Mip.SizeY);
+                return Mip.SizeX == LevelSize.X && Mip.SizeY == LevelSize.Y;
+            }, LowerMips.Num());
+    }
+
+    if (!WriteToRenderTargetTest::HasGPU(*this))
+    {
+        return true;
+    }
+
+    // Not a power of two, and large enough for two mip dispatches
+    const FIntPoint TargetSize(Size + 13, Size / 2 + 7);
+    UTexture2D* Input = WriteToRenderTargetTest::CreateTexture(TargetSize, WriteToRenderTargetTest::MakeNoise(TargetSize, 7));
+
+    FWriteToRenderTargetEffectParams Params;
+    Params.RotationAngle = 30.0f;
+    Params.Contrast = 1.5f;
+    Params.bGenerateMips = true;
+
+    struct FCase
+    {
+        const TCHAR* Name;
+        EWriteToRenderTargetBackend Backend;
+        EPixelFormat Format;
+        bool bUAV;
+    };
+    // The CPU backend uploads into BGRA8 targets only
+    const FCase Cases[] = {
+        { TEXT("RDG direct"), EWriteToRenderTargetBackend::RDG, PF_R8G8B8A8, true },
+        { TEXT("RDG scratch"), EWriteToRenderTargetBackend::RDG, PF_R8G8B8A8, false },
+        { TEXT("CPU upload"), EWriteToRenderTargetBackend::CPU, PF_B8G8R8A8, false },
+    };
+    for (const FCase& Case : Cases)
+    {
+        UTextureRenderTarget2D* RenderTarget = WriteToRenderTargetTest::CreateRenderTarget(TargetSize, Case.Format, Case.bUAV, true);
+        WriteToRenderTargetTest::FScopedProcessor Processor(Case.Backend);
+        Processor.Execute(Input, RenderTarget, Params);
+
+        FTextureRenderTargetResource* Resource = RenderTarget->GameThread_GetRenderTargetResource();
+        auto ReadLevel = [Resource](int32 Level, FIntPoint LevelSize, TArray<FColor>& OutPixels)
+        {
+            FReadSurfaceDataFlags Flags(RCM_UNorm, CubeFace_MAX);
+            Flags.SetMip(Level);
+            return Resource->ReadPixels(OutPixels, Flags, FIntRect(FIntPoint::ZeroValue, LevelSize));
+        };
+
+        TArray<FColor> Mip0;
+        const int32 NumLevels = RenderTarget->GetNumMips() - 1;
+        if (NumLevels < 1 || !ReadLevel(0, TargetSize, Mip0))
+        {
+            AddWarning(FString::Printf(TEXT("%s skipped, the render target has no mips"), Case.Name));
+        }
+        else
+        {
+            TestAgainstReference(*this, Case.Name, Mip0, TargetSize, ReadLevel, NumLevels);
+        }
+        RenderTarget->MarkAsGarbage();
+    }
+
+    Input->MarkAsGarbage();
+    return true;
+}
+
+#endif
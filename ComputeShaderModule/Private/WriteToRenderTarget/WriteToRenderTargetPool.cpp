@@ -0,0 +1,458 @@
+#include "WriteToRenderTarget/WriteToRenderTargetPool.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "RenderTargetPool.h"
+#include "TextureResource.h"
+#include "WriteToRenderTarget/WriteToRenderTarget.h"
+#include "WriteToRenderTarget/WriteToRenderTargetStats.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+
+DEFINE_STAT(STAT_WriteToRenderTarget_PoolTexturesAllocated);
+DEFINE_STAT(STAT_WriteToRenderTarget_PoolTexturesReused);
+DEFINE_STAT(STAT_WriteToRenderTarget_PoolRegistrationsCreated);
+DEFINE_STAT(STAT_WriteToRenderTarget_RenderTargetPoolMemory);
+DEFINE_STAT(STAT_WriteToRenderTarget_TransientTexturesCreated);
+DEFINE_STAT(STAT_WriteToRenderTarget_TransientTexturesReused);
+DEFINE_STAT(STAT_WriteToRenderTarget_TexturePoolMemory);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetRenderTargetPoolBudgetMB(
+    TEXT("r.ShaderMod.RenderTargetPoolBudgetMB"),
+    256,
+    TEXT("Memory budget in MB for the scratch textures WriteToRenderTarget keeps between dispatches. 0 keeps none."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetTexturePoolBudgetMB(
+    TEXT("r.ShaderMod.TexturePoolBudgetMB"),
+    128,
+    TEXT("Memory budget in MB for released resize textures kept for reuse by ResizeTexture. 0 keeps none."),
+    ECVF_Default);
+
+// Render target wrappers unused for this many render frames are dropped, and never more than this many are kept
+static constexpr uint32 GWriteToRenderTargetRegistrationMaxAge = 120;
+static constexpr int32 GWriteToRenderTargetMaxRegistrations = 64;
+
+static bool MatchesDesc(const FRDGTextureDesc& A, const FRDGTextureDesc& B)
+{
+    return A.Dimension == B.Dimension && A.Extent == B.Extent && A.Format == B.Format && A.Flags == B.Flags
+        && A.ArraySize == B.ArraySize && A.NumMips == B.NumMips && A.NumSamples == B.NumSamples;
+}
+
+FWriteToRenderTargetRenderTargetPool& FWriteToRenderTargetRenderTargetPool::Get()
+{
+    static FWriteToRenderTargetRenderTargetPool Instance;
+    return Instance;
+}
+
+FRDGTextureRef FWriteToRenderTargetRenderTargetPool::CreateTexture(FRDGBuilder& GraphBuilder, const FRDGTextureDesc& Desc, const TCHAR* Name)
+{
+    check(IsInRenderingThread());
+
+    FPooledTexture* Found = Textures.FindByPredicate([&Desc](const FPooledTexture& Texture) { return MatchesDesc(Texture.Desc, Desc); });
+    if (Found)
+    {
+        ++TexturesReused;
+        INC_DWORD_STAT(STAT_WriteToRenderTarget_PoolTexturesReused);
+    }
+    else
+    {
+        Found = &Textures.AddDefaulted_GetRef();
+        Found->Desc = Desc;
+        Found->RenderTarget = AllocatePooledTexture(Desc, Name);
+        Found->Bytes = (int64)Desc.Extent.X * Desc.Extent.Y * Desc.ArraySize * GPixelFormats[Desc.Format].BlockBytes;
+        BytesHeld += Found->Bytes;
+        ++TexturesAllocated;
+        INC_DWORD_STAT(STAT_WriteToRenderTarget_PoolTexturesAllocated);
+    }
+    Found->LastUseTick = ++UseTick;
+
+    // Registering first: the graph holds its own reference, so evicting this very texture below is harmless
+    FRDGTextureRef Texture = GraphBuilder.RegisterExternalTexture(Found->RenderTarget, Name);
+    EvictToBudget();
+    return Texture;
+}
+
+/*
+ * The wrapper carries the RDG state of the texture from one graph to the next. Every graph ends with its external
+ * textures back in their default readable state, which is also what the render target's other users leave it in.
+ */
+FRDGTextureRef FWriteToRenderTargetRenderTargetPool::RegisterExternalTexture(FRDGBuilder& GraphBuilder, FRHITexture* Texture, const TCHAR* Name)
+{
+    check(IsInRenderingThread());
+
+    FRegistration* Registration = Registrations.Find(Texture);
+    if (Registration)
+    {
+        ++RegistrationsReused;
+    }
+    else
+    {
+        Registration = &Registrations.Add(Texture);
+        Registration->RenderTarget = CreateRenderTarget(Texture, Name);
+        ++RegistrationsCreated;
+        INC_DWORD_STAT(STAT_WriteToRenderTarget_PoolRegistrationsCreated);
+    }
+    Registration->LastUseFrame = GFrameNumberRenderThread;
+
+    FRDGTextureRef RDGTexture = GraphBuilder.RegisterExternalTexture(Registration->RenderTarget, Name);
+    PruneRegistrations();
+    return RDGTexture;
+}
+
+void FWriteToRenderTargetRenderTargetPool::Empty()
+{
+    check(IsInRenderingThread());
+    Textures.Empty();
+    Registrations.Empty();
+    BytesHeld = 0;
+    SET_MEMORY_STAT(STAT_WriteToRenderTarget_RenderTargetPoolMemory, 0);
+}
+
+FWriteToRenderTargetRenderTargetPoolStats FWriteToRenderTargetRenderTargetPool::GetStats() const
+{
+    FWriteToRenderTargetRenderTargetPoolStats Stats;
+    Stats.TexturesAllocated = TexturesAllocated;
+    Stats.TexturesReused = TexturesReused;
+    Stats.RegistrationsCreated = RegistrationsCreated;
+    Stats.RegistrationsReused = RegistrationsReused;
+    Stats.Evictions = Evictions;
+    Stats.NumTextures = Textures.Num();
+    Stats.NumRegistrations = Registrations.Num();
+    Stats.BytesHeld = BytesHeld;
+    Stats.BudgetBytes = (int64)FMath::Max(CVarWriteToRenderTargetRenderTargetPoolBudgetMB.GetValueOnAnyThread(), 0) * 1024 * 1024;
+    return Stats;
+}
+
+void FWriteToRenderTargetRenderTargetPool::EvictToBudget()
+{
+    const int64 BudgetBytes = (int64)FMath::Max(CVarWriteToRenderTargetRenderTargetPoolBudgetMB.GetValueOnRenderThread(), 0) * 1024 * 1024;
+    while (Textures.Num() > 0 && BytesHeld > BudgetBytes)
+    {
+        int32 Oldest = 0;
+        for (int32 Index = 1; Index < Textures.Num(); ++Index)
+        {
+            Oldest = Textures[Index].LastUseTick < Textures[Oldest].LastUseTick ? Index : Oldest;
+        }
+        BytesHeld -= Textures[Oldest].Bytes;
+        Textures.RemoveAtSwap(Oldest);
+        ++Evictions;
+    }
+    SET_MEMORY_STAT(STAT_WriteToRenderTarget_RenderTargetPoolMemory, BytesHeld);
+}
+
+void FWriteToRenderTargetRenderTargetPool::PruneRegistrations()
+{
+    for (auto It = Registrations.CreateIterator(); It; ++It)
+    {
+        if (GFrameNumberRenderThread - It.Value().LastUseFrame > GWriteToRenderTargetRegistrationMaxAge)
+        {
+            It.RemoveCurrent();
+        }
+    }
+
+    while (Registrations.Num() > GWriteToRenderTargetMaxRegistrations)
+    {
+        FRHITexture* OldestTexture = nullptr;
+        uint32 OldestFrame = MAX_uint32;
+        for (const TPair<FRHITexture*, FRegistration>& Pair : Registrations)
+        {
+            if (Pair.Value.LastUseFrame < OldestFrame)
+            {
+                OldestFrame = Pair.Value.LastUseFrame;
+                OldestTexture = Pair.Key;
+            }
+        }
+        Registrations.Remove(OldestTexture);
+    }
+}
+
+FWriteToRenderTargetTexturePool& FWriteToRenderTargetTexturePool::Get()
+{
+    static FWriteToRenderTargetTexturePool Instance;
+    return Instance;
+}
+
+UTexture2D* FWriteToRenderTargetTexturePool::Acquire(FIntPoint Size, EPixelFormat Format)
+{
+    check(IsInGameThread());
+
+    // Most recently released first, its memory is the most likely to still be warm
+    for (int32 Index = FreeTextures.Num() - 1; Index >= 0; --Index)
+    {
+        const FFreeTexture& Free = FreeTextures[Index];
+        if (Free.Texture && Free.Texture->GetSizeX() == Size.X && Free.Texture->GetSizeY() == Size.Y && Free.Texture->GetPixelFormat() == Format
+            && Free.Fence->IsFenceComplete())
+        {
+            UTexture2D* Texture = Free.Texture;
+            BytesHeld -= Free.Bytes;
+            FreeTextures.RemoveAt(Index);
+            UpdateMemoryStat();
+            ++TexturesReused;
+            INC_DWORD_STAT(STAT_WriteToRenderTarget_TransientTexturesReused);
+            return Texture;
+        }
+    }
+
+    UTexture2D* Texture = UTexture2D::CreateTransient(Size.X, Size.Y, Format);
+    if (Texture)
+    {
+        ++TexturesCreated;
+        INC_DWORD_STAT(STAT_WriteToRenderTarget_TransientTexturesCreated);
+    }
+    return Texture;
+}
+
+void FWriteToRenderTargetTexturePool::Release(UTexture2D* Texture)
+{
+    check(IsInGameThread());
+
+    if (!Texture || PendingTextures.Contains(Texture) || FreeTextures.ContainsByPredicate([Texture](const FFreeTexture& Free) { return Free.Texture == Texture; }))
+    {
+        return;
+    }
+
+    if (InputUsers.FindRef(FObjectKey(Texture)) > 0)
+    {
+        PendingTextures.Add(Texture);
+        return;
+    }
+    MakeFree(Texture);
+}
+
+void FWriteToRenderTargetTexturePool::AddInputUser(UTexture2D* Texture)
+{
+    check(IsInGameThread());
+
+    if (Texture)
+    {
+        ++InputUsers.FindOrAdd(FObjectKey(Texture));
+    }
+}
+
+void FWriteToRenderTargetTexturePool::RemoveInputUser(UTexture2D* Texture)
+{
+    check(IsInGameThread());
+
+    int32* Count = Texture ? InputUsers.Find(FObjectKey(Texture)) : nullptr;
+    if (!Count || --*Count > 0)
+    {
+        return;
+    }
+
+    InputUsers.Remove(FObjectKey(Texture));
+    if (PendingTextures.Remove(Texture) > 0)
+    {
+        MakeFree(Texture);
+    }
+}
+
+/*
+ * The fence is begun after every render command that could still read the texture was enqueued,
+ * so Acquire never rewrites the mip of a texture the render thread has yet to dispatch or upload.
+ */
+void FWriteToRenderTargetTexturePool::MakeFree(UTexture2D* Texture)
+{
+    const int64 Bytes = (int64)Texture->GetSizeX() * Texture->GetSizeY() * GPixelFormats[Texture->GetPixelFormat()].BlockBytes;
+    if (Bytes > GetBudgetBytes())
+    {
+        ++Evictions;
+        return;
+    }
+
+    FFreeTexture& Free = FreeTextures.AddDefaulted_GetRef();
+    Free.Texture = Texture;
+    Free.Bytes = Bytes;
+    Free.LastUseTick = ++UseTick;
+    Free.Fence = MakeShared<FRenderCommandFence>();
+    Free.Fence->BeginFence();
+    BytesHeld += Bytes;
+    EvictToBudget();
+}
+
+/*
+ * Evicted textures are only dropped from the pool; nothing else references them, so the next garbage collection
+ * destroys them and releases their resources.
+ */
+void FWriteToRenderTargetTexturePool::EvictToBudget()
+{
+    const int64 BudgetBytes = GetBudgetBytes();
+    while (FreeTextures.Num() > 0 && BytesHeld > BudgetBytes)
+    {
+        int32 Oldest = 0;
+        for (int32 Index = 1; Index < FreeTextures.Num(); ++Index)
+        {
+            Oldest = FreeTextures[Index].LastUseTick < FreeTextures[Oldest].LastUseTick ? Index : Oldest;
+        }
+        BytesHeld -= FreeTextures[Oldest].Bytes;
+        FreeTextures.RemoveAt(Oldest);
+        ++Evictions;
+    }
+    UpdateMemoryStat();
+}
+
+void FWriteToRenderTargetTexturePool::UpdateMemoryStat()
+{
+    SET_MEMORY_STAT(STAT_WriteToRenderTarget_TexturePoolMemory, BytesHeld);
+}
+
+void FWriteToRenderTargetTexturePool::Empty(bool bIncludePending)
+{
+    check(IsInGameThread());
+    FreeTextures.Empty();
+    if (bIncludePending)
+    {
+        PendingTextures.Empty();
+        InputUsers.Empty();
+    }
+    BytesHeld = 0;
+    UpdateMemoryStat();
+}
+
+FWriteToRenderTargetTexturePoolStats FWriteToRenderTargetTexturePool::GetStats() const
+{
+    FWriteToRenderTargetTexturePoolStats Stats;
+    Stats.TexturesCreated = TexturesCreated;
+    Stats.TexturesReused = TexturesReused;
+    Stats.Evictions = Evictions;
+    Stats.NumFree = FreeTextures.Num();
+    Stats.NumPending = PendingTextures.Num();
+    Stats.BytesHeld = BytesHeld;
+    Stats.BudgetBytes = GetBudgetBytes();
+    return Stats;
+}
+
+int64 FWriteToRenderTargetTexturePool::GetBudgetBytes() const
+{
+    return (int64)FMath::Max(CVarWriteToRenderTargetTexturePoolBudgetMB.GetValueOnGameThread(), 0) * 1024 * 1024;
+}
+
+void FWriteToRenderTargetTexturePool::AddReferencedObjects(FReferenceCollector& Collector)
+{
+    for (FFreeTexture& Free : FreeTextures)
+    {
+        Collector.AddReferencedObject(Free.Texture);
+    }
+    Collector.AddReferencedObjects(PendingTextures);
+}
+
+FString FWriteToRenderTargetTexturePool::GetReferencerName() const
+{
+    return TEXT("FWriteToRenderTargetTexturePool");
+}
+
+static FWriteToRenderTargetRenderTargetPoolStats GetRenderTargetPoolStats()
+{
+    FWriteToRenderTargetRenderTargetPoolStats Stats;
+    ENQUEUE_RENDER_COMMAND(WriteToRenderTargetPoolStats)(
+        [&Stats](FRHICommandListImmediate& RHICmdList)
+        {
+            Stats = FWriteToRenderTargetRenderTargetPool::Get().GetStats();
+        });
+    FlushRenderingCommands();
+    return Stats;
+}
+
+static FAutoConsoleCommand GWriteToRenderTargetPoolStatsCommand(
+    TEXT("ShaderMod.Pool.Stats"),
+    TEXT("Logs the allocation and reuse statistics of the WriteToRenderTarget texture pools."),
+    FConsoleCommandDelegate::CreateLambda([]()
+    {
+        const FWriteToRenderTargetRenderTargetPoolStats RenderTargetStats = GetRenderTargetPoolStats();
+        UE_LOG(LogTemp, Display, TEXT("ShaderMod render target pool: %d textures, %.1f / %.1f MB, %llu allocated, %llu reused, %llu evictions; %d registrations, %llu created, %llu reused"),
+            RenderTargetStats.NumTextures, RenderTargetStats.BytesHeld / (1024.0 * 1024.0), RenderTargetStats.BudgetBytes / (1024.0 * 1024.0),
+            RenderTargetStats.TexturesAllocated, RenderTargetStats.TexturesReused, RenderTargetStats.Evictions,
+            RenderTargetStats.NumRegistrations, RenderTargetStats.RegistrationsCreated, RenderTargetStats.RegistrationsReused);
+
+        const FWriteToRenderTargetTexturePoolStats TextureStats = FWriteToRenderTargetTexturePool::Get().GetStats();
+        UE_LOG(LogTemp, Display, TEXT("ShaderMod texture pool: %d free, %d pending, %.1f / %.1f MB, %llu created, %llu reused, %llu evictions"),
+            TextureStats.NumFree, TextureStats.NumPending, TextureStats.BytesHeld / (1024.0 * 1024.0), TextureStats.BudgetBytes / (1024.0 * 1024.0),
+            TextureStats.TexturesCreated, TextureStats.TexturesReused, TextureStats.Evictions);
+    }));
+
+static FAutoConsoleCommand GWriteToRenderTargetPoolFlushCommand(
+    TEXT("ShaderMod.Pool.Flush"),
+    TEXT("Releases every texture held by the WriteToRenderTarget texture pools."),
+    FConsoleCommandDelegate::CreateLambda([]()
+    {
+        FWriteToRenderTargetTexturePool::Get().Empty();
+        ENQUEUE_RENDER_COMMAND(WriteToRenderTargetPoolFlush)(
+            [](FRHICommandListImmediate& RHICmdList)
+            {
+                FWriteToRenderTargetRenderTargetPool::Get().Empty();
+            });
+    }));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetPoolTest, "ShaderMod.WriteToRenderTarget.Pool", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks that the pools hand textures back out: a released texture is reused once the render thread caught up,
+ * but not while a processor still reads it. With a GPU, repeated copy-path dispatches of one processor must not
+ * allocate a scratch texture or wrap the render target again after the first one.
+ */
+bool FWriteToRenderTargetPoolTest::RunTest(const FString& Parameters)
+{
+    constexpr int32 NumDispatches = 8;
+
+    FWriteToRenderTargetTexturePool& TexturePool = FWriteToRenderTargetTexturePool::Get();
+    const FIntPoint Size(96, 80);
+    UTexture2D* First = TexturePool.Acquire(Size, PF_B8G8R8A8);
+    TexturePool.Release(First);
+    FlushRenderingCommands();
+    UTexture2D* Second = TexturePool.Acquire(Size, PF_B8G8R8A8);
+    TestTrue(TEXT("Texture reused after release"), First && Second == First);
+
+    TexturePool.AddInputUser(Second);
+    TexturePool.Release(Second);
+    FlushRenderingCommands();
+    UTexture2D* Third = TexturePool.Acquire(Size, PF_B8G8R8A8);
+    TestTrue(TEXT("Texture kept while read as input"), Third && Third != Second);
+
+    TexturePool.RemoveInputUser(Second);
+    FlushRenderingCommands();
+    UTexture2D* Fourth = TexturePool.Acquire(Size, PF_B8G8R8A8);
+    TestTrue(TEXT("Texture reused after its last reader"), Fourth == Second);
+    TexturePool.Release(Third);
+    TexturePool.Release(Fourth);
+
+    if (!WriteToRenderTargetTest::HasGPU(*this))
+    {
+        return true;
+    }
+
+    const FIntPoint TargetSize(256, 256);
+    TArray<FColor> Pixels;
+    Pixels.Init(FColor(128, 128, 128, 128), TargetSize.X * TargetSize.Y);
+    UTexture2D* Input = WriteToRenderTargetTest::CreateTexture(TargetSize, Pixels);
+
+    // No UAV, so every dispatch goes through a scratch texture and a copy
+    UTextureRenderTarget2D* RenderTarget = WriteToRenderTargetTest::CreateRenderTarget(TargetSize, PF_R8G8B8A8, false);
+
+    {
+        WriteToRenderTargetTest::FScopedProcessor Processor(EWriteToRenderTargetBackend::RDG);
+        FWriteToRenderTargetRenderTargetPoolStats AfterFirst;
+        for (int32 Dispatch = 0; Dispatch < NumDispatches; ++Dispatch)
+        {
+            FWriteToRenderTargetEffectParams Params;
+            Params.Contrast = 1.0f + Dispatch * 0.1f;
+            Processor.Execute(Input, RenderTarget, Params);
+            if (Dispatch == 0)
+            {
+                AfterFirst = GetRenderTargetPoolStats();
+            }
+        }
+        const FWriteToRenderTargetRenderTargetPoolStats AfterAll = GetRenderTargetPoolStats();
+
+        TestEqual(TEXT("No scratch allocation after the first dispatch"), (int64)(AfterAll.TexturesAllocated - AfterFirst.TexturesAllocated), (int64)0);
+        TestTrue(TEXT("Scratch texture reused"), AfterAll.TexturesReused > AfterFirst.TexturesReused);
+        TestEqual(TEXT("Render target wrapped once"), (int64)(AfterAll.RegistrationsCreated - AfterFirst.RegistrationsCreated), (int64)0);
+    }
+
+    RenderTarget->MarkAsGarbage();
+    Input->MarkAsGarbage();
+    return true;
+}
+
+#endif
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderGraphResources.h"
+#include "RenderingThread.h"
+#include "UObject/GCObject.h"
+#include "UObject/ObjectKey.h"
+
+class FRDGBuilder;
+class UTexture2D;
+
+struct FWriteToRenderTargetRenderTargetPoolStats
+{
+    uint64 TexturesAllocated = 0;
+    uint64 TexturesReused = 0;
+    uint64 RegistrationsCreated = 0;
+    uint64 RegistrationsReused = 0;
+    uint64 Evictions = 0;
+    int32 NumTextures = 0;
+    int32 NumRegistrations = 0;
+    int64 BytesHeld = 0;
+    int64 BudgetBytes = 0;
+};
+
+/*
+ * FWriteToRenderTargetRenderTargetPool keeps the GPU textures of the dispatch graphs alive from one dispatch to the next.
+ * Scratch textures (the copy path, the batch arrays) are pooled render targets keyed by their description and
+ * registered with each graph as external textures, so a steady stream of same-sized dispatches allocates nothing.
+ * Render targets are wrapped once per RHI texture instead of once per graph; wrappers that no graph used for a
+ * few seconds are dropped, so resized or destroyed render targets are released soon after.
+ * Textures beyond the memory budget (r.ShaderMod.RenderTargetPoolBudgetMB) are evicted least recently used first;
+ * a graph that still uses an evicted texture keeps its own reference until it has executed.
+ * The pool is render thread only.
+ */
+class FWriteToRenderTargetRenderTargetPool
+{
+public:
+    static FWriteToRenderTargetRenderTargetPool& Get();
+
+    // A texture matching Desc, registered with GraphBuilder. Passes of one graph that ask for the same description share it.
+    FRDGTextureRef CreateTexture(FRDGBuilder& GraphBuilder, const FRDGTextureDesc& Desc, const TCHAR* Name);
+
+    // Texture registered with GraphBuilder, through the wrapper of a previous graph when there is one
+    FRDGTextureRef RegisterExternalTexture(FRDGBuilder& GraphBuilder, FRHITexture* Texture, const TCHAR* Name);
+
+    void Empty();
+
+    FWriteToRenderTargetRenderTargetPoolStats GetStats() const;
+
+private:
+    struct FPooledTexture
+    {
+        FRDGTextureDesc Desc;
+        TRefCountPtr<IPooledRenderTarget> RenderTarget;
+        int64 Bytes = 0;
+        uint64 LastUseTick = 0;
+    };
+
+    struct FRegistration
+    {
+        TRefCountPtr<IPooledRenderTarget> RenderTarget;
+        uint32 LastUseFrame = 0;
+    };
+
+    void EvictToBudget();
+    void PruneRegistrations();
+
+    TArray<FPooledTexture> Textures;
+    TMap<FRHITexture*, FRegistration> Registrations;
+    uint64 UseTick = 0;
+    int64 BytesHeld = 0;
+    uint64 TexturesAllocated = 0;
+    uint64 TexturesReused = 0;
+    uint64 RegistrationsCreated = 0;
+    uint64 RegistrationsReused = 0;
+    uint64 Evictions = 0;
+};
+
+struct FWriteToRenderTargetTexturePoolStats
+{
+    uint64 TexturesCreated = 0;
+    uint64 TexturesReused = 0;
+    uint64 Evictions = 0;
+    int32 NumFree = 0;
+    int32 NumPending = 0;
+    int64 BytesHeld = 0;
+    int64 BudgetBytes = 0;
+};
+
+/*
+ * FWriteToRenderTargetTexturePool recycles the transient textures created by UWriteToRenderTarget::ResizeTexture.
+ * Textures come back through Release, typically when the resize cache evicts them, and are handed out again by
+ * Acquire for the same size and format once the render commands enqueued before their release have run.
+ * A texture that a processor still reads as its input (AddInputUser) stays pending until the last reader lets go,
+ * so re-running a processor never sees another image. Free textures beyond the memory budget
+ * (r.ShaderMod.TexturePoolBudgetMB) are released least recently used first.
+ * The pool is game thread only and keeps its textures alive through FGCObject.
+ */
+class FWriteToRenderTargetTexturePool : public FGCObject
+{
+public:
+    static FWriteToRenderTargetTexturePool& Get();
+
+    // A texture of Size and Format: a released one when available, a new transient one otherwise
+    UTexture2D* Acquire(FIntPoint Size, EPixelFormat Format);
+
+    // Hands a texture from Acquire back to the pool; the caller must not use it afterwards
+    void Release(UTexture2D* Texture);
+
+    // Readers of a texture that may still dispatch it; released textures are not reused while they have any
+    void AddInputUser(UTexture2D* Texture);
+    void RemoveInputUser(UTexture2D* Texture);
+
+    // Releases the free textures; bIncludePending also drops those still waiting for their readers, at module shutdown
+    void Empty(bool bIncludePending = false);
+
+    FWriteToRenderTargetTexturePoolStats GetStats() const;
+    int64 GetBudgetBytes() const;
+
+    // FGCObject
+    virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+    virtual FString GetReferencerName() const override;
+
+private:
+    struct FFreeTexture
+    {
+        TObjectPtr<UTexture2D> Texture = nullptr;
+        int64 Bytes = 0;
+        uint64 LastUseTick = 0;
+        TSharedPtr<FRenderCommandFence> Fence;
+    };
+
+    void MakeFree(UTexture2D* Texture);
+    void EvictToBudget();
+    void UpdateMemoryStat();
+
+    TArray<FFreeTexture> FreeTextures;
+    TArray<TObjectPtr<UTexture2D>> PendingTextures;
+    TMap<FObjectKey, int32> InputUsers;
+    uint64 UseTick = 0;
+    int64 BytesHeld = 0;
+    uint64 TexturesCreated = 0;
+    uint64 TexturesReused = 0;
+    uint64 Evictions = 0;
+};
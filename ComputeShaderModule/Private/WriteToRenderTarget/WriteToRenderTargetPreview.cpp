@@ -0,0 +1,121 @@
+#include "WriteToRenderTarget/WriteToRenderTargetShaders.h"
+#include "ImageCore.h"
+#include "RenderGraphUtils.h"
+#include "WriteToRenderTarget/WriteToRenderTargetCPU.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPool.h"
+#include "WriteToRenderTarget/WriteToRenderTargetStats.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+
+DEFINE_STAT(STAT_WriteToRenderTarget_PreviewDispatches);
+
+IMPLEMENT_GLOBAL_SHADER(FWriteToRenderTargetPreview, "/ComputeShaderModuleShaders/WriteToRenderTarget/WriteToRenderTargetPreview.usf", "MainPreview", SF_Compute);
+
+void WriteToRenderTargetRDG::AddUpsamplePreviewPass(FRDGBuilder& GraphBuilder, FRDGTextureRef Preview, FRDGTextureRef Texture)
+{
+    const FRDGTextureDesc& Desc = Texture->Desc;
+
+    // Written through a UAV; a target without one gets a pooled scratch texture that is copied into it afterwards
+    const bool bDirectWrite = EnumHasAnyFlags(Desc.Flags, TexCreate_UAV);
+    FRDGTextureRef OutputTexture = Texture;
+    if (!bDirectWrite)
+    {
+        OutputTexture = FWriteToRenderTargetRenderTargetPool::Get().CreateTexture(GraphBuilder,
+            FRDGTextureDesc::Create2D(Desc.Extent, Desc.Format, FClearValueBinding::None, TexCreate_ShaderResource | TexCreate_UAV),
+            TEXT("WriteToRenderTarget_TempTexture"));
+    }
+
+    FWriteToRenderTargetPreview::FPermutationDomain PermutationVector;
+    PermutationVector.Set<FWriteToRenderTargetPreview::FSingleChannelDim>(Desc.Format == PF_R8 || Desc.Format == PF_G8);
+    TShaderMapRef<FWriteToRenderTargetPreview> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+    FWriteToRenderTargetPreview::FParameters* PassParameters = GraphBuilder.AllocParameters<FWriteToRenderTargetPreview::FParameters>();
+    PassParameters->PreviewTexture = Preview;
+    // Clamped: the processed image is not periodic, wrapping would bleed the opposite edge into the border pixels
+    PassParameters->PreviewSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+    PassParameters->OutputTexture = GraphBuilder.CreateUAV(OutputTexture);
+    PassParameters->OutputSize = FUintVector2(Desc.Extent.X, Desc.Extent.Y);
+    PassParameters->InvOutputSize = FVector2f(1.0f / Desc.Extent.X, 1.0f / Desc.Extent.Y);
+
+    FComputeShaderUtils::AddPass(
+        GraphBuilder,
+        RDG_EVENT_NAME("UpsamplePreview %dx%d -> %dx%d", Preview->Desc.Extent.X, Preview->Desc.Extent.Y, Desc.Extent.X, Desc.Extent.Y),
+        ComputeShader,
+        PassParameters,
+        FComputeShaderUtils::GetGroupCount(Desc.Extent, FWriteToRenderTargetPreview::GroupSize));
+
+    if (!bDirectWrite)
+    {
+        AddCopyTexturePass(GraphBuilder, OutputTexture, Texture, FRHICopyTextureInfo());
+    }
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetPreviewTest, "ShaderMod.WriteToRenderTarget.Preview", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks the interactive preview on the CPU kernel: the shaded extent of each scale, a scale of 1 being exactly the
+ * full resolution dispatch, and a reduced preview of smooth content staying close to the full resolution result.
+ * Logs how much faster the preview is to compute.
+ */
+bool FWriteToRenderTargetPreviewTest::RunTest(const FString& Parameters)
+{
+    constexpr int32 Size = 2048;
+    constexpr float Scale = 0.25f;
+    constexpr double MaxMeanError = 3.0;
+
+    // Shaded extents, rounded and never empty
+    struct FExtentCase
+    {
+        int32 X;
+        int32 Y;
+        float Scale;
+        FIntPoint Expected;
+    };
+    const FExtentCase ExtentCases[] =
+    {
+        { 8192, 8192, 1.0f,  FIntPoint(8192, 8192) },
+        { 8192, 4096, 0.25f, FIntPoint(2048, 1024) },
+        { 1000, 10,   0.05f, FIntPoint(50, 1) },
+        { 7,    7,    0.01f, FIntPoint(1, 1) },
+    };
+    for (const FExtentCase& Case : ExtentCases)
+    {
+        FWriteToRenderTargetDispatchParams Params(Case.X, Case.Y, 1);
+        Params.PreviewScale = Case.Scale;
+        const FString What = FString::Printf(TEXT("%dx%d at %.2f"), Case.X, Case.Y, Case.Scale);
+        TestEqual(What + TEXT(" shaded extent"), Params.GetShadedExtent(), Case.Expected);
+        TestEqual(What + TEXT(" is a preview"), Params.IsPreview(), Case.Scale < 1.0f);
+    }
+
+    // Smooth content: a preview can only be close where the image has no detail finer than its pixels
+    FImage Source(Size, Size, ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+    const TArray<FColor> Gradient = WriteToRenderTargetTest::MakeGradient(Size);
+    FMemory::Memcpy(Source.AsBGRA8().GetData(), Gradient.GetData(), Gradient.Num() * sizeof(FColor));
+
+    FWriteToRenderTargetEffectParams EffectParams;
+    EffectParams.Contrast = 1.2f;
+    EffectParams.DistortionStrength = 0.02f;
+    EffectParams.RotationAngle = 30.0f;
+
+    TArray<FColor> Full;
+    TArray<FColor> Preview;
+    Full.SetNumUninitialized(Size * Size);
+    Preview.SetNumUninitialized(Size * Size);
+    const FWriteToRenderTargetCPUStats FullStats = FWriteToRenderTargetCPU::ExecuteImage(Source, Full.GetData(), Size, Size, EffectParams);
+
+    FWriteToRenderTargetCPU::ExecutePreview(Source, Preview.GetData(), Size, Size, EffectParams, FIntPoint(Size, Size));
+    WriteToRenderTargetTest::TestImagesEqual(*this, TEXT("Scale 1 against the full resolution dispatch"), Full, Preview);
+
+    FWriteToRenderTargetDispatchParams Params(Size, Size, 1);
+    Params.PreviewScale = Scale;
+    const FIntPoint ShadedExtent = Params.GetShadedExtent();
+    const FWriteToRenderTargetCPUStats PreviewStats = FWriteToRenderTargetCPU::ExecutePreview(Source, Preview.GetData(), Size, Size, EffectParams, ShadedExtent);
+    const FWriteToRenderTargetImageDiff Diff = FWriteToRenderTargetCPU::CompareImages(Full.GetData(), Preview.GetData(), Full.Num());
+    AddInfo(FString::Printf(TEXT("%dx%d at %.2f (%dx%d shaded): mean error %.3f, max error %d, %.2f ms instead of %.2f ms"),
+        Size, Size, Scale, ShadedExtent.X, ShadedExtent.Y, Diff.MeanError, Diff.MaxError, PreviewStats.Seconds * 1000.0, FullStats.Seconds * 1000.0));
+    TestTrue(FString::Printf(TEXT("Preview mean error %.3f within %.3f"), Diff.MeanError, MaxMeanError), Diff.MeanError <= MaxMeanError);
+    return true;
+}
+
+#endif
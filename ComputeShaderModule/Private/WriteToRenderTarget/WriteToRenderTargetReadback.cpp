@@ -0,0 +1,364 @@
+#include "WriteToRenderTarget/WriteToRenderTargetReadback.h"
+#include "Async/Async.h"
+#include "Engine/Texture2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "RenderingThread.h"
+#include "RHIGPUReadback.h"
+#include "TextureResource.h"
+#include "WriteToRenderTarget/WriteToRenderTarget.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPool.h"
+#include "WriteToRenderTarget/WriteToRenderTargetStats.h"
+#include "WriteToRenderTarget/WriteToRenderTargetSubsystem.h"
+
+DEFINE_STAT(STAT_WriteToRenderTarget_ReadbacksCompleted);
+DEFINE_STAT(STAT_WriteToRenderTarget_ReadbackMegabytes);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetReadbackRingSize(
+    TEXT("r.ShaderMod.ReadbackRingSize"),
+    4,
+    TEXT("Staging buffers per UWriteToRenderTarget instance, i.e. how many RequestReadback calls can be outstanding at once.\n")
+    TEXT("Read when an instance makes its first readback."),
+    ECVF_Default);
+
+FWriteToRenderTargetReadbackRing::FWriteToRenderTargetReadbackRing(int32 InNumSlots)
+{
+    Slots.SetNum(FMath::Max(InNumSlots, 1));
+}
+
+FWriteToRenderTargetReadbackRing::~FWriteToRenderTargetReadbackRing() = default;
+
+void FWriteToRenderTargetReadbackRing::Enqueue_RenderThread(FRHICommandListImmediate& RHICmdList, FRHITexture* Texture, FWriteToRenderTargetReadbackCallback Callback, TArrayView<uint8> CallerBuffer)
+{
+    check(IsInRenderingThread());
+
+    FWriteToRenderTargetReadbackResult FailedResult;
+    FSlot* Slot = Slots.FindByPredicate([](const FSlot& Candidate) { return !Candidate.bInFlight; });
+    if (!Texture || !Slot)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("ReadbackRing - %s."), Texture ? TEXT("No free staging buffer") : TEXT("No render target"));
+        DeliverResult(MoveTemp(Callback), MoveTemp(FailedResult), CallerBuffer);
+        return;
+    }
+
+    const FIntPoint Size = Texture->GetDesc().Extent;
+    const EPixelFormat Format = Texture->GetFormat();
+    const int64 NumBytes = (int64)Size.X * Size.Y * GPixelFormats[Format].BlockBytes;
+    if (CallerBuffer.Num() > 0 && CallerBuffer.Num() < NumBytes)
+    {
+        UE_LOG(LogTemp, Error, TEXT("ReadbackRing - The caller buffer holds %d bytes, the %dx%d %s render target needs %lld."),
+            CallerBuffer.Num(), Size.X, Size.Y, GPixelFormats[Format].Name, NumBytes);
+        DeliverResult(MoveTemp(Callback), MoveTemp(FailedResult), CallerBuffer);
+        return;
+    }
+
+    // Staging buffers are created on first use and reused; FRHIGPUTextureReadback reallocates when the size changes
+    if (!Slot->Readback)
+    {
+        Slot->Readback = MakeUnique<FRHIGPUTextureReadback>(TEXT("WriteToRenderTarget_Readback"));
+    }
+    Slot->bInFlight = true;
+    Slot->Serial = NextSerial++;
+    Slot->Size = Size;
+    Slot->Format = Format;
+    Slot->Callback = MoveTemp(Callback);
+    Slot->CallerBuffer = CallerBuffer;
+
+    // RDG takes care of the transitions of the render target around the copy
+    FRDGBuilder GraphBuilder(RHICmdList);
+    FRDGTextureRef SourceTexture = FWriteToRenderTargetRenderTargetPool::Get().RegisterExternalTexture(GraphBuilder, Texture, TEXT("WriteToRenderTarget_ReadbackSource"));
+    AddEnqueueCopyPass(GraphBuilder, Slot->Readback.Get(), SourceTexture);
+    GraphBuilder.Execute();
+}
+
+void FWriteToRenderTargetReadbackRing::Poll_RenderThread()
+{
+    check(IsInRenderingThread());
+
+    // Complete in request order and stop at the first copy the GPU has not finished
+    for (;;)
+    {
+        FSlot* Oldest = nullptr;
+        for (FSlot& Slot : Slots)
+        {
+            if (Slot.bInFlight && (!Oldest || Slot.Serial < Oldest->Serial))
+            {
+                Oldest = &Slot;
+            }
+        }
+        if (!Oldest || !Oldest->Readback->IsReady())
+        {
+            return;
+        }
+
+        FWriteToRenderTargetReadbackResult Result;
+        Result.Size = Oldest->Size;
+        Result.Format = Oldest->Format;
+        Result.BytesPerPixel = GPixelFormats[Oldest->Format].BlockBytes;
+
+        const int64 RowBytes = (int64)Result.Size.X * Result.BytesPerPixel;
+        const int64 NumBytes = RowBytes * Result.Size.Y;
+        uint8* Dest = Oldest->CallerBuffer.GetData();
+        if (Oldest->CallerBuffer.Num() == 0)
+        {
+            Result.Data.SetNumUninitialized(NumBytes);
+            Dest = Result.Data.GetData();
+        }
+
+        // The single copy out of the staging buffer, row by row when the buffer is padded
+        int32 RowPitchInPixels = 0;
+        const uint8* Source = static_cast<const uint8*>(Oldest->Readback->Lock(RowPitchInPixels));
+        if (Source)
+        {
+            const int64 SourceRowBytes = (int64)RowPitchInPixels * Result.BytesPerPixel;
+            if (SourceRowBytes == RowBytes)
+            {
+                FMemory::Memcpy(Dest, Source, NumBytes);
+            }
+            else
+            {
+                for (int32 Row = 0; Row < Result.Size.Y; ++Row)
+                {
+                    FMemory::Memcpy(Dest + Row * RowBytes, Source + Row * SourceRowBytes, RowBytes);
+                }
+            }
+            Oldest->Readback->Unlock();
+            Result.bSuccess = true;
+
+            INC_DWORD_STAT(STAT_WriteToRenderTarget_ReadbacksCompleted);
+            INC_FLOAT_STAT_BY(STAT_WriteToRenderTarget_ReadbackMegabytes, (float)(NumBytes / (1024.0 * 1024.0)));
+        }
+
+        Oldest->bInFlight = false;
+        DeliverResult(MoveTemp(Oldest->Callback), MoveTemp(Result), Oldest->CallerBuffer);
+        Oldest->Callback = nullptr;
+        Oldest->CallerBuffer = TArrayView<uint8>();
+    }
+}
+
+void FWriteToRenderTargetReadbackRing::Cancel_RenderThread()
+{
+    check(IsInRenderingThread());
+
+    for (FSlot& Slot : Slots)
+    {
+        if (Slot.bInFlight)
+        {
+            Slot.bInFlight = false;
+            DeliverResult(MoveTemp(Slot.Callback), FWriteToRenderTargetReadbackResult(), Slot.CallerBuffer);
+            Slot.Callback = nullptr;
+            Slot.CallerBuffer = TArrayView<uint8>();
+        }
+    }
+}
+
+void FWriteToRenderTargetReadbackRing::DeliverResult(FWriteToRenderTargetReadbackCallback Callback, FWriteToRenderTargetReadbackResult&& Result, TArrayView<uint8> CallerBuffer)
+{
+    if (!Callback)
+    {
+        return;
+    }
+
+    AsyncTask(ENamedThreads::GameThread, [Callback = MoveTemp(Callback), Result = MoveTemp(Result), CallerBuffer]() mutable
+    {
+        if (Result.bSuccess)
+        {
+            const int64 NumBytes = (int64)Result.Size.X * Result.Size.Y * Result.BytesPerPixel;
+            Result.Pixels = CallerBuffer.Num() > 0
+                ? TArrayView<const uint8>(CallerBuffer.GetData(), NumBytes)
+                : TArrayView<const uint8>(Result.Data);
+        }
+        Callback(Result);
+    });
+}
+
+/*
+ * Under the CPU backend the pixels are usually already on the CPU, so the callback is posted right away with a copy of CPUOutput.
+ * Otherwise (including tiled CPU dispatches, which upload their tiles without keeping them) the copy is enqueued on the render thread; Tick polls the ring until every readback has completed.
+ */
+bool UWriteToRenderTarget::RequestReadback(FWriteToRenderTargetReadbackCallback Callback, TArrayView<uint8> CallerBuffer)
+{
+    if (!StoredParams.RenderTarget || !Callback)
+    {
+        return false;
+    }
+
+    if (!ReadbackRing)
+    {
+        ReadbackRing = MakeShared<FWriteToRenderTargetReadbackRing, ESPMode::ThreadSafe>(CVarWriteToRenderTargetReadbackRingSize.GetValueOnGameThread());
+    }
+    if (ReadbacksInFlight >= ReadbackRing->GetNumSlots())
+    {
+        return false;
+    }
+
+    FlushPendingDispatch();
+
+    ++ReadbacksInFlight;
+    FWriteToRenderTargetReadbackCallback Completion = [WeakThis = TWeakObjectPtr<UWriteToRenderTarget>(this), Callback = MoveTemp(Callback)](const FWriteToRenderTargetReadbackResult& Result)
+    {
+        if (UWriteToRenderTarget* This = WeakThis.Get())
+        {
+            --This->ReadbacksInFlight;
+        }
+        Callback(Result);
+    };
+
+    if (ResolveBackend() == EWriteToRenderTargetBackend::CPU && (CPUOutput.Num() > 0 || GUsingNullRHI))
+    {
+        FWriteToRenderTargetReadbackResult Result;
+        Result.Size = CPUOutputSize;
+        Result.Format = PF_B8G8R8A8;
+        Result.BytesPerPixel = sizeof(FColor);
+        const int64 NumBytes = CPUOutput.Num() * (int64)sizeof(FColor);
+        if (CallerBuffer.Num() == 0)
+        {
+            Result.Data.Append(reinterpret_cast<const uint8*>(CPUOutput.GetData()), NumBytes);
+            Result.bSuccess = true;
+        }
+        else if (CallerBuffer.Num() >= NumBytes)
+        {
+            FMemory::Memcpy(CallerBuffer.GetData(), CPUOutput.GetData(), NumBytes);
+            Result.bSuccess = true;
+        }
+        FWriteToRenderTargetReadbackRing::DeliverResult(MoveTemp(Completion), MoveTemp(Result), CallerBuffer);
+        return true;
+    }
+
+    ENQUEUE_RENDER_COMMAND(WriteToRenderTargetReadback)(
+        [Ring = ReadbackRing, RenderTarget = StoredParams.RenderTarget, Completion = MoveTemp(Completion), CallerBuffer](FRHICommandListImmediate& RHICmdList) mutable
+        {
+            Ring->Enqueue_RenderThread(RHICmdList, RenderTarget->GetRenderTargetTexture(), MoveTemp(Completion), CallerBuffer);
+        });
+    return true;
+}
+
+/*
+ * Compares the game thread cost of a blocking ReadPixels with RequestReadback on the same render target, and checks
+ * that both return the same pixels. The readbacks write into caller buffers; the summary is logged by the last callback.
+ * Usage: ShaderMod.BenchReadback [Size] [Count]
+ */
+static FAutoConsoleCommand GWriteToRenderTargetBenchReadbackCommand(
+    TEXT("ShaderMod.BenchReadback"),
+    TEXT("Times RequestReadback against ReadPixels on the game thread. Usage: ShaderMod.BenchReadback [Size] [Count]"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        UWriteToRenderTargetSubsystem* Subsystem = UWriteToRenderTargetSubsystem::Get();
+        if (!Subsystem)
+        {
+            return;
+        }
+
+        const int32 Size = Args.Num() > 0 ? FMath::Clamp(FCString::Atoi(*Args[0]), 1, 4096) : 1024;
+        const int32 Count = Args.Num() > 1 ? FMath::Clamp(FCString::Atoi(*Args[1]), 1, 64) : 4;
+
+        UTexture2D* Input = UTexture2D::CreateTransient(Size, Size, PF_B8G8R8A8);
+        FColor* Pixels = static_cast<FColor*>(Input->GetPlatformData()->Mips[0].BulkData.Lock(LOCK_READ_WRITE));
+        for (int32 Pixel = 0; Pixel < Size * Size; ++Pixel)
+        {
+            Pixels[Pixel] = FColor((uint8)(Pixel * 7), (uint8)(Pixel / Size), (uint8)(Pixel * 13), 255);
+        }
+        Input->GetPlatformData()->Mips[0].BulkData.Unlock();
+        Input->UpdateResource();
+
+        UTextureRenderTarget2D* RenderTarget = NewObject<UTextureRenderTarget2D>();
+        RenderTarget->bCanCreateUAV = true;
+        RenderTarget->InitCustomFormat(Size, Size, PF_B8G8R8A8, true);
+        RenderTarget->UpdateResourceImmediate(false);
+
+        const FWriteToRenderTargetHandle Handle = Subsystem->CreateProcessor();
+        UWriteToRenderTarget* Processor = Subsystem->GetProcessor(Handle);
+        Subsystem->Execute(Handle, Input, RenderTarget);
+        Processor->FlushPendingDispatch();
+        FlushRenderingCommands();
+
+        // Blocking path: every ReadPixels waits for the render thread and the GPU
+        TArray<FColor> Expected;
+        double ReadPixelsSeconds = 0.0;
+        const bool bCPU = Processor->ResolveBackend() == EWriteToRenderTargetBackend::CPU;
+        if (bCPU)
+        {
+            Expected = Processor->GetCPUOutput();
+        }
+        else
+        {
+            const double StartTime = FPlatformTime::Seconds();
+            for (int32 Index = 0; Index < Count; ++Index)
+            {
+                RenderTarget->GameThread_GetRenderTargetResource()->ReadPixels(Expected);
+            }
+            ReadPixelsSeconds = (FPlatformTime::Seconds() - StartTime) / Count;
+        }
+
+        struct FBenchState
+        {
+            TArray<TArray<uint8>> Buffers;
+            TArray<FColor> Expected;
+            double StartTime = 0.0;
+            double RequestSeconds = 0.0;
+            double ReadPixelsSeconds = 0.0;
+            int32 NumPending = 0;
+            int32 NumMismatches = 0;
+            int32 NumFailed = 0;
+            FWriteToRenderTargetHandle Handle;
+            TWeakObjectPtr<UTexture2D> Input;
+            TWeakObjectPtr<UTextureRenderTarget2D> RenderTarget;
+        };
+        TSharedRef<FBenchState> State = MakeShared<FBenchState>();
+        State->Expected = MoveTemp(Expected);
+        State->ReadPixelsSeconds = ReadPixelsSeconds;
+        State->Handle = Handle;
+        State->Input = Input;
+        State->RenderTarget = RenderTarget;
+        State->Buffers.SetNum(Count);
+
+        // Non-blocking path: the requests only enqueue copies, the pixels arrive in the callbacks
+        State->StartTime = FPlatformTime::Seconds();
+        for (int32 Index = 0; Index < Count; ++Index)
+        {
+            State->Buffers[Index].SetNumUninitialized(Size * Size * sizeof(FColor));
+            const bool bRequested = Processor->RequestReadback([State, Size](const FWriteToRenderTargetReadbackResult& Result)
+            {
+                if (!Result.bSuccess)
+                {
+                    ++State->NumFailed;
+                }
+                else if (State->Expected.Num() * (int64)sizeof(FColor) != Result.Pixels.Num()
+                    || FMemory::Memcmp(State->Expected.GetData(), Result.Pixels.GetData(), Result.Pixels.Num()) != 0)
+                {
+                    ++State->NumMismatches;
+                }
+
+                if (--State->NumPending == 0)
+                {
+                    UE_LOG(LogTemp, Display, TEXT("ShaderMod.BenchReadback %dx%d: ReadPixels blocks %.2f ms, RequestReadback %.3f ms per request, all results after %.2f ms; %d failed, %d mismatches"),
+                        Size, Size, State->ReadPixelsSeconds * 1000.0, State->RequestSeconds * 1000.0,
+                        (FPlatformTime::Seconds() - State->StartTime) * 1000.0, State->NumFailed, State->NumMismatches);
+
+                    if (UWriteToRenderTargetSubsystem* Owner = UWriteToRenderTargetSubsystem::Get())
+                    {
+                        Owner->ReleaseProcessor(State->Handle);
+                    }
+                    if (State->Input.IsValid())
+                    {
+                        State->Input->MarkAsGarbage();
+                    }
+                    if (State->RenderTarget.IsValid())
+                    {
+                        State->RenderTarget->MarkAsGarbage();
+                    }
+                }
+            }, State->Buffers[Index]);
+
+            if (!bRequested)
+            {
+                UE_LOG(LogTemp, Display, TEXT("ShaderMod.BenchReadback - Ring full after %d requests."), Index);
+                break;
+            }
+            ++State->NumPending;
+        }
+        State->RequestSeconds = State->NumPending > 0 ? (FPlatformTime::Seconds() - State->StartTime) / State->NumPending : 0.0;
+    }));
@@ -0,0 +1,291 @@
+#include "WriteToRenderTarget/WriteToRenderTargetResampler.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "ImageUtils.h"
+
+namespace WriteToRenderTargetResampler
+{
+    using FRowBuffer = TArray<VectorRegister4Float, TAlignedHeapAllocator<alignof(VectorRegister4Float)>>;
+
+    /*
+     * Filter taps for one axis. Every destination index owns MaxTaps slots in TapIndices/TapWeights;
+     * only the first NumTaps[Index] of them are used. Source indices are already clamped to the image.
+     */
+    struct FAxisTaps
+    {
+        int32 MaxTaps = 0;
+        TArray<int32> NumTaps;
+        TArray<int32> TapIndices;
+        TArray<float> TapWeights;
+    };
+
+    FAxisTaps BuildAxisTaps(int32 SourceSize, int32 DestSize, EWriteToRenderTargetResampleFilter Filter)
+    {
+        FAxisTaps Taps;
+
+        // Widen the kernel when minifying so every source texel contributes
+        const float Scale = (float)SourceSize / DestSize;
+        const float FilterScale = FMath::Max(Scale, 1.0f);
+        const float Support = FWriteToRenderTargetResampler::GetFilterRadius(Filter) * FilterScale;
+
+        Taps.MaxTaps = FMath::CeilToInt(Support * 2.0f) + 2;
+        Taps.NumTaps.SetNumZeroed(DestSize);
+        Taps.TapIndices.SetNumZeroed(DestSize * Taps.MaxTaps);
+        Taps.TapWeights.SetNumZeroed(DestSize * Taps.MaxTaps);
+
+        for (int32 DestIndex = 0; DestIndex < DestSize; ++DestIndex)
+        {
+            // Work in texel-center space: source texel J covers [J, J + 1) and is centered on J + 0.5
+            const float Center = (DestIndex + 0.5f) * Scale;
+            const int32 FirstTap = FMath::FloorToInt(Center - Support);
+            const int32 LastTap = FMath::Min(FMath::CeilToInt(Center + Support), FirstTap + Taps.MaxTaps - 1);
+
+            int32* Indices = &Taps.TapIndices[DestIndex * Taps.MaxTaps];
+            float* Weights = &Taps.TapWeights[DestIndex * Taps.MaxTaps];
+            int32 Count = 0;
+            float WeightSum = 0.0f;
+
+            for (int32 Tap = FirstTap; Tap <= LastTap; ++Tap)
+            {
+                const float Weight = FWriteToRenderTargetResampler::EvaluateFilter(Filter, (Tap + 0.5f - Center) / FilterScale);
+                if (Weight != 0.0f)
+                {
+                    Indices[Count] = FMath::Clamp(Tap, 0, SourceSize - 1);
+                    Weights[Count] = Weight;
+                    WeightSum += Weight;
+                    ++Count;
+                }
+            }
+
+            if (Count == 0 || FMath::Abs(WeightSum) < UE_SMALL_NUMBER)
+            {
+                // Degenerate footprint, fall back to the nearest texel
+                Indices[0] = FMath::Clamp(FMath::FloorToInt(Center), 0, SourceSize - 1);
+                Weights[0] = 1.0f;
+                Count = 1;
+                WeightSum = 1.0f;
+            }
+
+            for (int32 Tap = 0; Tap < Count; ++Tap)
+            {
+                Weights[Tap] /= WeightSum;
+            }
+            Taps.NumTaps[DestIndex] = Count;
+        }
+
+        return Taps;
+    }
+
+    // Filters one source row horizontally into DestSizeX float4 pixels (still in the 0..255 range)
+    FORCEINLINE void FilterRowHorizontal(const FColor* SourceRow, const FAxisTaps& TapsX, int32 DestSizeX, VectorRegister4Float* OutRow)
+    {
+        for (int32 X = 0; X < DestSizeX; ++X)
+        {
+            const int32* Indices = &TapsX.TapIndices[X * TapsX.MaxTaps];
+            const float* Weights = &TapsX.TapWeights[X * TapsX.MaxTaps];
+            const int32 Count = TapsX.NumTaps[X];
+
+            VectorRegister4Float Accumulator = VectorZero();
+            for (int32 Tap = 0; Tap < Count; ++Tap)
+            {
+                Accumulator = VectorMultiplyAdd(VectorLoadByte4(&SourceRow[Indices[Tap]]), VectorSetFloat1(Weights[Tap]), Accumulator);
+            }
+            OutRow[X] = Accumulator;
+        }
+    }
+}
+
+float FWriteToRenderTargetResampler::GetFilterRadius(EWriteToRenderTargetResampleFilter Filter)
+{
+    switch (Filter)
+    {
+    case EWriteToRenderTargetResampleFilter::Bilinear:
+        return 1.0f;
+    case EWriteToRenderTargetResampleFilter::Lanczos:
+        return 3.0f;
+    default:
+        return 0.5f;
+    }
+}
+
+float FWriteToRenderTargetResampler::EvaluateFilter(EWriteToRenderTargetResampleFilter Filter, float X)
+{
+    const float AbsX = FMath::Abs(X);
+    switch (Filter)
+    {
+    case EWriteToRenderTargetResampleFilter::Bilinear:
+        return FMath::Max(1.0f - AbsX, 0.0f);
+    case EWriteToRenderTargetResampleFilter::Lanczos:
+    {
+        if (AbsX < UE_SMALL_NUMBER)
+        {
+            return 1.0f;
+        }
+        if (AbsX >= 3.0f)
+        {
+            return 0.0f;
+        }
+        const float PiX = UE_PI * X;
+        return 3.0f * FMath::Sin(PiX) * FMath::Sin(PiX / 3.0f) / (PiX * PiX);
+    }
+    default:
+        return AbsX <= 0.5f ? 1.0f : 0.0f;
+    }
+}
+
+namespace WriteToRenderTargetResampler
+{
+    /*
+     * Shared body of both Resample overloads. GetSourceRow(Row, Scratch) returns the pixels of a source row,
+     * either in place or after reading them into Scratch (SourceSizeX pixels).
+     */
+    template<typename GetSourceRowType>
+    void ResampleBands(
+        const GetSourceRowType& GetSourceRow, int32 SourceSizeX, int32 SourceSizeY,
+        FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+        EWriteToRenderTargetResampleFilter Filter,
+        bool bForceOpaque)
+    {
+        const FAxisTaps TapsX = BuildAxisTaps(SourceSizeX, DestSizeX, Filter);
+        const FAxisTaps TapsY = BuildAxisTaps(SourceSizeY, DestSizeY, Filter);
+        const int32 BandHeight = FWriteToRenderTargetResampler::BandHeight;
+        const int32 NumBands = FMath::DivideAndRoundUp(DestSizeY, BandHeight);
+
+        ParallelFor(NumBands, [&](int32 BandIndex)
+        {
+            const int32 Y0 = BandIndex * BandHeight;
+            const int32 Y1 = FMath::Min(Y0 + BandHeight, DestSizeY);
+
+            // Source rows touched by this band
+            int32 MinRow = SourceSizeY;
+            int32 MaxRow = -1;
+            for (int32 Y = Y0; Y < Y1; ++Y)
+            {
+                for (int32 Tap = 0; Tap < TapsY.NumTaps[Y]; ++Tap)
+                {
+                    const int32 Row = TapsY.TapIndices[Y * TapsY.MaxTaps + Tap];
+                    MinRow = FMath::Min(MinRow, Row);
+                    MaxRow = FMath::Max(MaxRow, Row);
+                }
+            }
+
+            // Horizontal pass for those rows only
+            FRowBuffer Horizontal;
+            Horizontal.SetNumUninitialized((MaxRow - MinRow + 1) * DestSizeX);
+            TArray<FColor> Scratch;
+            for (int32 Row = MinRow; Row <= MaxRow; ++Row)
+            {
+                FilterRowHorizontal(GetSourceRow(Row, Scratch), TapsX, DestSizeX, &Horizontal[(Row - MinRow) * DestSizeX]);
+            }
+
+            // Vertical pass straight into the destination
+            const VectorRegister4Float MaxValue = VectorSetFloat1(255.0f);
+            const VectorRegister4Float Half = VectorSetFloat1(0.5f);
+            for (int32 Y = Y0; Y < Y1; ++Y)
+            {
+                const int32* Indices = &TapsY.TapIndices[Y * TapsY.MaxTaps];
+                const float* Weights = &TapsY.TapWeights[Y * TapsY.MaxTaps];
+                const int32 Count = TapsY.NumTaps[Y];
+                FColor* DestRow = Dest + (int64)Y * DestSizeX;
+
+                for (int32 X = 0; X < DestSizeX; ++X)
+                {
+                    VectorRegister4Float Accumulator = VectorZero();
+                    for (int32 Tap = 0; Tap < Count; ++Tap)
+                    {
+                        Accumulator = VectorMultiplyAdd(Horizontal[(Indices[Tap] - MinRow) * DestSizeX + X], VectorSetFloat1(Weights[Tap]), Accumulator);
+                    }
+                    Accumulator = VectorMin(VectorMax(Accumulator, VectorZero()), MaxValue);
+                    VectorStoreByte4(VectorAdd(Accumulator, Half), &DestRow[X]);
+                    if (bForceOpaque)
+                    {
+                        DestRow[X].A = 255;
+                    }
+                }
+            }
+        });
+    }
+}
+
+void FWriteToRenderTargetResampler::Resample(
+    const FColor* Source, int32 SourceSizeX, int32 SourceSizeY,
+    FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+    EWriteToRenderTargetResampleFilter Filter,
+    bool bForceOpaque)
+{
+    if (!Source || !Dest || SourceSizeX <= 0 || SourceSizeY <= 0 || DestSizeX <= 0 || DestSizeY <= 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("FWriteToRenderTargetResampler::Resample - Invalid source or destination."));
+        return;
+    }
+
+    WriteToRenderTargetResampler::ResampleBands(
+        [Source, SourceSizeX](int32 Row, TArray<FColor>& Scratch)
+        {
+            return Source + (int64)Row * SourceSizeX;
+        },
+        SourceSizeX, SourceSizeY, Dest, DestSizeX, DestSizeY, Filter, bForceOpaque);
+}
+
+void FWriteToRenderTargetResampler::Resample(
+    FWriteToRenderTargetRowReadFunction ReadSourceRow, int32 SourceSizeX, int32 SourceSizeY,
+    FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+    EWriteToRenderTargetResampleFilter Filter,
+    bool bForceOpaque)
+{
+    if (!Dest || SourceSizeX <= 0 || SourceSizeY <= 0 || DestSizeX <= 0 || DestSizeY <= 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("FWriteToRenderTargetResampler::Resample - Invalid source or destination."));
+        return;
+    }
+
+    WriteToRenderTargetResampler::ResampleBands(
+        [&ReadSourceRow, SourceSizeX](int32 Row, TArray<FColor>& Scratch)
+        {
+            if (Scratch.Num() != SourceSizeX)
+            {
+                Scratch.SetNumUninitialized(SourceSizeX);
+            }
+            ReadSourceRow(0, Row, SourceSizeX, Scratch.GetData());
+            return static_cast<const FColor*>(Scratch.GetData());
+        },
+        SourceSizeX, SourceSizeY, Dest, DestSizeX, DestSizeY, Filter, bForceOpaque);
+}
+
+/*
+ * Compares the resampler against FImageUtils::ImageResize on a synthetic image.
+ * Usage: ShaderMod.BenchResize [SourceSize] [DestSize] [Filter: 0 = Box, 1 = Bilinear, 2 = Lanczos]
+ */
+static FAutoConsoleCommand GWriteToRenderTargetBenchResizeCommand(
+    TEXT("ShaderMod.BenchResize"),
+    TEXT("Times FWriteToRenderTargetResampler against FImageUtils::ImageResize. Usage: ShaderMod.BenchResize [SourceSize] [DestSize] [Filter]"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        const int32 SourceSize = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 8192;
+        const int32 DestSize = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 1024;
+        const EWriteToRenderTargetResampleFilter Filter = Args.Num() > 2
+            ? (EWriteToRenderTargetResampleFilter)FMath::Clamp(FCString::Atoi(*Args[2]), 0, 2)
+            : EWriteToRenderTargetResampleFilter::Box;
+
+        TArray<FColor> Source;
+        Source.SetNumUninitialized(SourceSize * SourceSize);
+        for (int32 Index = 0; Index < Source.Num(); ++Index)
+        {
+            Source[Index] = FColor((uint8)(Index * 7), (uint8)(Index * 13), (uint8)(Index * 29), 255);
+        }
+        TArray<FColor> Dest;
+        Dest.SetNumUninitialized(DestSize * DestSize);
+
+        double StartTime = FPlatformTime::Seconds();
+        FImageUtils::ImageResize(SourceSize, SourceSize, Source, DestSize, DestSize, Dest, true, true);
+        const double ImageResizeSeconds = FPlatformTime::Seconds() - StartTime;
+
+        StartTime = FPlatformTime::Seconds();
+        FWriteToRenderTargetResampler::Resample(Source.GetData(), SourceSize, SourceSize, Dest.GetData(), DestSize, DestSize, Filter);
+        const double ResamplerSeconds = FPlatformTime::Seconds() - StartTime;
+
+        UE_LOG(LogTemp, Display, TEXT("ShaderMod.BenchResize %d -> %d (%s): ImageResize %.1f ms, resampler %.1f ms (%.1fx)"),
+            SourceSize, DestSize, *UEnum::GetValueAsString(Filter),
+            ImageResizeSeconds * 1000.0, ResamplerSeconds * 1000.0, ImageResizeSeconds / FMath::Max(ResamplerSeconds, UE_DOUBLE_SMALL_NUMBER));
+    }));
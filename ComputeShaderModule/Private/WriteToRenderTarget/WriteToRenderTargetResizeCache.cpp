@@ -0,0 +1,183 @@
+#include "WriteToRenderTarget/WriteToRenderTargetResizeCache.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPool.h"
+#include "WriteToRenderTarget/WriteToRenderTargetStats.h"
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetResizeCacheBudgetMB(
+    TEXT("r.ShaderMod.ResizeCacheBudgetMB"),
+    256,
+    TEXT("Memory budget in MB for resized input textures kept by ExecuteRTComputeShader. 0 disables the cache."),
+    ECVF_Default);
+
+FWriteToRenderTargetResizeCache& FWriteToRenderTargetResizeCache::Get()
+{
+    static FWriteToRenderTargetResizeCache Instance;
+    return Instance;
+}
+
+FGuid FWriteToRenderTargetResizeCache::GetSourceRevision(const UTexture2D* Source)
+{
+    if (!Source)
+    {
+        return FGuid();
+    }
+
+#if WITH_EDITORONLY_DATA
+    return Source->Source.GetId();
+#else
+    return Source->GetLightingGuid();
+#endif
+}
+
+UTexture2D* FWriteToRenderTargetResizeCache::Find(UTexture2D* Source, FIntPoint TargetSize, EWriteToRenderTargetResampleFilter Filter)
+{
+    check(IsInGameThread());
+
+    const FWriteToRenderTargetResizeKey Key{ FObjectKey(Source), GetSourceRevision(Source), TargetSize, Filter };
+    FEntry* Entry = Entries.Find(Key);
+    if (!Entry || !Entry->Texture)
+    {
+        ++Misses;
+        INC_DWORD_STAT(STAT_WriteToRenderTarget_ResizeCacheMisses);
+        return nullptr;
+    }
+
+    ++Hits;
+    INC_DWORD_STAT(STAT_WriteToRenderTarget_ResizeCacheHits);
+    Entry->LastUseTick = ++UseTick;
+    return Entry->Texture;
+}
+
+void FWriteToRenderTargetResizeCache::Add(UTexture2D* Source, FIntPoint TargetSize, EWriteToRenderTargetResampleFilter Filter, UTexture2D* Resized)
+{
+    check(IsInGameThread());
+
+    if (!Source || !Resized)
+    {
+        return;
+    }
+
+    const int64 Bytes = (int64)TargetSize.X * TargetSize.Y * sizeof(FColor);
+    if (Bytes > GetBudgetBytes())
+    {
+        return;
+    }
+
+    const FWriteToRenderTargetResizeKey Key{ FObjectKey(Source), GetSourceRevision(Source), TargetSize, Filter };
+    RemoveEntry(Key);
+    EvictToBudget(Bytes);
+
+    FEntry& Entry = Entries.Add(Key);
+    Entry.Texture = Resized;
+    Entry.Bytes = Bytes;
+    Entry.LastUseTick = ++UseTick;
+    BytesHeld += Bytes;
+    SET_MEMORY_STAT(STAT_WriteToRenderTarget_ResizeCacheMemory, BytesHeld);
+}
+
+void FWriteToRenderTargetResizeCache::Empty()
+{
+    for (TPair<FWriteToRenderTargetResizeKey, FEntry>& Pair : Entries)
+    {
+        FWriteToRenderTargetTexturePool::Get().Release(Pair.Value.Texture);
+    }
+    Entries.Empty();
+    BytesHeld = 0;
+    SET_MEMORY_STAT(STAT_WriteToRenderTarget_ResizeCacheMemory, 0);
+}
+
+FWriteToRenderTargetResizeCacheStats FWriteToRenderTargetResizeCache::GetStats() const
+{
+    FWriteToRenderTargetResizeCacheStats Stats;
+    Stats.Hits = Hits;
+    Stats.Misses = Misses;
+    Stats.Evictions = Evictions;
+    Stats.NumEntries = Entries.Num();
+    Stats.BytesHeld = BytesHeld;
+    Stats.BudgetBytes = GetBudgetBytes();
+    return Stats;
+}
+
+void FWriteToRenderTargetResizeCache::SetBudgetBytes(int64 InBudgetBytes)
+{
+    BudgetBytesOverride = InBudgetBytes;
+    EvictToBudget(0);
+}
+
+int64 FWriteToRenderTargetResizeCache::GetBudgetBytes() const
+{
+    if (BudgetBytesOverride >= 0)
+    {
+        return BudgetBytesOverride;
+    }
+    return (int64)FMath::Max(CVarWriteToRenderTargetResizeCacheBudgetMB.GetValueOnGameThread(), 0) * 1024 * 1024;
+}
+
+/*
+ * Drops least recently used entries until ExtraBytes more would still fit in the budget.
+ * The cache only ever holds a handful of entries, so a linear scan for the oldest one is cheap enough.
+ */
+void FWriteToRenderTargetResizeCache::EvictToBudget(int64 ExtraBytes)
+{
+    const int64 BudgetBytes = GetBudgetBytes();
+    while (Entries.Num() > 0 && BytesHeld + ExtraBytes > BudgetBytes)
+    {
+        const FWriteToRenderTargetResizeKey* OldestKey = nullptr;
+        uint64 OldestTick = MAX_uint64;
+        for (const TPair<FWriteToRenderTargetResizeKey, FEntry>& Pair : Entries)
+        {
+            if (Pair.Value.LastUseTick < OldestTick)
+            {
+                OldestTick = Pair.Value.LastUseTick;
+                OldestKey = &Pair.Key;
+            }
+        }
+
+        const FWriteToRenderTargetResizeKey KeyToRemove = *OldestKey;
+        RemoveEntry(KeyToRemove);
+        ++Evictions;
+    }
+}
+
+void FWriteToRenderTargetResizeCache::RemoveEntry(const FWriteToRenderTargetResizeKey& Key)
+{
+    FEntry Removed;
+    if (Entries.RemoveAndCopyValue(Key, Removed))
+    {
+        BytesHeld -= Removed.Bytes;
+        SET_MEMORY_STAT(STAT_WriteToRenderTarget_ResizeCacheMemory, BytesHeld);
+        FWriteToRenderTargetTexturePool::Get().Release(Removed.Texture);
+    }
+}
+
+void FWriteToRenderTargetResizeCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+    for (TPair<FWriteToRenderTargetResizeKey, FEntry>& Pair : Entries)
+    {
+        Collector.AddReferencedObject(Pair.Value.Texture);
+    }
+}
+
+FString FWriteToRenderTargetResizeCache::GetReferencerName() const
+{
+    return TEXT("FWriteToRenderTargetResizeCache");
+}
+
+static FAutoConsoleCommand GWriteToRenderTargetResizeCacheStatsCommand(
+    TEXT("ShaderMod.ResizeCache.Stats"),
+    TEXT("Logs the hit, miss and memory statistics of the ExecuteRTComputeShader resize cache."),
+    FConsoleCommandDelegate::CreateLambda([]()
+    {
+        const FWriteToRenderTargetResizeCacheStats Stats = FWriteToRenderTargetResizeCache::Get().GetStats();
+        UE_LOG(LogTemp, Display, TEXT("ShaderMod resize cache: %d entries, %.1f / %.1f MB, %llu hits, %llu misses, %llu evictions"),
+            Stats.NumEntries, Stats.BytesHeld / (1024.0 * 1024.0), Stats.BudgetBytes / (1024.0 * 1024.0), Stats.Hits, Stats.Misses, Stats.Evictions);
+    }));
+
+static FAutoConsoleCommand GWriteToRenderTargetResizeCacheFlushCommand(
+    TEXT("ShaderMod.ResizeCache.Flush"),
+    TEXT("Releases every texture held by the ExecuteRTComputeShader resize cache."),
+    FConsoleCommandDelegate::CreateLambda([]()
+    {
+        FWriteToRenderTargetResizeCache::Get().Empty();
+    }));
@@ -0,0 +1,432 @@
+#include "WriteToRenderTarget/WriteToRenderTargetResultCache.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+#include "RenderGraphUtils.h"
+#include "RenderingThread.h"
+#include "UnrealClient.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPool.h"
+#include "WriteToRenderTarget/WriteToRenderTargetResizeCache.h"
+#include "WriteToRenderTarget/WriteToRenderTargetShaders.h"
+#include "WriteToRenderTarget/WriteToRenderTargetStats.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+
+DEFINE_STAT(STAT_WriteToRenderTarget_ResultCacheHits);
+DEFINE_STAT(STAT_WriteToRenderTarget_ResultCacheMisses);
+DEFINE_STAT(STAT_WriteToRenderTarget_ResultCacheHitRate);
+DEFINE_STAT(STAT_WriteToRenderTarget_ResultCacheMemory);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetResultCacheBudgetMB(
+    TEXT("r.ShaderMod.ResultCacheBudgetMB"),
+    64,
+    TEXT("Memory budget in MB for processed images kept to answer repeated parameter sets without recomputing. Each entry holds a full copy of its render target: the default of 64 keeps four 2048x2048 BGRA8 results. 0 disables the cache."),
+    ECVF_Default);
+
+// Exact comparison of two parameter sets, including the effect stack; the key only holds their hash
+static bool AreEffectParamsIdentical(const FWriteToRenderTargetEffectParams& A, const FWriteToRenderTargetEffectParams& B)
+{
+    return FWriteToRenderTargetEffectParams::StaticStruct()->CompareScriptStruct(&A, &B, PPF_None);
+}
+
+FWriteToRenderTargetCachedResult::~FWriteToRenderTargetCachedResult()
+{
+    // The last reference is gone, so no render command can still be filling or reading the texture
+    if (Texture.IsValid() && !IsInRenderingThread())
+    {
+        ENQUEUE_RENDER_COMMAND(WriteToRenderTargetReleaseResult)(
+            [ReleasedTexture = MoveTemp(Texture)](FRHICommandListImmediate&) mutable
+            {
+                ReleasedTexture.SafeRelease();
+            });
+    }
+}
+
+FWriteToRenderTargetResultCache& FWriteToRenderTargetResultCache::Get()
+{
+    static FWriteToRenderTargetResultCache Instance;
+    return Instance;
+}
+
+FWriteToRenderTargetResultKey FWriteToRenderTargetResultCache::MakeKey(const UTexture2D* Input, FObjectKey RenderTarget, FIntPoint Size,
+    EWriteToRenderTargetBackend Backend, const FWriteToRenderTargetEffectParams& Params)
+{
+    FWriteToRenderTargetResultKey Key;
+    Key.Input = FObjectKey(Input);
+    Key.InputRevision = FWriteToRenderTargetResizeCache::GetSourceRevision(Input);
+    Key.RenderTarget = RenderTarget;
+    Key.Size = Size;
+    Key.Backend = Backend;
+    Key.ParamsHash = GetTypeHash(Params);
+    return Key;
+}
+
+FWriteToRenderTargetCachedResultPtr FWriteToRenderTargetResultCache::Find(const FWriteToRenderTargetResultKey& Key, const FWriteToRenderTargetEffectParams& Params)
+{
+    check(IsInGameThread());
+
+    if (GetBudgetBytes() <= 0)
+    {
+        return nullptr;
+    }
+
+    FEntry* Entry = Entries.Find(Key);
+    const bool bCollision = Entry && !AreEffectParamsIdentical(Entry->Params, Params);
+    if (!Entry || bCollision)
+    {
+        ++Misses;
+        Collisions += bCollision ? 1 : 0;
+        INC_DWORD_STAT(STAT_WriteToRenderTarget_ResultCacheMisses);
+        UpdateStats();
+        return nullptr;
+    }
+
+    ++Hits;
+    INC_DWORD_STAT(STAT_WriteToRenderTarget_ResultCacheHits);
+    UpdateStats();
+    Entry->LastUseTick = ++UseTick;
+    return Entry->Result;
+}
+
+FWriteToRenderTargetCachedResultPtr FWriteToRenderTargetResultCache::Add(const FWriteToRenderTargetResultKey& Key, const FWriteToRenderTargetEffectParams& Params,
+    const FWriteToRenderTargetEffectParams& RequestedParams, int64 Bytes)
+{
+    check(IsInGameThread());
+
+    if (Bytes <= 0 || Bytes > GetBudgetBytes())
+    {
+        return nullptr;
+    }
+
+    RemoveEntry(Key);
+    EvictToBudget(Bytes);
+
+    FEntry& Entry = Entries.Add(Key);
+    Entry.Result = MakeShared<FWriteToRenderTargetCachedResult, ESPMode::ThreadSafe>();
+    Entry.Params = Params;
+    Entry.RequestedParams = RequestedParams;
+    Entry.Bytes = Bytes;
+    Entry.LastUseTick = ++UseTick;
+    Entry.bPreset = IsPreset(RequestedParams);
+    BytesHeld += Bytes;
+    UpdateStats();
+    return Entry.Result;
+}
+
+void FWriteToRenderTargetResultCache::Invalidate(const UTexture2D* Input)
+{
+    check(IsInGameThread());
+
+    const FObjectKey InputKey(Input);
+    TArray<FWriteToRenderTargetResultKey> KeysToRemove;
+    for (const TPair<FWriteToRenderTargetResultKey, FEntry>& Pair : Entries)
+    {
+        if (Pair.Key.Input == InputKey)
+        {
+            KeysToRemove.Add(Pair.Key);
+        }
+    }
+    for (const FWriteToRenderTargetResultKey& Key : KeysToRemove)
+    {
+        RemoveEntry(Key);
+    }
+}
+
+void FWriteToRenderTargetResultCache::Empty()
+{
+    check(IsInGameThread());
+
+    TArray<FWriteToRenderTargetResultKey> Keys;
+    Entries.GetKeys(Keys);
+    for (const FWriteToRenderTargetResultKey& Key : Keys)
+    {
+        RemoveEntry(Key);
+    }
+}
+
+void FWriteToRenderTargetResultCache::SavePreset(FName Name, const FWriteToRenderTargetEffectParams& Params)
+{
+    check(IsInGameThread());
+
+    Presets.Add(Name, Params);
+    UpdatePresetEntries();
+}
+
+bool FWriteToRenderTargetResultCache::FindPreset(FName Name, FWriteToRenderTargetEffectParams& OutParams) const
+{
+    if (const FWriteToRenderTargetEffectParams* Params = Presets.Find(Name))
+    {
+        OutParams = *Params;
+        return true;
+    }
+    return false;
+}
+
+bool FWriteToRenderTargetResultCache::RemovePreset(FName Name)
+{
+    check(IsInGameThread());
+
+    if (Presets.Remove(Name) == 0)
+    {
+        return false;
+    }
+    UpdatePresetEntries();
+    return true;
+}
+
+TArray<FName> FWriteToRenderTargetResultCache::GetPresetNames() const
+{
+    TArray<FName> Names;
+    Presets.GetKeys(Names);
+    return Names;
+}
+
+FWriteToRenderTargetResultCacheStats FWriteToRenderTargetResultCache::GetStats() const
+{
+    FWriteToRenderTargetResultCacheStats Stats;
+    Stats.Hits = Hits;
+    Stats.Misses = Misses;
+    Stats.Evictions = Evictions;
+    Stats.Collisions = Collisions;
+    Stats.NumEntries = Entries.Num();
+    for (const TPair<FWriteToRenderTargetResultKey, FEntry>& Pair : Entries)
+    {
+        Stats.NumPresetEntries += Pair.Value.bPreset ? 1 : 0;
+    }
+    Stats.NumPresets = Presets.Num();
+    Stats.BytesHeld = BytesHeld;
+    Stats.BudgetBytes = GetBudgetBytes();
+    return Stats;
+}
+
+void FWriteToRenderTargetResultCache::SetBudgetBytes(int64 InBudgetBytes)
+{
+    BudgetBytesOverride = InBudgetBytes;
+    EvictToBudget(0);
+}
+
+int64 FWriteToRenderTargetResultCache::GetBudgetBytes() const
+{
+    if (BudgetBytesOverride >= 0)
+    {
+        return BudgetBytesOverride;
+    }
+    return (int64)FMath::Max(CVarWriteToRenderTargetResultCacheBudgetMB.GetValueOnGameThread(), 0) * 1024 * 1024;
+}
+
+bool FWriteToRenderTargetResultCache::IsPreset(const FWriteToRenderTargetEffectParams& Params) const
+{
+    for (const TPair<FName, FWriteToRenderTargetEffectParams>& Pair : Presets)
+    {
+        if (AreEffectParamsIdentical(Pair.Value, Params))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FWriteToRenderTargetResultCache::UpdatePresetEntries()
+{
+    for (TPair<FWriteToRenderTargetResultKey, FEntry>& Pair : Entries)
+    {
+        Pair.Value.bPreset = IsPreset(Pair.Value.RequestedParams);
+    }
+}
+
+/*
+ * Drops least recently used entries until ExtraBytes more would still fit in the budget, results of presets last.
+ * The cache holds at most a few dozen entries, so a linear scan for the oldest one is cheap enough.
+ */
+void FWriteToRenderTargetResultCache::EvictToBudget(int64 ExtraBytes)
+{
+    const int64 BudgetBytes = GetBudgetBytes();
+    while (Entries.Num() > 0 && BytesHeld + ExtraBytes > BudgetBytes)
+    {
+        const FWriteToRenderTargetResultKey* OldestKey = nullptr;
+        bool bOldestPreset = true;
+        uint64 OldestTick = MAX_uint64;
+        for (const TPair<FWriteToRenderTargetResultKey, FEntry>& Pair : Entries)
+        {
+            const bool bPreset = Pair.Value.bPreset;
+            if ((bOldestPreset && !bPreset) || (bPreset == bOldestPreset && Pair.Value.LastUseTick < OldestTick))
+            {
+                OldestTick = Pair.Value.LastUseTick;
+                OldestKey = &Pair.Key;
+                bOldestPreset = bPreset;
+            }
+        }
+
+        const FWriteToRenderTargetResultKey KeyToRemove = *OldestKey;
+        RemoveEntry(KeyToRemove);
+        ++Evictions;
+    }
+}
+
+void FWriteToRenderTargetResultCache::RemoveEntry(const FWriteToRenderTargetResultKey& Key)
+{
+    FEntry Removed;
+    if (Entries.RemoveAndCopyValue(Key, Removed))
+    {
+        BytesHeld -= Removed.Bytes;
+        UpdateStats();
+    }
+}
+
+void FWriteToRenderTargetResultCache::UpdateStats() const
+{
+    SET_MEMORY_STAT(STAT_WriteToRenderTarget_ResultCacheMemory, BytesHeld);
+    SET_FLOAT_STAT(STAT_WriteToRenderTarget_ResultCacheHitRate, (float)(GetStats().GetHitRate() * 100.0));
+}
+
+bool FWriteToRenderTargetResultCache::CopyToRenderTarget_RenderThread(FRHICommandListImmediate& RHICmdList, const FWriteToRenderTargetCachedResult& Result, FRenderTarget* RenderTarget, bool bGenerateMips)
+{
+    check(IsInRenderingThread());
+
+    FRHITexture* TargetRHI = RenderTarget ? RenderTarget->GetRenderTargetTexture().GetReference() : nullptr;
+    if (!Result.Texture.IsValid() || !TargetRHI)
+    {
+        return false;
+    }
+
+    // The render target may have been resized or recreated with another format since the result was captured
+    const FRDGTextureDesc& ResultDesc = Result.Texture->GetDesc();
+    const FIntVector TargetSize = TargetRHI->GetSizeXYZ();
+    if (ResultDesc.Format != TargetRHI->GetFormat() || ResultDesc.Extent != FIntPoint(TargetSize.X, TargetSize.Y))
+    {
+        return false;
+    }
+
+    FRDGBuilder GraphBuilder(RHICmdList);
+    FRDGTextureRef Source = GraphBuilder.RegisterExternalTexture(Result.Texture, TEXT("WriteToRenderTarget_CachedResult"));
+    FRDGTextureRef Target = FWriteToRenderTargetRenderTargetPool::Get().RegisterExternalTexture(GraphBuilder, TargetRHI, TEXT("WriteToRenderTarget_RenderTarget"));
+    AddCopyTexturePass(GraphBuilder, Source, Target, FRHICopyTextureInfo());
+    if (bGenerateMips && Target->Desc.NumMips > 1)
+    {
+        WriteToRenderTargetRDG::AddGenerateMipsPass(GraphBuilder, Target);
+    }
+    GraphBuilder.Execute();
+    return true;
+}
+
+void FWriteToRenderTargetResultCache::CaptureRenderTarget_RenderThread(FRHICommandListImmediate& RHICmdList, FWriteToRenderTargetCachedResult& Result, FRenderTarget* RenderTarget)
+{
+    check(IsInRenderingThread());
+
+    FRHITexture* TargetRHI = RenderTarget ? RenderTarget->GetRenderTargetTexture().GetReference() : nullptr;
+    if (!TargetRHI)
+    {
+        return;
+    }
+
+    FRDGBuilder GraphBuilder(RHICmdList);
+    FRDGTextureRef Target = FWriteToRenderTargetRenderTargetPool::Get().RegisterExternalTexture(GraphBuilder, TargetRHI, TEXT("WriteToRenderTarget_RenderTarget"));
+    FRDGTextureRef Copy = GraphBuilder.CreateTexture(
+        FRDGTextureDesc::Create2D(Target->Desc.Extent, Target->Desc.Format, FClearValueBinding::None, TexCreate_ShaderResource),
+        TEXT("WriteToRenderTarget_CachedResult"));
+    AddCopyTexturePass(GraphBuilder, Target, Copy, FRHICopyTextureInfo());
+    GraphBuilder.QueueTextureExtraction(Copy, &Result.Texture);
+    GraphBuilder.Execute();
+}
+
+static FAutoConsoleCommand GWriteToRenderTargetResultCacheStatsCommand(
+    TEXT("ShaderMod.ResultCache.Stats"),
+    TEXT("Logs the hit rate, memory and presets of the processed result cache."),
+    FConsoleCommandDelegate::CreateLambda([]()
+    {
+        const FWriteToRenderTargetResultCache& Cache = FWriteToRenderTargetResultCache::Get();
+        const FWriteToRenderTargetResultCacheStats Stats = Cache.GetStats();
+        UE_LOG(LogTemp, Display, TEXT("ShaderMod result cache: %d entries (%d of presets), %.1f / %.1f MB, %llu hits, %llu misses (%llu collisions), %.1f%% hit rate, %llu evictions"),
+            Stats.NumEntries, Stats.NumPresetEntries, Stats.BytesHeld / (1024.0 * 1024.0), Stats.BudgetBytes / (1024.0 * 1024.0),
+            Stats.Hits, Stats.Misses, Stats.Collisions, Stats.GetHitRate() * 100.0, Stats.Evictions);
+        for (const FName& Name : Cache.GetPresetNames())
+        {
+            UE_LOG(LogTemp, Display, TEXT("ShaderMod result cache preset: %s"), *Name.ToString());
+        }
+    }));
+
+static FAutoConsoleCommand GWriteToRenderTargetResultCacheFlushCommand(
+    TEXT("ShaderMod.ResultCache.Flush"),
+    TEXT("Releases every processed result held by the result cache. Presets are kept."),
+    FConsoleCommandDelegate::CreateLambda([]()
+    {
+        FWriteToRenderTargetResultCache::Get().Empty();
+    }));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetResultCacheTest, "ShaderMod.WriteToRenderTarget.ResultCache", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks the result cache bookkeeping with CPU sized entries: hits for an identical key and parameter set, misses for
+ * another parameter set, another render target or after Invalidate, least recently used eviction beyond the budget,
+ * preset results surviving eviction, and the hit rate. Runs against the shared cache with a temporary budget and
+ * restores it afterwards.
+ */
+bool FWriteToRenderTargetResultCacheTest::RunTest(const FString& Parameters)
+{
+    FWriteToRenderTargetResultCache& Cache = FWriteToRenderTargetResultCache::Get();
+    Cache.Empty();
+    const FWriteToRenderTargetResultCacheStats Before = Cache.GetStats();
+
+    // Entries are 1 MB each, the budget holds three of them
+    const FIntPoint Size(512, 512);
+    const int64 EntryBytes = (int64)Size.X * Size.Y * sizeof(FColor);
+    Cache.SetBudgetBytes(EntryBytes * 3);
+
+    UTexture2D* Input = UTexture2D::CreateTransient(4, 4, PF_B8G8R8A8);
+    FWriteToRenderTargetEffectParams Params[5];
+    for (int32 Index = 0; Index < (int32)UE_ARRAY_COUNT(Params); ++Index)
+    {
+        Params[Index].Contrast = 1.0f + 0.25f * Index;
+    }
+    // Keys only identify the render target, it needs no resource
+    const FObjectKey RenderTarget(NewObject<UTextureRenderTarget2D>());
+    auto MakeKey = [Input, Size, RenderTarget](const FWriteToRenderTargetEffectParams& EffectParams)
+    {
+        return FWriteToRenderTargetResultCache::MakeKey(Input, RenderTarget, Size, EWriteToRenderTargetBackend::CPU, EffectParams);
+    };
+    auto AddEntry = [&Cache, &MakeKey, EntryBytes](const FWriteToRenderTargetEffectParams& EffectParams, uint8 Value)
+    {
+        if (FWriteToRenderTargetCachedResultPtr Result = Cache.Add(MakeKey(EffectParams), EffectParams, EffectParams, EntryBytes))
+        {
+            Result->Pixels.Init(FColor(Value, Value, Value, 255), 4);
+        }
+    };
+
+    AddEntry(Params[0], 0);
+    AddEntry(Params[1], 1);
+    const FWriteToRenderTargetCachedResultPtr Hit = Cache.Find(MakeKey(Params[0]), Params[0]);
+    TestTrue(TEXT("Identical parameters hit"), Hit.IsValid() && Hit->Pixels.Num() == 4 && Hit->Pixels[0].R == 0);
+    TestFalse(TEXT("Other parameters miss"), Cache.Find(MakeKey(Params[2]), Params[2]).IsValid());
+    TestFalse(TEXT("Other render target misses"),
+        Cache.Find(FWriteToRenderTargetResultCache::MakeKey(Input, FObjectKey(NewObject<UTextureRenderTarget2D>()), Size, EWriteToRenderTargetBackend::CPU, Params[0]), Params[0]).IsValid());
+    TestFalse(TEXT("Hash collision misses"), Cache.Find(MakeKey(Params[0]), Params[1]).IsValid());
+    TestEqual(TEXT("Hash collision counted"), (int64)(Cache.GetStats().Collisions - Before.Collisions), (int64)1);
+
+    // Params[1] is the least recently used entry and Params[0] the result of a preset: adding two more evicts Params[1] first
+    Cache.SavePreset(TEXT("VerifyResultCache"), Params[0]);
+    AddEntry(Params[2], 2);
+    AddEntry(Params[3], 3);
+    TestFalse(TEXT("Least recently used entry evicted"), Cache.Find(MakeKey(Params[1]), Params[1]).IsValid());
+    AddEntry(Params[4], 4);
+    TestTrue(TEXT("Preset result kept over more recent entries"), Cache.Find(MakeKey(Params[0]), Params[0]).IsValid());
+    TestTrue(TEXT("Budget respected"), Cache.GetStats().BytesHeld <= EntryBytes * 3);
+
+    FWriteToRenderTargetEffectParams PresetParams;
+    TestTrue(TEXT("Preset parameters found"), Cache.FindPreset(TEXT("VerifyResultCache"), PresetParams) && PresetParams.Contrast == Params[0].Contrast);
+    TestTrue(TEXT("Preset removed"), Cache.RemovePreset(TEXT("VerifyResultCache")) && Cache.GetStats().NumPresetEntries == 0);
+
+    TestNull(TEXT("Entry larger than the budget rejected"), Cache.Add(MakeKey(Params[1]), Params[1], Params[1], EntryBytes * 4).Get());
+
+    Cache.Invalidate(Input);
+    TestEqual(TEXT("Invalidate drops the entries of the input"), Cache.GetStats().NumEntries, 0);
+    TestFalse(TEXT("Invalidated input misses"), Cache.Find(MakeKey(Params[4]), Params[4]).IsValid());
+
+    const FWriteToRenderTargetResultCacheStats After = Cache.GetStats();
+    TestEqual(TEXT("Hits counted"), (int64)(After.Hits - Before.Hits), (int64)2);
+    TestEqual(TEXT("Misses counted"), (int64)(After.Misses - Before.Misses), (int64)5);
+
+    Cache.SetBudgetBytes(-1);
+    return true;
+}
+
+#endif
@@ -0,0 +1,464 @@
+#include "WriteToRenderTarget/WriteToRenderTargetScheduler.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Tickable.h"
+#include "WriteToRenderTarget/WriteToRenderTargetStats.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTrace.h"
+
+DEFINE_STAT(STAT_WriteToRenderTarget_Scheduler);
+DEFINE_STAT(STAT_WriteToRenderTarget_SchedulerJobsExecuted);
+DEFINE_STAT(STAT_WriteToRenderTarget_SchedulerJobsDeferred);
+DEFINE_STAT(STAT_WriteToRenderTarget_SchedulerMegapixels);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetScheduler(
+    TEXT("r.ShaderMod.Scheduler"),
+    1,
+    TEXT("Issue the dispatches of all processors through the frame-budgeted scheduler (1) or from each processor's own tick (0)."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarWriteToRenderTargetSchedulerBudgetMs(
+    TEXT("r.ShaderMod.SchedulerBudgetMs"),
+    4.0f,
+    TEXT("Game thread milliseconds per frame the scheduler spends issuing dispatches. 0 is unlimited."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarWriteToRenderTargetSchedulerBudgetMegapixels(
+    TEXT("r.ShaderMod.SchedulerBudgetMegapixels"),
+    16.0f,
+    TEXT("Output megapixels per frame the scheduler dispatches. 0 is unlimited."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetSchedulerAgingFrames(
+    TEXT("r.ShaderMod.SchedulerAgingFrames"),
+    30,
+    TEXT("Frames a deferred dispatch waits before it is promoted one priority level. 0 disables aging."),
+    ECVF_Default);
+
+FWriteToRenderTargetSchedulerBudget FWriteToRenderTargetSchedulerBudget::FromConsoleVariables()
+{
+    FWriteToRenderTargetSchedulerBudget Budget;
+    Budget.Milliseconds = FMath::Max(CVarWriteToRenderTargetSchedulerBudgetMs.GetValueOnGameThread(), 0.0f);
+    Budget.Megapixels = FMath::Max(CVarWriteToRenderTargetSchedulerBudgetMegapixels.GetValueOnGameThread(), 0.0f);
+    return Budget;
+}
+
+// Runs the shared scheduler once per frame, in the editor and while paused like the processors
+class FWriteToRenderTargetSchedulerTicker : public FTickableGameObject
+{
+public:
+    virtual void Tick(float DeltaTime) override
+    {
+        FWriteToRenderTargetScheduler& Scheduler = FWriteToRenderTargetScheduler::Get();
+        Scheduler.SetAgingFrames(CVarWriteToRenderTargetSchedulerAgingFrames.GetValueOnGameThread());
+        Scheduler.RunFrame(FWriteToRenderTargetSchedulerBudget::FromConsoleVariables());
+    }
+
+    virtual bool IsTickable() const override { return FWriteToRenderTargetScheduler::Get().GetNumQueued() > 0; }
+    virtual bool IsTickableInEditor() const override { return true; }
+    virtual bool IsTickableWhenPaused() const override { return true; }
+    virtual TStatId GetStatId() const override
+    {
+        RETURN_QUICK_DECLARE_CYCLE_STAT(FWriteToRenderTargetSchedulerTicker, STATGROUP_Tickables);
+    }
+};
+
+FWriteToRenderTargetScheduler::FWriteToRenderTargetScheduler()
+    : Clock([]() { return FPlatformTime::Seconds(); })
+{
+}
+
+FWriteToRenderTargetScheduler& FWriteToRenderTargetScheduler::Get()
+{
+    static FWriteToRenderTargetScheduler Instance;
+    static FWriteToRenderTargetSchedulerTicker Ticker;
+    return Instance;
+}
+
+bool FWriteToRenderTargetScheduler::IsEnabled()
+{
+    return CVarWriteToRenderTargetScheduler.GetValueOnGameThread() != 0;
+}
+
+uint64 FWriteToRenderTargetScheduler::Enqueue(EWriteToRenderTargetPriority Priority, double Megapixels, TFunction<void()> Execute, const void* Owner)
+{
+    if (Owner)
+    {
+        if (FJob* Job = Jobs.FindByPredicate([Owner](const FJob& Queued) { return Queued.Owner == Owner; }))
+        {
+            Job->Priority = Priority;
+            Job->Megapixels = Megapixels;
+            Job->Execute = MoveTemp(Execute);
+            ++Stats.JobsCoalesced;
+            return Job->Id;
+        }
+    }
+
+    FJob& Job = Jobs.AddDefaulted_GetRef();
+    Job.Id = NextJobId++;
+    Job.Sequence = NextSequence++;
+    Job.Owner = Owner;
+    Job.Priority = Priority;
+    Job.Megapixels = Megapixels;
+    Job.Execute = MoveTemp(Execute);
+    ++Stats.JobsEnqueued;
+    return Job.Id;
+}
+
+bool FWriteToRenderTargetScheduler::Cancel(uint64 JobId)
+{
+    const int32 Index = Jobs.IndexOfByPredicate([JobId](const FJob& Job) { return Job.Id == JobId; });
+    if (Index == INDEX_NONE)
+    {
+        return false;
+    }
+    Jobs.RemoveAt(Index);
+    ++Stats.JobsCancelled;
+    return true;
+}
+
+bool FWriteToRenderTargetScheduler::IsQueued(uint64 JobId) const
+{
+    return Jobs.ContainsByPredicate([JobId](const FJob& Job) { return Job.Id == JobId; });
+}
+
+int32 FWriteToRenderTargetScheduler::GetEffectivePriority(const FJob& Job) const
+{
+    if (Job.Priority == EWriteToRenderTargetPriority::Immediate)
+    {
+        return (int32)EWriteToRenderTargetPriority::Immediate;
+    }
+    const int32 Promotion = AgingFrames > 0 ? Job.FramesWaited / AgingFrames : 0;
+    return FMath::Min((int32)Job.Priority + Promotion, (int32)EWriteToRenderTargetPriority::High);
+}
+
+EWriteToRenderTargetPriority FWriteToRenderTargetScheduler::GetEffectivePriority(uint64 JobId) const
+{
+    const FJob* Job = Jobs.FindByPredicate([JobId](const FJob& Queued) { return Queued.Id == JobId; });
+    return Job ? (EWriteToRenderTargetPriority)GetEffectivePriority(*Job) : EWriteToRenderTargetPriority::Low;
+}
+
+FWriteToRenderTargetSchedulerFrame FWriteToRenderTargetScheduler::RunFrame(const FWriteToRenderTargetSchedulerBudget& Budget)
+{
+    SCOPE_CYCLE_COUNTER(STAT_WriteToRenderTarget_Scheduler);
+    WRITETORENDERTARGET_TRACE_SCOPE(WriteToRenderTarget_Scheduler);
+
+    FWriteToRenderTargetSchedulerFrame Frame;
+    Jobs.StableSort([this](const FJob& A, const FJob& B)
+    {
+        const int32 PriorityA = GetEffectivePriority(A);
+        const int32 PriorityB = GetEffectivePriority(B);
+        return PriorityA != PriorityB ? PriorityA > PriorityB : A.Sequence < B.Sequence;
+    });
+
+    // Jobs are taken from the front one at a time; a job may cancel or enqueue others while it runs
+    const double StartSeconds = Clock();
+    while (Jobs.Num() > 0)
+    {
+        const FJob& Next = Jobs[0];
+        const bool bImmediate = Next.Priority == EWriteToRenderTargetPriority::Immediate;
+        const bool bOverMegapixels = Budget.Megapixels > 0.0 && Frame.Megapixels + Next.Megapixels > Budget.Megapixels;
+        const bool bOverTime = Budget.Milliseconds > 0.0 && Frame.Milliseconds >= Budget.Milliseconds;
+        if (!bImmediate && Frame.JobsExecuted > 0 && (bOverMegapixels || bOverTime))
+        {
+            break;
+        }
+
+        FJob Job = MoveTemp(Jobs[0]);
+        Jobs.RemoveAt(0);
+        Stats.MaxWaitFrames = FMath::Max(Stats.MaxWaitFrames, Job.FramesWaited);
+        Job.Execute();
+
+        ++Frame.JobsExecuted;
+        Frame.Megapixels += Job.Megapixels;
+        Frame.Milliseconds = (Clock() - StartSeconds) * 1000.0;
+    }
+
+    for (FJob& Job : Jobs)
+    {
+        ++Job.FramesWaited;
+    }
+    Frame.JobsDeferred = Jobs.Num();
+
+    const bool bOverBudget = (Budget.Megapixels > 0.0 && Frame.Megapixels > Budget.Megapixels)
+        || (Budget.Milliseconds > 0.0 && Frame.Milliseconds > Budget.Milliseconds);
+    Stats.JobsExecuted += Frame.JobsExecuted;
+    Stats.JobDeferrals += Frame.JobsDeferred;
+    Stats.FramesOverBudget += bOverBudget ? 1 : 0;
+
+    INC_DWORD_STAT_BY(STAT_WriteToRenderTarget_SchedulerJobsExecuted, Frame.JobsExecuted);
+    INC_DWORD_STAT_BY(STAT_WriteToRenderTarget_SchedulerJobsDeferred, Frame.JobsDeferred);
+    INC_FLOAT_STAT_BY(STAT_WriteToRenderTarget_SchedulerMegapixels, (float)Frame.Megapixels);
+    return Frame;
+}
+
+void FWriteToRenderTargetScheduler::SetClock(TFunction<double()> InClock)
+{
+    Clock = MoveTemp(InClock);
+}
+
+FWriteToRenderTargetSchedulerStats FWriteToRenderTargetScheduler::GetStats() const
+{
+    FWriteToRenderTargetSchedulerStats Result = Stats;
+    Result.NumQueued = Jobs.Num();
+    return Result;
+}
+
+void FWriteToRenderTargetScheduler::ResetStats()
+{
+    Stats = FWriteToRenderTargetSchedulerStats();
+}
+
+void FWriteToRenderTargetScheduler::Empty()
+{
+    Stats.JobsCancelled += Jobs.Num();
+    Jobs.Empty();
+}
+
+static FAutoConsoleCommand GWriteToRenderTargetSchedulerStatsCommand(
+    TEXT("ShaderMod.Scheduler.Stats"),
+    TEXT("Logs the statistics of the WriteToRenderTarget dispatch scheduler. Usage: ShaderMod.Scheduler.Stats [reset]"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        FWriteToRenderTargetScheduler& Scheduler = FWriteToRenderTargetScheduler::Get();
+        const FWriteToRenderTargetSchedulerStats Stats = Scheduler.GetStats();
+        UE_LOG(LogTemp, Display, TEXT("ShaderMod scheduler: %d queued, %llu enqueued, %llu coalesced, %llu executed, %llu cancelled, %llu deferrals, %llu frames over budget, max wait %d frames"),
+            Stats.NumQueued, Stats.JobsEnqueued, Stats.JobsCoalesced, Stats.JobsExecuted, Stats.JobsCancelled, Stats.JobDeferrals, Stats.FramesOverBudget, Stats.MaxWaitFrames);
+        if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+        {
+            Scheduler.ResetStats();
+        }
+    }));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace WriteToRenderTargetScheduler
+{
+    struct FSimulatedJob
+    {
+        EWriteToRenderTargetPriority Priority = EWriteToRenderTargetPriority::Normal;
+        double Megapixels = 0.0;
+        int32 EnqueueFrame = 0;
+        int32 ExecuteFrame = INDEX_NONE;
+        bool bCancelled = false;
+    };
+
+    struct FSimulationResult
+    {
+        uint32 ExecutionHash = 0;
+        int32 FramesOverBudget = 0;
+        int32 NumCoalesced = 0;
+        TMap<uint64, FSimulatedJob> Jobs;
+    };
+
+    /*
+     * Drives a scheduler with a seeded stream of jobs on a simulated clock: every job advances the clock by a cost
+     * proportional to its megapixels. Checks every frame that jobs start only within the budget (except a frame's
+     * first job and Immediate jobs), in priority order with aging and oldest first, that cancelled jobs never run,
+     * and that every other job runs once the arrivals stop. Failed checks are reported to Test when there is one.
+     */
+    static FSimulationResult Simulate(int32 NumFrames, int32 Seed, FAutomationTestBase* Test)
+    {
+        const FWriteToRenderTargetSchedulerBudget Budget{ 2.0, 4.0 };
+        const double MillisecondsPerMegapixel = 0.4;
+        const int32 AgingFrames = 10;
+        const double Sizes[] = { 0.25, 0.5, 1.0, 2.0, 8.3 };   // Up to a 4K target
+        const double OversizeMegapixels = 33.2;                // An 8K target, larger than the whole budget
+        const int32 NumOwners = 8;
+
+        FSimulationResult Result;
+        FRandomStream Random(Seed);
+        double SimulatedSeconds = 0.0;
+
+        FWriteToRenderTargetScheduler Scheduler;
+        Scheduler.SetClock([&SimulatedSeconds]() { return SimulatedSeconds; });
+        Scheduler.SetAgingFrames(AgingFrames);
+
+        // Checks of the frame being run, updated by the jobs as they execute
+        int32 Frame = 0;
+        int32 ExecutedInFrame = 0;
+        double FrameMegapixels = 0.0;
+        double FrameStartSeconds = 0.0;
+        TMap<uint64, int32> Ranks;
+        int32 LastRank = MAX_int32;
+        uint64 LastId = 0;
+        auto Fail = [Test](const FString& Message)
+        {
+            if (Test)
+            {
+                Test->AddError(Message);
+            }
+        };
+
+        const int32 ArrivalFrames = NumFrames * 4 / 5;
+        for (Frame = 0; Frame < NumFrames * 4 && (Frame < ArrivalFrames || Scheduler.GetNumQueued() > 0); ++Frame)
+        {
+            // Arrivals: a few jobs per frame, some of them from owners that may still have a job queued
+            const int32 NumArrivals = Frame < ArrivalFrames ? Random.RandRange(0, 3) : 0;
+            for (int32 Arrival = 0; Arrival < NumArrivals; ++Arrival)
+            {
+                const int32 PriorityRoll = Random.RandRange(0, 99);
+                const EWriteToRenderTargetPriority Priority = PriorityRoll < 40 ? EWriteToRenderTargetPriority::Low
+                    : PriorityRoll < 80 ? EWriteToRenderTargetPriority::Normal
+                    : PriorityRoll < 96 ? EWriteToRenderTargetPriority::High : EWriteToRenderTargetPriority::Immediate;
+                const double Megapixels = Random.RandRange(0, 99) < 2 ? OversizeMegapixels : Sizes[Random.RandRange(0, (int32)UE_ARRAY_COUNT(Sizes) - 1)];
+                const int32 Owner = Random.RandRange(0, 99) < 25 ? Random.RandRange(0, NumOwners - 1) : INDEX_NONE;
+
+                TSharedRef<uint64> JobId = MakeShared<uint64>(0);
+                const uint64 EnqueuedId = Scheduler.Enqueue(Priority, Megapixels,
+                    [&, JobId, Megapixels, Priority]()
+                    {
+                        const uint64 Id = *JobId;
+                        FSimulatedJob& Job = Result.Jobs.FindChecked(Id);
+                        if (Job.bCancelled || Job.ExecuteFrame != INDEX_NONE)
+                        {
+                            Fail(FString::Printf(TEXT("job %llu ran after being cancelled or twice"), Id));
+                        }
+                        const double FrameMilliseconds = (SimulatedSeconds - FrameStartSeconds) * 1000.0;
+                        if (Priority != EWriteToRenderTargetPriority::Immediate && ExecutedInFrame > 0
+                            && (FrameMegapixels + Megapixels > Budget.Megapixels || FrameMilliseconds >= Budget.Milliseconds))
+                        {
+                            Fail(FString::Printf(TEXT("frame %d: job %llu started beyond the budget (%.2f MP, %.2f ms spent)"), Frame, Id, FrameMegapixels, FrameMilliseconds));
+                        }
+                        const int32 Rank = Ranks.FindRef(Id);
+                        if (Rank > LastRank || (Rank == LastRank && Id < LastId))
+                        {
+                            Fail(FString::Printf(TEXT("frame %d: job %llu ran out of priority order"), Frame, Id));
+                        }
+
+                        Job.ExecuteFrame = Frame;
+                        LastRank = Rank;
+                        LastId = Id;
+                        ++ExecutedInFrame;
+                        FrameMegapixels += Megapixels;
+                        SimulatedSeconds += Megapixels * MillisecondsPerMegapixel / 1000.0;
+                        Result.ExecutionHash = HashCombine(Result.ExecutionHash, HashCombine(GetTypeHash(Id), GetTypeHash(Frame)));
+                    },
+                    Owner != INDEX_NONE ? reinterpret_cast<const void*>((UPTRINT)(Owner + 1)) : nullptr);
+                *JobId = EnqueuedId;
+
+                // A coalesced job keeps its id and place in the queue and takes the new priority and cost
+                FSimulatedJob* Existing = Result.Jobs.Find(EnqueuedId);
+                if (Existing && Existing->ExecuteFrame == INDEX_NONE && !Existing->bCancelled)
+                {
+                    Existing->Priority = Priority;
+                    Existing->Megapixels = Megapixels;
+                    ++Result.NumCoalesced;
+                }
+                else
+                {
+                    Result.Jobs.Add(EnqueuedId, FSimulatedJob{ Priority, Megapixels, Frame });
+                }
+            }
+
+            // Cancellations, of jobs that may already have run
+            if (Frame < ArrivalFrames && Random.RandRange(0, 99) < 5 && Result.Jobs.Num() > 0)
+            {
+                const uint64 Id = (uint64)Random.RandRange(1, Result.Jobs.Num());
+                FSimulatedJob* Job = Result.Jobs.Find(Id);
+                const bool bQueued = Job && Job->ExecuteFrame == INDEX_NONE && !Job->bCancelled;
+                if (Scheduler.Cancel(Id) != bQueued)
+                {
+                    Fail(FString::Printf(TEXT("frame %d: cancelling job %llu returned the wrong result"), Frame, Id));
+                }
+                if (bQueued)
+                {
+                    Job->bCancelled = true;
+                }
+            }
+
+            // Rank of every queued job for this frame: effective priority first, then age (job ids grow with the enqueue order)
+            Ranks.Reset();
+            for (const TPair<uint64, FSimulatedJob>& Pair : Result.Jobs)
+            {
+                if (Pair.Value.ExecuteFrame == INDEX_NONE && !Pair.Value.bCancelled)
+                {
+                    Ranks.Add(Pair.Key, (int32)Scheduler.GetEffectivePriority(Pair.Key));
+                }
+            }
+
+            ExecutedInFrame = 0;
+            FrameMegapixels = 0.0;
+            FrameStartSeconds = SimulatedSeconds;
+            LastRank = MAX_int32;
+            LastId = 0;
+            const FWriteToRenderTargetSchedulerFrame FrameResult = Scheduler.RunFrame(Budget);
+            Result.FramesOverBudget += (FrameResult.Megapixels > Budget.Megapixels || FrameResult.Milliseconds > Budget.Milliseconds) ? 1 : 0;
+
+            // No deferred job may rank above the last one that ran
+            for (const TPair<uint64, int32>& Rank : Ranks)
+            {
+                const FSimulatedJob& Job = Result.Jobs.FindChecked(Rank.Key);
+                if (Job.ExecuteFrame == INDEX_NONE && ExecutedInFrame > 0 && Job.Priority != EWriteToRenderTargetPriority::Immediate
+                    && (Rank.Value > LastRank || (Rank.Value == LastRank && Rank.Key < LastId)))
+                {
+                    Fail(FString::Printf(TEXT("frame %d: job %llu was overtaken"), Frame, Rank.Key));
+                }
+                if (Job.ExecuteFrame == INDEX_NONE && Job.Priority == EWriteToRenderTargetPriority::Immediate)
+                {
+                    Fail(FString::Printf(TEXT("frame %d: immediate job %llu was deferred"), Frame, Rank.Key));
+                }
+            }
+        }
+
+        for (const TPair<uint64, FSimulatedJob>& Pair : Result.Jobs)
+        {
+            if (!Pair.Value.bCancelled && Pair.Value.ExecuteFrame == INDEX_NONE)
+            {
+                Fail(FString::Printf(TEXT("job %llu never ran"), Pair.Key));
+            }
+        }
+        return Result;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetSchedulerTest, "ShaderMod.WriteToRenderTarget.Scheduler", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Runs the scheduler against a deterministic simulated workload (seeded arrivals, priorities, sizes, coalescing
+ * owners and cancellations on a simulated clock) and checks budget compliance, priority order with aging,
+ * cancellation and that no job starves. The same seed is run twice and must produce the same schedule.
+ */
+bool FWriteToRenderTargetSchedulerTest::RunTest(const FString& Parameters)
+{
+    using namespace WriteToRenderTargetScheduler;
+
+    constexpr int32 NumFrames = 600;
+    constexpr int32 Seed = 1234;
+
+    const FSimulationResult Result = Simulate(NumFrames, Seed, this);
+    const FSimulationResult Repeat = Simulate(NumFrames, Seed, nullptr);
+    TestEqual(TEXT("The same seed produces the same schedule"), (int64)Repeat.ExecutionHash, (int64)Result.ExecutionHash);
+
+    static const TCHAR* PriorityNames[] = { TEXT("Low"), TEXT("Normal"), TEXT("High"), TEXT("Immediate") };
+    for (int32 Priority = 0; Priority < (int32)UE_ARRAY_COUNT(PriorityNames); ++Priority)
+    {
+        int32 NumExecuted = 0;
+        int32 NumCancelled = 0;
+        int64 TotalWait = 0;
+        int32 MaxWait = 0;
+        for (const TPair<uint64, FSimulatedJob>& Pair : Result.Jobs)
+        {
+            const FSimulatedJob& Job = Pair.Value;
+            if ((int32)Job.Priority != Priority)
+            {
+                continue;
+            }
+            NumCancelled += Job.bCancelled ? 1 : 0;
+            if (Job.ExecuteFrame != INDEX_NONE)
+            {
+                ++NumExecuted;
+                TotalWait += Job.ExecuteFrame - Job.EnqueueFrame;
+                MaxWait = FMath::Max(MaxWait, Job.ExecuteFrame - Job.EnqueueFrame);
+            }
+        }
+        AddInfo(FString::Printf(TEXT("%-9s %5d executed, %3d cancelled, wait mean %5.2f max %3d frames"),
+            PriorityNames[Priority], NumExecuted, NumCancelled, NumExecuted > 0 ? (double)TotalWait / NumExecuted : 0.0, MaxWait));
+    }
+    AddInfo(FString::Printf(TEXT("%d frames, seed %d: %d coalesced, %d frames over budget (oversize or immediate jobs)"),
+        NumFrames, Seed, Result.NumCoalesced, Result.FramesOverBudget));
+    return true;
+}
+
+#endif
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
+
+// Limits of one scheduler frame; 0 leaves a limit off
+struct FWriteToRenderTargetSchedulerBudget
+{
+    double Milliseconds = 0.0;  // Game thread time spent issuing dispatches, measured with the scheduler's clock
+    double Megapixels = 0.0;    // Output pixels dispatched, standing in for the GPU time they cost
+
+    // r.ShaderMod.SchedulerBudgetMs and r.ShaderMod.SchedulerBudgetMegapixels
+    static FWriteToRenderTargetSchedulerBudget FromConsoleVariables();
+};
+
+// What one call to RunFrame did
+struct FWriteToRenderTargetSchedulerFrame
+{
+    int32 JobsExecuted = 0;
+    int32 JobsDeferred = 0;
+    double Milliseconds = 0.0;
+    double Megapixels = 0.0;
+};
+
+struct FWriteToRenderTargetSchedulerStats
+{
+    uint64 JobsEnqueued = 0;
+    uint64 JobsCoalesced = 0;
+    uint64 JobsExecuted = 0;
+    uint64 JobsCancelled = 0;
+    uint64 JobDeferrals = 0;       // One per job and frame it stayed queued
+    uint64 FramesOverBudget = 0;   // Frames whose first job alone exceeded the budget
+    int32 MaxWaitFrames = 0;
+    int32 NumQueued = 0;
+};
+
+/*
+ * FWriteToRenderTargetScheduler stands between the processors and the render thread: instead of every processor
+ * enqueuing its dispatch on its own tick, pending dispatches queue here and RunFrame issues them once per frame,
+ * highest priority first and oldest first within a priority, until the frame budget is spent.
+ * A frame always issues at least its first job, so a job larger than the budget runs alone instead of never;
+ * the jobs behind it wait for the next frame rather than overtaking it. Jobs of one owner (a processor) coalesce:
+ * enqueuing again while queued updates the job and keeps its place. Queued jobs can be cancelled until they run.
+ * The clock is injectable so the scheduling can be simulated deterministically (the ShaderMod.WriteToRenderTarget.Scheduler automation test).
+ * The scheduler is game thread only.
+ */
+class FWriteToRenderTargetScheduler
+{
+public:
+    FWriteToRenderTargetScheduler();
+
+    // The instance ticked once per frame with the console variable budget
+    static FWriteToRenderTargetScheduler& Get();
+
+    // r.ShaderMod.Scheduler: when off, processors issue their dispatches on their own tick
+    static bool IsEnabled();
+
+    /*
+     * Queues Execute at Priority with a cost of Megapixels and returns the job id. When Owner already has a queued
+     * job, that job takes the new priority, cost and function instead, and its id is returned.
+     */
+    uint64 Enqueue(EWriteToRenderTargetPriority Priority, double Megapixels, TFunction<void()> Execute, const void* Owner = nullptr);
+
+    // Removes a queued job; returns false when it already ran or was cancelled
+    bool Cancel(uint64 JobId);
+
+    bool IsQueued(uint64 JobId) const;
+    int32 GetNumQueued() const { return Jobs.Num(); }
+
+    // Issues the queued jobs that fit into Budget and ages the others
+    FWriteToRenderTargetSchedulerFrame RunFrame(const FWriteToRenderTargetSchedulerBudget& Budget);
+
+    // Seconds, FPlatformTime::Seconds unless replaced
+    void SetClock(TFunction<double()> InClock);
+
+    // Frames a job waits before it is promoted one priority level; 0 disables aging
+    void SetAgingFrames(int32 InAgingFrames) { AgingFrames = InAgingFrames; }
+
+    // Priority a queued job is issued at, including aging
+    EWriteToRenderTargetPriority GetEffectivePriority(uint64 JobId) const;
+
+    FWriteToRenderTargetSchedulerStats GetStats() const;
+    void ResetStats();
+    void Empty();
+
+private:
+    struct FJob
+    {
+        uint64 Id = 0;
+        uint64 Sequence = 0;
+        const void* Owner = nullptr;
+        EWriteToRenderTargetPriority Priority = EWriteToRenderTargetPriority::Normal;
+        double Megapixels = 0.0;
+        int32 FramesWaited = 0;
+        TFunction<void()> Execute;
+    };
+
+    int32 GetEffectivePriority(const FJob& Job) const;
+
+    TArray<FJob> Jobs;
+    TFunction<double()> Clock;
+    int32 AgingFrames = 30;
+    uint64 NextJobId = 1;
+    uint64 NextSequence = 0;
+    FWriteToRenderTargetSchedulerStats Stats;
+};
@@ -0,0 +1,342 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GlobalShader.h"
+#include "RenderGraphBuilder.h"
+#include "ShaderParameterStruct.h"
+#include "WriteToRenderTarget/WriteToRenderTarget.h"
+#include "WriteToRenderTarget/WriteToRenderTargetEffects.h"
+#include "WriteToRenderTarget/WriteToRenderTargetGroupSize.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPermutation.h"
+
+// Global shaders of WriteToRenderTarget.usf, WriteToRenderTargetMips.usf, WriteToRenderTargetHistogram.usf and WriteToRenderTargetPreview.usf, and the RDG helpers shared by the single and batched dispatch paths
+
+/*
+ * FWriteToRenderTargetFusedEffects laid out for the kernels, must match FFusedEffects in WriteToRenderTarget.usf.
+ * The color matrix is passed as rows so the layout does not depend on the matrix packing of the shader compiler.
+ */
+struct FWriteToRenderTargetShaderEffects
+{
+    FVector4f UVMatrix[FWriteToRenderTargetFusedEffects::MaxDistortions + 1];
+    FVector4f UVOffset[FWriteToRenderTargetFusedEffects::MaxDistortions + 1];
+    FVector4f ColorMatrix[4];
+    FVector4f ColorOffset;
+    FVector2f DistortionStrength;
+    FVector2f Padding;
+
+    static FWriteToRenderTargetShaderEffects Make(const FWriteToRenderTargetFusedEffects& Effects)
+    {
+        FWriteToRenderTargetShaderEffects Packed;
+        for (int32 Stage = 0; Stage <= FWriteToRenderTargetFusedEffects::MaxDistortions; ++Stage)
+        {
+            Packed.UVMatrix[Stage] = Effects.UVStages[Stage].Matrix;
+            Packed.UVOffset[Stage] = FVector4f(Effects.UVStages[Stage].Offset.X, Effects.UVStages[Stage].Offset.Y, 0.0f, 0.0f);
+        }
+        for (int32 Row = 0; Row < 4; ++Row)
+        {
+            Packed.ColorMatrix[Row] = FVector4f(Effects.ColorMatrix.M[Row][0], Effects.ColorMatrix.M[Row][1], Effects.ColorMatrix.M[Row][2], Effects.ColorMatrix.M[Row][3]);
+        }
+        Packed.ColorOffset = Effects.ColorOffset;
+        Packed.DistortionStrength = FVector2f(Effects.DistortionStrengths[0], Effects.DistortionStrengths[1]);
+        Packed.Padding = FVector2f::ZeroVector;
+        return Packed;
+    }
+};
+
+// This class represents the global shader used to write to a render target
+class FWriteToRenderTarget : public FGlobalShader
+{
+public:
+    DECLARE_GLOBAL_SHADER(FWriteToRenderTarget);
+    SHADER_USE_PARAMETER_STRUCT(FWriteToRenderTarget, FGlobalShader);
+
+    // Define a permutation domain for shader configuration
+    // OUTPUT_FORMAT selects how the kernel converts its result for the render target (see EWriteToRenderTargetOutputFormat)
+    class FOutputFormatDim : SHADER_PERMUTATION_INT("OUTPUT_FORMAT", 3);
+    // Effect switches, chosen by FWriteToRenderTargetPermutation::Select
+    class FIdentityColorDim : SHADER_PERMUTATION_BOOL("IDENTITY_COLOR");
+    class FIdentityTransformDim : SHADER_PERMUTATION_BOOL("IDENTITY_TRANSFORM");
+    class FNumDistortionsDim : SHADER_PERMUTATION_RANGE_INT("NUM_DISTORTIONS", 0, FWriteToRenderTargetFusedEffects::MaxDistortions + 1);
+    // Thread group size, see EWriteToRenderTargetGroupSize
+    class FGroupSizeDim : SHADER_PERMUTATION_INT("GROUP_SIZE", (int32)EWriteToRenderTargetGroupSize::Num);
+    using FPermutationDomain = TShaderPermutationDomain<FOutputFormatDim, FIdentityColorDim, FIdentityTransformDim, FNumDistortionsDim, FGroupSizeDim>;
+
+    static FPermutationDomain GetPermutationVector(const FWriteToRenderTargetOutputTarget& OutputTarget, const FWriteToRenderTargetPermutation& Permutation, EWriteToRenderTargetGroupSize GroupSize)
+    {
+        FPermutationDomain PermutationVector;
+        PermutationVector.Set<FGroupSizeDim>((int32)GroupSize);
+        PermutationVector.Set<FOutputFormatDim>(OutputTarget.GetShaderOutputFormat());
+        PermutationVector.Set<FIdentityColorDim>(Permutation.bIdentityColor);
+        PermutationVector.Set<FIdentityTransformDim>(Permutation.bIdentityTransform);
+        PermutationVector.Set<FNumDistortionsDim>(Permutation.NumDistortions);
+        return PermutationVector;
+    }
+
+    BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+        SHADER_PARAMETER_TEXTURE(Texture2D, InputTexture) // The input texture to be processed
+        SHADER_PARAMETER_SAMPLER(SamplerState, InputSampler) // Sampler state for the input texture
+        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, RenderTarget) // The render target (or its fallback copy source) written by the kernel
+        // Folded effect stack, see FWriteToRenderTargetFusedEffects
+        SHADER_PARAMETER_ARRAY(FVector4f, UVMatrix, [FWriteToRenderTargetFusedEffects::MaxDistortions + 1]) // 2x2 matrix of each UV stage
+        SHADER_PARAMETER_ARRAY(FVector4f, UVOffset, [FWriteToRenderTargetFusedEffects::MaxDistortions + 1]) // Translation of each UV stage in xy
+        SHADER_PARAMETER_ARRAY(FVector4f, ColorMatrix, [4]) // Rows of the RGBA color matrix
+        SHADER_PARAMETER(FVector4f, ColorOffset)
+        SHADER_PARAMETER(FVector2f, DistortionStrength) // Strength of each distortion
+        // Input resampling
+        SHADER_PARAMETER(float, InputMipLevel) // Mip level sampled when the input is read at native size through a trilinear sampler
+        // Output region of the dispatch, see SetTileParameters
+        SHADER_PARAMETER(FUintVector2, OutputSize) // Size of the whole output, the UVs are computed against it
+        SHADER_PARAMETER(FUintVector2, TileOrigin) // First output pixel shaded by the dispatch
+        SHADER_PARAMETER(FUintVector2, TileExtent) // Number of pixels shaded along each axis
+        SHADER_PARAMETER(FUintVector2, WriteOrigin) // Where the first pixel lands in RenderTarget
+    END_SHADER_PARAMETER_STRUCT()
+
+    // Restricts the dispatch to Tile of an OutputSize image, written at WriteOrigin of the bound render target
+    static void SetTileParameters(FParameters& Parameters, FIntPoint OutputSize, const FIntRect& Tile, FIntPoint WriteOrigin)
+    {
+        Parameters.OutputSize = FUintVector2(OutputSize.X, OutputSize.Y);
+        Parameters.TileOrigin = FUintVector2(Tile.Min.X, Tile.Min.Y);
+        Parameters.TileExtent = FUintVector2(Tile.Width(), Tile.Height());
+        Parameters.WriteOrigin = FUintVector2(WriteOrigin.X, WriteOrigin.Y);
+    }
+
+    // Copies the folded effects into the kernel parameters
+    static void SetEffectParameters(FParameters& Parameters, const FWriteToRenderTargetFusedEffects& Effects)
+    {
+        const FWriteToRenderTargetShaderEffects Packed = FWriteToRenderTargetShaderEffects::Make(Effects);
+        for (int32 Stage = 0; Stage <= FWriteToRenderTargetFusedEffects::MaxDistortions; ++Stage)
+        {
+            Parameters.UVMatrix[Stage] = Packed.UVMatrix[Stage];
+            Parameters.UVOffset[Stage] = Packed.UVOffset[Stage];
+        }
+        for (int32 Row = 0; Row < 4; ++Row)
+        {
+            Parameters.ColorMatrix[Row] = Packed.ColorMatrix[Row];
+        }
+        Parameters.ColorOffset = Packed.ColorOffset;
+        Parameters.DistortionStrength = Packed.DistortionStrength;
+    }
+
+    // This function determines whether the shader permutation should be compiled
+    static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+    {
+        return true;
+    }
+
+    // This function modifies the shader compilation environment by setting constants and configurations
+    static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+    {
+        FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+
+        // The group size permutation decides numthreads; the host derives its group count from the same table
+        const FPermutationDomain PermutationVector(Parameters.PermutationId);
+        const FIntPoint ThreadCount = FWriteToRenderTargetGroupSize::GetThreadCount((EWriteToRenderTargetGroupSize)PermutationVector.Get<FGroupSizeDim>());
+        OutEnvironment.SetDefine(TEXT("THREADS_X"), ThreadCount.X);
+        OutEnvironment.SetDefine(TEXT("THREADS_Y"), ThreadCount.Y);
+        OutEnvironment.SetDefine(TEXT("THREADS_Z"), 1);
+    }
+};
+
+/*
+ * Batched entry point of WriteToRenderTarget.usf (MainBatched). Equally sized inputs are packed into a texture array
+ * and processed by one dispatch, one array slice per item, with the per-item parameters read from a structured buffer.
+ * Items in one dispatch share the effect permutation; only the default group size is compiled.
+ */
+class FWriteToRenderTargetBatched : public FGlobalShader
+{
+public:
+    DECLARE_GLOBAL_SHADER(FWriteToRenderTargetBatched);
+    SHADER_USE_PARAMETER_STRUCT(FWriteToRenderTargetBatched, FGlobalShader);
+
+    using FPermutationDomain = FWriteToRenderTarget::FPermutationDomain;
+
+    // Per-item folded effects
+    using FItem = FWriteToRenderTargetShaderEffects;
+
+    BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+        SHADER_PARAMETER_RDG_TEXTURE(Texture2DArray, BatchInputTexture) // Inputs, one slice per item
+        SHADER_PARAMETER_SAMPLER(SamplerState, InputSampler)
+        SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FFusedEffects>, BatchItems) // Per-item folded effects
+        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2DArray, BatchRenderTarget) // Outputs, one slice per item
+    END_SHADER_PARAMETER_STRUCT()
+
+    static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+    {
+        const FPermutationDomain PermutationVector(Parameters.PermutationId);
+        return PermutationVector.Get<FWriteToRenderTarget::FGroupSizeDim>() == (int32)FWriteToRenderTargetGroupSize::Default;
+    }
+
+    static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+    {
+        FWriteToRenderTarget::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+    }
+};
+
+/*
+ * Mip chain builder of WriteToRenderTargetMips.usf. One dispatch reads a level and writes up to MaxLevelsPerPass levels
+ * below it, each thread group reducing a SourceBlockSize square of the source in groupshared memory.
+ */
+class FWriteToRenderTargetMips : public FGlobalShader
+{
+public:
+    DECLARE_GLOBAL_SHADER(FWriteToRenderTargetMips);
+    SHADER_USE_PARAMETER_STRUCT(FWriteToRenderTargetMips, FGlobalShader);
+
+    static constexpr int32 MaxLevelsPerPass = 6;
+    static constexpr int32 SourceBlockSize = 64;
+
+    // MIP_FORMAT: how the levels are averaged and stored, see GetMipFormat
+    class FMipFormatDim : SHADER_PERMUTATION_INT("MIP_FORMAT", 4);
+    using FPermutationDomain = TShaderPermutationDomain<FMipFormatDim>;
+
+    BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+        SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, SourceMip) // The level read by the dispatch
+        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutMip1) // The levels written below it; unused ones repeat the last level written
+        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutMip2)
+        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutMip3)
+        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutMip4)
+        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutMip5)
+        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutMip6)
+        SHADER_PARAMETER(FUintVector2, SourceSize)
+        SHADER_PARAMETER(uint32, NumLevels)
+    END_SHADER_PARAMETER_STRUCT()
+
+    // Value of MIP_FORMAT for a render target format: 0 = UNORM RGBA, 1 = UNORM single channel, 2 = half RGBA,
+    // 3 = float RGBA, INDEX_NONE when its mips are not generated
+    static int32 GetMipFormat(EPixelFormat Format)
+    {
+        switch (Format)
+        {
+        case PF_B8G8R8A8:
+        case PF_R8G8B8A8:
+            return 0;
+        case PF_G8:
+        case PF_R8:
+            return 1;
+        case PF_FloatRGBA:
+            return 2;
+        case PF_A32B32G32R32F:
+            return 3;
+        default:
+            return INDEX_NONE;
+        }
+    }
+
+    static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+    {
+        return true;
+    }
+};
+
+/*
+ * Luminance histogram of WriteToRenderTargetHistogram.usf. Each thread group bins a BlockSize square of the input in
+ * groupshared memory and adds the result to a NumBins uint buffer.
+ */
+class FWriteToRenderTargetHistogram : public FGlobalShader
+{
+public:
+    DECLARE_GLOBAL_SHADER(FWriteToRenderTargetHistogram);
+    SHADER_USE_PARAMETER_STRUCT(FWriteToRenderTargetHistogram, FGlobalShader);
+
+    static constexpr int32 NumBins = 256;
+    static constexpr int32 BlockSize = 64;
+
+    BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+        SHADER_PARAMETER_TEXTURE(Texture2D, InputTexture) // Top mip is binned
+        SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, HistogramBins) // Cleared to zero before the pass
+        SHADER_PARAMETER(FUintVector2, InputSize)
+        SHADER_PARAMETER(uint32, bInputSRGB) // Loads are linearized by the sRGB view and encoded again, to bin the stored bytes
+    END_SHADER_PARAMETER_STRUCT()
+
+    static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+    {
+        return true;
+    }
+};
+
+/*
+ * Bilinear upsample of WriteToRenderTargetPreview.usf: stretches a reduced resolution kernel output over the render target.
+ */
+class FWriteToRenderTargetPreview : public FGlobalShader
+{
+public:
+    DECLARE_GLOBAL_SHADER(FWriteToRenderTargetPreview);
+    SHADER_USE_PARAMETER_STRUCT(FWriteToRenderTargetPreview, FGlobalShader);
+
+    static constexpr int32 GroupSize = 8;
+
+    // SINGLE_CHANNEL: R8 render targets, which store the first channel only
+    class FSingleChannelDim : SHADER_PERMUTATION_BOOL("SINGLE_CHANNEL");
+    using FPermutationDomain = TShaderPermutationDomain<FSingleChannelDim>;
+
+    BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+        SHADER_PARAMETER_RDG_TEXTURE(Texture2D, PreviewTexture) // Kernel output at the reduced size
+        SHADER_PARAMETER_SAMPLER(SamplerState, PreviewSampler)
+        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutputTexture) // Render target size
+        SHADER_PARAMETER(FUintVector2, OutputSize)
+        SHADER_PARAMETER(FVector2f, InvOutputSize)
+    END_SHADER_PARAMETER_STRUCT()
+
+    static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+    {
+        return true;
+    }
+};
+
+namespace WriteToRenderTargetRDG
+{
+    // Fills the kernel parameters shared by the dispatch and the group size autotune
+    FWriteToRenderTarget::FParameters* AllocPassParameters(
+        FRDGBuilder& GraphBuilder,
+        FRHITexture* InputTextureRHI,
+        FRDGTextureRef OutputTexture,
+        FIntPoint Extent,
+        const FWriteToRenderTargetFusedEffects& Effects,
+        bool bResampleInKernel);
+
+    /*
+     * Adds the kernel pass for one input and render target: straight into the target when it has a UAV,
+     * otherwise through one scratch texture of the same format and a copy. Updates the per-dispatch stats.
+     * A TileSize above zero splits larger outputs into one pass per TileSize square (see FWriteToRenderTargetTiling);
+     * the scratch texture then only covers one tile. Every pixel is shaded exactly as in a single pass.
+     */
+    void AddExecutePass(
+        FRDGBuilder& GraphBuilder,
+        const TShaderRef<FWriteToRenderTarget>& ComputeShader,
+        FRHITexture* InputTextureRHI,
+        FRDGTextureRef TargetTexture,
+        const FWriteToRenderTargetOutputTarget& OutputTarget,
+        const FWriteToRenderTargetPermutation& Permutation,
+        EWriteToRenderTargetGroupSize GroupSize,
+        FIntPoint Extent,
+        const FWriteToRenderTargetFusedEffects& Effects,
+        bool bResampleInKernel,
+        int32 TileSize = 0);
+
+    /*
+     * Rebuilds mips 1..N of Texture from mip 0 (WriteToRenderTargetMips.usf), MaxLevelsPerPass levels per dispatch.
+     * Textures without a UAV are processed in a pooled scratch texture and their mips copied back.
+     * Does nothing for single mip textures and formats GetMipFormat does not handle.
+     */
+    void AddGenerateMipsPass(FRDGBuilder& GraphBuilder, FRDGTextureRef Texture);
+
+    /*
+     * Stretches Preview over mip 0 of Texture with bilinear filtering (WriteToRenderTargetPreview.usf).
+     * Textures without a UAV are written through a pooled scratch texture and a copy, like AddExecutePass.
+     */
+    void AddUpsamplePreviewPass(FRDGBuilder& GraphBuilder, FRDGTextureRef Preview, FRDGTextureRef Texture);
+
+    // Adds the histogram pass of Input's top mip and returns the NumBins uint buffer it fills
+    FRDGBufferRef AddHistogramPass(FRDGBuilder& GraphBuilder, FRHITexture* Input);
+
+    // Times every group size and returns the fastest, see FWriteToRenderTargetGroupSizeTuner
+    EWriteToRenderTargetGroupSize AutotuneGroupSize(
+        FRHICommandListImmediate& RHICmdList,
+        FRHITexture* InputTextureRHI,
+        EPixelFormat TargetFormat,
+        FIntPoint Extent,
+        const FWriteToRenderTargetOutputTarget& OutputTarget,
+        const FWriteToRenderTargetPermutation& Permutation,
+        const FWriteToRenderTargetFusedEffects& Effects,
+        bool bResampleInKernel);
+}
@@ -0,0 +1,120 @@
+#include "WriteToRenderTarget/WriteToRenderTargetSnapshot.h"
+#include "Async/Async.h"
+#include "HAL/PlatformTime.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace WriteToRenderTargetSnapshot
+{
+    // A snapshot whose every field is derived from Serial, so a reader can tell whether it saw one consistent write
+    static FWriteToRenderTargetDispatchSnapshot MakeStressSnapshot(uint64 Serial)
+    {
+        const int32 Value = (int32)(Serial % 100000);
+
+        FWriteToRenderTargetDispatchSnapshot Snapshot;
+        Snapshot.Serial = Serial;
+        Snapshot.Params = FWriteToRenderTargetDispatchParams(Value, Value + 1, 1);
+        Snapshot.Params.PreviewScale = (float)(Serial % 100) / 100.0f;
+        Snapshot.EffectParams.bGreyscale = (Serial & 1) != 0;
+        Snapshot.EffectParams.Contrast = (float)Value;
+        Snapshot.EffectParams.RotationAngle = (float)(Serial % 360);
+        Snapshot.EffectParams.DistortionStrength = -(float)Value;
+        for (int32 Index = 0; Index <= (int32)(Serial % 4); ++Index)
+        {
+            FWriteToRenderTargetEffect Effect = FWriteToRenderTargetEffect::Make(EWriteToRenderTargetEffectOp::Contrast, (float)Value);
+            Effect.ColorOffset = FVector4((double)Value, (double)Index, 0.0, 0.0);
+            Snapshot.EffectParams.EffectStack.Add(Effect);
+        }
+        return Snapshot;
+    }
+
+    static bool IsConsistent(const FWriteToRenderTargetDispatchSnapshot& Snapshot)
+    {
+        const FWriteToRenderTargetDispatchSnapshot Expected = MakeStressSnapshot(Snapshot.Serial);
+        return Snapshot.Params.X == Expected.Params.X
+            && Snapshot.Params.Y == Expected.Params.Y
+            && Snapshot.Params.PreviewScale == Expected.Params.PreviewScale
+            && FWriteToRenderTargetEffectParams::StaticStruct()->CompareScriptStruct(&Snapshot.EffectParams, &Expected.EffectParams, PPF_None);
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetSnapshotTest, "ShaderMod.WriteToRenderTarget.Snapshots", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Stress test of the parameter hand-off between the game and render threads. This thread publishes NumSnapshots
+ * snapshots into a render state as fast as it can while a second thread consumes them the way render commands do,
+ * checking every snapshot it sees against the values its serial was written with and that serials never go back.
+ * Also checks that of several commands queued behind each other only the first renders the newest snapshot.
+ */
+bool FWriteToRenderTargetSnapshotTest::RunTest(const FString& Parameters)
+{
+    using namespace WriteToRenderTargetSnapshot;
+
+    constexpr uint64 NumSnapshots = 1000000;
+
+    // Coalescing: three commands queued behind three publishes render the last snapshot once
+    {
+        FWriteToRenderTargetRenderState State;
+        for (uint64 Serial = 1; Serial <= 3; ++Serial)
+        {
+            State.Publish(MakeStressSnapshot(Serial));
+        }
+        const FWriteToRenderTargetDispatchSnapshot* First = State.BeginRender_RenderThread();
+        TestTrue(TEXT("The first queued command renders the newest snapshot"), First && First->Serial == 3);
+        TestNull(TEXT("The second queued command is dropped"), State.BeginRender_RenderThread());
+        TestNull(TEXT("The third queued command is dropped"), State.BeginRender_RenderThread());
+        TestEqual(TEXT("Dropped commands counted"), (int64)State.DispatchesDropped.load(), (int64)2);
+    }
+
+    FWriteToRenderTargetRenderState State;
+    std::atomic<bool> bWriterDone{false};
+
+    struct FReaderResult
+    {
+        uint64 NumReads = 0;
+        uint64 NumDistinct = 0;
+        uint64 NumTorn = 0;
+        uint64 NumBackwards = 0;
+        uint64 LastSerial = 0;
+    };
+
+    const double StartTime = FPlatformTime::Seconds();
+    TFuture<FReaderResult> Reader = Async(EAsyncExecution::Thread, [&State, &bWriterDone]()
+    {
+        FReaderResult Result;
+        bool bLastRound = false;
+        while (!bLastRound)
+        {
+            // One more pass after the writer finished, so the final snapshot is always seen
+            bLastRound = bWriterDone.load();
+            const FWriteToRenderTargetDispatchSnapshot& Snapshot = State.Acquire_RenderThread();
+            ++Result.NumReads;
+            if (Snapshot.Serial == 0)
+            {
+                continue;
+            }
+            Result.NumTorn += IsConsistent(Snapshot) ? 0 : 1;
+            Result.NumBackwards += Snapshot.Serial < Result.LastSerial ? 1 : 0;
+            Result.NumDistinct += Snapshot.Serial != Result.LastSerial ? 1 : 0;
+            Result.LastSerial = Snapshot.Serial;
+        }
+        return Result;
+    });
+
+    for (uint64 Serial = 1; Serial <= NumSnapshots; ++Serial)
+    {
+        State.Publish(MakeStressSnapshot(Serial));
+    }
+    bWriterDone = true;
+    const FReaderResult Result = Reader.Get();
+    const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+    AddInfo(FString::Printf(TEXT("%llu snapshots published in %.2f ms, %llu reads saw %llu of them"), NumSnapshots, Seconds * 1000.0, Result.NumReads, Result.NumDistinct));
+    TestEqual(TEXT("Torn snapshots"), (int64)Result.NumTorn, (int64)0);
+    TestEqual(TEXT("Snapshots out of order"), (int64)Result.NumBackwards, (int64)0);
+    TestEqual(TEXT("Last snapshot seen"), (int64)Result.LastSerial, (int64)NumSnapshots);
+    return true;
+}
+
+#endif
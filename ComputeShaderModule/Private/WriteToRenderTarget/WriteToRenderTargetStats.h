@@ -0,0 +1,80 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/RealtimeGPUProfiler.h"
+#include "Stats/Stats.h"
+
+// Stat declarations for profiling and performance monitoring, shared by the WriteToRenderTarget translation units
+DECLARE_STATS_GROUP(TEXT("WriteToRenderTarget"), STATGROUP_WriteToRenderTarget, STATCAT_Advanced);
+
+// Execution
+DECLARE_CYCLE_STAT_EXTERN(TEXT("WriteToRenderTarget Execute"), STAT_WriteToRenderTarget_Execute, STATGROUP_WriteToRenderTarget, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("WriteToRenderTarget Graph Setup"), STAT_WriteToRenderTarget_GraphSetup, STATGROUP_WriteToRenderTarget, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("WriteToRenderTarget Graph Execute"), STAT_WriteToRenderTarget_GraphExecute, STATGROUP_WriteToRenderTarget, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("WriteToRenderTarget Execute CPU"), STAT_WriteToRenderTarget_ExecuteCPU, STATGROUP_WriteToRenderTarget, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("CPU MP/s per core"), STAT_WriteToRenderTarget_CPUMegapixelsPerCore, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Lean Permutation Dispatches"), STAT_WriteToRenderTarget_LeanPermutationDispatches, STATGROUP_WriteToRenderTarget, );
+
+// Batches
+DECLARE_CYCLE_STAT_EXTERN(TEXT("WriteToRenderTarget Execute Batch"), STAT_WriteToRenderTarget_ExecuteBatch, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Batch Items"), STAT_WriteToRenderTarget_BatchItems, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Batch Items Packed"), STAT_WriteToRenderTarget_BatchItemsPacked, STATGROUP_WriteToRenderTarget, );
+
+// Dispatch coalescing
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Dispatches Issued"), STAT_WriteToRenderTarget_DispatchesIssued, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Dispatches Coalesced"), STAT_WriteToRenderTarget_DispatchesCoalesced, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Dispatches Dropped"), STAT_WriteToRenderTarget_DispatchesDropped, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Dispatches Skipped"), STAT_WriteToRenderTarget_DispatchesSkipped, STATGROUP_WriteToRenderTarget, );
+
+// Dispatch scheduler
+DECLARE_CYCLE_STAT_EXTERN(TEXT("WriteToRenderTarget Scheduler"), STAT_WriteToRenderTarget_Scheduler, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Scheduled Jobs Executed"), STAT_WriteToRenderTarget_SchedulerJobsExecuted, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Scheduled Jobs Deferred"), STAT_WriteToRenderTarget_SchedulerJobsDeferred, STATGROUP_WriteToRenderTarget, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Scheduled MP"), STAT_WriteToRenderTarget_SchedulerMegapixels, STATGROUP_WriteToRenderTarget, );
+
+// Histogram
+DECLARE_CYCLE_STAT_EXTERN(TEXT("WriteToRenderTarget Histogram"), STAT_WriteToRenderTarget_Histogram, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Histogram Cache Hits"), STAT_WriteToRenderTarget_HistogramCacheHits, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Histogram Cache Misses"), STAT_WriteToRenderTarget_HistogramCacheMisses, STATGROUP_WriteToRenderTarget, );
+
+// Resize
+DECLARE_CYCLE_STAT_EXTERN(TEXT("WriteToRenderTarget Resize"), STAT_WriteToRenderTarget_Resize, STATGROUP_WriteToRenderTarget, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Resize MB"), STAT_WriteToRenderTarget_ResizeMegabytes, STATGROUP_WriteToRenderTarget, );
+
+// Input mips
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Input MB Read"), STAT_WriteToRenderTarget_InputMegabytes, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Input Mips Skipped"), STAT_WriteToRenderTarget_InputMipsSkipped, STATGROUP_WriteToRenderTarget, );
+
+// Resize cache
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Resize Cache Hits"), STAT_WriteToRenderTarget_ResizeCacheHits, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Resize Cache Misses"), STAT_WriteToRenderTarget_ResizeCacheMisses, STATGROUP_WriteToRenderTarget, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Resize Cache Memory"), STAT_WriteToRenderTarget_ResizeCacheMemory, STATGROUP_WriteToRenderTarget, );
+
+// Result cache
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Result Cache Hits"), STAT_WriteToRenderTarget_ResultCacheHits, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Result Cache Misses"), STAT_WriteToRenderTarget_ResultCacheMisses, STATGROUP_WriteToRenderTarget, );
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Result Cache Hit Rate %"), STAT_WriteToRenderTarget_ResultCacheHitRate, STATGROUP_WriteToRenderTarget, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Result Cache Memory"), STAT_WriteToRenderTarget_ResultCacheMemory, STATGROUP_WriteToRenderTarget, );
+
+// Pools
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pooled Textures Allocated"), STAT_WriteToRenderTarget_PoolTexturesAllocated, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pooled Textures Reused"), STAT_WriteToRenderTarget_PoolTexturesReused, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Render Target Registrations Created"), STAT_WriteToRenderTarget_PoolRegistrationsCreated, STATGROUP_WriteToRenderTarget, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Render Target Pool Memory"), STAT_WriteToRenderTarget_RenderTargetPoolMemory, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Resize Textures Created"), STAT_WriteToRenderTarget_TransientTexturesCreated, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Resize Textures Reused"), STAT_WriteToRenderTarget_TransientTexturesReused, STATGROUP_WriteToRenderTarget, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Texture Pool Memory"), STAT_WriteToRenderTarget_TexturePoolMemory, STATGROUP_WriteToRenderTarget, );
+
+// Output
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Transient Textures"), STAT_WriteToRenderTarget_TransientTextures, STATGROUP_WriteToRenderTarget, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Output MB Written"), STAT_WriteToRenderTarget_OutputMegabytes, STATGROUP_WriteToRenderTarget, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Upload MB"), STAT_WriteToRenderTarget_UploadMegabytes, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mip Levels Generated"), STAT_WriteToRenderTarget_MipLevelsGenerated, STATGROUP_WriteToRenderTarget, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Preview Dispatches"), STAT_WriteToRenderTarget_PreviewDispatches, STATGROUP_WriteToRenderTarget, );
+
+// GPU time of the kernel passes ("stat GPU"), shared by single and batched dispatches
+DECLARE_GPU_STAT_NAMED_EXTERN(WriteToRenderTarget, TEXT("WriteToRenderTarget"));
+
+// Readback
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Readbacks Completed"), STAT_WriteToRenderTarget_ReadbacksCompleted, STATGROUP_WriteToRenderTarget, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Readback MB"), STAT_WriteToRenderTarget_ReadbackMegabytes, STATGROUP_WriteToRenderTarget, );
@@ -0,0 +1,259 @@
+#include "WriteToRenderTarget/WriteToRenderTargetSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/Texture2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "HAL/PlatformTime.h"
+#include "RenderingThread.h"
+#include "WriteToRenderTarget/WriteToRenderTarget.h"
+#include "WriteToRenderTarget/WriteToRenderTargetCPU.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+
+UWriteToRenderTargetSubsystem* UWriteToRenderTargetSubsystem::Get()
+{
+    return GEngine ? GEngine->GetEngineSubsystem<UWriteToRenderTargetSubsystem>() : nullptr;
+}
+
+void UWriteToRenderTargetSubsystem::Deinitialize()
+{
+    Processors.Empty();
+    DefaultProcessor = FWriteToRenderTargetHandle();
+    Super::Deinitialize();
+}
+
+FWriteToRenderTargetHandle UWriteToRenderTargetSubsystem::CreateProcessor()
+{
+    FWriteToRenderTargetHandle Handle;
+    Handle.Id = NextProcessorId++;
+    Processors.Add(Handle.Id, NewObject<UWriteToRenderTarget>(this));
+    return Handle;
+}
+
+void UWriteToRenderTargetSubsystem::ReleaseProcessor(FWriteToRenderTargetHandle Handle)
+{
+    if (Handle == DefaultProcessor)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("ReleaseProcessor - The default processor cannot be released."));
+        return;
+    }
+
+    // Render commands already in flight are waited for by UWriteToRenderTarget::BeginDestroy
+    Processors.Remove(Handle.Id);
+}
+
+bool UWriteToRenderTargetSubsystem::IsValidProcessor(FWriteToRenderTargetHandle Handle) const
+{
+    return Processors.Contains(Handle.Id);
+}
+
+FWriteToRenderTargetHandle UWriteToRenderTargetSubsystem::GetDefaultProcessor()
+{
+    if (!IsValidProcessor(DefaultProcessor))
+    {
+        DefaultProcessor = CreateProcessor();
+    }
+    return DefaultProcessor;
+}
+
+TArray<FWriteToRenderTargetHandle> UWriteToRenderTargetSubsystem::GetProcessorHandles() const
+{
+    TArray<FWriteToRenderTargetHandle> Handles;
+    Handles.Reserve(Processors.Num());
+    for (const TPair<int32, TObjectPtr<UWriteToRenderTarget>>& Pair : Processors)
+    {
+        FWriteToRenderTargetHandle& Handle = Handles.AddDefaulted_GetRef();
+        Handle.Id = Pair.Key;
+    }
+    Handles.Sort([](const FWriteToRenderTargetHandle& A, const FWriteToRenderTargetHandle& B) { return A.Id < B.Id; });
+    return Handles;
+}
+
+void UWriteToRenderTargetSubsystem::SetEffectParams(FWriteToRenderTargetHandle Handle, const FWriteToRenderTargetEffectParams& Params)
+{
+    if (UWriteToRenderTarget* Processor = GetProcessor(Handle))
+    {
+        Processor->SetEffectParams(Params);
+    }
+}
+
+FWriteToRenderTargetEffectParams UWriteToRenderTargetSubsystem::GetEffectParams(FWriteToRenderTargetHandle Handle) const
+{
+    const UWriteToRenderTarget* Processor = GetProcessor(Handle);
+    return Processor ? Processor->GetEffectParams() : FWriteToRenderTargetEffectParams();
+}
+
+bool UWriteToRenderTargetSubsystem::Execute(FWriteToRenderTargetHandle Handle, UTexture2D* InputTexture, UTextureRenderTarget2D* RT)
+{
+    UWriteToRenderTarget* Processor = GetProcessor(Handle);
+    if (!Processor)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("Execute - Invalid processor handle %d."), Handle.Id);
+        return false;
+    }
+
+    if (!InputTexture || !RT)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("Invalid input texture or render target."));
+        return false;
+    }
+
+    UTexture2D* KernelInput = Processor->PrepareInput(InputTexture, FIntPoint(RT->SizeX, RT->SizeY), Processor->bResampleInKernel);
+    if (!KernelInput)
+    {
+        return false;
+    }
+
+    FWriteToRenderTargetDispatchParams Params(RT->SizeX, RT->SizeY, 1);
+    Params.RenderTarget = RT->GameThread_GetRenderTargetResource();
+    Params.RenderTargetObject = FObjectKey(RT);
+
+    // Initialize the shader resources before dispatching is necessary
+    // as the shader resources are not available on the render thread
+    Processor->Initialize(KernelInput, Params);
+
+    // Mark the processor dirty; the dispatch runs once on the next tick together with any other changes made this frame
+    Processor->RequestDispatch();
+    return true;
+}
+
+void UWriteToRenderTargetSubsystem::SetPriority(FWriteToRenderTargetHandle Handle, EWriteToRenderTargetPriority Priority)
+{
+    if (UWriteToRenderTarget* Processor = GetProcessor(Handle))
+    {
+        Processor->SetPriority(Priority);
+    }
+}
+
+bool UWriteToRenderTargetSubsystem::CancelDispatch(FWriteToRenderTargetHandle Handle)
+{
+    UWriteToRenderTarget* Processor = GetProcessor(Handle);
+    return Processor && Processor->CancelPendingDispatch();
+}
+
+UWriteToRenderTarget* UWriteToRenderTargetSubsystem::GetProcessor(FWriteToRenderTargetHandle Handle) const
+{
+    const TObjectPtr<UWriteToRenderTarget>* Processor = Processors.Find(Handle.Id);
+    return Processor ? Processor->Get() : nullptr;
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetStressProcessorsTest, "ShaderMod.WriteToRenderTarget.StressProcessors", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Runs many processors with different parameters in the same frame and checks that they do not interfere.
+ * Every processor gets its own input, render target and parameter set, and all dispatches are flushed together.
+ * On the CPU backend each output is compared with the CPU kernel run on that processor's parameters; with a GPU, each
+ * RDG output is compared with the same dispatch run alone on a separate processor.
+ */
+bool FWriteToRenderTargetStressProcessorsTest::RunTest(const FString& Parameters)
+{
+    constexpr int32 Count = 48;
+    constexpr int32 Size = 128;
+
+    UWriteToRenderTargetSubsystem* Subsystem = UWriteToRenderTargetSubsystem::Get();
+    if (!Subsystem)
+    {
+        AddInfo(TEXT("No WriteToRenderTarget subsystem, test skipped"));
+        return true;
+    }
+
+    // Whole-image dispatches, so CPU processors keep their output for the comparison
+    WriteToRenderTargetTest::FScopedConsoleVariable TiledVariable(TEXT("r.ShaderMod.Tiled"), 0);
+
+    TArray<EWriteToRenderTargetBackend> Backends = { EWriteToRenderTargetBackend::CPU };
+    if (WriteToRenderTargetTest::HasGPU(*this))
+    {
+        Backends.Add(EWriteToRenderTargetBackend::RDG);
+    }
+
+    for (const EWriteToRenderTargetBackend Backend : Backends)
+    {
+        const bool bCPU = Backend == EWriteToRenderTargetBackend::CPU;
+        const TCHAR* BackendName = bCPU ? TEXT("CPU") : TEXT("RDG");
+
+        TArray<FWriteToRenderTargetHandle> Handles;
+        TArray<UTexture2D*> Inputs;
+        TArray<UTextureRenderTarget2D*> RenderTargets;
+        TArray<TArray<FColor>> SourcePixels;
+        TArray<FWriteToRenderTargetEffectParams> ParamSets;
+        for (int32 Index = 0; Index < Count; ++Index)
+        {
+            const TArray<FColor>& Pixels = SourcePixels.Add_GetRef(WriteToRenderTargetTest::MakeNoise(FIntPoint(Size, Size), Index, true));
+            UTexture2D* Input = WriteToRenderTargetTest::CreateTexture(FIntPoint(Size, Size), Pixels);
+            // The CPU backend uploads into BGRA8 targets only
+            UTextureRenderTarget2D* RenderTarget = WriteToRenderTargetTest::CreateRenderTarget(FIntPoint(Size, Size), bCPU ? PF_B8G8R8A8 : PF_R8G8B8A8, !bCPU);
+
+            // Every processor gets a different parameter set
+            FWriteToRenderTargetEffectParams& Params = ParamSets.AddDefaulted_GetRef();
+            Params.bInvertColors = (Index & 1) != 0;
+            Params.bGreyscale = (Index & 2) != 0;
+            Params.Contrast = 0.5f + (Index % 5) * 0.25f;
+            Params.DistortionStrength = (Index % 3) * 0.02f;
+            Params.ImageScale = 0.75f + (Index % 4) * 0.25f;
+            Params.RotationAngle = Index * 15.0f;
+
+            const FWriteToRenderTargetHandle Handle = Subsystem->CreateProcessor();
+            Subsystem->GetProcessor(Handle)->SetBackend(Backend);
+            Subsystem->SetEffectParams(Handle, Params);
+            Subsystem->Execute(Handle, Input, RenderTarget);
+
+            Handles.Add(Handle);
+            Inputs.Add(Input);
+            RenderTargets.Add(RenderTarget);
+        }
+
+        // Issue every processor's dispatch in the same frame instead of waiting for the tick
+        const double StartTime = FPlatformTime::Seconds();
+        for (const FWriteToRenderTargetHandle& Handle : Handles)
+        {
+            Subsystem->GetProcessor(Handle)->FlushPendingDispatch();
+        }
+        FlushRenderingCommands();
+        AddInfo(FString::Printf(TEXT("%s: %d processors at %dx%d dispatched in %.2f ms"), BackendName, Count, Size, Size, (FPlatformTime::Seconds() - StartTime) * 1000.0));
+
+        TArray<FColor> Expected;
+        TArray<FColor> Actual;
+        UTextureRenderTarget2D* ReferenceTarget = bCPU ? nullptr : WriteToRenderTargetTest::CreateRenderTarget(FIntPoint(Size, Size), PF_R8G8B8A8, true);
+        for (int32 Index = 0; Index < Count; ++Index)
+        {
+            UWriteToRenderTarget* Processor = Subsystem->GetProcessor(Handles[Index]);
+            const FString What = FString::Printf(TEXT("%s processor %d of %d"), BackendName, Index, Count);
+            TestTrue(What + TEXT(" dispatched"), Processor->GetDispatchCounters().Issued > 0);
+
+            if (bCPU)
+            {
+                Expected.SetNumUninitialized(Size * Size);
+                FWriteToRenderTargetCPU::Execute(SourcePixels[Index].GetData(), Size, Size, Expected.GetData(), Size, Size, ParamSets[Index]);
+                WriteToRenderTargetTest::TestImagesEqual(*this, What, Expected, Processor->GetCPUOutput());
+            }
+            else
+            {
+                WriteToRenderTargetTest::FScopedProcessor Reference(Backend);
+                Reference.Execute(Inputs[Index], ReferenceTarget, ParamSets[Index]);
+                ReferenceTarget->GameThread_GetRenderTargetResource()->ReadPixels(Expected);
+                RenderTargets[Index]->GameThread_GetRenderTargetResource()->ReadPixels(Actual);
+                WriteToRenderTargetTest::TestImagesEqual(*this, What, Expected, Actual);
+            }
+        }
+
+        for (const FWriteToRenderTargetHandle& Handle : Handles)
+        {
+            Subsystem->ReleaseProcessor(Handle);
+        }
+        for (UTexture2D* Input : Inputs)
+        {
+            Input->MarkAsGarbage();
+        }
+        for (UTextureRenderTarget2D* RenderTarget : RenderTargets)
+        {
+            RenderTarget->MarkAsGarbage();
+        }
+        if (ReferenceTarget)
+        {
+            ReferenceTarget->MarkAsGarbage();
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/Texture2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "HAL/IConsoleManager.h"
+#include "RenderingThread.h"
+#include "RHI.h"
+#include "WriteToRenderTarget/WriteToRenderTarget.h"
+#include "WriteToRenderTarget/WriteToRenderTargetCPU.h"
+#include "WriteToRenderTarget/WriteToRenderTargetSubsystem.h"
+
+/*
+ * Shared pieces of the WriteToRenderTarget automation tests. The tests live next to the code they check, are named
+ * ShaderMod.WriteToRenderTarget.*, and run with "Automation RunTests ShaderMod" in the editor, in games and from the
+ * command line; checks that need a GPU are skipped with a note under the null RHI.
+ */
+#define WRITETORENDERTARGET_TEST_FLAGS (EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+namespace WriteToRenderTargetTest
+{
+    // Hash noise, so a single misaddressed texel shows up; Seed selects another pattern
+    inline TArray<FColor> MakeNoise(FIntPoint Size, uint32 Seed = 0, bool bOpaque = false)
+    {
+        TArray<FColor> Pixels;
+        Pixels.SetNumUninitialized(Size.X * Size.Y);
+        for (int32 Index = 0; Index < Pixels.Num(); ++Index)
+        {
+            const uint32 Hash = ((uint32)Index + Seed) * 2654435761u;
+            Pixels[Index] = FColor((uint8)Hash, (uint8)(Hash >> 8), (uint8)(Hash >> 16), bOpaque ? 255 : (uint8)(Hash >> 24));
+        }
+        return Pixels;
+    }
+
+    // Smooth content, for comparing paths that only differ in their reconstruction filter, which noise would exaggerate
+    inline TArray<FColor> MakeGradient(int32 Size)
+    {
+        TArray<FColor> Pixels;
+        Pixels.SetNumUninitialized(Size * Size);
+        for (int32 Y = 0; Y < Size; ++Y)
+        {
+            for (int32 X = 0; X < Size; ++X)
+            {
+                const float U = (float)X / Size;
+                const float V = (float)Y / Size;
+                Pixels[Y * Size + X] = FLinearColor(U, V, 0.5f + 0.5f * FMath::Sin(UE_TWO_PI * (U + V)), 1.0f).ToFColor(false);
+            }
+        }
+        return Pixels;
+    }
+
+    // Transient BGRA8 texture with Pixels in its top mip
+    inline UTexture2D* CreateTexture(FIntPoint Size, TConstArrayView<FColor> Pixels, bool bSRGB = true)
+    {
+        check(Pixels.Num() == Size.X * Size.Y);
+        UTexture2D* Texture = UTexture2D::CreateTransient(Size.X, Size.Y, PF_B8G8R8A8);
+        Texture->SRGB = bSRGB;
+        FByteBulkData& BulkData = Texture->GetPlatformData()->Mips[0].BulkData;
+        FMemory::Memcpy(BulkData.Lock(LOCK_READ_WRITE), Pixels.GetData(), Pixels.Num() * sizeof(FColor));
+        BulkData.Unlock();
+        Texture->UpdateResource();
+        return Texture;
+    }
+
+    // Linear render target; without bUAV every dispatch into it goes through a scratch texture and a copy
+    inline UTextureRenderTarget2D* CreateRenderTarget(FIntPoint Size, EPixelFormat Format, bool bUAV, bool bMips = false)
+    {
+        UTextureRenderTarget2D* RenderTarget = NewObject<UTextureRenderTarget2D>();
+        RenderTarget->bCanCreateUAV = bUAV;
+        RenderTarget->bAutoGenerateMips = bMips;
+        RenderTarget->InitCustomFormat(Size.X, Size.Y, Format, true);
+        RenderTarget->UpdateResourceImmediate(true);
+        return RenderTarget;
+    }
+
+    // False, with a note in the test's log, when the GPU half of a test cannot run
+    inline bool HasGPU(FAutomationTestBase& Test)
+    {
+        if (GUsingNullRHI || !UWriteToRenderTargetSubsystem::Get())
+        {
+            Test.AddInfo(TEXT("No RHI, GPU checks skipped"));
+            return false;
+        }
+        return true;
+    }
+
+    // Compares two BGRA8 images channel by channel and reports how far apart they are when they differ by more than MaxError
+    inline bool TestImagesEqual(FAutomationTestBase& Test, const FString& What, TConstArrayView<FColor> Expected, TConstArrayView<FColor> Actual, int32 MaxError = 0)
+    {
+        if (Expected.Num() != Actual.Num())
+        {
+            Test.AddError(FString::Printf(TEXT("%s: %d pixels, expected %d"), *What, Actual.Num(), Expected.Num()));
+            return false;
+        }
+        const FWriteToRenderTargetImageDiff Diff = FWriteToRenderTargetCPU::CompareImages(Expected.GetData(), Actual.GetData(), Expected.Num());
+        if (Diff.MaxError > MaxError)
+        {
+            Test.AddError(FString::Printf(TEXT("%s: max error %d (tolerance %d), %lld different pixels, mean error %.3f"),
+                *What, Diff.MaxError, MaxError, Diff.NumDifferentPixels, Diff.MeanError));
+            return false;
+        }
+        return true;
+    }
+
+    // Overrides a console variable for the lifetime of the scope and restores the previous value
+    class FScopedConsoleVariable
+    {
+    public:
+        FScopedConsoleVariable(const TCHAR* Name, int32 Value)
+            : Variable(IConsoleManager::Get().FindConsoleVariable(Name))
+        {
+            check(Variable);
+            Previous = Variable->GetString();
+            Set(Value);
+        }
+
+        ~FScopedConsoleVariable()
+        {
+            Variable->Set(*Previous, ECVF_SetByConsole);
+        }
+
+        UE_NONCOPYABLE(FScopedConsoleVariable);
+
+        void Set(int32 Value)
+        {
+            Variable->Set(Value, ECVF_SetByConsole);
+        }
+
+    private:
+        IConsoleVariable* Variable;
+        FString Previous;
+    };
+
+    // A processor of the subsystem, released at the end of the scope
+    struct FScopedProcessor
+    {
+        UWriteToRenderTargetSubsystem* Subsystem;
+        FWriteToRenderTargetHandle Handle;
+        UWriteToRenderTarget* Processor;
+
+        explicit FScopedProcessor(EWriteToRenderTargetBackend Backend)
+            : Subsystem(UWriteToRenderTargetSubsystem::Get())
+            , Handle(Subsystem->CreateProcessor())
+            , Processor(Subsystem->GetProcessor(Handle))
+        {
+            Processor->SetBackend(Backend);
+        }
+
+        ~FScopedProcessor()
+        {
+            Subsystem->ReleaseProcessor(Handle);
+        }
+
+        UE_NONCOPYABLE(FScopedProcessor);
+
+        // Runs one dispatch into RenderTarget now instead of on the next tick, and waits for the render thread
+        void Execute(UTexture2D* Input, UTextureRenderTarget2D* RenderTarget, const FWriteToRenderTargetEffectParams& Params)
+        {
+            Subsystem->SetEffectParams(Handle, Params);
+            Subsystem->Execute(Handle, Input, RenderTarget);
+            Processor->FlushPendingDispatch();
+            FlushRenderingCommands();
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,502 @@
+#include "WriteToRenderTarget/WriteToRenderTargetTiled.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+#include "ImageCoreUtils.h"
+#include "TextureResource.h"
+#include "WriteToRenderTarget/WriteToRenderTarget.h"
+#include "WriteToRenderTarget/WriteToRenderTargetCPU.h"
+#include "WriteToRenderTarget/WriteToRenderTargetPool.h"
+#include "WriteToRenderTarget/WriteToRenderTargetResampler.h"
+#include "WriteToRenderTarget/WriteToRenderTargetStats.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTest.h"
+
+DEFINE_STAT(STAT_WriteToRenderTarget_InputMegabytes);
+DEFINE_STAT(STAT_WriteToRenderTarget_InputMipsSkipped);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetTiled(
+    TEXT("r.ShaderMod.Tiled"),
+    2,
+    TEXT("Processes WriteToRenderTarget outputs in tiles to bound memory, with output identical to whole-image processing.\n")
+    TEXT(" 0: Off, the whole image at once\n")
+    TEXT(" 1: Always\n")
+    TEXT(" 2: Auto, when the render target is larger than r.ShaderMod.TileSize on either axis (default)"),
+    ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetTileSize(
+    TEXT("r.ShaderMod.TileSize"),
+    2048,
+    TEXT("Edge length in pixels of the output tiles of the tiled mode. The CPU backend splits tiles further to stay under r.ShaderMod.TileMemoryBudgetMB."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetTileMemoryBudgetMB(
+    TEXT("r.ShaderMod.TileMemoryBudgetMB"),
+    256,
+    TEXT("Memory the CPU backend may hold per tile in the tiled mode, in MB: the output tile plus the source region it samples."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarWriteToRenderTargetMipAwareInput(
+    TEXT("r.ShaderMod.MipAwareInput"),
+    1,
+    TEXT("Reads inputs on the CPU from their smallest mip that is still at least the size they are processed at, instead of the top mip.\n")
+    TEXT(" 0: Always the top mip\n")
+    TEXT(" 1: Smallest sufficient mip (default)"),
+    ECVF_Default);
+
+int32 FWriteToRenderTargetTiling::GetTileSize(FIntPoint Extent)
+{
+    const int32 Mode = CVarWriteToRenderTargetTiled.GetValueOnAnyThread();
+    const int32 TileSize = FMath::Max(CVarWriteToRenderTargetTileSize.GetValueOnAnyThread(), FWriteToRenderTargetCPU::TileSize);
+    const bool bTiled = Mode == 1 || (Mode == 2 && (Extent.X > TileSize || Extent.Y > TileSize));
+    return bTiled ? TileSize : 0;
+}
+
+int64 FWriteToRenderTargetTiling::GetMemoryBudget()
+{
+    return (int64)FMath::Max(CVarWriteToRenderTargetTileMemoryBudgetMB.GetValueOnAnyThread(), 1) * 1024 * 1024;
+}
+
+int32 FWriteToRenderTargetRowReader::SelectMip(FIntPoint TopSize, int32 NumMips, FIntPoint MinSize)
+{
+    if (MinSize.X <= 0 || MinSize.Y <= 0)
+    {
+        return 0;
+    }
+
+    int32 Mip = 0;
+    while (Mip + 1 < NumMips
+        && FMath::Max(TopSize.X >> (Mip + 1), 1) >= MinSize.X
+        && FMath::Max(TopSize.Y >> (Mip + 1), 1) >= MinSize.Y)
+    {
+        ++Mip;
+    }
+    return Mip;
+}
+
+FIntPoint FWriteToRenderTargetRowReader::GetMinInputSize(FIntPoint TargetSize, float ImageScale)
+{
+    // Same footprint as ComputeInputLod: a mip of this size is sampled at a LOD of 0 or above, so it never magnifies
+    const float Scale = FMath::Max(FMath::Abs(ImageScale), 1.0e-5f);
+    return FIntPoint(
+        FMath::Max(FMath::CeilToInt((float)TargetSize.X * Scale), 1),
+        FMath::Max(FMath::CeilToInt((float)TargetSize.Y * Scale), 1));
+}
+
+bool FWriteToRenderTargetRowReader::Open(UTexture2D* Texture, FIntPoint MinSize)
+{
+    Close();
+    if (!Texture)
+    {
+        return false;
+    }
+
+    if (CVarWriteToRenderTargetMipAwareInput.GetValueOnAnyThread() == 0)
+    {
+        MinSize = FIntPoint::ZeroValue;
+    }
+
+    // Platform data first: it is all a cooked build has, and transient textures created by ResizeTexture keep their mip in memory
+    if (!OpenPlatformMip(Texture, MinSize))
+    {
+#if WITH_EDITOR
+        FTextureSource& Source = Texture->Source;
+        if (!Source.IsValid())
+        {
+            return false;
+        }
+
+        const int32 SourceMip = SelectMip(FIntPoint(Source.GetSizeX(), Source.GetSizeY()), Source.GetNumMips(), MinSize);
+        const uint8* MipData = Source.LockMipReadOnly(0, 0, SourceMip);
+        if (!MipData)
+        {
+            return false;
+        }
+        View = FImageView(const_cast<uint8*>(MipData), FMath::Max(Source.GetSizeX() >> SourceMip, 1), FMath::Max(Source.GetSizeY() >> SourceMip, 1), 1,
+            FImageCoreUtils::ConvertToRawImageFormat(Source.GetFormat()), Source.GetGammaSpace(0));
+        MipIndex = SourceMip;
+        LockedSourceTexture = Texture;
+#else
+        return false;
+#endif
+    }
+
+    INC_FLOAT_STAT_BY(STAT_WriteToRenderTarget_InputMegabytes, (float)(View.GetImageSizeBytes() / (1024.0 * 1024.0)));
+    INC_DWORD_STAT_BY(STAT_WriteToRenderTarget_InputMipsSkipped, MipIndex);
+    return true;
+}
+
+bool FWriteToRenderTargetRowReader::OpenPlatformMip(UTexture2D* Texture, FIntPoint MinSize)
+{
+    FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+    if (!PlatformData || PlatformData->Mips.Num() == 0)
+    {
+        return false;
+    }
+
+    // Block compressed formats have no CPU decoder outside the editor; those inputs are read from their source data
+    bool bExactFormat = false;
+    const ERawImageFormat::Type Format = FImageCoreUtils::GetRawImageFormatForPixelFormat(PlatformData->PixelFormat, &bExactFormat);
+    if (!bExactFormat)
+    {
+        return false;
+    }
+
+    const FIntPoint TopSize(PlatformData->Mips[0].SizeX, PlatformData->Mips[0].SizeY);
+    const int32 Index = SelectMip(TopSize, PlatformData->Mips.Num(), MinSize);
+    FTexture2DMipMap& Mip = PlatformData->Mips[Index];
+    if (Mip.BulkData.GetBulkDataSize() < (int64)Mip.SizeX * Mip.SizeY * ERawImageFormat::GetBytesPerPixel(Format))
+    {
+        return false;
+    }
+
+    // A streamed mip that is not resident is loaded from disk on its own, without pulling in the mips above it
+    const void* MipData = nullptr;
+    if (Mip.BulkData.IsBulkDataLoaded())
+    {
+        MipData = Mip.BulkData.LockReadOnly();
+        LockedMip = &Mip;
+    }
+    else if (Mip.BulkData.CanLoadFromDisk())
+    {
+        Mip.BulkData.GetCopy(&LoadedMipData, false);
+        MipData = LoadedMipData;
+    }
+    if (!MipData)
+    {
+        Close();
+        return false;
+    }
+
+    const EGammaSpace GammaSpace = ERawImageFormat::GetFormatNeedsGammaSpace(Format) && Texture->SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+    View = FImageView(const_cast<void*>(MipData), Mip.SizeX, Mip.SizeY, 1, Format, GammaSpace);
+    MipIndex = Index;
+    return true;
+}
+
+void FWriteToRenderTargetRowReader::Close()
+{
+    if (LockedMip)
+    {
+        LockedMip->BulkData.Unlock();
+        LockedMip = nullptr;
+    }
+    if (LoadedMipData)
+    {
+        FMemory::Free(LoadedMipData);
+        LoadedMipData = nullptr;
+    }
+#if WITH_EDITOR
+    if (LockedSourceTexture)
+    {
+        LockedSourceTexture->Source.UnlockMip(0, 0, MipIndex);
+        LockedSourceTexture = nullptr;
+    }
+#endif
+    View = FImageView();
+    MipIndex = 0;
+}
+
+void FWriteToRenderTargetRowReader::ReadRow(int32 X, int32 Y, int32 Width, FColor* Dest) const
+{
+    check(X >= 0 && Y >= 0 && X + Width <= View.SizeX && Y < View.SizeY);
+    const int64 BytesPerPixel = View.GetBytesPerPixel();
+    const uint8* SourcePixels = static_cast<const uint8*>(View.RawData) + ((int64)Y * View.SizeX + X) * BytesPerPixel;
+    if (View.Format == ERawImageFormat::BGRA8)
+    {
+        FMemory::Memcpy(Dest, SourcePixels, Width * sizeof(FColor));
+        return;
+    }
+
+    // Same per-pixel conversion as FImage::CopyTo, applied to this span only
+    const FImageView SourceRow(const_cast<uint8*>(SourcePixels), Width, 1, 1, View.Format, View.GammaSpace);
+    FImageCore::CopyImage(SourceRow, FImageView(Dest, Width, 1, EGammaSpace::sRGB));
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetTiledTest, "ShaderMod.WriteToRenderTarget.Tiled", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks that the tiled mode is bit-identical to whole-image processing. The CPU kernel runs every effect combination
+ * on a non-square source, both at native size and into a smaller destination, with a memory budget small enough to force
+ * tile splits; the streamed resampler is compared with the in-memory one. With a GPU, the RDG path is also run whole and
+ * tiled into render targets with and without UAV and the two are read back and compared.
+ */
+bool FWriteToRenderTargetTiledTest::RunTest(const FString& Parameters)
+{
+    constexpr int32 Size = 1536;
+    constexpr int32 TileSize = 256;
+    const int64 MemoryBudget = (int64)TileSize * TileSize * sizeof(FColor) * 2;
+
+    struct FCase
+    {
+        const TCHAR* Name;
+        FWriteToRenderTargetEffectParams Params;
+    };
+    TArray<FCase> Cases;
+    auto AddCase = [&Cases](const TCHAR* Name, TFunctionRef<void(FWriteToRenderTargetEffectParams&)> Setup)
+    {
+        FCase& Case = Cases.Add_GetRef({ Name, FWriteToRenderTargetEffectParams() });
+        Case.Params.RotationAngle = 0.0f;
+        Setup(Case.Params);
+    };
+    AddCase(TEXT("Identity"), [](FWriteToRenderTargetEffectParams& Params) {});
+    AddCase(TEXT("Default rotation"), [](FWriteToRenderTargetEffectParams& Params) { Params = FWriteToRenderTargetEffectParams(); });
+    AddCase(TEXT("Rotate 30"), [](FWriteToRenderTargetEffectParams& Params) { Params.RotationAngle = 30.0f; });
+    AddCase(TEXT("Rotate 90"), [](FWriteToRenderTargetEffectParams& Params) { Params.RotationAngle = 90.0f; });
+    AddCase(TEXT("Scale 0.5"), [](FWriteToRenderTargetEffectParams& Params) { Params.ImageScale = 0.5f; });
+    AddCase(TEXT("Scale 2"), [](FWriteToRenderTargetEffectParams& Params) { Params.ImageScale = 2.0f; });
+    AddCase(TEXT("Mirrored"), [](FWriteToRenderTargetEffectParams& Params) { Params.ImageScale = -1.0f; });
+    AddCase(TEXT("Distortion"), [](FWriteToRenderTargetEffectParams& Params) { Params.DistortionStrength = 0.05f; });
+    AddCase(TEXT("Rotate distort color"), [](FWriteToRenderTargetEffectParams& Params)
+    {
+        Params.RotationAngle = 45.0f;
+        Params.DistortionStrength = 0.03f;
+        Params.ImageScale = 0.8f;
+        Params.Contrast = 1.3f;
+        Params.bGreyscale = true;
+    });
+
+    const FIntPoint SourceSize(Size, Size * 3 / 4 + 7);
+    const TArray<FColor> Source = WriteToRenderTargetTest::MakeNoise(SourceSize);
+    auto ReadSourceRow = [&Source, SourceSize](int32 X, int32 Y, int32 Width, FColor* Dest)
+    {
+        FMemory::Memcpy(Dest, &Source[Y * SourceSize.X + X], Width * sizeof(FColor));
+    };
+
+    const FIntPoint DestSizes[] = { SourceSize, FIntPoint(Size * 2 / 3 + 5, Size / 2) };
+    for (const FIntPoint& DestSize : DestSizes)
+    {
+        TArray<FColor> Expected;
+        Expected.SetNumUninitialized(DestSize.X * DestSize.Y);
+        TArray<FColor> Actual;
+        Actual.SetNumZeroed(DestSize.X * DestSize.Y);
+
+        for (const FCase& Case : Cases)
+        {
+            FWriteToRenderTargetCPU::Execute(Source.GetData(), SourceSize.X, SourceSize.Y, Expected.GetData(), DestSize.X, DestSize.Y, Case.Params);
+            FWriteToRenderTargetCPU::ExecuteTiled(
+                ReadSourceRow, SourceSize.X, SourceSize.Y, DestSize.X, DestSize.Y, Case.Params, TileSize, MemoryBudget,
+                [&Actual, DestSize](const FIntRect& Tile, const FColor* Pixels)
+                {
+                    for (int32 Row = 0; Row < Tile.Height(); ++Row)
+                    {
+                        FMemory::Memcpy(&Actual[(Tile.Min.Y + Row) * DestSize.X + Tile.Min.X], Pixels + Row * Tile.Width(), Tile.Width() * sizeof(FColor));
+                    }
+                });
+
+            WriteToRenderTargetTest::TestImagesEqual(*this,
+                FString::Printf(TEXT("CPU %dx%d -> %dx%d %s"), SourceSize.X, SourceSize.Y, DestSize.X, DestSize.Y, Case.Name), Expected, Actual);
+        }
+    }
+
+    // The streamed resampler reads rows on demand but has to produce the same pixels
+    for (int32 Filter = 0; Filter < 3; ++Filter)
+    {
+        const FIntPoint DestSize = DestSizes[1];
+        TArray<FColor> Expected;
+        Expected.SetNumUninitialized(DestSize.X * DestSize.Y);
+        TArray<FColor> Actual;
+        Actual.SetNumUninitialized(DestSize.X * DestSize.Y);
+        FWriteToRenderTargetResampler::Resample(Source.GetData(), SourceSize.X, SourceSize.Y, Expected.GetData(), DestSize.X, DestSize.Y, (EWriteToRenderTargetResampleFilter)Filter);
+        FWriteToRenderTargetResampler::Resample(ReadSourceRow, SourceSize.X, SourceSize.Y, Actual.GetData(), DestSize.X, DestSize.Y, (EWriteToRenderTargetResampleFilter)Filter);
+        WriteToRenderTargetTest::TestImagesEqual(*this, FString::Printf(TEXT("Resample %s streamed rows"), *UEnum::GetValueAsString((EWriteToRenderTargetResampleFilter)Filter)), Expected, Actual);
+    }
+
+    if (!WriteToRenderTargetTest::HasGPU(*this))
+    {
+        return true;
+    }
+
+    // Square, and not a multiple of the tile size, so the edge tiles are partial
+    const int32 TargetSize = Size + 37;
+    UTexture2D* Input = WriteToRenderTargetTest::CreateTexture(FIntPoint(TargetSize, TargetSize), WriteToRenderTargetTest::MakeNoise(FIntPoint(TargetSize, TargetSize), 0, true));
+
+    WriteToRenderTargetTest::FScopedConsoleVariable TiledVariable(TEXT("r.ShaderMod.Tiled"), 0);
+    WriteToRenderTargetTest::FScopedConsoleVariable TileSizeVariable(TEXT("r.ShaderMod.TileSize"), TileSize);
+    WriteToRenderTargetTest::FScopedProcessor Processor(EWriteToRenderTargetBackend::RDG);
+
+    // Renders one case whole (Tiled = 0) or tiled (Tiled = 1) and reads the result back
+    auto Render = [&](UTextureRenderTarget2D* RenderTarget, const FWriteToRenderTargetEffectParams& Params, int32 Tiled, TArray<FColor>& OutPixels)
+    {
+        TiledVariable.Set(Tiled);
+        Processor.Execute(Input, RenderTarget, Params);
+        RenderTarget->GameThread_GetRenderTargetResource()->ReadPixels(OutPixels);
+    };
+
+    for (const bool bUAV : { true, false })
+    {
+        // Separate targets, so a tiled dispatch that writes nothing cannot pass on the whole image's pixels
+        UTextureRenderTarget2D* RenderTargets[2];
+        for (UTextureRenderTarget2D*& RenderTarget : RenderTargets)
+        {
+            RenderTarget = WriteToRenderTargetTest::CreateRenderTarget(FIntPoint(TargetSize, TargetSize), PF_R8G8B8A8, bUAV);
+        }
+
+        TArray<FColor> Whole;
+        TArray<FColor> Tiled;
+        for (const FCase& Case : Cases)
+        {
+            Render(RenderTargets[0], Case.Params, 0, Whole);
+            Render(RenderTargets[1], Case.Params, 1, Tiled);
+            WriteToRenderTargetTest::TestImagesEqual(*this, FString::Printf(TEXT("RDG %dx%d %s write %s"),
+                TargetSize, TargetSize, bUAV ? TEXT("direct") : TEXT("copy"), Case.Name), Whole, Tiled);
+        }
+
+        for (UTextureRenderTarget2D* RenderTarget : RenderTargets)
+        {
+            RenderTarget->MarkAsGarbage();
+        }
+    }
+
+    Input->MarkAsGarbage();
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWriteToRenderTargetMipInputTest, "ShaderMod.WriteToRenderTarget.MipInput", WRITETORENDERTARGET_TEST_FLAGS)
+
+/*
+ * Checks the mip selection of the row reader. Builds a non-square transient texture with a full mip chain whose mips
+ * are told apart by their pixels, then checks which mip SelectMip picks for a range of sizes, that Open and
+ * ReadTexturePixels read exactly that mip, that r.ShaderMod.MipAwareInput 0 goes back to the top mip, and that
+ * ResizeTexture matches resampling the selected mip directly.
+ */
+bool FWriteToRenderTargetMipInputTest::RunTest(const FString& Parameters)
+{
+    constexpr int32 Size = 256;
+    const FIntPoint TopSize(Size, Size / 2);
+
+    // Pure selection, on the sizes of the texture below
+    struct FSelectCase
+    {
+        FIntPoint MinSize;
+        int32 NumMips;
+        int32 Expected;
+    };
+    const int32 NumMips = FMath::FloorLog2(Size) + 1;
+    const FSelectCase SelectCases[] =
+    {
+        { FIntPoint::ZeroValue, NumMips, 0 },
+        { TopSize, NumMips, 0 },
+        { TopSize * 2, NumMips, 0 },
+        { TopSize / 2, NumMips, 1 },
+        { FIntPoint(TopSize.X / 2 - 1, TopSize.Y / 2), NumMips, 1 },
+        { FIntPoint(TopSize.X / 2, TopSize.Y / 2 + 1), NumMips, 0 },
+        { FIntPoint(TopSize.X / 4, 1), NumMips, 2 },
+        { FIntPoint(1, 1), NumMips, NumMips - 1 },
+        { FIntPoint(1, 1), 1, 0 },
+    };
+    for (const FSelectCase& Case : SelectCases)
+    {
+        TestEqual(FString::Printf(TEXT("SelectMip %dx%d of %d mips for %dx%d"), TopSize.X, TopSize.Y, Case.NumMips, Case.MinSize.X, Case.MinSize.Y),
+            FWriteToRenderTargetRowReader::SelectMip(TopSize, Case.NumMips, Case.MinSize), Case.Expected);
+    }
+
+    TestEqual(TEXT("GetMinInputSize at scale 1"), FWriteToRenderTargetRowReader::GetMinInputSize(FIntPoint(100, 50), 1.0f), FIntPoint(100, 50));
+    TestEqual(TEXT("GetMinInputSize at scale 0.5"), FWriteToRenderTargetRowReader::GetMinInputSize(FIntPoint(100, 50), 0.5f), FIntPoint(50, 25));
+    TestEqual(TEXT("GetMinInputSize at scale -2"), FWriteToRenderTargetRowReader::GetMinInputSize(FIntPoint(100, 50), -2.0f), FIntPoint(200, 100));
+    TestEqual(TEXT("GetMinInputSize at scale 0"), FWriteToRenderTargetRowReader::GetMinInputSize(FIntPoint(100, 50), 0.0f), FIntPoint(1, 1));
+
+    // Every mip gets its own noise, with the mip index in blue so a wrong mip cannot pass by accident
+    UTexture2D* Texture = UTexture2D::CreateTransient(TopSize.X, TopSize.Y, PF_B8G8R8A8);
+    FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+    TArray<TArray<FColor>> MipPixels;
+    for (int32 Mip = 0; Mip < NumMips; ++Mip)
+    {
+        const FIntPoint MipSize(FMath::Max(TopSize.X >> Mip, 1), FMath::Max(TopSize.Y >> Mip, 1));
+        TArray<FColor>& Pixels = MipPixels.Add_GetRef(WriteToRenderTargetTest::MakeNoise(MipSize, Mip * 7919, true));
+        for (FColor& Pixel : Pixels)
+        {
+            Pixel.B = (uint8)Mip;
+        }
+
+        if (Mip > 0)
+        {
+            FTexture2DMipMap* MipMap = new FTexture2DMipMap();
+            MipMap->SizeX = MipSize.X;
+            MipMap->SizeY = MipSize.Y;
+            MipMap->SizeZ = 1;
+            PlatformData->Mips.Add(MipMap);
+        }
+        FByteBulkData& BulkData = PlatformData->Mips[Mip].BulkData;
+        BulkData.Lock(LOCK_READ_WRITE);
+        FMemory::Memcpy(BulkData.Realloc(Pixels.Num() * sizeof(FColor)), Pixels.GetData(), Pixels.Num() * sizeof(FColor));
+        BulkData.Unlock();
+    }
+    Texture->UpdateResource();
+
+    auto TestMip = [this, &MipPixels](const FString& What, const FColor* Pixels, FIntPoint PixelsSize, int32 Mip)
+    {
+        WriteToRenderTargetTest::TestImagesEqual(*this, What, MipPixels[Mip], TConstArrayView<FColor>(Pixels, PixelsSize.X * PixelsSize.Y));
+    };
+
+    // The reader and ReadTexturePixels open the mip SelectMip picks and see exactly its pixels
+    for (const FSelectCase& Case : SelectCases)
+    {
+        if (Case.NumMips != NumMips)
+        {
+            continue;
+        }
+        const FString What = FString::Printf(TEXT("Read for %dx%d"), Case.MinSize.X, Case.MinSize.Y);
+
+        FWriteToRenderTargetRowReader Reader;
+        if (TestTrue(What + TEXT(" opens"), Reader.Open(Texture, Case.MinSize)))
+        {
+            const FIntPoint ReaderSize = Reader.GetSize();
+            TArray<FColor> RowPixels;
+            RowPixels.SetNumUninitialized(ReaderSize.X * ReaderSize.Y);
+            for (int32 Y = 0; Y < ReaderSize.Y; ++Y)
+            {
+                Reader.ReadRow(0, Y, ReaderSize.X, RowPixels.GetData() + Y * ReaderSize.X);
+            }
+            TestEqual(What + TEXT(" mip"), Reader.GetMipIndex(), Case.Expected);
+            TestMip(What + TEXT(" through the row reader"), RowPixels.GetData(), ReaderSize, Case.Expected);
+            Reader.Close();
+        }
+
+        FImage Image;
+        if (TestTrue(What + TEXT(" with ReadTexturePixels"), FWriteToRenderTargetCPU::ReadTexturePixels(Texture, Image, Case.MinSize)))
+        {
+            TestMip(What + TEXT(" through ReadTexturePixels"), reinterpret_cast<const FColor*>(Image.RawData.GetData()), FIntPoint(Image.SizeX, Image.SizeY), Case.Expected);
+        }
+    }
+
+    // Switched off, every read goes back to the top mip
+    {
+        WriteToRenderTargetTest::FScopedConsoleVariable MipAwareInput(TEXT("r.ShaderMod.MipAwareInput"), 0);
+        FWriteToRenderTargetRowReader Reader;
+        if (TestTrue(TEXT("Open without mip aware input"), Reader.Open(Texture, FIntPoint(1, 1))))
+        {
+            TestEqual(TEXT("r.ShaderMod.MipAwareInput 0 reads the top mip"), Reader.GetMipIndex(), 0);
+            TestEqual(TEXT("r.ShaderMod.MipAwareInput 0 reads the top mip size"), Reader.GetSize(), TopSize);
+            Reader.Close();
+        }
+    }
+
+    // ResizeTexture resamples from the selected mip: just above a mip's size, so the mip above it is the one read
+    {
+        const FIntPoint TargetSize(TopSize.X / 4 - 3, TopSize.Y / 4 - 1);
+        const int32 ExpectedMip = FWriteToRenderTargetRowReader::SelectMip(TopSize, NumMips, TargetSize);
+        const FIntPoint MipSize(FMath::Max(TopSize.X >> ExpectedMip, 1), FMath::Max(TopSize.Y >> ExpectedMip, 1));
+
+        UWriteToRenderTarget* Processor = NewObject<UWriteToRenderTarget>();
+        TArray<FColor> Expected;
+        Expected.SetNumUninitialized(TargetSize.X * TargetSize.Y);
+        FWriteToRenderTargetResampler::Resample(MipPixels[ExpectedMip].GetData(), MipSize.X, MipSize.Y, Expected.GetData(), TargetSize.X, TargetSize.Y, Processor->ResampleFilter);
+
+        UTexture2D* Resized = Processor->ResizeTexture(Texture, TargetSize.X, TargetSize.Y);
+        if (TestNotNull(TEXT("ResizeTexture"), Resized))
+        {
+            FByteBulkData& BulkData = Resized->GetPlatformData()->Mips[0].BulkData;
+            WriteToRenderTargetTest::TestImagesEqual(*this, FString::Printf(TEXT("ResizeTexture to %dx%d from mip %d"), TargetSize.X, TargetSize.Y, ExpectedMip),
+                Expected, TConstArrayView<FColor>(static_cast<const FColor*>(BulkData.LockReadOnly()), Expected.Num()));
+            BulkData.Unlock();
+            FWriteToRenderTargetTexturePool::Get().Release(Resized);
+        }
+        Processor->MarkAsGarbage();
+    }
+
+    Texture->MarkAsGarbage();
+    return true;
+}
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageCore.h"
+
+class UTexture2D;
+struct FTexture2DMipMap;
+
+/*
+ * Settings of the tiled mode, which processes large render targets in tiles under a memory ceiling
+ * (r.ShaderMod.Tiled, r.ShaderMod.TileSize, r.ShaderMod.TileMemoryBudgetMB).
+ */
+struct FWriteToRenderTargetTiling
+{
+    // Edge length of the output tiles when an Extent sized output should be tiled, 0 to process it at once
+    static int32 GetTileSize(FIntPoint Extent);
+
+    // Bytes the CPU backend may hold per tile: the output pixels plus the source region they sample
+    static int64 GetMemoryBudget();
+};
+
+/*
+ * Row access to one mip of a texture as BGRA8 without copying the whole image: the mip stays locked in its stored
+ * format and ReadRow converts only the requested pixels. Open reads the smallest mip that is still at least MinSize on
+ * both axes (the top mip when MinSize is zero or r.ShaderMod.MipAwareInput is 0), so a large input processed into a
+ * small target never touches its top mips. Uses the platform data when its format is uncompressed, loading the mip from
+ * disk when it is not resident (streamed mips in cooked builds), and the editor source data otherwise.
+ * ReadTexturePixels reads through this class, so both see the same pixels. ReadRow may be called from several threads at once.
+ */
+class FWriteToRenderTargetRowReader
+{
+public:
+    FWriteToRenderTargetRowReader() = default;
+    ~FWriteToRenderTargetRowReader() { Close(); }
+    UE_NONCOPYABLE(FWriteToRenderTargetRowReader);
+
+    bool Open(UTexture2D* Texture, FIntPoint MinSize = FIntPoint::ZeroValue);
+    void Close();
+
+    FIntPoint GetSize() const { return FIntPoint(View.SizeX, View.SizeY); }
+
+    // Mip of the texture that was opened, 0 = top
+    int32 GetMipIndex() const { return MipIndex; }
+
+    // Converts Width pixels of row Y starting at column X to BGRA8
+    void ReadRow(int32 X, int32 Y, int32 Width, FColor* Dest) const;
+
+    // Index of the smallest of NumMips mips halving from TopSize that is at least MinSize on both axes
+    static int32 SelectMip(FIntPoint TopSize, int32 NumMips, FIntPoint MinSize);
+
+    // Smallest input mip that still has a texel per output pixel when a TargetSize output samples it at ImageScale
+    static FIntPoint GetMinInputSize(FIntPoint TargetSize, float ImageScale);
+
+private:
+    bool OpenPlatformMip(UTexture2D* Texture, FIntPoint MinSize);
+
+    FImageView View;
+    int32 MipIndex = 0;
+    FTexture2DMipMap* LockedMip = nullptr;
+    void* LoadedMipData = nullptr;
+    UTexture2D* LockedSourceTexture = nullptr;
+};
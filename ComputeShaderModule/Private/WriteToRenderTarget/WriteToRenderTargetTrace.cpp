@@ -0,0 +1,50 @@
+#include "WriteToRenderTarget/WriteToRenderTargetTrace.h"
+#include "HAL/PlatformTime.h"
+#include "Trace/Trace.inl"
+
+UE_TRACE_CHANNEL_DEFINE(ShaderModChannel)
+
+UE_TRACE_EVENT_BEGIN(ShaderMod, Dispatch)
+    UE_TRACE_EVENT_FIELD(uint64, Cycle)
+    UE_TRACE_EVENT_FIELD(uint32, Width)
+    UE_TRACE_EVENT_FIELD(uint32, Height)
+    UE_TRACE_EVENT_FIELD(uint32, ParamHash)
+    UE_TRACE_EVENT_FIELD(uint8, Backend)
+    UE_TRACE_EVENT_FIELD(uint8, Permutation)
+    UE_TRACE_EVENT_FIELD(bool, Batched)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ShaderMod, DispatchSkipped)
+    UE_TRACE_EVENT_FIELD(uint64, Cycle)
+    UE_TRACE_EVENT_FIELD(uint64, Serial)
+    UE_TRACE_EVENT_FIELD(uint8, Reason)
+UE_TRACE_EVENT_END()
+
+namespace WriteToRenderTargetTrace
+{
+    void Dispatch(FIntPoint Size, const FWriteToRenderTargetEffectParams& Params, EWriteToRenderTargetBackend Backend, int32 PermutationIndex, bool bBatched)
+    {
+        // Hashing the effect stack is not free, skip it when nobody is tracing
+        if (!UE_TRACE_CHANNELEXPR_IS_ENABLED(ShaderModChannel))
+        {
+            return;
+        }
+
+        UE_TRACE_LOG(ShaderMod, Dispatch, ShaderModChannel)
+            << Dispatch.Cycle(FPlatformTime::Cycles64())
+            << Dispatch.Width((uint32)Size.X)
+            << Dispatch.Height((uint32)Size.Y)
+            << Dispatch.ParamHash(GetTypeHash(Params))
+            << Dispatch.Backend((uint8)Backend)
+            << Dispatch.Permutation((uint8)PermutationIndex)
+            << Dispatch.Batched(bBatched);
+    }
+
+    void DispatchSkipped(ESkipReason Reason, uint64 Serial)
+    {
+        UE_TRACE_LOG(ShaderMod, DispatchSkipped, ShaderModChannel)
+            << DispatchSkipped.Cycle(FPlatformTime::Cycles64())
+            << DispatchSkipped.Serial(Serial)
+            << DispatchSkipped.Reason((uint8)Reason);
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
+
+/*
+ * Unreal Insights channel of the WriteToRenderTarget processing path, enabled with -trace=cpu,ShaderMod.
+ * The phases of a dispatch show up as CPU timing scopes on the channel; each dispatch and each skipped dispatch
+ * additionally logs an event carrying the resolution and the parameter hash, so slider drags can be told apart in a trace.
+ */
+UE_TRACE_CHANNEL_EXTERN(ShaderModChannel)
+
+// Timing scope on the ShaderMod channel
+#define WRITETORENDERTARGET_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, ShaderModChannel)
+
+namespace WriteToRenderTargetTrace
+{
+    enum class ESkipReason : uint8
+    {
+        Coalesced,  // Merged into a dispatch that was already pending on the game thread
+        Dropped     // Overtaken on the render thread by a newer dispatch
+    };
+
+    // A dispatch recorded for a render target of Size with Params; PermutationIndex is FWriteToRenderTargetPermutation::GetIndex
+    void Dispatch(FIntPoint Size, const FWriteToRenderTargetEffectParams& Params, EWriteToRenderTargetBackend Backend, int32 PermutationIndex, bool bBatched);
+
+    // Serial is a dispatch snapshot serial: the one overtaken when Dropped, the newest one issued before the pending dispatch when Coalesced
+    void DispatchSkipped(ESkipReason Reason, uint64 Serial);
+}
@@ -3,12 +3,19 @@
 #include "CoreMinimal.h"
 #include "GlobalShader.h"
 #include "RHICommandList.h"
+#include "RenderCommandFence.h"
 #include "ShaderParameterMacros.h"
+#include "Tickable.h"
+#include "UObject/ObjectKey.h"
+#include "WriteToRenderTarget/WriteToRenderTargetReadback.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
+#include <atomic>
 #include "WriteToRenderTarget.generated.h"
 
-#define NUM_THREADS_WriteToRenderTarget_X 32
-#define NUM_THREADS_WriteToRenderTarget_Y 32
-#define NUM_THREADS_WriteToRenderTarget_Z 1
+class FRenderTarget;
+class FTextureResource;
+class FWriteToRenderTargetRowReader;
+struct FWriteToRenderTargetRenderState;
 
 /*
  * FWriteToRenderTargetDispatchParams defines the dimensions (X, Y, Z) for the shader execution and holds a reference to the render target.
@@ -21,6 +28,12 @@ struct COMPUTESHADERMODULE_API FWriteToRenderTargetDispatchParams
     int Z; 
     FRenderTarget* RenderTarget;
 
+    // The UTextureRenderTarget2D owning RenderTarget; keys the result cache, where a resource address could be reused
+    FObjectKey RenderTargetObject;
+
+    // Fraction of X and Y the kernel shades; below 1 the result is upsampled over the render target (UWriteToRenderTarget::SetPreviewScale)
+    float PreviewScale = 1.0f;
+
     // Default constructor is required for the ENQUEUE_RENDER_COMMAND macro, otherwise it will not compile
     FWriteToRenderTargetDispatchParams()
         : X(0), Y(0), Z(0), RenderTarget(nullptr) {}
@@ -28,67 +41,296 @@ struct COMPUTESHADERMODULE_API FWriteToRenderTargetDispatchParams
     // Constructor to initialize the dispatch parameters
     FWriteToRenderTargetDispatchParams(int x, int y, int z)
         : X(x), Y(y), Z(z), RenderTarget(nullptr) {}
+
+    // Size the kernel runs at: X x Y, or the reduced preview size when PreviewScale is below 1
+    FIntPoint GetShadedExtent() const
+    {
+        if (PreviewScale >= 1.0f)
+        {
+            return FIntPoint(X, Y);
+        }
+        return FIntPoint(FMath::Max(FMath::RoundToInt(X * PreviewScale), 1), FMath::Max(FMath::RoundToInt(Y * PreviewScale), 1));
+    }
+
+    bool IsPreview() const { return GetShadedExtent() != FIntPoint(X, Y); }
+};
+
+/*
+ * FWriteToRenderTargetOutputTarget describes how a dispatch writes into a given render target:
+ * which kernel output conversion to use and whether the kernel can write the target's UAV directly
+ * or has to go through a scratch texture and a copy.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetOutputTarget
+{
+    EWriteToRenderTargetOutputFormat Format = EWriteToRenderTargetOutputFormat::Unsupported;
+    bool bDirectWrite = false;
+
+    static FWriteToRenderTargetOutputTarget Select(EPixelFormat Format, ETextureCreateFlags Flags);
+
+    // Value of the OUTPUT_FORMAT shader permutation: 0 = UNORM RGBA, 1 = float RGBA, 2 = UNORM single channel
+    int32 GetShaderOutputFormat() const;
+};
+
+/*
+ * One item of a batch dispatch as seen by the render thread. The input resource is bound as it is,
+ * so it has to be resized beforehand unless EffectParams.bResampleInKernel is set.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetBatchRenderItem
+{
+    FTextureResource* Input = nullptr;
+    FRenderTarget* RenderTarget = nullptr;
+    FWriteToRenderTargetEffectParams EffectParams;
 };
 
 UCLASS()
-class COMPUTESHADERMODULE_API UWriteToRenderTarget : public UObject
+class COMPUTESHADERMODULE_API UWriteToRenderTarget : public UObject, public FTickableGameObject
 {
     GENERATED_BODY()
 
 public:
+    // Runs with the effect parameters of the newest published dispatch: the member values belong to the game thread
     void DispatchRenderThread(
         FRHICommandListImmediate& RHICmdList,
         UTexture2D* InputTexture,
         FWriteToRenderTargetDispatchParams Params
     );
 
+    // Same as above, but runs with an explicit parameter snapshot instead of the current member values; touches no member
+    static void DispatchRenderThread(
+        FRHICommandListImmediate& RHICmdList,
+        UTexture2D* InputTexture,
+        FWriteToRenderTargetDispatchParams Params,
+        const FWriteToRenderTargetEffectParams& EffectParams
+    );
+
     void DispatchGameThread(
         UTexture2D* InputTexture,
         FWriteToRenderTargetDispatchParams Params
     );
 
+    /*
+     * Records every item into a single render graph, looking each shader permutation up once.
+     * Items whose input already has the render target size are packed into texture arrays and processed by one
+     * dispatch per group when enough of them share size, formats and permutation (r.ShaderMod.BatchPacking).
+     * Batches always run on the RDG backend.
+     */
+    static void DispatchBatchRenderThread(
+        FRHICommandListImmediate& RHICmdList,
+        TConstArrayView<FWriteToRenderTargetBatchRenderItem> Items
+    );
+
+    static void DispatchBatchGameThread(
+        TArray<FWriteToRenderTargetBatchRenderItem> Items
+    );
+
     void Dispatch(
         UTexture2D* InputTexture,
         FWriteToRenderTargetDispatchParams Params
     );
 
+    /*
+     * Runs the CPU reference kernel on the game thread and uploads the result to the render target when a GPU is present.
+     * Under NullRHI the result is only kept in the CPU output buffer.
+     */
+    void DispatchCPU(
+        UTexture2D* InputTexture,
+        FWriteToRenderTargetDispatchParams Params
+    );
+
     /*
      * Initializes the shader parameters and stores them for use in subsequent shader dispatches.
      * This function is critical for setting up the shader environment with the correct input texture and render target.
      */
-    void Initialize(FRHICommandListImmediate& RHICmdList, UTexture2D* InputTexture,
-                    FWriteToRenderTargetDispatchParams Params);
+    void Initialize(UTexture2D* InputTexture, FWriteToRenderTargetDispatchParams Params);
 
 	// Color change
     void SetInvertColors(bool bInvert);
     void SetGreyscale(bool bGrey);
     void SetContrast(float Contrast);
+    void SetAutoContrast(EWriteToRenderTargetAutoContrast InAutoContrast, float InClipPercent = 0.5f);
     // Deformation
     void SetDistortionStrength(float Distortion);
     void SetImageScale(float Scale);
     void SetRotationAngle(float Angle);
+    // Input
+    void SetResampleInKernel(bool bInKernel);
+    // Output
+    void SetGenerateMips(bool bInGenerateMips);
+    // Effects (an empty stack falls back to the individual parameters above)
+    void SetEffectStack(const TArray<FWriteToRenderTargetEffect>& InEffectStack);
+    // All effect parameters at once
+    void SetEffectParams(const FWriteToRenderTargetEffectParams& InEffectParams);
+    // Backend
+    void SetBackend(EWriteToRenderTargetBackend InBackend);
+    // Scheduling (see FWriteToRenderTargetScheduler); a pending dispatch keeps its place in the queue
+    void SetPriority(EWriteToRenderTargetPriority InPriority);
+
+    /*
+     * Interactive preview: below 1 the following dispatches shade Scale x the render target size and stretch the result
+     * over it with bilinear filtering, so dragging a parameter on a very large target stays responsive.
+     * Setting it back to 1 requests the full resolution dispatch that refines the preview.
+     */
+    void SetPreviewScale(float Scale);
 
     /*
-     * Resizes the input texture to the specified dimensions.
-     * This function ensures that the input texture has the correct dimensions for processing
+     * Presets (see FWriteToRenderTargetResultCache): SavePreset keeps the current effect parameters under Name, and the
+     * results rendered with them stay cached in preference to any other. ApplyPreset switches back to them, which
+     * normally only copies the cached result. Returns false when there is no preset of that name.
+     */
+    void SavePreset(FName Name);
+    bool ApplyPreset(FName Name);
+
+    /*
+     * Returns the backend that will actually run the next dispatch.
+     * An explicit backend on the instance wins, then r.ShaderMod.Backend, then Auto picks the CPU backend under NullRHI.
+     */
+    EWriteToRenderTargetBackend ResolveBackend() const;
+
+    // Returns a copy of the current shader parameters
+    FWriteToRenderTargetEffectParams GetEffectParams() const;
+
+    /*
+     * GetEffectParams with the histogram driven operations resolved for InputTexture (see FWriteToRenderTargetHistogramCache).
+     * While the histogram is still being computed on the GPU, or off the game thread, they stay the identity;
+     * the cache requests another dispatch once the histogram is available.
+     * On the RDG backend an input that is not TargetSize is resampled in the kernel: PrepareInput only hands one over
+     * when it could not resize it. The CPU backend keeps bResampleInKernel as set.
+     */
+    FWriteToRenderTargetEffectParams GetDispatchEffectParams(UTexture2D* InputTexture, FIntPoint TargetSize);
+
+    // The pixels written by the last CPU backend dispatch (BGRA8, render target size), empty after a tiled dispatch uploaded to a GPU
+    const TArray<FColor>& GetCPUOutput() const { return CPUOutput; }
+    FIntPoint GetCPUOutputSize() const { return CPUOutputSize; }
+
+    /*
+     * Resizes the input texture to the specified dimensions using ResampleFilter, reading the smallest mip of the
+     * input that is at least that size. This function ensures that the input texture has the correct dimensions for processing
      */
     UTexture2D* ResizeTexture(UTexture2D* SourceTexture, int32 TargetWidth, int32 TargetHeight);
 
+    /*
+     * Returns the texture the kernel reads for InputTexture at TargetSize: the input itself when the sizes match or
+     * bInKernel is set, otherwise a resized copy from the resize cache (created with ResizeTexture on a miss).
+     * With bInKernel, a streamed input is asked to stream in the mip the kernel will sample. On the RDG backend, an input
+     * whose pixels cannot be read on the CPU (block compressed in a cooked build) falls back to the kernel resampling it.
+     */
+    UTexture2D* PrepareInput(UTexture2D* InputTexture, FIntPoint TargetSize, bool bInKernel);
+
     void EnqueueShaderExecution();
 
+    /*
+     * Marks the parameters as changed. The actual dispatch is deferred to the next tick so that any number of
+     * parameter changes within a frame result in a single dispatch using the latest values.
+     */
+    void RequestDispatch();
+
+    // Issues the pending dispatch right away instead of waiting for the next tick (e.g. from commandlets that do not tick)
+    void FlushPendingDispatch();
+
+    bool HasPendingDispatch() const { return bDispatchPending; }
+
+    // Drops the pending dispatch before it is issued, queued in the scheduler or not. Returns false when none was pending.
+    bool CancelPendingDispatch();
+
+    /*
+     * Copies the render target back to the CPU without blocking: the copy goes into a staging buffer of a small ring
+     * (r.ShaderMod.ReadbackRingSize) and Callback runs on the game thread once the GPU has finished it, a few frames later.
+     * The pixels are written into CallerBuffer when it is given (it has to stay valid until the callback ran).
+     * A pending dispatch is issued first so the readback sees the latest parameters.
+     * Returns false without calling Callback when no render target is bound or the ring is full.
+     */
+    bool RequestReadback(FWriteToRenderTargetReadbackCallback Callback, TArrayView<uint8> CallerBuffer = TArrayView<uint8>());
+
+    int32 GetNumReadbacksInFlight() const { return ReadbacksInFlight; }
+
+    // Returns how many dispatches were requested, issued, coalesced on the game thread and dropped on the render thread
+    FWriteToRenderTargetDispatchCounters GetDispatchCounters() const;
+    void ResetDispatchCounters();
+
+    // FTickableGameObject
+    virtual void Tick(float DeltaTime) override;
+    virtual ETickableTickType GetTickableTickType() const override;
+    virtual bool IsTickable() const override { return (bDispatchPending && ScheduledJobId == 0) || ReadbacksInFlight > 0; }
+    virtual bool IsTickableInEditor() const override { return true; }
+    virtual bool IsTickableWhenPaused() const override { return true; }
+    virtual TStatId GetStatId() const override;
+
+    // UObject
+    virtual void BeginDestroy() override;
+    virtual bool IsReadyForFinishDestroy() override;
+
     // Shader parameters for image processing, initialized with default values
 	// Color change
 	uint32 bInvertColors = 0;         // Whether to invert colors (0 = false, 1 = true)
     uint32 bGreyscale = 0;            // Whether to convert to grayscale (0 = false, 1 = true)
     float Contrast = 1.0f;            
+    EWriteToRenderTargetAutoContrast AutoContrast = EWriteToRenderTargetAutoContrast::Off;  // Contrast or levels from the input's luminance histogram
+    float AutoContrastClipPercent = 0.5f;   // Percent of the pixels ignored at each end of the histogram
 	// Deformation
     float DistortionStrength = 0.0f;  
     float ImageScale = 1.0f;          // Scaling factor for the image (1.0 = 100%)
     float RotationAngle = 90.0f;      // Rotation angle in degrees (default 90 degrees)
+
+    // Input
+    bool bResampleInKernel = false;   // Sample mismatched inputs at native size in the kernel instead of calling ResizeTexture
+
+    // Output
+    bool bGenerateMips = false;       // Rebuild the render target's lower mips after each dispatch
+
+    // Effects
+    TArray<FWriteToRenderTargetEffect> EffectStack;   // Ordered effect stack, folded into one pass per dispatch
+
+    // Filter used by ResizeTexture
+    EWriteToRenderTargetResampleFilter ResampleFilter = EWriteToRenderTargetResampleFilter::Box;
+
+    // Backend used to execute the kernel (Auto follows r.ShaderMod.Backend and the active RHI)
+    EWriteToRenderTargetBackend Backend = EWriteToRenderTargetBackend::Auto;
+
+    // Place of this processor's dispatches in the scheduler queue (r.ShaderMod.Scheduler)
+    EWriteToRenderTargetPriority Priority = EWriteToRenderTargetPriority::Normal;
+
+    // Fraction of the render target size shaded by the next dispatches, 1 = full resolution (see SetPreviewScale)
+    float PreviewScale = 1.0f;
     
 private:
     UPROPERTY()
     UTexture2D* StoredInputTexture;  
-    FRHICommandListImmediate* StoredRHICmdList;  
     FWriteToRenderTargetDispatchParams StoredParams;  
+
+    // Tiled DispatchCPU: shades TileSize tiles from SourceReader and uploads each one, see r.ShaderMod.Tiled
+    void DispatchCPUTiled(const FWriteToRenderTargetRowReader& SourceReader, const FWriteToRenderTargetDispatchParams& Params, const FWriteToRenderTargetEffectParams& EffectParams, int32 TileSize);
+
+    // Uploads CPUOutput into the render target on the render thread, with its lower mips when bGenerateMips is set
+    void UploadCPUOutput(FRenderTarget* RenderTarget, bool bGenerateMips);
+
+    // Output of the CPU backend
+    TArray<FColor> CPUOutput;
+    FIntPoint CPUOutputSize = FIntPoint::ZeroValue;
+
+    // Dirty state: set by the setters, consumed once per tick or by the scheduler
+    bool bDispatchPending = false;
+
+    // Queues the pending dispatch in the scheduler, or updates its queued job
+    void ScheduleDispatch();
+
+    // Scheduler job of the pending dispatch, 0 when it is issued from Tick instead
+    uint64 ScheduledJobId = 0;
+
+    // Serial of the most recently published parameter snapshot
+    uint64 LatestDispatchSerial = 0;
+
+    // Parameter snapshots handed to the render thread and the render commands' own state, created by Initialize.
+    // The render commands hold it instead of this instance (see FWriteToRenderTargetRenderState).
+    TSharedPtr<FWriteToRenderTargetRenderState, ESPMode::ThreadSafe> RenderState;
+
+    uint64 DispatchesRequested = 0;
+    uint64 DispatchesIssued = 0;
+    uint64 DispatchesCoalesced = 0;
+
+    // Staging buffers of RequestReadback, created on first use. Shared with the render commands that use them.
+    TSharedPtr<FWriteToRenderTargetReadbackRing, ESPMode::ThreadSafe> ReadbackRing;
+    int32 ReadbacksInFlight = 0;
+
+    // Waits for render commands that still reference this instance (DispatchGameThread) before it is destroyed
+    FRenderCommandFence ReleaseFence;
 };
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
+
+class UTexture2D;
+struct FImage;
+
+/*
+ * Timing of a single CPU kernel run. Throughput is reported per core so numbers from
+ * machines with different core counts can be compared directly.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetCPUStats
+{
+    int64 NumPixels = 0;
+    int32 NumTiles = 0;
+    int32 NumWorkers = 1;
+    double Seconds = 0.0;
+
+    // Largest output tile plus source region held at once by ExecuteTiled
+    int64 PeakWorkingBytes = 0;
+
+    double GetMegapixelsPerSecond() const
+    {
+        return Seconds > 0.0 ? (double)NumPixels / 1.0e6 / Seconds : 0.0;
+    }
+
+    double GetMegapixelsPerSecondPerCore() const
+    {
+        return GetMegapixelsPerSecond() / FMath::Max(NumWorkers, 1);
+    }
+};
+
+/*
+ * Per-channel difference between two BGRA8 images, in 8-bit steps.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetImageDiff
+{
+    int32 MaxError = 0;
+    double MeanError = 0.0;
+    int64 NumDifferentPixels = 0;
+
+    bool IsIdentical() const { return MaxError == 0; }
+};
+
+/*
+ * One BGRA8 level of a mip chain handed to the filtered CPU kernel.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetCPUMip
+{
+    const FColor* Pixels = nullptr;
+    int32 SizeX = 0;
+    int32 SizeY = 0;
+};
+
+/*
+ * FWriteToRenderTargetCPU is a CPU reference implementation of WriteToRenderTarget.usf.
+ * It evaluates the same folded effect stack as the shader (FWriteToRenderTargetFusedEffects: affine UV stages, sine
+ * distortions and one color matrix), including the point sampler with clamp addressing, so headless (NullRHI) machines
+ * produce the same output as the GPU.
+ * The UV math runs four pixels at a time through the engine's VectorRegister abstraction (SSE/NEON, with the
+ * FPU fallback on platforms without vector intrinsics) and the image is split into tiles processed with ParallelFor.
+ * When the input is point sampled and the color operations amount to greyscale, contrast, invert and brightness,
+ * the pixels stay in 8-bit fixed point, four to a 128-bit register, and may differ from the float path by one
+ * 8-bit step (r.ShaderMod.PackedColor, the ShaderMod.WriteToRenderTarget.PackedColor test).
+ */
+class COMPUTESHADERMODULE_API FWriteToRenderTargetCPU
+{
+public:
+    // Edge length in pixels of the square tiles handed to ParallelFor
+    static constexpr int32 TileSize = 64;
+
+    /*
+     * Runs the kernel on a BGRA8 source and writes BGRA8 pixels into Dest.
+     * Source and Dest may have different sizes; like the shader, UVs are computed from the destination size.
+     */
+    static FWriteToRenderTargetCPUStats Execute(
+        const FColor* Source, int32 SourceSizeX, int32 SourceSizeY,
+        FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+        const FWriteToRenderTargetEffectParams& Params);
+
+    /*
+     * Same as Execute, but samples the source at its native size through a trilinear, clamp-addressed lookup into Mips
+     * (level 0 first). This is the CPU reference of the RDG path when the input is resampled inside the kernel.
+     */
+    static FWriteToRenderTargetCPUStats ExecuteFiltered(
+        TArrayView<const FWriteToRenderTargetCPUMip> Mips,
+        FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+        const FWriteToRenderTargetEffectParams& Params);
+
+    /*
+     * Runs the kernel on a BGRA8 image the way UWriteToRenderTarget does: through ExecuteFiltered when bResampleInKernel
+     * is set and the sizes differ, through Execute otherwise.
+     */
+    static FWriteToRenderTargetCPUStats ExecuteImage(
+        const FImage& Source,
+        FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+        const FWriteToRenderTargetEffectParams& Params);
+
+    /*
+     * The CPU side of the interactive preview: ExecuteImage at ShadedExtent, stretched over the DestSizeX x DestSizeY
+     * destination with the bilinear resampler. Same as ExecuteImage when ShadedExtent is the destination size.
+     */
+    static FWriteToRenderTargetCPUStats ExecutePreview(
+        const FImage& Source,
+        FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+        const FWriteToRenderTargetEffectParams& Params,
+        FIntPoint ShadedExtent);
+
+    /*
+     * Bounded-memory variant of Execute for images too large to hold at once. The destination is processed in squares
+     * of at most OutputTileSize pixels. For each one the exact set of source texels its samples reach (the halo pulled in
+     * by rotation, scale and distortion, clamped to the edges) is located first, only that region is read through
+     * ReadSourceRow, and the finished tile is handed to WriteTile (tightly packed) on the calling thread.
+     * Tiles whose pixels and source region need more than MemoryBudget bytes are split into quarters, down to TileSize.
+     * The output is bit-identical to Execute on the whole source.
+     */
+    static FWriteToRenderTargetCPUStats ExecuteTiled(
+        FWriteToRenderTargetRowReadFunction ReadSourceRow, int32 SourceSizeX, int32 SourceSizeY,
+        int32 DestSizeX, int32 DestSizeY,
+        const FWriteToRenderTargetEffectParams& Params,
+        int32 OutputTileSize, int64 MemoryBudget,
+        TFunctionRef<void(const FIntRect& Tile, const FColor* Pixels)> WriteTile);
+
+    // The mip level sampled when an input of ResolutionRatio x the render target size is drawn at ImageScale
+    static float ComputeInputLod(const FVector2f& ResolutionRatio, float ImageScale);
+
+    // Builds box filtered mips 1..N of a BGRA8 image, down to 1x1
+    static void BuildMipChain(const FColor* Mip0, int32 SizeX, int32 SizeY, TArray<FImage>& OutLowerMips);
+
+    /*
+     * Writes the next mip level of a BGRA8 image into Dest (max(1, Size / 2) pixels): the 2x2 box filter of the level,
+     * rounded half up, with odd trailing rows and columns dropped and axes of size 1 repeating their texel.
+     * This is the CPU reference of the render target mip pass (WriteToRenderTargetMips.usf) and matches it exactly.
+     */
+    static void DownsampleMip(const FColor* Source, int32 SourceSizeX, int32 SourceSizeY, FColor* Dest);
+
+    // Builds up to MaxLevels levels below Mip0 with DownsampleMip, stopping at 1x1
+    static void GenerateMips(const FColor* Mip0, int32 SizeX, int32 SizeY, int32 MaxLevels, TArray<FImage>& OutLowerMips);
+
+    // Compares two images of NumPixels BGRA8 pixels channel by channel
+    static FWriteToRenderTargetImageDiff CompareImages(const FColor* A, const FColor* B, int64 NumPixels);
+
+    /*
+     * Reads a texture as BGRA8, from its smallest mip that is at least MinSize (the top mip when MinSize is zero).
+     * Uses the platform data when its format is uncompressed, streamed mips included, and falls back to the editor source data otherwise.
+     */
+    static bool ReadTexturePixels(UTexture2D* Texture, FImage& OutImage, FIntPoint MinSize = FIntPoint::ZeroValue);
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
+
+/*
+ * 2D affine transform of a sampling position in UV space: UV' = Matrix * UV + Offset.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetUVTransform
+{
+    // Row major 2x2 matrix (M00, M01, M10, M11)
+    FVector4f Matrix = FVector4f(1.0f, 0.0f, 0.0f, 1.0f);
+    FVector2f Offset = FVector2f::ZeroVector;
+
+    FVector2f Apply(const FVector2f& UV) const
+    {
+        return FVector2f(
+            Matrix.X * UV.X + Matrix.Y * UV.Y + Offset.X,
+            Matrix.Z * UV.X + Matrix.W * UV.Y + Offset.Y);
+    }
+
+    // This transform followed by Next
+    FWriteToRenderTargetUVTransform Then(const FWriteToRenderTargetUVTransform& Next) const
+    {
+        FWriteToRenderTargetUVTransform Result;
+        Result.Matrix = FVector4f(
+            Next.Matrix.X * Matrix.X + Next.Matrix.Y * Matrix.Z,
+            Next.Matrix.X * Matrix.Y + Next.Matrix.Y * Matrix.W,
+            Next.Matrix.Z * Matrix.X + Next.Matrix.W * Matrix.Z,
+            Next.Matrix.Z * Matrix.Y + Next.Matrix.W * Matrix.W);
+        Result.Offset = Next.Apply(Offset);
+        return Result;
+    }
+
+    float GetDeterminant() const
+    {
+        return Matrix.X * Matrix.W - Matrix.Y * Matrix.Z;
+    }
+
+    // Exact comparison on purpose: anything else changes the sampled position
+    bool IsIdentity() const
+    {
+        return Matrix == FVector4f(1.0f, 0.0f, 0.0f, 1.0f) && Offset == FVector2f::ZeroVector;
+    }
+};
+
+/*
+ * FWriteToRenderTargetFusedEffects is an effect stack folded into the form the kernels evaluate in one pass.
+ * Consecutive UV operations collapse into one affine stage; the sine distortion is not affine, so each distortion
+ * starts a new stage: UV -> Stage 0 -> Distort 0 -> Stage 1 -> Distort 1 -> Stage 2. All color operations are affine
+ * and collapse into a single 4x4 matrix and offset, applied as a row vector (RGBA * ColorMatrix + ColorOffset).
+ * UV and color operations commute, so their relative order in the stack does not matter.
+ * This header has no rendering dependencies so the folding can be checked on its own (see the ShaderMod.WriteToRenderTarget.EffectFolding test).
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetFusedEffects
+{
+    // Distortions the kernels can evaluate; further distortions in a stack are dropped
+    static constexpr int32 MaxDistortions = 2;
+
+    FWriteToRenderTargetUVTransform UVStages[MaxDistortions + 1];
+    float DistortionStrengths[MaxDistortions] = { 0.0f, 0.0f };
+    int32 NumDistortions = 0;
+
+    FMatrix44f ColorMatrix = FMatrix44f::Identity;
+    FVector4f ColorOffset = FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+
+    // Operations of the source stack that did not fit (distortions past MaxDistortions)
+    int32 NumDroppedOps = 0;
+
+    static FWriteToRenderTargetFusedEffects Fold(TConstArrayView<FWriteToRenderTargetEffect> EffectStack);
+
+    // Folds Params.EffectStack, or the stack described by the individual fields when it is empty
+    static FWriteToRenderTargetFusedEffects Fold(const FWriteToRenderTargetEffectParams& Params);
+
+    // The stack equivalent to the individual fields of Params: rotate, scale, distort, auto contrast, greyscale, contrast, invert
+    static void MakeFieldStack(const FWriteToRenderTargetEffectParams& Params, TArray<FWriteToRenderTargetEffect>& OutEffectStack);
+
+    // Runs the folded UV chain for a UV in [0, 1] of the output
+    FVector2f TransformUV(const FVector2f& UV) const;
+
+    // Applies the folded color transform to an RGBA color
+    FVector4f TransformColor(const FVector4f& Color) const;
+
+    bool IsIdentityColor() const
+    {
+        return ColorMatrix == FMatrix44f::Identity && ColorOffset == FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    /*
+     * How much larger the output shows the input, ignoring the distortions. Picks the input mip level when
+     * the input is resampled in the kernel; equals ImageScale for the stack described by the individual fields.
+     */
+    float GetImageScale() const;
+
+    // Reference implementation of a single operation, used to check the folding
+    static FVector2f ApplyUV(const FWriteToRenderTargetEffect& Effect, const FVector2f& UV);
+    static FVector4f ApplyColor(const FWriteToRenderTargetEffect& Effect, const FVector4f& Color);
+
+    static bool IsUVOp(EWriteToRenderTargetEffectOp Op)
+    {
+        return Op == EWriteToRenderTargetEffectOp::Rotate || Op == EWriteToRenderTargetEffectOp::Scale || Op == EWriteToRenderTargetEffectOp::Distort;
+    }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * Thread group sizes WriteToRenderTarget.usf is compiled with (the GROUP_SIZE permutation).
+ */
+enum class EWriteToRenderTargetGroupSize : uint8
+{
+    G8x8,
+    G16x16,
+    G32x8,
+    G8x32,
+    Num
+};
+
+/*
+ * FWriteToRenderTargetGroupSize is the single place that maps a group size to its thread counts and to the
+ * number of groups needed for a given output size. The kernel is launched with one thread per output pixel,
+ * rounded up to whole groups; threads of the partial edge groups are rejected by the bounds check in the kernel.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetGroupSize
+{
+    static constexpr EWriteToRenderTargetGroupSize Default = EWriteToRenderTargetGroupSize::G8x8;
+
+    static FIntPoint GetThreadCount(EWriteToRenderTargetGroupSize GroupSize)
+    {
+        switch (GroupSize)
+        {
+        case EWriteToRenderTargetGroupSize::G16x16:
+            return FIntPoint(16, 16);
+        case EWriteToRenderTargetGroupSize::G32x8:
+            return FIntPoint(32, 8);
+        case EWriteToRenderTargetGroupSize::G8x32:
+            return FIntPoint(8, 32);
+        default:
+            return FIntPoint(8, 8);
+        }
+    }
+
+    static FIntVector GetGroupCount(FIntPoint Extent, EWriteToRenderTargetGroupSize GroupSize)
+    {
+        const FIntPoint ThreadCount = GetThreadCount(GroupSize);
+        return FIntVector(
+            FMath::DivideAndRoundUp(FMath::Max(Extent.X, 0), ThreadCount.X),
+            FMath::DivideAndRoundUp(FMath::Max(Extent.Y, 0), ThreadCount.Y),
+            1);
+    }
+
+    static FString ToString(EWriteToRenderTargetGroupSize GroupSize)
+    {
+        const FIntPoint ThreadCount = GetThreadCount(GroupSize);
+        return FString::Printf(TEXT("%dx%d"), ThreadCount.X, ThreadCount.Y);
+    }
+};
+
+/*
+ * FWriteToRenderTargetGroupSizeTuner remembers the fastest group size per GPU adapter and output resolution.
+ * Results are measured on the render thread the first time a resolution is dispatched (see UWriteToRenderTarget::DispatchRenderThread)
+ * and persisted in the engine config ([ShaderMod.GroupSizeAutotune]) so later sessions skip the measurement.
+ * r.ShaderMod.GroupSize forces one size for every dispatch instead.
+ */
+class COMPUTESHADERMODULE_API FWriteToRenderTargetGroupSizeTuner
+{
+public:
+    static FWriteToRenderTargetGroupSizeTuner& Get();
+
+    // Reads the persisted results. Game thread only, called at module startup
+    void LoadConfig();
+
+    // Returns true with the size to use for Extent, or false when the resolution still needs to be measured
+    bool Find(FIntPoint Extent, EWriteToRenderTargetGroupSize& OutGroupSize) const;
+
+    // Stores the measured winner and schedules the config write on the game thread
+    void Set(FIntPoint Extent, EWriteToRenderTargetGroupSize GroupSize);
+
+    // Forgets every result, in memory and in the config
+    void Empty();
+
+    // Number of timed dispatches per candidate (r.ShaderMod.GroupSizeAutotune.Iterations)
+    static int32 GetIterations();
+
+private:
+    static FString MakeKey(FIntPoint Extent);
+
+    mutable FCriticalSection CriticalSection;
+    TMap<FString, EWriteToRenderTargetGroupSize> Entries;
+};
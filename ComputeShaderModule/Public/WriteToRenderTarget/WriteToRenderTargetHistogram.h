@@ -0,0 +1,150 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/WeakObjectPtr.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
+
+class UTexture2D;
+class UWriteToRenderTarget;
+
+/*
+ * 256 bin luminance histogram of an 8-bit image. The luminance of a pixel is the greyscale weighting of the kernel
+ * (0.3, 0.6, 0.1) in integer arithmetic, so the CPU reduction and the GPU pass (WriteToRenderTargetHistogram.usf)
+ * bin every pixel identically.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetLuminanceHistogram
+{
+    static constexpr int32 NumBins = 256;
+
+    uint32 Bins[NumBins] = {};
+    uint64 NumPixels = 0;
+
+    static uint32 GetBin(uint32 R, uint32 G, uint32 B)
+    {
+        return (R * 307u + G * 614u + B * 103u + 512u) >> 10;
+    }
+
+    /*
+     * Computes the histogram of a SizeX x SizeY BGRA8 image read a row at a time, split into NumTasks bands run with
+     * ParallelFor (0 = one per worker thread). Each band bins four pixels at a time with vector integer math into
+     * private sub-histograms, which are summed at the end.
+     */
+    static FWriteToRenderTargetLuminanceHistogram Compute(FWriteToRenderTargetRowReadFunction ReadRow, int32 SizeX, int32 SizeY, int32 NumTasks = 0);
+    static FWriteToRenderTargetLuminanceHistogram Compute(const FColor* Pixels, int32 SizeX, int32 SizeY, int32 NumTasks = 0);
+
+    // One pixel at a time, the definition Compute and the GPU pass are checked against
+    static FWriteToRenderTargetLuminanceHistogram ComputeReference(const FColor* Pixels, int64 NumPixels);
+
+    // Luminance in [0, 1] below which Fraction of the pixels fall
+    float GetPercentile(float Fraction) const;
+
+    // Black and white points that leave ClipPercent of the pixels below and above them
+    void GetLevels(float ClipPercent, float& OutBlack, float& OutWhite) const;
+
+    // Concrete color operations for the histogram driven ones; the identity for an empty or flat histogram
+    FWriteToRenderTargetEffect ResolveAutoContrast(float ClipPercent) const;
+    FWriteToRenderTargetEffect ResolveAutoLevels(float ClipPercent) const;
+
+    // Whether Params contains an operation that needs the histogram of its input
+    static bool IsNeededBy(const FWriteToRenderTargetEffectParams& Params);
+
+    // Turns Params into an explicit effect stack with every histogram driven operation resolved against this histogram
+    void Resolve(FWriteToRenderTargetEffectParams& Params) const;
+
+    bool operator==(const FWriteToRenderTargetLuminanceHistogram& Other) const
+    {
+        return NumPixels == Other.NumPixels && FMemory::Memcmp(Bins, Other.Bins, sizeof(Bins)) == 0;
+    }
+};
+
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetHistogramCacheStats
+{
+    uint64 Hits = 0;
+    uint64 Misses = 0;
+    uint64 ComputedOnCPU = 0;
+    uint64 ComputedOnGPU = 0;
+    int32 NumEntries = 0;
+    int32 NumPending = 0;
+};
+
+/*
+ * FWriteToRenderTargetHistogramCache keeps the luminance histogram of every input the automatic contrast was used on,
+ * keyed by texture and data revision like the resize cache, so changing any other parameter never recomputes it.
+ * Inputs with readable CPU pixels are reduced on the CPU right away. Inputs without them (cooked textures whose
+ * top mip only lives on the GPU) are reduced by a compute pass and read back asynchronously; the processors that
+ * asked in the meantime dispatch again once it arrived. At most r.ShaderMod.HistogramCacheSize histograms are kept,
+ * least recently used first out. The cache is game thread only.
+ */
+class COMPUTESHADERMODULE_API FWriteToRenderTargetHistogramCache : public FTickableGameObject
+{
+public:
+    static FWriteToRenderTargetHistogramCache& Get();
+
+    /*
+     * Copies the histogram of Texture into OutHistogram, computing it on a miss. Returns false while the GPU computes it,
+     * in which case Waiter (when given) gets a new dispatch requested once the histogram is cached.
+     */
+    bool FindOrCompute(UTexture2D* Texture, UWriteToRenderTarget* Waiter, FWriteToRenderTargetLuminanceHistogram& OutHistogram);
+
+    // Drops the histograms of Texture, for textures whose pixels change without a new revision (recycled transient textures)
+    void Invalidate(const UTexture2D* Texture);
+
+    void Empty();
+
+    FWriteToRenderTargetHistogramCacheStats GetStats() const;
+
+    /*
+     * Runs the GPU reduction of Texture and waits for its result; for verification and benchmarks only.
+     * Returns false under NullRHI or when the texture has no resource.
+     */
+    static bool ComputeOnGPUBlocking(UTexture2D* Texture, FWriteToRenderTargetLuminanceHistogram& OutHistogram);
+
+    // FTickableGameObject: collects finished GPU reductions
+    virtual void Tick(float DeltaTime) override;
+    virtual bool IsTickable() const override { return Pending.Num() > 0; }
+    virtual bool IsTickableInEditor() const override { return true; }
+    virtual bool IsTickableWhenPaused() const override { return true; }
+    virtual TStatId GetStatId() const override;
+
+private:
+    struct FKey
+    {
+        FObjectKey Texture;
+        FGuid Revision;
+        FIntPoint Size = FIntPoint::ZeroValue;
+
+        bool operator==(const FKey& Other) const
+        {
+            return Texture == Other.Texture && Revision == Other.Revision && Size == Other.Size;
+        }
+
+        friend uint32 GetTypeHash(const FKey& Key)
+        {
+            return HashCombine(HashCombine(GetTypeHash(Key.Texture), GetTypeHash(Key.Revision)), GetTypeHash(Key.Size));
+        }
+    };
+
+    struct FEntry
+    {
+        FWriteToRenderTargetLuminanceHistogram Histogram;
+        uint64 LastUseTick = 0;
+    };
+
+    struct FGPURequest;
+
+    struct FPendingRequest
+    {
+        TSharedPtr<FGPURequest, ESPMode::ThreadSafe> Request;
+        TArray<TWeakObjectPtr<UWriteToRenderTarget>> Waiters;
+    };
+
+    static FKey MakeKey(const UTexture2D* Texture);
+    void Add(const FKey& Key, const FWriteToRenderTargetLuminanceHistogram& Histogram);
+
+    TMap<FKey, FEntry> Entries;
+    TMap<FKey, FPendingRequest> Pending;
+    uint64 UseTick = 0;
+    FWriteToRenderTargetHistogramCacheStats Stats;
+};
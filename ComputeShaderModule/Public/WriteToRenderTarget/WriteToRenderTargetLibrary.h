@@ -1,9 +1,11 @@
 #pragma once
 
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
 #include "WriteToRenderTargetLibrary.generated.h"
 
-class UWriteToRenderTarget;
+class UTexture2D;
+class UTextureRenderTarget2D;
 
 UCLASS()
 class COMPUTESHADERMODULE_API UWriteToRenderTargetLibrary : public UBlueprintFunctionLibrary
@@ -14,13 +16,22 @@ public:
 	/*
 	 * Executes the compute shader on the provided input texture and render target.
 	 * It ensures that the compute shader runs with the correct input data and outputs to the specified render target.
+	 * Uses the default processor of UWriteToRenderTargetSubsystem and its parameters.
 	 */
 	UFUNCTION(BlueprintCallable)
 	static void ExecuteRTComputeShader(UTexture2D* InputTexture, UTextureRenderTarget2D* RT);
 
 	/*
-	 * A singleton instance of UWriteToRenderTarget used to maintain state between function calls.
-	 * This instance is reused to avoid repeatedly creating and destroying objects.
+	 * Executes the compute shader on many input textures and render targets, each with its own parameters,
+	 * recorded into a single render graph. Inputs are resized through the resize cache like ExecuteRTComputeShader does.
 	 */
-	static UWriteToRenderTarget* WriteToRenderTargetInstance;
+	UFUNCTION(BlueprintCallable)
+	static void ExecuteRTComputeShaderBatch(const TArray<FWriteToRenderTargetBatchItem>& Items);
+
+	/*
+	 * Same as ExecuteRTComputeShader, but runs on a processor created with UWriteToRenderTargetSubsystem::CreateProcessor,
+	 * so each render target can keep its own parameters.
+	 */
+	UFUNCTION(BlueprintCallable)
+	static void ExecuteRTComputeShaderWithProcessor(FWriteToRenderTargetHandle Processor, UTexture2D* InputTexture, UTextureRenderTarget2D* RT);
 };
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WriteToRenderTarget/WriteToRenderTargetEffects.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
+
+/*
+ * FWriteToRenderTargetPermutation is the set of compile-time switches of the fused WriteToRenderTarget.usf kernel.
+ * Each switch removes a piece of per-pixel work from the kernel, so Select picks the leanest permutation
+ * that still produces the same image as the full kernel for the given folded effect stack.
+ * This header has no rendering dependencies so the selection can be exercised on its own (see the ShaderMod.WriteToRenderTarget.Permutations test).
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetPermutation
+{
+    static constexpr int32 NumPermutations = 4 * (FWriteToRenderTargetFusedEffects::MaxDistortions + 1);
+
+    // Index of the full kernel: both stages applied and every distortion evaluated
+    static constexpr int32 FullIndex = FWriteToRenderTargetFusedEffects::MaxDistortions << 2;
+
+    bool bIdentityColor = false;        // IDENTITY_COLOR: skips the color matrix
+    bool bIdentityTransform = false;    // IDENTITY_TRANSFORM: the first UV stage is the identity, skips its matrix
+    int32 NumDistortions = 0;           // NUM_DISTORTIONS: sine distortions (and the UV stages after them) to evaluate
+
+    static FWriteToRenderTargetPermutation Select(const FWriteToRenderTargetFusedEffects& Effects)
+    {
+        FWriteToRenderTargetPermutation Permutation;
+        Permutation.bIdentityColor = Effects.IsIdentityColor();
+        Permutation.bIdentityTransform = Effects.UVStages[0].IsIdentity();
+        Permutation.NumDistortions = Effects.NumDistortions;
+        return Permutation;
+    }
+
+    static FWriteToRenderTargetPermutation Select(const FWriteToRenderTargetEffectParams& Params)
+    {
+        return Select(FWriteToRenderTargetFusedEffects::Fold(Params));
+    }
+
+    // Dense index in [0, NumPermutations), used for the per-permutation dispatch counters
+    int32 GetIndex() const
+    {
+        return (bIdentityColor ? 1 : 0)
+            | (bIdentityTransform ? 2 : 0)
+            | (NumDistortions << 2);
+    }
+
+    // Whether any switch removes work from the full kernel, fewer distortions included
+    bool IsLean() const
+    {
+        return GetIndex() != FullIndex;
+    }
+
+    static FWriteToRenderTargetPermutation FromIndex(int32 Index)
+    {
+        FWriteToRenderTargetPermutation Permutation;
+        Permutation.bIdentityColor = (Index & 1) != 0;
+        Permutation.bIdentityTransform = (Index & 2) != 0;
+        Permutation.NumDistortions = Index >> 2;
+        return Permutation;
+    }
+
+    // Short name used in RDG event names and logs, e.g. "IdentityColor+Distort1"
+    FString ToString() const
+    {
+        TArray<FString> Parts;
+        if (bIdentityColor) Parts.Add(TEXT("IdentityColor"));
+        if (bIdentityTransform) Parts.Add(TEXT("IdentityTransform"));
+        if (NumDistortions > 0) Parts.Add(FString::Printf(TEXT("Distort%d"), NumDistortions));
+        return Parts.Num() > 0 ? FString::Join(Parts, TEXT("+")) : FString(TEXT("Default"));
+    }
+
+    bool operator==(const FWriteToRenderTargetPermutation& Other) const
+    {
+        return GetIndex() == Other.GetIndex();
+    }
+};
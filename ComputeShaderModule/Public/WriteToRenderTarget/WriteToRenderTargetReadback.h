@@ -0,0 +1,77 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PixelFormat.h"
+#include "Templates/SharedPointer.h"
+
+class FRHICommandListImmediate;
+class FRHIGPUTextureReadback;
+class FRHITexture;
+
+/*
+ * Pixels of one readback, handed to the callback on the game thread.
+ * Rows are tightly packed (Size.X * BytesPerPixel bytes each) in the render target's format,
+ * BGRA8 for results of the CPU backend.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetReadbackResult
+{
+    bool bSuccess = false;
+    FIntPoint Size = FIntPoint::ZeroValue;
+    EPixelFormat Format = PF_Unknown;
+    int32 BytesPerPixel = 0;
+
+    // The caller buffer when one was given, otherwise Data. Only valid for the duration of the callback.
+    TArrayView<const uint8> Pixels;
+
+    // Owned copy of the pixels, empty when they were written into the caller buffer
+    TArray<uint8> Data;
+};
+
+using FWriteToRenderTargetReadbackCallback = TFunction<void(const FWriteToRenderTargetReadbackResult&)>;
+
+/*
+ * FWriteToRenderTargetReadbackRing is a fixed set of FRHIGPUTextureReadback staging buffers used round robin.
+ * A readback copies the render target into a free staging buffer on the render thread; polling maps the buffers
+ * that the GPU has finished, copies the pixels out once (straight into the caller buffer when one was given)
+ * and posts the callbacks to the game thread, in request order. Nothing waits on the GPU.
+ * All methods except the constructor and GetNumSlots run on the render thread.
+ */
+class COMPUTESHADERMODULE_API FWriteToRenderTargetReadbackRing : public TSharedFromThis<FWriteToRenderTargetReadbackRing, ESPMode::ThreadSafe>
+{
+public:
+    explicit FWriteToRenderTargetReadbackRing(int32 InNumSlots);
+    ~FWriteToRenderTargetReadbackRing();
+
+    int32 GetNumSlots() const { return Slots.Num(); }
+
+    /*
+     * Copies Texture into a free staging buffer. The owner keeps at most GetNumSlots readbacks outstanding,
+     * so a free slot always exists; if none does the callback receives a failed result.
+     * CallerBuffer has to stay valid until the callback ran.
+     */
+    void Enqueue_RenderThread(FRHICommandListImmediate& RHICmdList, FRHITexture* Texture, FWriteToRenderTargetReadbackCallback Callback, TArrayView<uint8> CallerBuffer);
+
+    // Completes the readbacks whose copy has finished on the GPU, oldest first
+    void Poll_RenderThread();
+
+    // Fails every outstanding readback, used when the owner is destroyed
+    void Cancel_RenderThread();
+
+    // Posts Result to Callback on the game thread, pointing Result.Pixels at the caller buffer or the owned data
+    static void DeliverResult(FWriteToRenderTargetReadbackCallback Callback, FWriteToRenderTargetReadbackResult&& Result, TArrayView<uint8> CallerBuffer);
+
+private:
+    struct FSlot
+    {
+        TUniquePtr<FRHIGPUTextureReadback> Readback;
+        bool bInFlight = false;
+        uint64 Serial = 0;
+        FIntPoint Size = FIntPoint::ZeroValue;
+        EPixelFormat Format = PF_Unknown;
+        FWriteToRenderTargetReadbackCallback Callback;
+        TArrayView<uint8> CallerBuffer;
+    };
+
+    TArray<FSlot> Slots;
+    uint64 NextSerial = 0;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
+
+/*
+ * FWriteToRenderTargetResampler is a separable, multithreaded BGRA8 resampler used by UWriteToRenderTarget::ResizeTexture.
+ * The destination is split into bands of rows processed with ParallelFor. Each band filters the source rows it needs
+ * horizontally into a small band-local buffer and then filters that buffer vertically straight into the destination,
+ * so the caller can point Dest at a locked mip and no full-size intermediate image is ever allocated.
+ * All four channels of a pixel are filtered together in one VectorRegister.
+ */
+class COMPUTESHADERMODULE_API FWriteToRenderTargetResampler
+{
+public:
+    // Number of destination rows handed to a single ParallelFor task
+    static constexpr int32 BandHeight = 32;
+
+    /*
+     * Resamples Source into Dest. Both images are tightly packed BGRA8.
+     * When bForceOpaque is set the output alpha is 255, matching FImageUtils::ImageResize.
+     */
+    static void Resample(
+        const FColor* Source, int32 SourceSizeX, int32 SourceSizeY,
+        FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+        EWriteToRenderTargetResampleFilter Filter,
+        bool bForceOpaque = true);
+
+    /*
+     * Same as above, but reads the source rows through ReadSourceRow as each band needs them, so the source
+     * never has to be in memory as a whole. The output is identical.
+     */
+    static void Resample(
+        FWriteToRenderTargetRowReadFunction ReadSourceRow, int32 SourceSizeX, int32 SourceSizeY,
+        FColor* Dest, int32 DestSizeX, int32 DestSizeY,
+        EWriteToRenderTargetResampleFilter Filter,
+        bool bForceOpaque = true);
+
+    // Support radius of a filter in source texels at a 1:1 ratio
+    static float GetFilterRadius(EWriteToRenderTargetResampleFilter Filter);
+
+    // Evaluates the filter kernel at distance X (in texels at a 1:1 ratio)
+    static float EvaluateFilter(EWriteToRenderTargetResampleFilter Filter, float X);
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "UObject/ObjectKey.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
+
+class UTexture2D;
+
+/*
+ * Identifies one resized copy of a texture: which texture, which revision of its data, which target size and which filter.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetResizeKey
+{
+    FObjectKey Source;
+    FGuid SourceRevision;
+    FIntPoint TargetSize = FIntPoint::ZeroValue;
+    EWriteToRenderTargetResampleFilter Filter = EWriteToRenderTargetResampleFilter::Box;
+
+    bool operator==(const FWriteToRenderTargetResizeKey& Other) const
+    {
+        return Source == Other.Source && SourceRevision == Other.SourceRevision && TargetSize == Other.TargetSize && Filter == Other.Filter;
+    }
+
+    friend uint32 GetTypeHash(const FWriteToRenderTargetResizeKey& Key)
+    {
+        const uint32 Hash = HashCombine(HashCombine(GetTypeHash(Key.Source), GetTypeHash(Key.SourceRevision)), GetTypeHash(Key.TargetSize));
+        return HashCombine(Hash, ::GetTypeHash((uint8)Key.Filter));
+    }
+};
+
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetResizeCacheStats
+{
+    uint64 Hits = 0;
+    uint64 Misses = 0;
+    uint64 Evictions = 0;
+    int32 NumEntries = 0;
+    int64 BytesHeld = 0;
+    int64 BudgetBytes = 0;
+};
+
+/*
+ * FWriteToRenderTargetResizeCache keeps the transient textures produced by UWriteToRenderTarget::ResizeTexture,
+ * so executing the shader repeatedly on the same input skips both the CPU resize and the texture upload.
+ * Entries are evicted least recently used first once the memory budget (r.ShaderMod.ResizeCacheBudgetMB) is exceeded.
+ * Evicted textures go back to the texture pool, which hands them to the next resize of the same size.
+ * The cache is game thread only and keeps its textures alive through FGCObject.
+ */
+class COMPUTESHADERMODULE_API FWriteToRenderTargetResizeCache : public FGCObject
+{
+public:
+    static FWriteToRenderTargetResizeCache& Get();
+
+    // Returns the cached resized texture, or null when Source has not been resized to TargetSize at its current revision
+    UTexture2D* Find(UTexture2D* Source, FIntPoint TargetSize, EWriteToRenderTargetResampleFilter Filter);
+
+    // Stores a resized texture and evicts older entries until the cache fits in its budget again
+    void Add(UTexture2D* Source, FIntPoint TargetSize, EWriteToRenderTargetResampleFilter Filter, UTexture2D* Resized);
+
+    void Empty();
+
+    FWriteToRenderTargetResizeCacheStats GetStats() const;
+
+    // Overrides r.ShaderMod.ResizeCacheBudgetMB; pass a negative value to go back to the console variable
+    void SetBudgetBytes(int64 InBudgetBytes);
+    int64 GetBudgetBytes() const;
+
+    // Changes whenever the texture data changes (the source id in the editor, the lighting guid in cooked builds)
+    static FGuid GetSourceRevision(const UTexture2D* Source);
+
+    // FGCObject
+    virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+    virtual FString GetReferencerName() const override;
+
+private:
+    struct FEntry
+    {
+        TObjectPtr<UTexture2D> Texture = nullptr;
+        int64 Bytes = 0;
+        uint64 LastUseTick = 0;
+    };
+
+    void EvictToBudget(int64 ExtraBytes);
+    void RemoveEntry(const FWriteToRenderTargetResizeKey& Key);
+
+    TMap<FWriteToRenderTargetResizeKey, FEntry> Entries;
+    uint64 UseTick = 0;
+    int64 BytesHeld = 0;
+    int64 BudgetBytesOverride = -1;
+    uint64 Hits = 0;
+    uint64 Misses = 0;
+    uint64 Evictions = 0;
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RendererInterface.h"
+#include "UObject/ObjectKey.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
+
+class FRenderTarget;
+class FRHICommandListImmediate;
+class UTexture2D;
+
+/*
+ * Identifies one processed image: which input at which revision, written into which render target at which size,
+ * by which backend, with which parameters. Input and render target are keyed by object, so a new object allocated
+ * where a destroyed one lived never hits its results. ParamsHash covers every effect parameter after the histogram driven
+ * operations were resolved, so an input whose histogram changes never hits an older result.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetResultKey
+{
+    FObjectKey Input;
+    FGuid InputRevision;
+    FObjectKey RenderTarget;
+    FIntPoint Size = FIntPoint::ZeroValue;
+    EWriteToRenderTargetBackend Backend = EWriteToRenderTargetBackend::RDG;
+    uint32 ParamsHash = 0;
+
+    bool operator==(const FWriteToRenderTargetResultKey& Other) const
+    {
+        return Input == Other.Input && InputRevision == Other.InputRevision && RenderTarget == Other.RenderTarget
+            && Size == Other.Size && Backend == Other.Backend && ParamsHash == Other.ParamsHash;
+    }
+
+    friend uint32 GetTypeHash(const FWriteToRenderTargetResultKey& Key)
+    {
+        uint32 Hash = HashCombine(GetTypeHash(Key.Input), GetTypeHash(Key.InputRevision));
+        Hash = HashCombine(Hash, GetTypeHash(Key.RenderTarget));
+        Hash = HashCombine(Hash, GetTypeHash(Key.Size));
+        return HashCombine(HashCombine(Hash, ::GetTypeHash((uint8)Key.Backend)), Key.ParamsHash);
+    }
+};
+
+/*
+ * A cached processed image. The RDG backend keeps a copy of the render target's mip 0, which only the render thread
+ * touches: it is filled behind the dispatch that produced it and copied back by later hits. The CPU backend keeps the
+ * BGRA8 pixels, on the game thread. Whichever thread drops the last reference, the texture is released on the render thread.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetCachedResult
+{
+    TRefCountPtr<IPooledRenderTarget> Texture;
+    TArray<FColor> Pixels;
+
+    ~FWriteToRenderTargetCachedResult();
+};
+
+using FWriteToRenderTargetCachedResultPtr = TSharedPtr<FWriteToRenderTargetCachedResult, ESPMode::ThreadSafe>;
+
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetResultCacheStats
+{
+    uint64 Hits = 0;
+    uint64 Misses = 0;
+    uint64 Evictions = 0;
+    uint64 Collisions = 0;      // Same key, different parameters: counted as misses
+    int32 NumEntries = 0;
+    int32 NumPresetEntries = 0;
+    int32 NumPresets = 0;
+    int64 BytesHeld = 0;
+    int64 BudgetBytes = 0;
+
+    double GetHitRate() const
+    {
+        return Hits + Misses > 0 ? (double)Hits / (double)(Hits + Misses) : 0.0;
+    }
+};
+
+/*
+ * FWriteToRenderTargetResultCache memoizes processed images, so toggling a processor back to parameters it already
+ * rendered copies the earlier result into the render target instead of running the kernel again.
+ * Named presets live in the same cache: their parameters are kept by name, and the results rendered with them are
+ * evicted only once no other entry is left. Entries are evicted least recently used first beyond the memory budget
+ * (r.ShaderMod.ResultCacheBudgetMB, default 64 MB). The cache is game thread only.
+ */
+class COMPUTESHADERMODULE_API FWriteToRenderTargetResultCache
+{
+public:
+    static FWriteToRenderTargetResultCache& Get();
+
+    static FWriteToRenderTargetResultKey MakeKey(const UTexture2D* Input, FObjectKey RenderTarget, FIntPoint Size,
+        EWriteToRenderTargetBackend Backend, const FWriteToRenderTargetEffectParams& Params);
+
+    // The result stored under Key when it was rendered with exactly Params, null otherwise
+    FWriteToRenderTargetCachedResultPtr Find(const FWriteToRenderTargetResultKey& Key, const FWriteToRenderTargetEffectParams& Params);
+
+    /*
+     * Adds an empty result of Bytes for the caller to fill and evicts older entries until the cache fits its budget again.
+     * Params is the resolved parameter set the key was made from, RequestedParams the processor's own (matched against presets).
+     * Returns null when Bytes alone exceed the budget.
+     */
+    FWriteToRenderTargetCachedResultPtr Add(const FWriteToRenderTargetResultKey& Key, const FWriteToRenderTargetEffectParams& Params,
+        const FWriteToRenderTargetEffectParams& RequestedParams, int64 Bytes);
+
+    // Drops every result of Input, for textures whose pixels change without a new revision (recycled transient textures)
+    void Invalidate(const UTexture2D* Input);
+
+    void Empty();
+
+    // Presets: named parameter sets whose results are kept in preference to any other
+    void SavePreset(FName Name, const FWriteToRenderTargetEffectParams& Params);
+    bool FindPreset(FName Name, FWriteToRenderTargetEffectParams& OutParams) const;
+    bool RemovePreset(FName Name);
+    TArray<FName> GetPresetNames() const;
+
+    FWriteToRenderTargetResultCacheStats GetStats() const;
+
+    // Overrides r.ShaderMod.ResultCacheBudgetMB; pass a negative value to go back to the console variable
+    void SetBudgetBytes(int64 InBudgetBytes);
+    int64 GetBudgetBytes() const;
+
+    // Copies Result into RenderTarget and rebuilds its mips when asked. Returns false when Result was never filled or does not fit.
+    static bool CopyToRenderTarget_RenderThread(FRHICommandListImmediate& RHICmdList, const FWriteToRenderTargetCachedResult& Result, FRenderTarget* RenderTarget, bool bGenerateMips);
+
+    // Fills Result with a copy of RenderTarget's mip 0
+    static void CaptureRenderTarget_RenderThread(FRHICommandListImmediate& RHICmdList, FWriteToRenderTargetCachedResult& Result, FRenderTarget* RenderTarget);
+
+private:
+    struct FEntry
+    {
+        FWriteToRenderTargetCachedResultPtr Result;
+        FWriteToRenderTargetEffectParams Params;
+        FWriteToRenderTargetEffectParams RequestedParams;
+        int64 Bytes = 0;
+        uint64 LastUseTick = 0;
+        bool bPreset = false;
+    };
+
+    bool IsPreset(const FWriteToRenderTargetEffectParams& Params) const;
+    void UpdatePresetEntries();
+    void EvictToBudget(int64 ExtraBytes);
+    void RemoveEntry(const FWriteToRenderTargetResultKey& Key);
+    void UpdateStats() const;
+
+    TMap<FWriteToRenderTargetResultKey, FEntry> Entries;
+    TMap<FName, FWriteToRenderTargetEffectParams> Presets;
+    uint64 UseTick = 0;
+    int64 BytesHeld = 0;
+    int64 BudgetBytesOverride = -1;
+    uint64 Hits = 0;
+    uint64 Misses = 0;
+    uint64 Evictions = 0;
+    uint64 Collisions = 0;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/TripleBuffer.h"
+#include "WriteToRenderTarget/WriteToRenderTarget.h"
+#include "WriteToRenderTarget/WriteToRenderTargetResultCache.h"
+#include <atomic>
+
+/*
+ * Everything one dispatch of UWriteToRenderTarget needs, copied on the game thread when the dispatch is issued.
+ * A snapshot is never modified after it was published, so the render thread reads it without locks.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetDispatchSnapshot
+{
+    // Increases with every published snapshot, 0 = nothing published yet
+    uint64 Serial = 0;
+
+    UTexture2D* InputTexture = nullptr;
+    FWriteToRenderTargetDispatchParams Params;
+    FWriteToRenderTargetEffectParams EffectParams;
+
+    // Result cache entry to copy from, or to fill behind the dispatch (see FWriteToRenderTargetResultCache)
+    FWriteToRenderTargetCachedResultPtr CachedResult;
+};
+
+/*
+ * FWriteToRenderTargetRenderState is the part of a processor the render thread works with. The game thread publishes
+ * snapshots into a lock-free triple buffer and enqueues one render command per snapshot; each command takes the newest
+ * snapshot, so a command that finds it already rendered has been overtaken and is dropped. Render commands hold the state
+ * through a shared pointer instead of the processor, and never see its mutable parameter fields.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetRenderState
+{
+    // Written by the game thread, read by the render thread
+    TTripleBuffer<FWriteToRenderTargetDispatchSnapshot> Snapshots;
+
+    // Render thread only: serial of the snapshot rendered last
+    uint64 RenderedSerial = 0;
+
+    std::atomic<uint64> DispatchesDropped{0};
+
+    // Game thread: publishes Snapshot as the newest one
+    void Publish(const FWriteToRenderTargetDispatchSnapshot& Snapshot)
+    {
+        Snapshots.Write(Snapshot);
+    }
+
+    // Render thread: the newest published snapshot
+    const FWriteToRenderTargetDispatchSnapshot& Acquire_RenderThread()
+    {
+        if (Snapshots.IsDirty())
+        {
+            Snapshots.SwapReadBuffers();
+        }
+        return Snapshots.Read();
+    }
+
+    // Render thread: the newest snapshot when it still has to be rendered, null (counted as dropped) when an earlier command rendered it
+    const FWriteToRenderTargetDispatchSnapshot* BeginRender_RenderThread()
+    {
+        const FWriteToRenderTargetDispatchSnapshot& Latest = Acquire_RenderThread();
+        if (Latest.Serial == RenderedSerial)
+        {
+            ++DispatchesDropped;
+            return nullptr;
+        }
+        RenderedSerial = Latest.Serial;
+        return &Latest;
+    }
+};
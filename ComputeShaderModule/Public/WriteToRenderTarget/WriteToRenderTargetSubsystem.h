@@ -0,0 +1,80 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
+#include "WriteToRenderTargetSubsystem.generated.h"
+
+class UTexture2D;
+class UTextureRenderTarget2D;
+class UWriteToRenderTarget;
+
+/*
+ * UWriteToRenderTargetSubsystem owns the UWriteToRenderTarget processors and hands out handles to them.
+ * Every processor keeps its own effect parameters, input texture and render target, and schedules its own
+ * dispatch, so any number of render targets can be processed with different settings in the same frame.
+ * The default processor backs UWriteToRenderTargetLibrary::ExecuteRTComputeShader and unbound ShaderModWidgets.
+ */
+UCLASS()
+class COMPUTESHADERMODULE_API UWriteToRenderTargetSubsystem : public UEngineSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // Returns the subsystem of GEngine, or null before the engine is initialized
+    static UWriteToRenderTargetSubsystem* Get();
+
+    // USubsystem
+    virtual void Deinitialize() override;
+
+    // Creates an independent processor with default parameters
+    UFUNCTION(BlueprintCallable, Category = "ShaderMod")
+    FWriteToRenderTargetHandle CreateProcessor();
+
+    // Destroys the processor; its handle becomes stale. The default processor cannot be released.
+    UFUNCTION(BlueprintCallable, Category = "ShaderMod")
+    void ReleaseProcessor(FWriteToRenderTargetHandle Handle);
+
+    UFUNCTION(BlueprintPure, Category = "ShaderMod")
+    bool IsValidProcessor(FWriteToRenderTargetHandle Handle) const;
+
+    // The shared processor used when a caller does not bring its own handle, created on first use
+    UFUNCTION(BlueprintCallable, Category = "ShaderMod")
+    FWriteToRenderTargetHandle GetDefaultProcessor();
+
+    UFUNCTION(BlueprintPure, Category = "ShaderMod")
+    TArray<FWriteToRenderTargetHandle> GetProcessorHandles() const;
+
+    UFUNCTION(BlueprintCallable, Category = "ShaderMod")
+    void SetEffectParams(FWriteToRenderTargetHandle Handle, const FWriteToRenderTargetEffectParams& Params);
+
+    UFUNCTION(BlueprintPure, Category = "ShaderMod")
+    FWriteToRenderTargetEffectParams GetEffectParams(FWriteToRenderTargetHandle Handle) const;
+
+    /*
+     * Binds the input and render target to the processor and schedules its dispatch for the next tick.
+     * The input is resized through the resize cache unless the processor resamples in the kernel.
+     */
+    UFUNCTION(BlueprintCallable, Category = "ShaderMod")
+    bool Execute(FWriteToRenderTargetHandle Handle, UTexture2D* InputTexture, UTextureRenderTarget2D* RT);
+
+    // Priority of the processor's dispatches in the frame-budgeted scheduler (r.ShaderMod.Scheduler)
+    UFUNCTION(BlueprintCallable, Category = "ShaderMod")
+    void SetPriority(FWriteToRenderTargetHandle Handle, EWriteToRenderTargetPriority Priority);
+
+    // Drops the processor's dispatch if it has not been issued yet; returns false when none was pending
+    UFUNCTION(BlueprintCallable, Category = "ShaderMod")
+    bool CancelDispatch(FWriteToRenderTargetHandle Handle);
+
+    // Returns the processor behind a handle, or null for invalid or released handles
+    UWriteToRenderTarget* GetProcessor(FWriteToRenderTargetHandle Handle) const;
+
+    int32 GetNumProcessors() const { return Processors.Num(); }
+
+private:
+    UPROPERTY()
+    TMap<int32, TObjectPtr<UWriteToRenderTarget>> Processors;
+
+    int32 NextProcessorId = 0;
+    FWriteToRenderTargetHandle DefaultProcessor;
+};
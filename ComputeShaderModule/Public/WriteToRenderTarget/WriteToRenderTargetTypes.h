@@ -0,0 +1,247 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WriteToRenderTargetTypes.generated.h"
+
+class UTexture2D;
+class UTextureRenderTarget2D;
+
+/*
+ * Selects which backend executes the WriteToRenderTarget kernel.
+ * Auto uses the RDG compute path when a GPU is available and falls back to the CPU backend under NullRHI.
+ */
+UENUM(BlueprintType)
+enum class EWriteToRenderTargetBackend : uint8
+{
+    Auto,
+    RDG,
+    CPU
+};
+
+/*
+ * Reconstruction filter used when an input texture has to be resampled to the render target size.
+ */
+UENUM(BlueprintType)
+enum class EWriteToRenderTargetResampleFilter : uint8
+{
+    Box,        // Area average when minifying, nearest neighbour when magnifying
+    Bilinear,   // Triangle filter, widened when minifying
+    Lanczos     // Lanczos3, sharpest of the three
+};
+
+/*
+ * Order in which the dispatch scheduler issues pending dispatches within its per-frame budget.
+ * Deferred dispatches are promoted one level every r.ShaderMod.SchedulerAgingFrames frames, up to High,
+ * so low priority work is delayed but never starved. Immediate dispatches ignore the budget.
+ */
+UENUM(BlueprintType)
+enum class EWriteToRenderTargetPriority : uint8
+{
+    Low,
+    Normal,
+    High,
+    Immediate
+};
+
+/*
+ * One operation of an effect stack. UV operations move the position the output pixel samples the input at,
+ * color operations change the sampled color. Every color operation is affine on RGBA.
+ */
+UENUM(BlueprintType)
+enum class EWriteToRenderTargetEffectOp : uint8
+{
+    // UV
+    Rotate,         // Value: angle in degrees, around the image center
+    Scale,          // Value: image scale (1.0 = 100%), around the image center
+    Distort,        // Value: strength of the sine offset
+    // Color
+    Greyscale,      // Weighted luminance (0.3, 0.6, 0.1)
+    Contrast,       // Value: contrast around 0.5
+    Invert,         // 1 - color
+    Brightness,     // Value: added to RGB
+    Saturation,     // Value: 0 = greyscale, 1 = unchanged
+    Hue,            // Value: hue rotation in degrees
+    ColorMatrix,    // ColorMatrix and ColorOffset: color * ColorMatrix + ColorOffset, RGBA row vector
+    // Histogram driven: resolved per input from its luminance histogram, the identity until then
+    AutoContrast,   // Value: percent of pixels clipped at each end; contrast around 0.5 that stretches the rest to [0, 1]
+    AutoLevels      // Value: percent of pixels clipped at each end; maps the black and white points to 0 and 1
+};
+
+/*
+ * Histogram driven color correction of the individual effect parameters, applied before the other color operations.
+ */
+UENUM(BlueprintType)
+enum class EWriteToRenderTargetAutoContrast : uint8
+{
+    Off,
+    Contrast,   // EWriteToRenderTargetEffectOp::AutoContrast
+    Levels      // EWriteToRenderTargetEffectOp::AutoLevels
+};
+
+/*
+ * An entry of FWriteToRenderTargetEffectParams::EffectStack.
+ */
+USTRUCT(BlueprintType)
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetEffect
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Effect")
+    EWriteToRenderTargetEffectOp Op = EWriteToRenderTargetEffectOp::Rotate;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Effect")
+    float Value = 0.0f;
+
+    // Only used by EWriteToRenderTargetEffectOp::ColorMatrix
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Effect")
+    FMatrix ColorMatrix = FMatrix::Identity;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Effect")
+    FVector4 ColorOffset = FVector4(0.0, 0.0, 0.0, 0.0);
+
+    static FWriteToRenderTargetEffect Make(EWriteToRenderTargetEffectOp InOp, float InValue = 0.0f)
+    {
+        FWriteToRenderTargetEffect Effect;
+        Effect.Op = InOp;
+        Effect.Value = InValue;
+        return Effect;
+    }
+
+    static FWriteToRenderTargetEffect MakeColorMatrix(const FMatrix& InColorMatrix, const FVector4& InColorOffset)
+    {
+        FWriteToRenderTargetEffect Effect;
+        Effect.Op = EWriteToRenderTargetEffectOp::ColorMatrix;
+        Effect.ColorMatrix = InColorMatrix;
+        Effect.ColorOffset = InColorOffset;
+        return Effect;
+    }
+};
+
+/*
+ * FWriteToRenderTargetEffectParams is a plain copy of the shader parameters held by UWriteToRenderTarget.
+ * It lets the CPU backend (and anything else running off the game thread) work on one consistent parameter set.
+ */
+USTRUCT(BlueprintType)
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetEffectParams
+{
+    GENERATED_BODY()
+
+    // Color change
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Color")
+    bool bInvertColors = false;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Color")
+    bool bGreyscale = false;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Color")
+    float Contrast = 1.0f;
+
+    // Derive contrast or black and white points from the luminance histogram of the input
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Color")
+    EWriteToRenderTargetAutoContrast AutoContrast = EWriteToRenderTargetAutoContrast::Off;
+
+    // Percent of the pixels at each end of the histogram the automatic correction ignores
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Color")
+    float AutoContrastClipPercent = 0.5f;
+
+    // Deformation
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Deformation")
+    float DistortionStrength = 0.0f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Deformation")
+    float ImageScale = 1.0f;          // Scaling factor for the image (1.0 = 100%)
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Deformation")
+    float RotationAngle = 90.0f;      // Rotation angle in degrees
+
+    // Input
+    // Read inputs that do not match the render target at their native size through a filtered, mip-mapped sampler
+    // instead of resizing them on the CPU first
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Input")
+    bool bResampleInKernel = false;
+
+    // Output
+    // Rebuild the render target's lower mips from the processed image in the same dispatch; needs a mip-mapped target
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Output")
+    bool bGenerateMips = false;
+
+    // Effects
+    // Ordered effect stack, applied first to last. When it is empty the fields above describe the stack
+    // (rotate, scale, distort, auto contrast, greyscale, contrast, invert); otherwise they are ignored, except bResampleInKernel and bGenerateMips.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Effects")
+    TArray<FWriteToRenderTargetEffect> EffectStack;
+};
+
+// Hash of every field and effect of Params, used to tag dispatches in traces. Implemented in WriteToRenderTargetEffects.cpp.
+COMPUTESHADERMODULE_API uint32 GetTypeHash(const FWriteToRenderTargetEffectParams& Params);
+
+/*
+ * Identifies one processor of UWriteToRenderTargetSubsystem. Each processor has its own parameters, input and
+ * render target binding, so several processors can be dispatched in the same frame with different settings.
+ */
+USTRUCT(BlueprintType)
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetHandle
+{
+    GENERATED_BODY()
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Processor")
+    int32 Id = INDEX_NONE;
+
+    bool IsValid() const { return Id != INDEX_NONE; }
+
+    bool operator==(const FWriteToRenderTargetHandle& Other) const { return Id == Other.Id; }
+    bool operator!=(const FWriteToRenderTargetHandle& Other) const { return Id != Other.Id; }
+
+    friend uint32 GetTypeHash(const FWriteToRenderTargetHandle& Handle) { return ::GetTypeHash(Handle.Id); }
+};
+
+/*
+ * One input / render target / parameter set of UWriteToRenderTargetLibrary::ExecuteRTComputeShaderBatch.
+ */
+USTRUCT(BlueprintType)
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetBatchItem
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Batch")
+    UTexture2D* InputTexture = nullptr;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Batch")
+    UTextureRenderTarget2D* RenderTarget = nullptr;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Batch")
+    FWriteToRenderTargetEffectParams Params;
+};
+
+/*
+ * Dispatch bookkeeping of a UWriteToRenderTarget instance.
+ * Coalesced counts requests merged into an already pending dispatch on the game thread,
+ * Dropped counts render commands that were overtaken by a newer dispatch before they ran.
+ */
+struct COMPUTESHADERMODULE_API FWriteToRenderTargetDispatchCounters
+{
+    uint64 Requested = 0;
+    uint64 Issued = 0;
+    uint64 Coalesced = 0;
+    uint64 Dropped = 0;
+
+    uint64 GetSkipped() const { return Coalesced + Dropped; }
+};
+
+/*
+ * Render target formats the kernel can write. RGBA8 covers both RGBA8 and BGRA8 targets.
+ */
+enum class EWriteToRenderTargetOutputFormat : uint8
+{
+    Unsupported,
+    RGBA8,
+    RGBA16F,
+    RGBA32F,
+    R8          // Single channel, receives the luminance of the result
+};
+
+/*
+ * Reads Width BGRA8 pixels of source row Y, starting at column X, into Dest. Lets the CPU kernel and the resampler
+ * stream a source that is never held in memory as a whole. Called concurrently from several worker threads.
+ */
+using FWriteToRenderTargetRowReadFunction = TFunctionRef<void(int32 X, int32 Y, int32 Width, FColor* Dest)>;
@@ -25,7 +25,10 @@ public class ComputeShaderModuleEditor : ModuleRules
 		PrivateDependencyModuleNames.AddRange(new string[] 
 		{
 			"UMGEditor",
-			"ComputeShaderModule"
+			"ComputeShaderModule",
+			"ImageCore",
+			"Json",
+			"JsonUtilities"
 		});
 
 		DynamicallyLoadedModuleNames.AddRange(new string[] { });
@@ -0,0 +1,321 @@
+#include "Commandlets/ShaderModBatchCommandlet.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "ImageCore.h"
+#include "ImageUtils.h"
+#include "JsonObjectConverter.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Tasks/Pipe.h"
+#include "Tasks/Task.h"
+#include "WriteToRenderTarget/WriteToRenderTargetCPU.h"
+#include "WriteToRenderTarget/WriteToRenderTargetHistogram.h"
+#include "WriteToRenderTarget/WriteToRenderTargetResampler.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
+#include <atomic>
+
+namespace ShaderModBatch
+{
+    /*
+     * One image travelling through the pipeline. Each stage only touches the job after the previous stage finished,
+     * so no locking is needed; the memory counters are shared between jobs and atomic.
+     */
+    struct FJob
+    {
+        FString SourcePath;
+        FString DestPath;
+        FImage Input;
+        TArray<FColor> Output;
+        FIntPoint OutputSize = FIntPoint::ZeroValue;
+        int64 FileBytes = 0;
+        bool bFailed = false;
+    };
+
+    struct FCounters
+    {
+        std::atomic<int64> LiveBytes{0};
+        std::atomic<int64> PeakLiveBytes{0};
+        std::atomic<int64> FileBytesRead{0};
+        std::atomic<int64> DecodedBytes{0};
+        std::atomic<int64> PixelsWritten{0};
+        std::atomic<int32> NumSucceeded{0};
+        std::atomic<int32> NumFailed{0};
+
+        void AddLiveBytes(int64 Bytes)
+        {
+            const int64 Live = LiveBytes += Bytes;
+            int64 Peak = PeakLiveBytes.load();
+            while (Live > Peak && !PeakLiveBytes.compare_exchange_weak(Peak, Live))
+            {
+            }
+        }
+    };
+
+    static const TCHAR* SupportedExtensions[] = { TEXT("png"), TEXT("exr"), TEXT("tga") };
+
+    static bool IsSupportedImage(const FString& Path)
+    {
+        const FString Extension = FPaths::GetExtension(Path);
+        for (const TCHAR* Supported : SupportedExtensions)
+        {
+            if (Extension.Equals(Supported, ESearchCase::IgnoreCase))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void GatherDirectory(const FString& Directory, TArray<FString>& OutPaths)
+    {
+        TArray<FString> Files;
+        IFileManager::Get().FindFiles(Files, *Directory, nullptr);
+        Files.Sort();
+        for (const FString& File : Files)
+        {
+            if (IsSupportedImage(File))
+            {
+                OutPaths.Add(FPaths::Combine(Directory, File));
+            }
+        }
+    }
+
+    // Paths in the manifest are relative to the manifest; empty lines and lines starting with # are skipped
+    static bool GatherManifest(const FString& ManifestPath, TArray<FString>& OutPaths)
+    {
+        TArray<FString> Lines;
+        if (!FFileHelper::LoadFileToStringArray(Lines, *ManifestPath))
+        {
+            return false;
+        }
+
+        const FString BaseDirectory = FPaths::GetPath(ManifestPath);
+        for (FString& Line : Lines)
+        {
+            Line.TrimStartAndEndInline();
+            if (Line.IsEmpty() || Line.StartsWith(TEXT("#")))
+            {
+                continue;
+            }
+            if (!IsSupportedImage(Line))
+            {
+                UE_LOG(LogTemp, Warning, TEXT("ShaderModBatch - Skipping %s, only PNG, EXR and TGA are supported."), *Line);
+                continue;
+            }
+            OutPaths.Add(FPaths::IsRelative(Line) ? FPaths::Combine(BaseDirectory, Line) : Line);
+        }
+        return true;
+    }
+
+    static void Decode(FJob& Job, FCounters& Counters)
+    {
+        Job.FileBytes = IFileManager::Get().FileSize(*Job.SourcePath);
+        if (!FImageUtils::LoadImage(*Job.SourcePath, Job.Input))
+        {
+            UE_LOG(LogTemp, Error, TEXT("ShaderModBatch - Failed to decode %s."), *Job.SourcePath);
+            Job.bFailed = true;
+            return;
+        }
+
+        // The kernel works on BGRA8; EXR inputs are converted to sRGB on the way
+        Job.Input.ChangeFormat(ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+
+        Counters.FileBytesRead += FMath::Max<int64>(Job.FileBytes, 0);
+        Counters.DecodedBytes += Job.Input.RawData.Num();
+        Counters.AddLiveBytes(Job.Input.RawData.Num());
+    }
+
+    static void Process(FJob& Job, FCounters& Counters, const FWriteToRenderTargetEffectParams& Params, FIntPoint RequestedSize)
+    {
+        if (Job.bFailed)
+        {
+            return;
+        }
+
+        Job.OutputSize = RequestedSize.X > 0 && RequestedSize.Y > 0 ? RequestedSize : FIntPoint(Job.Input.SizeX, Job.Input.SizeY);
+        Job.Output.SetNumUninitialized(Job.OutputSize.X * Job.OutputSize.Y);
+        Counters.AddLiveBytes(Job.Output.Num() * (int64)sizeof(FColor));
+
+        // Auto contrast and auto levels resolve against the histogram of each image, as they do per input texture in the engine
+        FWriteToRenderTargetEffectParams ImageParams = Params;
+        if (FWriteToRenderTargetLuminanceHistogram::IsNeededBy(ImageParams))
+        {
+            FWriteToRenderTargetLuminanceHistogram::Compute(Job.Input.AsBGRA8().GetData(), Job.Input.SizeX, Job.Input.SizeY).Resolve(ImageParams);
+        }
+
+        // An image of another size is resized first, like UWriteToRenderTarget::PrepareInput does with its default filter,
+        // unless the preset resamples it in the kernel
+        if (!ImageParams.bResampleInKernel && Job.OutputSize != FIntPoint(Job.Input.SizeX, Job.Input.SizeY))
+        {
+            FImage Resized(Job.OutputSize.X, Job.OutputSize.Y, ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+            Counters.AddLiveBytes(Resized.RawData.Num());
+            FWriteToRenderTargetResampler::Resample(Job.Input.AsBGRA8().GetData(), Job.Input.SizeX, Job.Input.SizeY,
+                Resized.AsBGRA8().GetData(), Job.OutputSize.X, Job.OutputSize.Y, EWriteToRenderTargetResampleFilter::Box);
+            Counters.AddLiveBytes(-Job.Input.RawData.Num());
+            Job.Input = MoveTemp(Resized);
+        }
+
+        FWriteToRenderTargetCPU::ExecuteImage(Job.Input, Job.Output.GetData(), Job.OutputSize.X, Job.OutputSize.Y, ImageParams);
+
+        // The input is not needed anymore, release it before the job waits for the encoder
+        Counters.AddLiveBytes(-Job.Input.RawData.Num());
+        Job.Input = FImage();
+    }
+
+    static void Encode(FJob& Job, FCounters& Counters)
+    {
+        if (!Job.bFailed)
+        {
+            const FImageView View(Job.Output.GetData(), Job.OutputSize.X, Job.OutputSize.Y, EGammaSpace::sRGB);
+            if (FImageUtils::SaveImageByExtension(*Job.DestPath, View))
+            {
+                Counters.PixelsWritten += Job.Output.Num();
+                ++Counters.NumSucceeded;
+            }
+            else
+            {
+                UE_LOG(LogTemp, Error, TEXT("ShaderModBatch - Failed to write %s."), *Job.DestPath);
+                Job.bFailed = true;
+            }
+        }
+
+        if (Job.bFailed)
+        {
+            ++Counters.NumFailed;
+        }
+
+        Counters.AddLiveBytes(-Job.Output.Num() * (int64)sizeof(FColor));
+        Job.Output.Empty();
+    }
+}
+
+UShaderModBatchCommandlet::UShaderModBatchCommandlet()
+{
+    IsClient = false;
+    IsEditor = false;
+    IsServer = false;
+    LogToConsole = true;
+}
+
+int32 UShaderModBatchCommandlet::Main(const FString& Params)
+{
+    using namespace ShaderModBatch;
+
+    FString InputDirectory;
+    FString ManifestPath;
+    FString OutputDirectory;
+    FString PresetPath;
+    FString SizeString;
+    FString Format = TEXT("png");
+    int32 MaxInFlight = 4;
+    FParse::Value(*Params, TEXT("Input="), InputDirectory);
+    FParse::Value(*Params, TEXT("Manifest="), ManifestPath);
+    FParse::Value(*Params, TEXT("Output="), OutputDirectory);
+    FParse::Value(*Params, TEXT("Preset="), PresetPath);
+    FParse::Value(*Params, TEXT("Size="), SizeString);
+    FParse::Value(*Params, TEXT("Format="), Format);
+    FParse::Value(*Params, TEXT("MaxInFlight="), MaxInFlight);
+    MaxInFlight = FMath::Max(MaxInFlight, 1);
+
+    if ((InputDirectory.IsEmpty() == ManifestPath.IsEmpty()) || OutputDirectory.IsEmpty())
+    {
+        UE_LOG(LogTemp, Error, TEXT("ShaderModBatch - Usage: -run=ShaderModBatch -Input=<Directory>|-Manifest=<File> -Output=<Directory> [-Preset=<Json>] [-Size=<W>x<H>] [-Format=png|exr|tga|same] [-MaxInFlight=<N>]"));
+        return 1;
+    }
+
+    // Preset: the same parameters UWriteToRenderTarget exposes, defaults for anything the file leaves out
+    FWriteToRenderTargetEffectParams EffectParams;
+    if (!PresetPath.IsEmpty())
+    {
+        FString PresetJson;
+        if (!FFileHelper::LoadFileToString(PresetJson, *PresetPath)
+            || !FJsonObjectConverter::JsonObjectStringToUStruct(PresetJson, &EffectParams))
+        {
+            UE_LOG(LogTemp, Error, TEXT("ShaderModBatch - Failed to read the preset %s."), *PresetPath);
+            return 1;
+        }
+    }
+
+    FIntPoint RequestedSize = FIntPoint::ZeroValue;
+    if (!SizeString.IsEmpty())
+    {
+        FString Width;
+        FString Height;
+        if (!SizeString.Split(TEXT("x"), &Width, &Height) || (RequestedSize = FIntPoint(FCString::Atoi(*Width), FCString::Atoi(*Height))).GetMin() <= 0)
+        {
+            UE_LOG(LogTemp, Error, TEXT("ShaderModBatch - Invalid size %s, expected <Width>x<Height>."), *SizeString);
+            return 1;
+        }
+    }
+
+    TArray<FString> SourcePaths;
+    if (!ManifestPath.IsEmpty())
+    {
+        if (!GatherManifest(ManifestPath, SourcePaths))
+        {
+            UE_LOG(LogTemp, Error, TEXT("ShaderModBatch - Failed to read the manifest %s."), *ManifestPath);
+            return 1;
+        }
+    }
+    else
+    {
+        GatherDirectory(InputDirectory, SourcePaths);
+    }
+
+    if (SourcePaths.Num() == 0)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("ShaderModBatch - No PNG, EXR or TGA images found."));
+        return 0;
+    }
+
+    IFileManager::Get().MakeDirectory(*OutputDirectory, true);
+    UE_LOG(LogTemp, Display, TEXT("ShaderModBatch - Processing %d images with at most %d in flight."), SourcePaths.Num(), MaxInFlight);
+
+    FCounters Counters;
+    UE::Tasks::FPipe ProcessPipe(TEXT("ShaderModBatchProcess"));
+    TArray<UE::Tasks::FTask> InFlight;
+    const double StartTime = FPlatformTime::Seconds();
+
+    for (const FString& SourcePath : SourcePaths)
+    {
+        // Back-pressure: wait for the oldest image to be written before decoding another one
+        if (InFlight.Num() >= MaxInFlight)
+        {
+            InFlight[0].Wait();
+            InFlight.RemoveAt(0, 1, false);
+        }
+
+        TSharedRef<FJob> Job = MakeShared<FJob>();
+        Job->SourcePath = SourcePath;
+        const FString Extension = Format.Equals(TEXT("same"), ESearchCase::IgnoreCase) ? FPaths::GetExtension(SourcePath) : Format;
+        Job->DestPath = FPaths::Combine(OutputDirectory, FPaths::GetBaseFilename(SourcePath) + TEXT(".") + Extension);
+
+        UE::Tasks::FTask DecodeTask = UE::Tasks::Launch(TEXT("ShaderModBatchDecode"),
+            [Job, &Counters]() { Decode(*Job, Counters); });
+
+        // Processing is serialized through the pipe since a single image already runs on every worker
+        UE::Tasks::FTask ProcessTask = ProcessPipe.Launch(TEXT("ShaderModBatchProcess"),
+            [Job, &Counters, &EffectParams, RequestedSize]() { Process(*Job, Counters, EffectParams, RequestedSize); },
+            UE::Tasks::Prerequisites(DecodeTask));
+
+        InFlight.Add(UE::Tasks::Launch(TEXT("ShaderModBatchEncode"),
+            [Job, &Counters]() { Encode(*Job, Counters); },
+            UE::Tasks::Prerequisites(ProcessTask)));
+    }
+
+    UE::Tasks::Wait(InFlight);
+    const double Seconds = FMath::Max(FPlatformTime::Seconds() - StartTime, 1.0e-6);
+
+    const double MegabytesRead = Counters.FileBytesRead.load() / (1024.0 * 1024.0);
+    const double MegabytesDecoded = Counters.DecodedBytes.load() / (1024.0 * 1024.0);
+    const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+    UE_LOG(LogTemp, Display, TEXT("ShaderModBatch - %d images written, %d failed in %.2f s"),
+        Counters.NumSucceeded.load(), Counters.NumFailed.load(), Seconds);
+    UE_LOG(LogTemp, Display, TEXT("ShaderModBatch - %.2f images/s, %.1f MB/s read from disk, %.1f MB/s decoded, %.1f MP/s written"),
+        Counters.NumSucceeded.load() / Seconds, MegabytesRead / Seconds, MegabytesDecoded / Seconds, Counters.PixelsWritten.load() / 1.0e6 / Seconds);
+    UE_LOG(LogTemp, Display, TEXT("ShaderModBatch - Peak pipeline memory %.1f MB, peak process memory %.1f MB"),
+        Counters.PeakLiveBytes.load() / (1024.0 * 1024.0), MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0));
+
+    return Counters.NumFailed.load() > 0 ? 1 : 0;
+}
@@ -36,6 +36,12 @@ void FComputeShaderModuleEditor::StartupModule()
 
 void FComputeShaderModuleEditor::OnPostWorldInitialization(UWorld* World, const UWorld::InitializationValues IVS)
 {
+    // Commandlets such as ShaderModBatch run without an editor UI
+    if (IsRunningCommandlet())
+    {
+        return;
+    }
+
     UShaderModSettings* ShaderModSettings = GetMutableDefault<UShaderModSettings>();
     if (ShaderModSettings)
     {
@@ -2,8 +2,10 @@
 #include "Components/Button.h"
 #include "Components/CheckBox.h"
 #include "Components/Slider.h"
+#include "HAL/PlatformTime.h"
+#include "System/ShaderModSettings.h"
 #include "WriteToRenderTarget/WriteToRenderTarget.h"
-#include "WriteToRenderTarget/WriteToRenderTargetLibrary.h"
+#include "WriteToRenderTarget/WriteToRenderTargetSubsystem.h"
 
 void UShaderModWidget::NativeConstruct()
 {
@@ -43,6 +45,54 @@ void UShaderModWidget::NativeConstruct()
     {
         Button_Reset->OnClicked.AddDynamic(this, &UShaderModWidget::OnResetClicked);
     }
+
+    // Releasing a handle refines the preview right away instead of waiting for the refine delay
+    for (USlider* Slider : { Slider_Contrast, Slider_Distortion, Slider_Scaling, Slider_Rotation })
+    {
+        if (Slider)
+        {
+            Slider->OnMouseCaptureEnd.AddDynamic(this, &UShaderModWidget::OnSliderCaptureEnd);
+            Slider->OnControllerCaptureEnd.AddDynamic(this, &UShaderModWidget::OnSliderCaptureEnd);
+        }
+    }
+}
+
+void UShaderModWidget::NativeDestruct()
+{
+    // Never leave the processor rendering at the preview scale
+    RefinePreview();
+
+    Super::NativeDestruct();
+}
+
+void UShaderModWidget::NativeTick(const FGeometry& MyGeometry, float InDeltaTime)
+{
+    Super::NativeTick(MyGeometry, InDeltaTime);
+
+    // Debounce: refine once the value has settled, even while the handle is still held
+    if (bPreviewActive && FPlatformTime::Seconds() - LastPreviewChangeTime >= GetDefault<UShaderModSettings>()->PreviewRefineDelay)
+    {
+        RefinePreview();
+    }
+}
+
+void UShaderModWidget::BindToProcessor(FWriteToRenderTargetHandle Handle)
+{
+    RefinePreview();
+    ProcessorHandle = Handle;
+    WriteToRenderTargetInstance = nullptr;
+
+    // Show the parameters of the newly bound processor
+    if (CheckWriteToRenderTargetInstance())
+    {
+        const FWriteToRenderTargetEffectParams Params = WriteToRenderTargetInstance->GetEffectParams();
+        CheckBox_InvertColors->SetIsChecked(Params.bInvertColors);
+        CheckBox_Grayscale->SetIsChecked(Params.bGreyscale);
+        Slider_Contrast->SetValue(Params.Contrast);
+        Slider_Distortion->SetValue(Params.DistortionStrength);
+        Slider_Scaling->SetValue(Params.ImageScale);
+        Slider_Rotation->SetValue(Params.RotationAngle);
+    }
 }
 
 void UShaderModWidget::OnInvertColorsChanged(bool bIsChecked)
@@ -65,6 +115,7 @@ void UShaderModWidget::OnContrastChanged(float Value)
 {
     if (CheckWriteToRenderTargetInstance())
     {
+        BeginPreview();
         WriteToRenderTargetInstance->SetContrast(Value);
     }
 }
@@ -73,6 +124,7 @@ void UShaderModWidget::OnDistortionChanged(float Value)
 {
     if (CheckWriteToRenderTargetInstance())
     {
+        BeginPreview();
         WriteToRenderTargetInstance->SetDistortionStrength(Value);
     }
 }
@@ -81,6 +133,7 @@ void UShaderModWidget::OnScalingChanged(float Value)
 {
     if (CheckWriteToRenderTargetInstance())
     {
+        BeginPreview();
         WriteToRenderTargetInstance->SetImageScale(Value);
     }
 }
@@ -89,6 +142,7 @@ void UShaderModWidget::OnRotationChanged(float Value)
 {
     if (CheckWriteToRenderTargetInstance())
     {
+        BeginPreview();
         WriteToRenderTargetInstance->SetRotationAngle(Value);
     }
 }
@@ -98,6 +152,38 @@ void UShaderModWidget::OnResetClicked()
     ResetShaderParameters();
 }
 
+void UShaderModWidget::OnSliderCaptureEnd()
+{
+    RefinePreview();
+}
+
+void UShaderModWidget::BeginPreview()
+{
+    const UShaderModSettings* Settings = GetDefault<UShaderModSettings>();
+    if (!Settings->bProgressivePreview)
+    {
+        return;
+    }
+
+    WriteToRenderTargetInstance->SetPreviewScale(Settings->PreviewScale);
+    bPreviewActive = true;
+    LastPreviewChangeTime = FPlatformTime::Seconds();
+}
+
+void UShaderModWidget::RefinePreview()
+{
+    if (!bPreviewActive)
+    {
+        return;
+    }
+
+    bPreviewActive = false;
+    if (CheckWriteToRenderTargetInstance())
+    {
+        WriteToRenderTargetInstance->SetPreviewScale(1.0f);
+    }
+}
+
 void UShaderModWidget::ResetShaderParameters()
 {
     // Reset all parameters to their default values
@@ -114,18 +200,26 @@ void UShaderModWidget::ResetShaderParameters()
     OnDistortionChanged(0.0f);
     OnScalingChanged(1.0f);
     OnRotationChanged(90.0f);
+
+    // A reset is not an interaction, show the result at full resolution right away
+    RefinePreview();
 }
 
 bool UShaderModWidget::CheckWriteToRenderTargetInstance()
 {
+    UWriteToRenderTargetSubsystem* Subsystem = UWriteToRenderTargetSubsystem::Get();
+    if (!Subsystem)
+    {
+        return false;
+    }
+
+    // Resolve the handle every time, the bound processor may have been released in the meantime
+    const FWriteToRenderTargetHandle Handle = ProcessorHandle.IsValid() ? ProcessorHandle : Subsystem->GetDefaultProcessor();
+    WriteToRenderTargetInstance = Subsystem->GetProcessor(Handle);
     if (!WriteToRenderTargetInstance)
     {
-        WriteToRenderTargetInstance = UWriteToRenderTargetLibrary::WriteToRenderTargetInstance;
-        if (!WriteToRenderTargetInstance)
-        {
-            UE_LOG(LogTemp, Warning, TEXT("WriteToRenderTargetInstance is null. Shader operations cannot be performed."));
-            return false;
-        }
+        UE_LOG(LogTemp, Warning, TEXT("Processor %d does not exist. Shader operations cannot be performed."), Handle.Id);
+        return false;
     }
     return true;
 }
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ShaderModBatchCommandlet.generated.h"
+
+/*
+ * Applies a WriteToRenderTarget parameter preset to a directory or manifest of PNG/EXR/TGA images and writes the results.
+ * Images go through a decode -> process -> encode pipeline on the task system: decoding and encoding of different images
+ * overlap with processing, at most MaxInFlight images are held in memory, and processing runs on the CPU backend
+ * one image at a time (each image already uses every core), so no GPU is needed.
+ * With -Size, an image of another size is resized to it with the Box filter (UWriteToRenderTarget's default ResampleFilter)
+ * before the kernel runs, as the editor and runtime do; a preset with bResampleInKernel samples it in the kernel instead.
+ *
+ * Usage: UnrealEditor-Cmd <Project> -run=ShaderModBatch -nullrhi
+ *     -Input=<Directory> | -Manifest=<File with one image path per line>
+ *     -Output=<Directory> [-Preset=<FWriteToRenderTargetEffectParams as JSON>]
+ *     [-Size=<Width>x<Height>] [-Format=png|exr|tga|same] [-MaxInFlight=<N>]
+ */
+UCLASS()
+class COMPUTESHADERMODULEEDITOR_API UShaderModBatchCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UShaderModBatchCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -18,6 +18,18 @@ public:
 	UPROPERTY(EditAnywhere, config, Category = "Shader Mod")
 	bool bEnableShaderMod;
 
+	// Dispatch at PreviewScale while a Shader Mod slider moves, and at full resolution once it settles or is released
+	UPROPERTY(EditAnywhere, config, Category = "Shader Mod|Preview")
+	bool bProgressivePreview = true;
+
+	// Fraction of the render target size shaded during interaction, stretched over the whole target
+	UPROPERTY(EditAnywhere, config, Category = "Shader Mod|Preview", meta = (ClampMin = "0.05", ClampMax = "1.0", EditCondition = "bProgressivePreview"))
+	float PreviewScale = 0.25f;
+
+	// Seconds a slider value has to stay unchanged before the full resolution refinement is dispatched
+	UPROPERTY(EditAnywhere, config, Category = "Shader Mod|Preview", meta = (ClampMin = "0.0", ClampMax = "5.0", Units = "s", EditCondition = "bProgressivePreview"))
+	float PreviewRefineDelay = 0.2f;
+
 	// Delegate to notify when settings change
 	FOnShaderModSettingsChanged OnShaderModSettingsChanged;
 
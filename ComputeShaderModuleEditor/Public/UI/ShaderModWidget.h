@@ -2,11 +2,14 @@
 
 #include "CoreMinimal.h"
 #include "EditorUtilityWidget.h"
+#include "WriteToRenderTarget/WriteToRenderTargetTypes.h"
 #include "ShaderModWidget.generated.h"
 
 /*
  * Is an editor utility widget that provides a user interface for controlling the parameters of the compute shader.
  * Includes checkboxes and sliders for modifying color and deformation effects.
+ * While a slider moves the processor dispatches a reduced resolution preview, refined to full resolution once the value
+ * has not changed for UShaderModSettings::PreviewRefineDelay or the handle is released (UShaderModSettings::bProgressivePreview).
  */
 
 class UWriteToRenderTarget;
@@ -18,6 +21,18 @@ class COMPUTESHADERMODULEEDITOR_API UShaderModWidget : public UEditorUtilityWidg
 
 public:
 	virtual void NativeConstruct() override;
+	virtual void NativeDestruct() override;
+	virtual void NativeTick(const FGeometry& MyGeometry, float InDeltaTime) override;
+
+	/*
+	 * Makes the widget drive the given processor of UWriteToRenderTargetSubsystem.
+	 * An invalid handle binds the widget to the default processor used by ExecuteRTComputeShader.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "ShaderMod")
+	void BindToProcessor(FWriteToRenderTargetHandle Handle);
+
+	UFUNCTION(BlueprintPure, Category = "ShaderMod")
+	FWriteToRenderTargetHandle GetBoundProcessor() const { return ProcessorHandle; }
 
 protected:
 	UPROPERTY(meta = (BindWidget))
@@ -62,10 +77,27 @@ protected:
 	UFUNCTION()
 	void OnResetClicked();
 
+	// Mouse or controller released a slider handle
+	UFUNCTION()
+	void OnSliderCaptureEnd();
+
 private:
 	void ResetShaderParameters();
 	bool CheckWriteToRenderTargetInstance();
 
+	// Switches the bound processor to the preview scale for the slider change about to be applied
+	void BeginPreview();
+
+	// Returns the bound processor to full resolution, which dispatches the refined image
+	void RefinePreview();
+
+	bool bPreviewActive = false;
+	double LastPreviewChangeTime = 0.0;
+
+	// Processor driven by the controls, the default processor when unset
+	UPROPERTY(EditAnywhere, Category = "ShaderMod")
+	FWriteToRenderTargetHandle ProcessorHandle;
+
 	UPROPERTY()
 	UWriteToRenderTarget* WriteToRenderTargetInstance;
 };